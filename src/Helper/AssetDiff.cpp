@@ -0,0 +1,320 @@
+#include "AssetDiff.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "../Misc/Json.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+#include "../Things/ItemTypeFields.h"
+
+namespace {
+    constexpr uint32_t SPRITE_JOB_IDS = 8192;
+
+    const char* const THING_NAMES[] = {"items", "outfits", "effects", "missiles"};
+
+    bool sameRecord(const AssetFiles::Record& a, const AssetFiles::Record& b, size_t skip = 0) {
+        if (a.size != b.size) {
+            return false;
+        }
+        return a.size <= skip || std::memcmp(a.data + skip, b.data + skip, a.size - skip) == 0;
+    }
+
+    void appendChanges(std::string& out, const AssetDiff::IdChanges& changes) {
+        out += "{\"added\": ";
+        Json::appendIds(out, changes.added);
+        out += ", \"removed\": ";
+        Json::appendIds(out, changes.removed);
+        out += ", \"modified\": ";
+        Json::appendIds(out, changes.modified);
+        out += '}';
+    }
+
+    void appendSide(std::string& out, const AssetDiff::SideInfo& side) {
+        out += "{\"spr\": ";
+        Json::appendString(out, side.paths.spr);
+        out += ", \"dat\": ";
+        Json::appendString(out, side.paths.dat);
+        out += fmt::format(", \"sprSignature\": {}, \"datSignature\": {}, \"protocol\": \"{}\", \"sprites\": {}, "
+                           "\"items\": {}, \"outfits\": {}, \"effects\": {}, \"missiles\": {}}}",
+                           side.sprSignature, side.datSignature, side.profile, side.spriteCount, side.itemCount,
+                           side.thingCounts[THING_OUTFIT], side.thingCounts[THING_EFFECT], side.thingCounts[THING_MISSILE]);
+    }
+
+    AssetDiff::SideInfo describe(const AssetFiles& files) {
+        AssetDiff::SideInfo side;
+        side.paths = {files.getSprPath(), files.getDatPath()};
+        side.sprSignature = files.getSprSignature();
+        side.datSignature = files.getDatHeader().signature;
+        side.profile = DatFormat::PROFILE_NAMES[files.getProfileId()];
+        side.spriteCount = files.getSpriteCount();
+        side.itemCount = files.getItems().empty() ? 0 : 99 + static_cast<uint32_t>(files.getItems().size());
+        for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+            side.thingCounts[category] = files.getThingCount(category);
+        }
+        return side;
+    }
+}
+
+AssetDiff::~AssetDiff() {
+    cancel();
+}
+
+std::shared_ptr<AssetDiff::Comparison> AssetDiff::open(const Paths& base, const Paths& target, const AssetFormat& format,
+                                                       std::string& error) {
+    auto comparison = std::make_shared<Comparison>();
+    if (!comparison->base.openSpr(base.spr, format, error) || !comparison->target.openSpr(target.spr, format, error)) {
+        return nullptr;
+    }
+    comparison->result.base.paths = base;
+    comparison->result.target.paths = target;
+    return comparison;
+}
+
+std::vector<JobHandle> AssetDiff::schedule(const std::shared_ptr<Comparison>& comparison) {
+    auto jobSystem = JobSystem::getInstance();
+    std::vector<JobHandle> jobs;
+    comparison->start = std::chrono::steady_clock::now();
+
+    // Both .dat at once, items can only be compared once both are there
+    std::vector<JobHandle> datJobs;
+    for (AssetFiles* files : {&comparison->base, &comparison->target}) {
+        const bool isBase = files == &comparison->base;
+        datJobs.push_back(jobSystem->schedule("Reading .dat", [comparison, files, isBase](Job& job) {
+            std::string datError;
+            const Paths& paths = isBase ? comparison->result.base.paths : comparison->result.target.paths;
+            if (!files->readDat(paths.dat, files->getFormat(), datError)) {
+                job.fail(datError);
+                return;
+            }
+            ++comparison->doneCount;
+        }));
+    }
+    jobs.insert(jobs.end(), datJobs.begin(), datJobs.end());
+    jobs.push_back(jobSystem->schedule("Comparing items", [comparison](Job& job) {
+        compareThings(*comparison, job);
+    }, datJobs));
+
+    const uint32_t lastId = std::max(comparison->base.getSpriteCount(), comparison->target.getSpriteCount());
+    comparison->spriteChunks.assign((lastId + SPRITE_JOB_IDS - 1) / SPRITE_JOB_IDS, IdChanges());
+    comparison->totalCount = lastId + 3;
+    for (size_t chunk = 0; chunk < comparison->spriteChunks.size(); ++chunk) {
+        const auto first = static_cast<uint32_t>(chunk * SPRITE_JOB_IDS) + 1;
+        const uint32_t last = std::min(lastId, first + SPRITE_JOB_IDS - 1);
+        jobs.push_back(jobSystem->schedule("Comparing sprites", [comparison, chunk, first, last](Job& job) {
+            compareSprites(*comparison, chunk, first, last, job);
+        }));
+    }
+
+    std::vector<JobHandle> dependencies = jobs;
+    jobs.push_back(jobSystem->schedule("Collecting diff", [comparison](Job&) {
+        collect(*comparison);
+    }, dependencies));
+    return jobs;
+}
+
+std::shared_ptr<AssetDiff::Comparison> AssetDiff::run(const Paths& base, const Paths& target, const AssetFormat& format,
+                                                      std::string& error) {
+    auto comparison = open(base, target, format, error);
+    if (!comparison) {
+        return nullptr;
+    }
+
+    auto jobs = schedule(comparison);
+    JobSystem::getInstance()->waitIdle();
+    if (jobs.back()->getStatus() != Job::Status::DONE) {
+        error = getChainError(jobs);
+        return nullptr;
+    }
+    return comparison;
+}
+
+void AssetDiff::compareSprites(Comparison& comparison, size_t chunk, uint32_t first, uint32_t last, Job& job) {
+    const AssetFiles& base = comparison.base;
+    const AssetFiles& target = comparison.target;
+    IdChanges& changes = comparison.spriteChunks[chunk];
+    std::vector<uint8_t> scratch;
+
+    for (uint32_t id = first; id <= last; ++id) {
+        if (id > base.getSpriteCount()) {
+            changes.added.push_back(id);
+        } else if (id > target.getSpriteCount()) {
+            changes.removed.push_back(id);
+        } else {
+            // Color key bytes aren't used, a record that only differs in them is the same sprite
+            AssetFiles::Record baseRecord = base.getSpriteRecord(id);
+            AssetFiles::Record targetRecord = target.getSpriteRecord(id);
+            if (!sameRecord(baseRecord, targetRecord, 3) && base.hashSprite(id, scratch) != target.hashSprite(id, scratch)) {
+                changes.modified.push_back(id);
+            }
+        }
+
+        if ((id - first) % 256 == 255) {
+            if (job.isCancelled()) {
+                return;
+            }
+            comparison.doneCount += 256;
+            job.setProgress(id - first + 1, last - first + 1);
+        }
+    }
+    comparison.doneCount += (last - first + 1) % 256;
+}
+
+void AssetDiff::compareThings(Comparison& comparison, Job& job) {
+    const AssetFiles& base = comparison.base;
+    const AssetFiles& target = comparison.target;
+    Result& result = comparison.result;
+
+    // Raw records first, only items whose bytes differ get compared field by field
+    const auto itemCount = static_cast<uint32_t>(std::max(base.getItems().size(), target.getItems().size()));
+    for (uint32_t id = 100; id < 100 + itemCount; ++id) {
+        const ItemType* baseItem = base.getItem(id);
+        const ItemType* targetItem = target.getItem(id);
+        if (!baseItem) {
+            result.itemsAdded.push_back(id);
+        } else if (!targetItem) {
+            result.itemsRemoved.push_back(id);
+        } else if (!sameRecord(base.getDatRecord(THING_ITEM, id), target.getDatRecord(THING_ITEM, id))) {
+            if (uint32_t fields = ItemTypeFields::diff(*baseItem, *targetItem)) {
+                result.itemsModified.push_back({id, fields});
+            }
+        }
+        if (job.isCancelled()) {
+            return;
+        }
+    }
+
+    for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        IdChanges& changes = result.things[category];
+        const uint32_t count = std::max(base.getThingCount(category), target.getThingCount(category));
+        for (uint32_t id = 1; id <= count; ++id) {
+            if (id > base.getThingCount(category)) {
+                changes.added.push_back(id);
+            } else if (id > target.getThingCount(category)) {
+                changes.removed.push_back(id);
+            } else if (!sameRecord(base.getDatRecord(category, id), target.getDatRecord(category, id))) {
+                changes.modified.push_back(id);
+            }
+        }
+    }
+    ++comparison.doneCount;
+}
+
+void AssetDiff::collect(Comparison& comparison) {
+    Result& result = comparison.result;
+    // Chunks are in id order, so the lists come out ascending
+    for (auto& chunk : comparison.spriteChunks) {
+        result.sprites.added.insert(result.sprites.added.end(), chunk.added.begin(), chunk.added.end());
+        result.sprites.removed.insert(result.sprites.removed.end(), chunk.removed.begin(), chunk.removed.end());
+        result.sprites.modified.insert(result.sprites.modified.end(), chunk.modified.begin(), chunk.modified.end());
+    }
+    comparison.spriteChunks.clear();
+
+    result.base = describe(comparison.base);
+    result.target = describe(comparison.target);
+    result.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - comparison.start).count();
+    comparison.doneCount = comparison.totalCount;
+}
+
+std::string AssetDiff::getChainError(const std::vector<JobHandle>& jobs) {
+    for (const auto& job : jobs) {
+        if (job->getStatus() == Job::Status::FAILED) {
+            return job->getError();
+        }
+    }
+    return "Got cancelled.";
+}
+
+bool AssetDiff::start(const Paths& base, const Paths& target, const AssetFormat& format, std::string& startError) {
+    if (comparison) {
+        startError = "Already comparing.";
+        return false;
+    }
+
+    auto newComparison = open(base, target, format, startError);
+    if (!newComparison) {
+        return false;
+    }
+    jobs = schedule(newComparison);
+    comparison = std::move(newComparison);
+    error.clear();
+    return true;
+}
+
+void AssetDiff::update() {
+    if (!comparison || !jobs.back()->isFinished()) {
+        return;
+    }
+
+    if (jobs.back()->getStatus() == Job::Status::DONE) {
+        // Only the result is kept, that lets go of both mapped .spr
+        result = std::make_shared<const Result>(std::move(comparison->result));
+        fmt::print("Compared assets in {:.0f} ms: {} sprites, {} items changed\n", result->ms, result->sprites.size(),
+                   result->itemsAdded.size() + result->itemsRemoved.size() + result->itemsModified.size());
+    } else {
+        error = getChainError(jobs);
+        Warninger::sendWarning(FUNC_NAME, "Comparing assets failed: " + error);
+    }
+    comparison.reset();
+    jobs.clear();
+}
+
+void AssetDiff::cancel() {
+    for (const auto& job : jobs) {
+        job->cancel();
+    }
+    // Jobs still running keep the comparison alive themselves
+    comparison.reset();
+    jobs.clear();
+}
+
+float AssetDiff::getProgress() const {
+    if (!comparison || comparison->totalCount == 0) {
+        return 1.0f;
+    }
+    return std::min(1.0f, static_cast<float>(comparison->doneCount) / static_cast<float>(comparison->totalCount));
+}
+
+bool AssetDiff::writeJson(const Result& result, const std::string& path) {
+    std::string json = "{\n  \"base\": ";
+    appendSide(json, result.base);
+    json += ",\n  \"target\": ";
+    appendSide(json, result.target);
+    json += ",\n  \"sprites\": ";
+    appendChanges(json, result.sprites);
+
+    json += ",\n  \"items\": {\"added\": ";
+    Json::appendIds(json, result.itemsAdded);
+    json += ", \"removed\": ";
+    Json::appendIds(json, result.itemsRemoved);
+    json += ", \"modified\": [";
+    for (size_t i = 0; i < result.itemsModified.size(); ++i) {
+        const ItemChange& change = result.itemsModified[i];
+        json += fmt::format("{}\n    {{\"id\": {}, \"fields\": [", i > 0 ? "," : "", change.id);
+        bool first = true;
+        for (uint32_t bit = 0; bit < ItemTypeFields::FIELD_COUNT; ++bit) {
+            if (change.fields & (1u << bit)) {
+                json += fmt::format("{}\"{}\"", first ? "" : ", ", ItemTypeFields::NAMES[bit]);
+                first = false;
+            }
+        }
+        json += "]}";
+    }
+    json += result.itemsModified.empty() ? "]}" : "\n  ]}";
+
+    for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        json += fmt::format(",\n  \"{}\": ", THING_NAMES[category]);
+        appendChanges(json, result.things[category]);
+    }
+    json += "\n}\n";
+
+    if (path == "-") {
+        fmt::print("{}", json);
+        return true;
+    }
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open() || !file.write(json.data(), static_cast<std::streamsize>(json.size()))) {
+        Warninger::sendWarning(FUNC_NAME, "Failed to write " + path);
+        return false;
+    }
+    return true;
+}
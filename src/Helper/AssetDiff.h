@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AssetFiles.h"
+#include "JobSystem.h"
+
+/**
+ * @brief What changed between two .spr/.dat pairs (base -> target)
+ *
+ * Both pairs are read straight from disk (AssetFiles), nothing gets loaded into AssetsManager or the GPU.
+ * Sprites are compared id by id as jobs over chunks of ids: byte-identical records are the same without
+ * decoding anything, the rest gets decoded and compared by content hash - so a sprite that only got
+ * encoded differently isn't a change. Items are compared field by field (ItemTypeFields),
+ * outfits, effects and missiles by their raw .dat records.
+ */
+class AssetDiff {
+public:
+    struct Paths {
+        std::string spr;
+        std::string dat;
+    };
+
+    struct IdChanges {
+        std::vector<uint32_t> added;   // only in target
+        std::vector<uint32_t> removed; // only in base
+        std::vector<uint32_t> modified;
+
+        [[nodiscard]] size_t size() const { return added.size() + removed.size() + modified.size(); }
+    };
+
+    struct ItemChange {
+        uint32_t id = 0;
+        uint32_t fields = 0; // ItemTypeFields::Field bits
+    };
+
+    struct SideInfo {
+        Paths paths;
+        uint32_t sprSignature = 0;
+        uint32_t datSignature = 0;
+        const char* profile = "";
+        uint32_t spriteCount = 0;
+        uint32_t itemCount = 0; // highest item id
+        std::array<uint32_t, THING_CATEGORY_COUNT> thingCounts{}; // outfits, effects and missiles
+    };
+
+    struct Result {
+        SideInfo base;
+        SideInfo target;
+        IdChanges sprites;
+        std::vector<uint32_t> itemsAdded;
+        std::vector<uint32_t> itemsRemoved;
+        std::vector<ItemChange> itemsModified; // ascending ids
+        std::array<IdChanges, THING_CATEGORY_COUNT> things; // THING_ITEM stays empty, items are above
+        float ms = 0.0f;
+    };
+
+    // Shared with the jobs. Others (patches, merges) can schedule theirs after the last diff job and use the files.
+    struct Comparison {
+        AssetFiles base;
+        AssetFiles target;
+        Result result;
+        std::vector<IdChanges> spriteChunks; // by sprite job, put together once they're all done
+        std::atomic<size_t> doneCount{0};
+        size_t totalCount = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    AssetDiff() = default;
+    ~AssetDiff();
+
+    AssetDiff(const AssetDiff&) = delete;
+    AssetDiff& operator=(const AssetDiff&) = delete;
+
+    // Opens both .spr (the .dat are read by the jobs), false with 'error' set if either can't be opened
+    static std::shared_ptr<Comparison> open(const Paths& base, const Paths& target, const AssetFormat& format, std::string& error);
+    // Schedules the whole comparison, the result is complete once the last of the returned jobs is DONE
+    static std::vector<JobHandle> schedule(const std::shared_ptr<Comparison>& comparison);
+    // Runs it all and waits for it (command line), nullptr with 'error' set if it failed
+    static std::shared_ptr<Comparison> run(const Paths& base, const Paths& target, const AssetFormat& format, std::string& error);
+
+    // UI thread. False with 'error' set if the files can't be opened or it's already comparing.
+    bool start(const Paths& base, const Paths& target, const AssetFormat& format, std::string& error);
+    // UI thread, once per frame - picks up the result
+    void update();
+    void cancel();
+
+    [[nodiscard]] bool isRunning() const { return comparison != nullptr; }
+    [[nodiscard]] float getProgress() const;
+    // Last finished diff, nullptr if there's none yet
+    [[nodiscard]] const std::shared_ptr<const Result>& getResult() const { return result; }
+    [[nodiscard]] const std::string& getError() const { return error; }
+
+    // Whole result as JSON, path "-" = stdout. False if the file couldn't be written.
+    static bool writeJson(const Result& result, const std::string& path);
+    // Error of the first job of the chain that didn't get done
+    static std::string getChainError(const std::vector<JobHandle>& jobs);
+private:
+    static void compareSprites(Comparison& comparison, size_t chunk, uint32_t first, uint32_t last, Job& job);
+    static void compareThings(Comparison& comparison, Job& job);
+    static void collect(Comparison& comparison);
+
+    std::shared_ptr<Comparison> comparison;
+    std::vector<JobHandle> jobs; // last one collects
+    std::shared_ptr<const Result> result;
+    std::string error;
+};
@@ -0,0 +1,355 @@
+#include "AssetDiffWindow.h"
+#include <ctime>
+#include <imgui.h>
+#include "AssetPatch.h"
+#include "SavedData.h"
+#include "../Misc/tools.h"
+#include "../Things/ItemTypeFields.h"
+#include "misc/cpp/imgui_stdlib.h"
+
+namespace {
+    const char* const CHANGE_NAMES[] = {"added", "removed", "modified"};
+
+    // Row of added, then removed, then modified ids
+    void getChangeRow(const AssetDiff::IdChanges& changes, size_t row, uint32_t& id, const char*& kind) {
+        const std::vector<uint32_t>* lists[] = {&changes.added, &changes.removed, &changes.modified};
+        for (size_t list = 0; list < 3; ++list) {
+            if (row < lists[list]->size()) {
+                id = (*lists[list])[row];
+                kind = CHANGE_NAMES[list];
+                return;
+            }
+            row -= lists[list]->size();
+        }
+    }
+
+    void drawChangeList(const char* childId, const AssetDiff::IdChanges& changes) {
+        if (changes.size() == 0) {
+            ImGui::TextDisabled("No changes.");
+            return;
+        }
+
+        ImGui::BeginChild(childId, ImVec2(0, 0), true);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(changes.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                uint32_t id = 0;
+                const char* kind = "";
+                getChangeRow(changes, static_cast<size_t>(i), id, kind);
+                ImGui::Text("%6u  %s", id, kind);
+            }
+        }
+        ImGui::EndChild();
+    }
+
+    std::string describeFields(uint32_t fields) {
+        std::string text;
+        for (uint32_t bit = 0; bit < ItemTypeFields::FIELD_COUNT; ++bit) {
+            if (fields & (1u << bit)) {
+                text += text.empty() ? "" : ", ";
+                text += ItemTypeFields::NAMES[bit];
+            }
+        }
+        return text;
+    }
+}
+
+AssetDiffWindow::AssetDiffWindow(AssetsManager* assetsManager) : assetsManager(assetsManager) {
+    auto savedData = SavedData::getInstance();
+    basePaths = {savedData->getDataString("diffBaseSpr"), savedData->getDataString("diffBaseDat")};
+    targetPaths = {savedData->getDataString("diffTargetSpr"), savedData->getDataString("diffTargetDat")};
+    patchPath = savedData->getDataString("diffPatch");
+    patchOutput = {savedData->getDataString("diffPatchOutSpr"), savedData->getDataString("diffPatchOutDat")};
+}
+
+void AssetDiffWindow::toggle() {
+    visible = !visible;
+    if (visible && !diff.isRunning()) {
+        useLoadedFormat();
+    }
+}
+
+void AssetDiffWindow::useLoadedFormat() {
+    const AssetsInfo& info = assetsManager->m_assetsInfo;
+    format.extended = info.extended;
+    format.transparency = info.transparency;
+    format.frameDurations = info.frameDurations;
+    format.frameGroups = info.frameGroups;
+    format.dimension = static_cast<uint32_t>(assetsManager->getSpriteDimensionsVector()[info.dimensionIndex]);
+    format.fallbackProfile = info.versionIndex;
+}
+
+void AssetDiffWindow::draw() {
+    diff.update();
+    updatePatch();
+    if (!visible) {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(560, 520), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Compare Assets (F4)", &visible)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("Base:");
+    drawPathInput("Spr##DiffBaseSpr", "diffBaseSpr", basePaths.spr, "spr");
+    drawPathInput("Dat##DiffBaseDat", "diffBaseDat", basePaths.dat, "dat");
+    ImGui::Text("Target:");
+    drawPathInput("Spr##DiffTargetSpr", "diffTargetSpr", targetPaths.spr, "spr");
+    drawPathInput("Dat##DiffTargetDat", "diffTargetDat", targetPaths.dat, "dat");
+    drawFormatOptions();
+
+    ImGui::Separator();
+    if (diff.isRunning()) {
+        ImGui::Text("Comparing...");
+        ImGui::ProgressBar(diff.getProgress(), ImVec2(300, 0));
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel##DiffCancel")) {
+            diff.cancel();
+        }
+    } else if (ImGui::Button("Compare##DiffStart")) {
+        std::string error;
+        status = diff.start(basePaths, targetPaths, format, error) ? "" : error;
+    }
+
+    if (!diff.isRunning() && !diff.getError().empty()) {
+        ImGui::TextWrapped("%s", diff.getError().c_str());
+    }
+    if (!status.empty()) {
+        ImGui::TextWrapped("%s", status.c_str());
+    }
+    drawPatch();
+    if (diff.getResult()) {
+        drawResult(*diff.getResult());
+    }
+
+    ImGui::End();
+}
+
+void AssetDiffWindow::drawPathInput(const char* label, const char* key, std::string& path, const char* extension) {
+    ImGui::PushID(key);
+    ImGui::PushItemWidth(380);
+    if (ImGui::InputText(label, &path)) {
+        SavedData::getInstance()->setDataString(key, path);
+    }
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    if (ImGui::Button("Browse")) {
+        auto chosen = Tools::openFileDialog({extension});
+        if (!chosen.empty()) {
+            path = chosen;
+            SavedData::getInstance()->setDataString(key, path);
+        }
+    }
+    ImGui::PopID();
+}
+
+void AssetDiffWindow::drawFormatOptions() {
+    ImGui::Checkbox("Extended##DiffExtended", &format.extended);
+    ImGui::SameLine();
+    ImGui::Checkbox("Transparency##DiffTransparency", &format.transparency);
+    ImGui::SameLine();
+    ImGui::Checkbox("Frame Durations##DiffFrameDurations", &format.frameDurations);
+    ImGui::SameLine();
+    ImGui::Checkbox("Frame Groups##DiffFrameGroups", &format.frameGroups);
+
+    const auto& dimensions = assetsManager->getSpriteDimensionsVector();
+    std::string currentLabel = std::to_string(format.dimension) + "x" + std::to_string(format.dimension);
+    ImGui::PushItemWidth(100);
+    if (ImGui::BeginCombo("Sprite Dimension##DiffDimension", currentLabel.c_str())) {
+        for (int dimension : dimensions) {
+            std::string label = std::to_string(dimension) + "x" + std::to_string(dimension);
+            bool isSelected = static_cast<uint32_t>(dimension) == format.dimension;
+            if (ImGui::Selectable(label.c_str(), isSelected)) {
+                format.dimension = static_cast<uint32_t>(dimension);
+            }
+            if (isSelected) {
+                ImGui::SetItemDefaultFocus();
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    if (ImGui::Button("Use Loaded##DiffUseLoadedFormat")) {
+        useLoadedFormat();
+    }
+}
+
+void AssetDiffWindow::drawPatch() {
+    if (!ImGui::CollapsingHeader("Patch##DiffPatch")) {
+        return;
+    }
+
+    drawPathInput("Patch##DiffPatchPath", "diffPatch", patchPath, "otpatch");
+    if (!patchJobs.empty()) {
+        ImGui::Text("%s...", patchJobs.back()->getName().c_str());
+        ImGui::ProgressBar(patchJobs.back()->getProgress(), ImVec2(300, 0));
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel##DiffPatchCancel")) {
+            for (const auto& job : patchJobs) {
+                job->cancel();
+            }
+        }
+    } else {
+        if (ImGui::Button("Create (Base -> Target)##DiffPatchCreate")) {
+            createPatch();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Apply to Base##DiffPatchApply")) {
+            applyPatch();
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("In Place##DiffPatchInPlace", &patchInPlace);
+    }
+    if (!patchInPlace) {
+        drawPathInput("Spr##DiffPatchOutSpr", "diffPatchOutSpr", patchOutput.spr, "spr");
+        drawPathInput("Dat##DiffPatchOutDat", "diffPatchOutDat", patchOutput.dat, "dat");
+    }
+    if (!patchStatus.empty()) {
+        ImGui::TextWrapped("%s", patchStatus.c_str());
+    }
+}
+
+void AssetDiffWindow::createPatch() {
+    if (patchPath.empty()) {
+        patchStatus = "Choose where the patch goes.";
+        return;
+    }
+
+    std::string error;
+    auto comparison = AssetDiff::open(basePaths, targetPaths, format, error);
+    if (!comparison) {
+        patchStatus = error;
+        return;
+    }
+    patchJobs = AssetDiff::schedule(comparison);
+    patchJobs.push_back(JobSystem::getInstance()->schedule("Writing patch", [comparison, path = patchPath](Job& job) {
+        std::string writeError;
+        if (!AssetPatch::write(*comparison, path, writeError)) {
+            job.fail(writeError);
+        }
+    }, {patchJobs.back()}));
+    patchDoneMessage = "Wrote " + patchPath;
+    patchStatus.clear();
+}
+
+void AssetDiffWindow::applyPatch() {
+    if (!patchInPlace && (patchOutput.spr.empty() || patchOutput.dat.empty())) {
+        patchStatus = "Choose both output files, or apply in place.";
+        return;
+    }
+
+    auto patch = std::make_shared<AssetPatch>();
+    std::string error;
+    if (!patch->load(patchPath, error)) {
+        patchStatus = error;
+        return;
+    }
+    AssetDiff::Paths output = patchInPlace ? AssetDiff::Paths() : patchOutput;
+    patchJobs = {JobSystem::getInstance()->schedule("Applying patch", [patch, base = basePaths, output](Job& job) {
+        std::string applyError;
+        if (!patch->apply(base, output, applyError, &job)) {
+            job.fail(applyError);
+        }
+    })};
+    patchDoneMessage = "Patched " + (patchInPlace ? basePaths.spr : patchOutput.spr);
+    patchStatus.clear();
+}
+
+void AssetDiffWindow::updatePatch() {
+    if (patchJobs.empty() || !patchJobs.back()->isFinished()) {
+        return;
+    }
+
+    patchStatus = patchJobs.back()->getStatus() == Job::Status::DONE ? patchDoneMessage : AssetDiff::getChainError(patchJobs);
+    patchJobs.clear();
+}
+
+void AssetDiffWindow::drawResult(const AssetDiff::Result& result) {
+    ImGui::Separator();
+    ImGui::Text("%u -> %u sprites, %u -> %u items (%.0f ms)", result.base.spriteCount, result.target.spriteCount,
+                result.base.itemCount, result.target.itemCount, result.ms);
+    ImGui::SameLine();
+    if (ImGui::Button("Export JSON##DiffExport")) {
+        std::string folder = Tools::openFileDialogChooseFolder();
+        if (!folder.empty()) {
+            char name[64];
+            std::time_t now = std::time(nullptr);
+            std::strftime(name, sizeof(name), "assets_diff_%Y%m%d_%H%M%S.json", std::localtime(&now));
+            std::string path = folder + "/" + name;
+            status = AssetDiff::writeJson(result, path) ? "Exported to " + path : "Couldn't write " + path;
+        }
+    }
+
+    if (ImGui::BeginTable("DiffSummary", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("");
+        ImGui::TableSetupColumn("Added");
+        ImGui::TableSetupColumn("Removed");
+        ImGui::TableSetupColumn("Modified");
+        ImGui::TableHeadersRow();
+
+        auto row = [](const char* name, size_t added, size_t removed, size_t modified) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", added);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", removed);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", modified);
+        };
+        row("Sprites", result.sprites.added.size(), result.sprites.removed.size(), result.sprites.modified.size());
+        row("Items", result.itemsAdded.size(), result.itemsRemoved.size(), result.itemsModified.size());
+        const char* thingNames[] = {"", "Outfits", "Effects", "Missiles"};
+        for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+            const auto& changes = result.things[category];
+            row(thingNames[category], changes.added.size(), changes.removed.size(), changes.modified.size());
+        }
+        ImGui::EndTable();
+    }
+
+    if (!ImGui::BeginTabBar("DiffTabs")) {
+        return;
+    }
+    if (ImGui::BeginTabItem("Sprites##DiffSpritesTab")) {
+        drawChangeList("DiffSprites", result.sprites);
+        ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Items##DiffItemsTab")) {
+        // Added, removed, then modified ones with the fields that changed
+        const size_t addedCount = result.itemsAdded.size();
+        const size_t removedCount = result.itemsRemoved.size();
+        ImGui::BeginChild("DiffItems", ImVec2(0, 0), true);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(addedCount + removedCount + result.itemsModified.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                const auto row = static_cast<size_t>(i);
+                if (row < addedCount) {
+                    ImGui::Text("%6u  added", result.itemsAdded[row]);
+                } else if (row < addedCount + removedCount) {
+                    ImGui::Text("%6u  removed", result.itemsRemoved[row - addedCount]);
+                } else {
+                    const auto& change = result.itemsModified[row - addedCount - removedCount];
+                    ImGui::Text("%6u  modified: %s", change.id, describeFields(change.fields).c_str());
+                }
+            }
+        }
+        ImGui::EndChild();
+        ImGui::EndTabItem();
+    }
+    for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        const char* tabNames[] = {"", "Outfits##DiffOutfitsTab", "Effects##DiffEffectsTab", "Missiles##DiffMissilesTab"};
+        if (ImGui::BeginTabItem(tabNames[category])) {
+            ImGui::PushID(category);
+            drawChangeList("DiffThings", result.things[category]);
+            ImGui::PopID();
+            ImGui::EndTabItem();
+        }
+    }
+    ImGui::EndTabBar();
+}
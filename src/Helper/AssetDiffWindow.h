@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "AssetDiff.h"
+#include "JobSystem.h"
+#include "../ResourceManagers/AssetsManager.h"
+
+/**
+ * @brief Window comparing two .spr/.dat pairs on disk (F4)
+ *
+ * Works on files only, whatever is loaded stays as it is - the loaded assets only give the default format.
+ * Paths are remembered in SavedData, the result can be exported as the same JSON the command line writes.
+ * Patches get made from base -> target and applied to the base, in place or into new files.
+ */
+class AssetDiffWindow {
+public:
+    explicit AssetDiffWindow(AssetsManager* assetsManager);
+
+    void toggle();
+    [[nodiscard]] bool isVisible() const { return visible; }
+
+    // Main loop, every frame - picks up finished diffs also while hidden
+    void draw();
+private:
+    // Input + Browse button for one file, remembered under 'key'
+    void drawPathInput(const char* label, const char* key, std::string& path, const char* extension);
+    void drawFormatOptions();
+    void drawResult(const AssetDiff::Result& result);
+    void drawPatch();
+    void createPatch();
+    void applyPatch();
+    // Picks up a finished patch job chain
+    void updatePatch();
+    void useLoadedFormat();
+
+    AssetsManager* assetsManager;
+    bool visible = false;
+
+    AssetDiff::Paths basePaths;
+    AssetDiff::Paths targetPaths;
+    AssetFormat format;
+    AssetDiff diff;
+    std::string status;
+
+    std::string patchPath;
+    bool patchInPlace = true;
+    AssetDiff::Paths patchOutput;
+    std::vector<JobHandle> patchJobs; // last one writes/applies the patch
+    std::string patchDoneMessage;
+    std::string patchStatus;
+};
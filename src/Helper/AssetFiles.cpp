@@ -0,0 +1,147 @@
+#include "AssetFiles.h"
+#include <algorithm>
+#include <cstring>
+#include "SpriteHashIndex.h"
+#include "../Misc/BinaryReader.h"
+#include "../Misc/SpriteCodec.h"
+#include "../Misc/tools.h"
+
+bool AssetFiles::openSpr(const std::string& path, const AssetFormat& newFormat, std::string& error) {
+    if (!SpriteCodec::withCodec(newFormat.transparency, newFormat.dimension, [](auto) {})) {
+        error = "Sprite dimension " + std::to_string(newFormat.dimension) + " is not supported.";
+        return false;
+    }
+    if (!spr.open(path)) {
+        error = "Couldn't open " + path;
+        return false;
+    }
+
+    sprPath = path;
+    format = newFormat;
+
+    BinaryReader reader(spr.data(), spr.size());
+    sprSignature = reader.readU32();
+    SpriteCodec::withSprLayout(format.extended, [&](auto layout) {
+        spriteCount = static_cast<uint32_t>(reader.read<typename decltype(layout)::CountType>());
+    });
+    offsetsStart = reader.tell();
+    if (reader.overflowed() || offsetsStart + 4ull * spriteCount > spr.size()) {
+        error = "Offset table of " + path + " is cut off.";
+        spr.close();
+        return false;
+    }
+    return true;
+}
+
+AssetFiles::Record AssetFiles::getSpriteRecord(uint32_t id) const {
+    if (id == 0 || id > spriteCount) {
+        return {};
+    }
+
+    uint32_t offset = 0;
+    std::memcpy(&offset, spr.data() + offsetsStart + 4ull * (id - 1), 4);
+    if (offset == 0 || static_cast<uint64_t>(offset) + 5 > spr.size()) {
+        return {};
+    }
+    uint16_t dataSize = 0;
+    std::memcpy(&dataSize, spr.data() + offset + 3, 2);
+    return {spr.data() + offset, std::min<size_t>(5 + static_cast<size_t>(dataSize), spr.size() - offset)};
+}
+
+void AssetFiles::decodeSprite(uint32_t id, uint8_t* out) const {
+    const size_t rgbaSize = static_cast<size_t>(format.dimension) * format.dimension * 4;
+    Record record = getSpriteRecord(id);
+    if (record.size == 0) {
+        std::memset(out, 0, rgbaSize);
+        return;
+    }
+
+    SpriteCodec::withCodec(format.transparency, format.dimension, [&](auto codec) {
+        using Codec = decltype(codec);
+        Codec::decode(record.data + 5, record.size - 5, out);
+    });
+}
+
+uint64_t AssetFiles::hashSprite(uint32_t id, std::vector<uint8_t>& scratch) const {
+    scratch.resize(static_cast<size_t>(format.dimension) * format.dimension * 4);
+    decodeSprite(id, scratch.data());
+    return SpriteHashIndex::hashPixels(scratch.data(), scratch.size());
+}
+
+bool AssetFiles::readDat(const std::string& path, const AssetFormat& newFormat, std::string& error) {
+    if (!Tools::readFileBytes(path, datData)) {
+        error = "Couldn't read " + path;
+        return false;
+    }
+    datPath = path;
+
+    const auto* data = reinterpret_cast<const uint8_t*>(datData.data());
+    const DatFormat::ParseOptions options = newFormat.getParseOptions();
+    profileId = DatFormat::findProfile(data, datData.size(), options);
+    if (profileId < 0) {
+        profileId = newFormat.fallbackProfile;
+    }
+
+    BinaryReader reader(data, datData.size());
+    datHeader = DatFormat::readHeader(reader);
+    items.clear();
+    items.reserve(datHeader.itemCount >= 100 ? datHeader.itemCount - 99 : 0);
+    for (auto& starts : recordStarts) {
+        starts.clear();
+    }
+    for (auto& categoryThings : things) {
+        categoryThings.clear();
+    }
+
+    std::string parseError;
+    bool parsed = DatFormat::withProfile(profileId, [&](auto profile) {
+        using Profile = decltype(profile);
+        // Every record ends where the next one starts
+        recordStarts[THING_ITEM].push_back(static_cast<uint32_t>(reader.tell()));
+        bool ok = DatFormat::parseItems<Profile>(reader, datHeader, options,
+                                                 []() { return std::make_shared<ItemType>(); },
+                                                 [&](std::shared_ptr<ItemType> itemType) {
+                                                     items.push_back(std::move(itemType));
+                                                     recordStarts[THING_ITEM].push_back(static_cast<uint32_t>(reader.tell()));
+                                                 },
+                                                 parseError);
+
+        const std::pair<ThingCategory_t, uint16_t> thingCategories[] = {
+                {THING_OUTFIT, datHeader.outfitCount},
+                {THING_EFFECT, datHeader.effectCount},
+                {THING_MISSILE, datHeader.missileCount},
+        };
+        for (const auto& [category, count] : thingCategories) {
+            if (!ok) {
+                break;
+            }
+            recordStarts[category].push_back(static_cast<uint32_t>(reader.tell()));
+            ok = DatFormat::parseThings<Profile>(reader, category, count, options,
+                                                 []() { return std::make_shared<ThingType>(std::pmr::get_default_resource()); },
+                                                 [&, category = category](std::shared_ptr<ThingType> thingType) {
+                                                     things[category].push_back(std::move(thingType));
+                                                     recordStarts[category].push_back(static_cast<uint32_t>(reader.tell()));
+                                                 },
+                                                 parseError);
+        }
+        return ok;
+    });
+
+    format = newFormat;
+    if (!parsed) {
+        error = "Failed to read " + path + " as " + DatFormat::PROFILE_NAMES[profileId] + ": " + parseError;
+        return false;
+    }
+    return true;
+}
+
+AssetFiles::Record AssetFiles::getDatRecord(ThingCategory_t category, uint32_t id) const {
+    const uint32_t firstId = category == THING_ITEM ? 100 : 1;
+    const auto& starts = recordStarts[category];
+    if (id < firstId || id - firstId + 1 >= starts.size()) {
+        return {};
+    }
+
+    const uint32_t index = id - firstId;
+    return {reinterpret_cast<const uint8_t*>(datData.data()) + starts[index], starts[index + 1] - starts[index]};
+}
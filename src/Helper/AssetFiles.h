@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "../Things/DatFormat.h"
+#include "../Things/ItemType.h"
+
+// How a .spr/.dat pair is laid out - what AssetsInfo says for the loaded assets
+struct AssetFormat {
+    bool extended = false;
+    bool transparency = false;
+    bool frameDurations = false;
+    bool frameGroups = false;
+    uint32_t dimension = 32;
+    int fallbackProfile = 0; // DatFormat::ProfileId, if the .dat's protocol can't be detected
+
+    [[nodiscard]] DatFormat::ParseOptions getParseOptions() const {
+        DatFormat::ParseOptions options;
+        options.extended = extended;
+        options.frameDurations = frameDurations;
+        options.frameGroups = frameGroups;
+        return options;
+    }
+};
+
+/**
+ * @brief A .spr/.dat pair as it is on disk, read without touching AssetsManager or any texture
+ *
+ * The .spr is memory mapped and only its header is read up front, records are found through the offset
+ * table when asked for - so opening even a huge file is instant and any thread can read sprites at once.
+ * The .dat is read whole (a few MB) and parsed into ItemTypes/ThingTypes of its own, with where every thing's
+ * record is, so things can be compared or copied as raw bytes.
+ */
+class AssetFiles {
+public:
+    // Bytes of a sprite record in .spr or of a thing in .dat (flags up to the last sprite id)
+    struct Record {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    // UI thread or any, false with 'error' set if the .spr can't be read
+    bool openSpr(const std::string& path, const AssetFormat& format, std::string& error);
+    // Any thread, false with 'error' set if the .dat can't be read or parsed to the end
+    bool readDat(const std::string& path, const AssetFormat& format, std::string& error);
+
+    [[nodiscard]] const std::string& getSprPath() const { return sprPath; }
+    [[nodiscard]] const std::string& getDatPath() const { return datPath; }
+    [[nodiscard]] const AssetFormat& getFormat() const { return format; }
+
+    [[nodiscard]] uint32_t getSprSignature() const { return sprSignature; }
+    // Highest sprite id
+    [[nodiscard]] uint32_t getSpriteCount() const { return spriteCount; }
+    // Raw record of a sprite (3 bytes color key, u16 size, RLE data), size 0 if it's blank or out of range
+    [[nodiscard]] Record getSpriteRecord(uint32_t id) const;
+    // dimension^2 RGBA pixels into 'out', all zero for blank sprites. Any thread.
+    void decodeSprite(uint32_t id, uint8_t* out) const;
+    // SpriteHashIndex::hashPixels() of the decoded sprite, 'scratch' gets resized to fit the pixels
+    [[nodiscard]] uint64_t hashSprite(uint32_t id, std::vector<uint8_t>& scratch) const;
+
+    [[nodiscard]] const DatFormat::Header& getDatHeader() const { return datHeader; }
+    [[nodiscard]] int getProfileId() const { return profileId; }
+    // Index = item id - 100
+    [[nodiscard]] const std::vector<std::shared_ptr<ItemType>>& getItems() const { return items; }
+    [[nodiscard]] const ItemType* getItem(uint32_t id) const {
+        return id >= 100 && id - 100 < items.size() ? items[id - 100].get() : nullptr;
+    }
+    // Number of things of the category, items counted from 100 like the rest counts from 1
+    [[nodiscard]] uint32_t getThingCount(ThingCategory_t category) const {
+        return static_cast<uint32_t>(recordStarts[category].empty() ? 0 : recordStarts[category].size() - 1);
+    }
+    // Outfit, effect or missile by id (from 1), nullptr if there's no such thing
+    [[nodiscard]] const ThingType* getThing(ThingCategory_t category, uint32_t id) const {
+        return category != THING_ITEM && id >= 1 && id <= things[category].size() ? things[category][id - 1].get() : nullptr;
+    }
+    // Item ids start at 100, the rest at 1. Empty record if there's no such thing.
+    [[nodiscard]] Record getDatRecord(ThingCategory_t category, uint32_t id) const;
+    [[nodiscard]] const std::vector<char>& getDatData() const { return datData; }
+private:
+    std::string sprPath;
+    std::string datPath;
+    AssetFormat format;
+
+    MappedFile spr;
+    uint32_t sprSignature = 0;
+    uint32_t spriteCount = 0;
+    size_t offsetsStart = 0;
+
+    std::vector<char> datData;
+    DatFormat::Header datHeader;
+    int profileId = 0;
+    std::vector<std::shared_ptr<ItemType>> items;
+    std::array<std::vector<std::shared_ptr<ThingType>>, THING_CATEGORY_COUNT> things; // THING_ITEM stays empty
+    // Per category, offset of every record in datData and where the last one ends
+    std::array<std::vector<uint32_t>, THING_CATEGORY_COUNT> recordStarts;
+};
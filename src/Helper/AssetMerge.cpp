@@ -0,0 +1,570 @@
+#include "AssetMerge.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include "AtomicFileWriter.h"
+#include "../Misc/BinaryWriter.h"
+#include "../Misc/Json.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+#include "../Things/ItemTypeFields.h"
+
+namespace {
+    constexpr uint32_t HASH_JOB_IDS = 8192;
+
+    // Which side changed a base sprite/thing
+    enum Sides : uint8_t {
+        OURS = 1 << 0,
+        THEIRS = 1 << 1,
+    };
+
+    const char* const KIND_NAMES[] = {"sprite", "item", "outfit", "effect", "missile"};
+    const char* const THING_NAMES[] = {"items", "outfits", "effects", "missiles"};
+
+    bool sameRecord(const AssetFiles::Record& a, const AssetFiles::Record& b) {
+        return a.size == b.size && (a.size == 0 || std::memcmp(a.data, b.data, a.size) == 0);
+    }
+
+    bool samePath(const std::string& a, const std::string& b) {
+        std::error_code error;
+        return std::filesystem::weakly_canonical(a, error) == std::filesystem::weakly_canonical(b, error);
+    }
+
+    // Value of whichever side changed it, ours if both did
+    template<typename T>
+    T pick(T base, T ours, T theirs) {
+        return ours != base ? ours : theirs;
+    }
+
+    void appendRemaps(std::string& out, const std::vector<AssetMerge::Remap>& remaps) {
+        out += '[';
+        for (size_t i = 0; i < remaps.size(); ++i) {
+            out += fmt::format("{}[{},{}]", i > 0 ? "," : "", remaps[i].from, remaps[i].to);
+        }
+        out += ']';
+    }
+}
+
+std::shared_ptr<AssetMerge::Merge> AssetMerge::open(const AssetDiff::Paths& base, const AssetDiff::Paths& ours,
+                                                    const AssetDiff::Paths& theirs, const AssetDiff::Paths& output,
+                                                    const AssetFormat& format, std::string& error) {
+    for (const AssetDiff::Paths* input : {&base, &ours, &theirs}) {
+        if (samePath(output.spr, input->spr) || samePath(output.dat, input->dat)) {
+            error = "The merge has to go to new files, not over " + input->spr + " or " + input->dat;
+            return nullptr;
+        }
+    }
+
+    auto merge = std::make_shared<Merge>();
+    merge->ours = AssetDiff::open(base, ours, format, error);
+    merge->theirs = merge->ours ? AssetDiff::open(base, theirs, format, error) : nullptr;
+    if (!merge->theirs) {
+        return nullptr;
+    }
+    merge->result.output = output;
+    return merge;
+}
+
+std::vector<JobHandle> AssetMerge::schedule(const std::shared_ptr<Merge>& merge) {
+    auto jobSystem = JobSystem::getInstance();
+    merge->start = std::chrono::steady_clock::now();
+
+    // Both diffs at once, their sprite jobs already hash whatever isn't byte-identical on all cores
+    std::vector<JobHandle> jobs = AssetDiff::schedule(merge->ours);
+    std::vector<JobHandle> diffsDone = {jobs.back()};
+    std::vector<JobHandle> theirsJobs = AssetDiff::schedule(merge->theirs);
+    diffsDone.push_back(theirsJobs.back());
+    jobs.insert(jobs.end(), theirsJobs.begin(), theirsJobs.end());
+
+    // Sprites changed on both sides and appended ones get hashed again, the diffs don't keep their hashes
+    const uint32_t oursCount = merge->ours->target.getSpriteCount();
+    const uint32_t theirsCount = merge->theirs->target.getSpriteCount();
+    merge->oursHashes.assign(oursCount + 1, 0);
+    merge->theirsHashes.assign(theirsCount + 1, 0);
+    std::vector<JobHandle> hashJobs = diffsDone;
+    const uint32_t lastId = std::max(oursCount, theirsCount);
+    for (uint32_t first = 1; first <= lastId; first += HASH_JOB_IDS) {
+        const uint32_t last = std::min(lastId, first + HASH_JOB_IDS - 1);
+        hashJobs.push_back(jobSystem->schedule("Hashing sprites", [merge, first, last](Job& job) {
+            hashSprites(*merge, first, last, job);
+        }, diffsDone));
+    }
+    jobs.insert(jobs.end(), hashJobs.begin() + 2, hashJobs.end());
+
+    JobHandle merging = jobSystem->schedule("Merging", [merge](Job& job) {
+        mergeSprites(*merge);
+        std::string error;
+        if (!mergeDat(*merge, error)) {
+            job.fail(error);
+        }
+    }, hashJobs);
+    jobs.push_back(merging);
+
+    JobHandle writingSpr = jobSystem->schedule("Writing .spr", [merge](Job& job) {
+        std::string error;
+        if (!writeSpr(*merge, error, job)) {
+            job.fail(error);
+        }
+    }, {merging});
+    JobHandle writingDat = jobSystem->schedule("Writing .dat", [merge](Job& job) {
+        const std::string& path = merge->result.output.dat;
+        AtomicFileWriter out(path);
+        out.write(merge->datData.data(), merge->datData.size());
+        if (!out.commit()) {
+            job.fail("Failed to write " + path);
+        }
+    }, {merging});
+    jobs.push_back(writingSpr);
+    jobs.push_back(writingDat);
+
+    jobs.push_back(jobSystem->schedule("Finishing merge", [merge](Job&) {
+        merge->result.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - merge->start).count();
+    }, {writingSpr, writingDat}));
+    return jobs;
+}
+
+std::shared_ptr<AssetMerge::Merge> AssetMerge::run(const AssetDiff::Paths& base, const AssetDiff::Paths& ours,
+                                                   const AssetDiff::Paths& theirs, const AssetDiff::Paths& output,
+                                                   const AssetFormat& format, std::string& error) {
+    auto merge = open(base, ours, theirs, output, format, error);
+    if (!merge) {
+        return nullptr;
+    }
+
+    auto jobs = schedule(merge);
+    JobSystem::getInstance()->waitIdle();
+    if (jobs.back()->getStatus() != Job::Status::DONE) {
+        error = AssetDiff::getChainError(jobs);
+        return nullptr;
+    }
+    return merge;
+}
+
+void AssetMerge::hashSprites(Merge& merge, uint32_t first, uint32_t last, Job& job) {
+    const AssetFiles& ours = merge.ours->target;
+    const AssetFiles& theirs = merge.theirs->target;
+    const uint32_t baseCount = merge.ours->base.getSpriteCount();
+    const auto& oursModified = merge.ours->result.sprites.modified;
+    const auto& theirsModified = merge.theirs->result.sprites.modified;
+    // Appended sprites are only compared if both sides appended some
+    const bool bothAppended = ours.getSpriteCount() > baseCount && theirs.getSpriteCount() > baseCount;
+    std::vector<uint8_t> scratch;
+
+    for (uint32_t id = first; id <= last; ++id) {
+        if (id <= baseCount) {
+            if (std::binary_search(oursModified.begin(), oursModified.end(), id) &&
+                std::binary_search(theirsModified.begin(), theirsModified.end(), id)) {
+                merge.oursHashes[id] = ours.hashSprite(id, scratch);
+                merge.theirsHashes[id] = theirs.hashSprite(id, scratch);
+            }
+        } else if (bothAppended) {
+            if (id <= ours.getSpriteCount()) {
+                merge.oursHashes[id] = ours.hashSprite(id, scratch);
+            }
+            if (id <= theirs.getSpriteCount()) {
+                merge.theirsHashes[id] = theirs.hashSprite(id, scratch);
+            }
+        }
+
+        if ((id - first) % 256 == 255) {
+            if (job.isCancelled()) {
+                return;
+            }
+            job.setProgress(id - first + 1, last - first + 1);
+        }
+    }
+}
+
+void AssetMerge::mergeSprites(Merge& merge) {
+    const AssetFiles& base = merge.ours->base;
+    const AssetFiles& ours = merge.ours->target;
+    const AssetFiles& theirs = merge.theirs->target;
+    const uint32_t baseCount = base.getSpriteCount();
+    const uint32_t oursCount = ours.getSpriteCount();
+    const uint32_t theirsCount = theirs.getSpriteCount();
+    Result& result = merge.result;
+    auto& sprites = merge.sprites;
+
+    std::vector<uint8_t> changed(baseCount + 1, 0);
+    for (uint32_t id : merge.ours->result.sprites.modified) {
+        changed[id] |= OURS;
+    }
+    for (uint32_t id : merge.theirs->result.sprites.modified) {
+        changed[id] |= THEIRS;
+    }
+
+    const uint32_t keptCount = std::min(baseCount, std::max(oursCount, theirsCount));
+    sprites.clear();
+    sprites.reserve(static_cast<size_t>(std::max(keptCount, oursCount)) + (theirsCount > baseCount ? theirsCount - baseCount : 0));
+    for (uint32_t id = 1; id <= keptCount; ++id) {
+        if (changed[id] == (OURS | THEIRS) && merge.oursHashes[id] != merge.theirsHashes[id]) {
+            result.conflicts.push_back({Kind::SPRITE, id, 0});
+        }
+        if (changed[id] & OURS) {
+            sprites.emplace_back(&ours, id);
+            ++result.spritesFromOurs;
+        } else if (changed[id] & THEIRS) {
+            sprites.emplace_back(&theirs, id);
+            ++result.spritesFromTheirs;
+        } else {
+            sprites.emplace_back(&base, id);
+        }
+    }
+
+    merge.theirsSprites.assign(theirsCount + 1, 0);
+    for (uint32_t id = 1; id <= std::min(theirsCount, keptCount); ++id) {
+        merge.theirsSprites[id] = id;
+    }
+
+    // Appended by ours keep their ids, appended by theirs go after them unless ours has the same sprite
+    std::unordered_map<uint64_t, uint32_t> oursAppended;
+    for (uint32_t id = baseCount + 1; id <= oursCount; ++id) {
+        sprites.emplace_back(&ours, id);
+        ++result.spritesFromOurs;
+        if (theirsCount > baseCount && ours.getSpriteRecord(id).size > 0) {
+            oursAppended.emplace(merge.oursHashes[id], id);
+        }
+    }
+    for (uint32_t id = baseCount + 1; id <= theirsCount; ++id) {
+        auto found = theirs.getSpriteRecord(id).size > 0 ? oursAppended.find(merge.theirsHashes[id]) : oursAppended.end();
+        uint32_t mergedId = 0;
+        if (found != oursAppended.end()) {
+            mergedId = found->second;
+            ++result.spritesDeduplicated;
+        } else {
+            sprites.emplace_back(&theirs, id);
+            ++result.spritesFromTheirs;
+            mergedId = static_cast<uint32_t>(sprites.size());
+        }
+        merge.theirsSprites[id] = mergedId;
+        if (mergedId != id) {
+            result.spriteRemaps.push_back({id, mergedId});
+        }
+    }
+
+    result.sprSignature = pick(base.getSprSignature(), ours.getSprSignature(), theirs.getSprSignature());
+    result.spriteCount = static_cast<uint32_t>(sprites.size());
+}
+
+bool AssetMerge::mergeDat(Merge& merge, std::string& error) {
+    const AssetFiles& base = merge.ours->base;
+    const AssetFiles& ours = merge.ours->target;
+    const AssetFiles& theirs = merge.theirs->target;
+    if (ours.getProfileId() != base.getProfileId() || theirs.getProfileId() != base.getProfileId()) {
+        error = "Base, ours and theirs .dat have to be of the same protocol.";
+        return false;
+    }
+
+    const DatFormat::ParseOptions options = base.getFormat().getParseOptions();
+    const auto& theirsSprites = merge.theirsSprites;
+    Result& result = merge.result;
+
+    // Records of theirs go as they are, unless any of their sprites got another id
+    auto needsRemap = [&](const auto& ids) {
+        return std::any_of(ids.begin(), ids.end(), [&](uint32_t id) {
+            return id < theirsSprites.size() && theirsSprites[id] != id;
+        });
+    };
+    auto remap = [&](auto& ids) {
+        for (uint32_t& id : ids) {
+            id = id < theirsSprites.size() ? theirsSprites[id] : id;
+        }
+    };
+
+    merge.datData.clear();
+    BinaryWriter writer(merge.datData);
+    DatFormat::Header header;
+    DatFormat::writeHeader(writer, header); // counts get filled in at the end
+    auto writeRaw = [&](const AssetFiles& files, ThingCategory_t category, uint32_t id) {
+        AssetFiles::Record record = files.getDatRecord(category, id);
+        writer.writeBytes(record.data, record.size);
+    };
+
+    bool written = DatFormat::withProfile(base.getProfileId(), [&](auto profile) {
+        using Profile = decltype(profile);
+        auto writeItem = [&](const ItemType& itemType, uint32_t id) {
+            DatFormat::writeFlags<Profile>(writer, itemType);
+            if (!DatFormat::writeTexturesInfo(writer, itemType, options)) {
+                error = "Sprite id too big for non-extended .dat in item " + std::to_string(id);
+                return false;
+            }
+            return true;
+        };
+        auto writeTheirsItem = [&](uint32_t id) {
+            const ItemType& itemType = *theirs.getItem(id);
+            if (!needsRemap(itemType.textureIdsVector)) {
+                writeRaw(theirs, THING_ITEM, id);
+                return true;
+            }
+            ItemType remapped(itemType);
+            remap(remapped.textureIdsVector);
+            return writeItem(remapped, id);
+        };
+        // Field by field, what only theirs changed goes into ours
+        auto writeBothItem = [&](uint32_t id, uint32_t oursFields, uint32_t theirsFields) {
+            using namespace ItemTypeFields;
+            const ItemType& oursItem = *ours.getItem(id);
+            const ItemType& theirsItem = *theirs.getItem(id);
+            const ItemType& baseItem = *base.getItem(id);
+            oursFields |= (oursFields & LAYOUT) ? LAYOUT : 0;
+            theirsFields |= (theirsFields & LAYOUT) ? LAYOUT : 0;
+
+            // Flags merge bit by bit, a bit both flipped has the same value on both sides
+            const uint64_t theirsFlipped = theirsItem.getAllFlags() ^ baseItem.getAllFlags();
+            const uint64_t flags = (oursItem.getAllFlags() & ~theirsFlipped) | (theirsItem.getAllFlags() & theirsFlipped);
+            const uint32_t conflicting = oursFields & theirsFields & ItemTypeFields::diff(oursItem, theirsItem) & ~FLAGS;
+            if (conflicting) {
+                result.conflicts.push_back({Kind::ITEM, id, conflicting});
+            }
+
+            const uint32_t fromTheirs = theirsFields & ~oursFields & ~FLAGS;
+            if (!fromTheirs && flags == oursItem.getAllFlags()) {
+                writeRaw(ours, THING_ITEM, id);
+                return true;
+            }
+            ItemType merged(oursItem);
+            ItemTypeFields::copy(fromTheirs, theirsItem, merged);
+            if (fromTheirs & SPRITES) {
+                remap(merged.textureIdsVector);
+            }
+            merged.setAllFlags(flags);
+            ++result.itemsMerged;
+            return writeItem(merged, id);
+        };
+
+        const auto baseItems = static_cast<uint32_t>(base.getItems().size());
+        const auto oursItems = static_cast<uint32_t>(ours.getItems().size());
+        const auto theirsItems = static_cast<uint32_t>(theirs.getItems().size());
+        std::vector<uint32_t> oursFields(baseItems, 0);
+        std::vector<uint32_t> theirsFields(baseItems, 0);
+        for (const auto& change : merge.ours->result.itemsModified) {
+            oursFields[change.id - 100] = change.fields;
+        }
+        for (const auto& change : merge.theirs->result.itemsModified) {
+            theirsFields[change.id - 100] = change.fields;
+        }
+
+        const uint32_t keptItems = std::min(baseItems, std::max(oursItems, theirsItems));
+        for (uint32_t index = 0; index < keptItems; ++index) {
+            const uint32_t id = 100 + index;
+            bool ok = true;
+            if (!theirsFields[index]) {
+                writeRaw(oursFields[index] ? ours : base, THING_ITEM, id);
+            } else if (!oursFields[index]) {
+                ok = writeTheirsItem(id);
+            } else {
+                ok = writeBothItem(id, oursFields[index], theirsFields[index]);
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+
+        uint32_t itemCount = std::max(keptItems, oursItems);
+        for (uint32_t index = baseItems; index < oursItems; ++index) {
+            writeRaw(ours, THING_ITEM, 100 + index);
+        }
+        for (uint32_t index = baseItems; index < theirsItems; ++index) {
+            const uint32_t id = 100 + index;
+            const uint32_t mergedId = 100 + itemCount++;
+            if (!writeTheirsItem(id)) {
+                return false;
+            }
+            if (mergedId != id) {
+                result.thingRemaps[THING_ITEM].push_back({id, mergedId});
+            }
+        }
+        if (itemCount + 99 > 0xFFFF) {
+            error = "Merged .dat would have more items than it can hold.";
+            return false;
+        }
+        header.itemCount = static_cast<uint16_t>(itemCount > 0 ? itemCount + 99 : 0);
+        return true;
+    });
+    if (!written) {
+        return false;
+    }
+
+    auto writeTheirsThing = [&](ThingCategory_t category, uint32_t id) {
+        const ThingType* thingType = theirs.getThing(category, id);
+        if (!needsRemap(thingType->textureIds)) {
+            writeRaw(theirs, category, id);
+            return true;
+        }
+        auto remapped = std::make_shared<ThingType>(*thingType);
+        remap(remapped->textureIds);
+        return DatFormat::writeThings(writer, category, {remapped}, options, error);
+    };
+
+    std::array<uint32_t, THING_CATEGORY_COUNT> counts{};
+    for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        const uint32_t baseCount = base.getThingCount(category);
+        const uint32_t oursCount = ours.getThingCount(category);
+        const uint32_t theirsCount = theirs.getThingCount(category);
+        const auto kind = static_cast<Kind>(static_cast<uint8_t>(Kind::ITEM) + category);
+
+        std::vector<uint8_t> changed(baseCount + 1, 0);
+        for (uint32_t id : merge.ours->result.things[category].modified) {
+            changed[id] |= OURS;
+        }
+        for (uint32_t id : merge.theirs->result.things[category].modified) {
+            changed[id] |= THEIRS;
+        }
+
+        const uint32_t keptCount = std::min(baseCount, std::max(oursCount, theirsCount));
+        for (uint32_t id = 1; id <= keptCount; ++id) {
+            if (changed[id] == (OURS | THEIRS) && !sameRecord(ours.getDatRecord(category, id), theirs.getDatRecord(category, id))) {
+                result.conflicts.push_back({kind, id, 0});
+            }
+            if (changed[id] & OURS) {
+                writeRaw(ours, category, id);
+            } else if (changed[id] & THEIRS) {
+                if (!writeTheirsThing(category, id)) {
+                    return false;
+                }
+            } else {
+                writeRaw(base, category, id);
+            }
+        }
+
+        uint32_t& count = counts[category];
+        count = std::max(keptCount, oursCount);
+        for (uint32_t id = baseCount + 1; id <= oursCount; ++id) {
+            writeRaw(ours, category, id);
+        }
+        for (uint32_t id = baseCount + 1; id <= theirsCount; ++id) {
+            const uint32_t mergedId = ++count;
+            if (!writeTheirsThing(category, id)) {
+                return false;
+            }
+            if (mergedId != id) {
+                result.thingRemaps[category].push_back({id, mergedId});
+            }
+        }
+        if (count > 0xFFFF) {
+            error = fmt::format("Merged .dat would have more {} than it can hold.", THING_NAMES[category]);
+            return false;
+        }
+    }
+
+    header.signature = pick(base.getDatHeader().signature, ours.getDatHeader().signature, theirs.getDatHeader().signature);
+    header.outfitCount = static_cast<uint16_t>(counts[THING_OUTFIT]);
+    header.effectCount = static_cast<uint16_t>(counts[THING_EFFECT]);
+    header.missileCount = static_cast<uint16_t>(counts[THING_MISSILE]);
+    std::vector<uint8_t> headerData;
+    BinaryWriter headerWriter(headerData);
+    DatFormat::writeHeader(headerWriter, header);
+    std::copy(headerData.begin(), headerData.end(), merge.datData.begin());
+    result.datHeader = header;
+    return true;
+}
+
+bool AssetMerge::writeSpr(const Merge& merge, std::string& error, Job& job) {
+    const AssetFormat& format = merge.ours->base.getFormat();
+    const auto& sprites = merge.sprites;
+    const auto count = static_cast<uint32_t>(sprites.size());
+    const std::string& path = merge.result.output.spr;
+    if (!format.extended && count > 0xFFFF) {
+        error = "Merged .spr has " + std::to_string(count) + " sprites, that needs extended.";
+        return false;
+    }
+
+    auto getRecord = [&](uint32_t index) {
+        const auto& [files, id] = sprites[index];
+        return files ? files->getSpriteRecord(id) : AssetFiles::Record();
+    };
+
+    const size_t headerSize = 4 + (format.extended ? 4 : 2);
+    std::vector<uint32_t> offsets(count, 0);
+    uint64_t position = headerSize + 4ull * count;
+    for (uint32_t index = 0; index < count; ++index) {
+        size_t size = getRecord(index).size;
+        if (size > 0) {
+            offsets[index] = static_cast<uint32_t>(position);
+            position += size;
+        }
+    }
+    if (position > UINT32_MAX) {
+        error = "Merged .spr would be over 4 GB, offsets can't point that far.";
+        return false;
+    }
+
+    AtomicFileWriter out(path);
+    out.writeValue(merge.result.sprSignature);
+    if (format.extended) {
+        out.writeValue(count);
+    } else {
+        out.writeValue(static_cast<uint16_t>(count));
+    }
+    out.write(offsets.data(), offsets.size() * 4);
+    for (uint32_t index = 0; index < count && out.good(); ++index) {
+        AssetFiles::Record record = getRecord(index);
+        out.write(record.data, record.size);
+        if (index % 4096 == 4095) {
+            if (job.isCancelled()) {
+                return true;
+            }
+            job.setProgress(index + 1, count);
+        }
+    }
+    if (!out.commit()) {
+        error = "Failed to write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool AssetMerge::writeJson(const Result& result, const std::string& path) {
+    std::string json = "{\n  \"output\": {\"spr\": ";
+    Json::appendString(json, result.output.spr);
+    json += ", \"dat\": ";
+    Json::appendString(json, result.output.dat);
+    json += fmt::format("}},\n  \"sprSignature\": {}, \"datSignature\": {}, \"sprites\": {}, \"items\": {}, "
+                        "\"outfits\": {}, \"effects\": {}, \"missiles\": {},\n",
+                        result.sprSignature, result.datHeader.signature, result.spriteCount, result.datHeader.itemCount,
+                        result.datHeader.outfitCount, result.datHeader.effectCount, result.datHeader.missileCount);
+    json += fmt::format("  \"spritesFromOurs\": {}, \"spritesFromTheirs\": {}, \"spritesDeduplicated\": {}, "
+                        "\"itemsMerged\": {}, \"ms\": {:.0f},\n",
+                        result.spritesFromOurs, result.spritesFromTheirs, result.spritesDeduplicated,
+                        result.itemsMerged, result.ms);
+
+    json += "  \"remapped\": {\"sprites\": ";
+    appendRemaps(json, result.spriteRemaps);
+    for (ThingCategory_t category : {THING_ITEM, THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        json += fmt::format(", \"{}\": ", THING_NAMES[category]);
+        appendRemaps(json, result.thingRemaps[category]);
+    }
+
+    json += "},\n  \"conflicts\": [";
+    for (size_t i = 0; i < result.conflicts.size(); ++i) {
+        const Conflict& conflict = result.conflicts[i];
+        json += fmt::format("{}\n    {{\"kind\": \"{}\", \"id\": {}", i > 0 ? "," : "",
+                            KIND_NAMES[static_cast<size_t>(conflict.kind)], conflict.id);
+        if (conflict.kind == Kind::ITEM) {
+            json += ", \"fields\": [";
+            bool first = true;
+            for (uint32_t bit = 0; bit < ItemTypeFields::FIELD_COUNT; ++bit) {
+                if (conflict.fields & (1u << bit)) {
+                    json += fmt::format("{}\"{}\"", first ? "" : ", ", ItemTypeFields::NAMES[bit]);
+                    first = false;
+                }
+            }
+            json += ']';
+        }
+        json += '}';
+    }
+    json += result.conflicts.empty() ? "]\n}\n" : "\n  ]\n}\n";
+
+    if (path == "-") {
+        fmt::print("{}", json);
+        return true;
+    }
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open() || !file.write(json.data(), static_cast<std::streamsize>(json.size()))) {
+        Warninger::sendWarning(FUNC_NAME, "Failed to write " + path);
+        return false;
+    }
+    return true;
+}
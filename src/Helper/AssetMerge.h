@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AssetDiff.h"
+#include "AssetFiles.h"
+#include "JobSystem.h"
+
+/**
+ * @brief Three-way merge of two .spr/.dat forks (ours, theirs) of the same base
+ *
+ * Both forks are diffed against the base (AssetDiff, sprites by content hash, items field by field),
+ * then whatever changed on only one side is taken from that side:
+ *   - sprites changed on both sides are the same if their content hashes are, otherwise it's a conflict
+ *   - items changed on both sides are merged field by field (flags bit by bit), fields changed on both
+ *     sides to different values are conflicts; size, patterns, animation and sprites only go together
+ *   - outfits, effects and missiles changed on both sides are conflicts unless the records are the same
+ *   - something is only dropped when both sides dropped it
+ * Conflicts keep ours and get reported. Sprites and things appended by ours keep their ids, the ones
+ * appended by theirs go after them - theirs sprites already appended by ours (same content) aren't added twice,
+ * and sprite ids in everything taken from theirs are remapped to where their sprites ended up.
+ * The output is always a new pair of files, none of the inputs gets touched.
+ */
+class AssetMerge {
+public:
+    enum class Kind : uint8_t {
+        SPRITE,
+        ITEM,
+        OUTFIT,
+        EFFECT,
+        MISSILE,
+    };
+
+    struct Conflict {
+        Kind kind = Kind::SPRITE;
+        uint32_t id = 0;     // in base
+        uint32_t fields = 0; // items, ItemTypeFields both sides changed differently
+    };
+
+    // Id theirs had -> id in the merged files
+    struct Remap {
+        uint32_t from = 0;
+        uint32_t to = 0;
+    };
+
+    struct Result {
+        AssetDiff::Paths output;
+        uint32_t sprSignature = 0;
+        uint32_t spriteCount = 0;
+        DatFormat::Header datHeader;
+        size_t spritesFromOurs = 0;
+        size_t spritesFromTheirs = 0;
+        size_t spritesDeduplicated = 0; // appended by both with the same content
+        size_t itemsMerged = 0;         // changed on both sides, put together field by field
+        std::vector<Remap> spriteRemaps;
+        std::array<std::vector<Remap>, THING_CATEGORY_COUNT> thingRemaps;
+        std::vector<Conflict> conflicts;
+        float ms = 0.0f;
+    };
+
+    // Shared with the jobs
+    struct Merge {
+        std::shared_ptr<AssetDiff::Comparison> ours;   // base -> ours
+        std::shared_ptr<AssetDiff::Comparison> theirs; // base -> theirs
+        // Content hashes by id, only of the sprites the merge has to compare
+        std::vector<uint64_t> oursHashes;
+        std::vector<uint64_t> theirsHashes;
+        // By merged id - 1, where the record comes from (files nullptr = blank sprite)
+        std::vector<std::pair<const AssetFiles*, uint32_t>> sprites;
+        std::vector<uint32_t> theirsSprites; // theirs sprite id -> merged id
+        std::vector<uint8_t> datData; // merged .dat, built whole
+        Result result;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Opens all three .spr, nullptr with 'error' set if any can't be opened
+    static std::shared_ptr<Merge> open(const AssetDiff::Paths& base, const AssetDiff::Paths& ours,
+                                       const AssetDiff::Paths& theirs, const AssetDiff::Paths& output,
+                                       const AssetFormat& format, std::string& error);
+    // Schedules the whole merge, the output is written once the last of the returned jobs is DONE
+    static std::vector<JobHandle> schedule(const std::shared_ptr<Merge>& merge);
+    // Runs it all and waits for it (command line), nullptr with 'error' set if it failed
+    static std::shared_ptr<Merge> run(const AssetDiff::Paths& base, const AssetDiff::Paths& ours,
+                                      const AssetDiff::Paths& theirs, const AssetDiff::Paths& output,
+                                      const AssetFormat& format, std::string& error);
+
+    // Result with every conflict and remapped id as JSON, path "-" = stdout. False if the file couldn't be written.
+    static bool writeJson(const Result& result, const std::string& path);
+private:
+    static void hashSprites(Merge& merge, uint32_t first, uint32_t last, Job& job);
+    static void mergeSprites(Merge& merge);
+    // False with 'error' set if the merged .dat can't be written (different protocols, too many things)
+    static bool mergeDat(Merge& merge, std::string& error);
+    static bool writeSpr(const Merge& merge, std::string& error, Job& job);
+};
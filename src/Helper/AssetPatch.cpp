@@ -0,0 +1,537 @@
+#include "AssetPatch.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include "../Misc/BinaryReader.h"
+#include "../Misc/Hash.h"
+#include "../Misc/tools.h"
+
+namespace {
+    constexpr size_t STAMP_CHUNK = 4 * 1024 * 1024;
+    constexpr uint32_t JOURNAL_MAGIC = 0x4A50544F; // "OTPJ"
+
+    // Kept next to the .spr while it's patched in place
+    std::string getJournalPath(const std::string& sprPath) {
+        return sprPath + ".journal";
+    }
+
+    // Copy of a .dat that gets replaced by an in-place apply
+    std::string getDatBackupPath(const std::string& datPath) {
+        return datPath + ".bak";
+    }
+
+    enum FormatFlags : uint16_t {
+        FLAG_EXTENDED = 1 << 0,
+        FLAG_TRANSPARENCY = 1 << 1,
+        FLAG_FRAME_DURATIONS = 1 << 2,
+        FLAG_FRAME_GROUPS = 1 << 3,
+    };
+
+    uint32_t getFirstId(ThingCategory_t category) {
+        return category == THING_ITEM ? 100 : 1;
+    }
+
+    // Highest id of the category in a .dat header (items count up to their last id)
+    uint32_t getLastId(const DatFormat::Header& header, ThingCategory_t category) {
+        switch (category) {
+            case THING_ITEM: return header.itemCount;
+            case THING_OUTFIT: return header.outfitCount;
+            case THING_EFFECT: return header.effectCount;
+            default: return header.missileCount;
+        }
+    }
+
+    // Walks the sorted entries along with ascending ids
+    const AssetPatch::Entry* findEntry(const std::vector<AssetPatch::Entry>& entries, size_t& next, uint32_t id) {
+        while (next < entries.size() && entries[next].id < id) {
+            ++next;
+        }
+        return next < entries.size() && entries[next].id == id ? &entries[next] : nullptr;
+    }
+
+    void writeEntries(AtomicFileWriter& out, const std::vector<uint32_t>& ids,
+                      const std::function<AssetFiles::Record(uint32_t)>& getRecord) {
+        out.writeValue(static_cast<uint32_t>(ids.size()));
+        for (uint32_t id : ids) {
+            AssetFiles::Record record = getRecord(id);
+            out.writeValue(id);
+            out.writeValue(static_cast<uint32_t>(record.size));
+            out.write(record.data, record.size);
+        }
+    }
+
+    std::vector<uint32_t> changedIds(const AssetDiff::IdChanges& changes) {
+        // Modified ids are all below the added ones
+        std::vector<uint32_t> ids = changes.modified;
+        ids.insert(ids.end(), changes.added.begin(), changes.added.end());
+        return ids;
+    }
+
+    bool samePath(const std::string& a, const std::string& b) {
+        std::error_code error;
+        return std::filesystem::weakly_canonical(a, error) == std::filesystem::weakly_canonical(b, error);
+    }
+}
+
+bool AssetPatch::stampFile(const std::string& path, FileStamp& stamp) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::vector<char> chunk(STAMP_CHUNK);
+    stamp = FileStamp();
+    while (file) {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        auto count = static_cast<size_t>(file.gcount());
+        stamp.crc = Hash::crc32(chunk.data(), count, stamp.crc);
+        stamp.size += count;
+    }
+    return file.eof();
+}
+
+bool AssetPatch::write(const AssetDiff::Comparison& comparison, const std::string& path, std::string& error) {
+    const AssetFiles& base = comparison.base;
+    const AssetFiles& target = comparison.target;
+    const AssetDiff::Result& result = comparison.result;
+    const AssetFormat& format = base.getFormat();
+
+    FileStamp sprStamp;
+    FileStamp datStamp;
+    if (!stampFile(base.getSprPath(), sprStamp) || !stampFile(base.getDatPath(), datStamp)) {
+        error = "Couldn't read the base files.";
+        return false;
+    }
+
+    AtomicFileWriter out(path, 1024 * 1024);
+    uint16_t flags = (format.extended ? FLAG_EXTENDED : 0) | (format.transparency ? FLAG_TRANSPARENCY : 0) |
+                     (format.frameDurations ? FLAG_FRAME_DURATIONS : 0) | (format.frameGroups ? FLAG_FRAME_GROUPS : 0);
+    out.writeValue(MAGIC);
+    out.writeValue(VERSION);
+    out.writeValue(flags);
+    out.writeValue(format.dimension);
+
+    out.writeValue(sprStamp.size);
+    out.writeValue(sprStamp.crc);
+    out.writeValue(datStamp.size);
+    out.writeValue(datStamp.crc);
+
+    const DatFormat::Header& header = target.getDatHeader();
+    out.writeValue(target.getSprSignature());
+    out.writeValue(target.getSpriteCount());
+    out.writeValue(header.signature);
+    out.writeValue(header.itemCount);
+    out.writeValue(header.outfitCount);
+    out.writeValue(header.effectCount);
+    out.writeValue(header.missileCount);
+
+    writeEntries(out, changedIds(result.sprites), [&](uint32_t id) { return target.getSpriteRecord(id); });
+
+    // Items by their raw records too, whatever the fields that changed
+    std::vector<uint32_t> itemIds;
+    for (const auto& change : result.itemsModified) {
+        itemIds.push_back(change.id);
+    }
+    itemIds.insert(itemIds.end(), result.itemsAdded.begin(), result.itemsAdded.end());
+    writeEntries(out, itemIds, [&](uint32_t id) { return target.getDatRecord(THING_ITEM, id); });
+    for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        writeEntries(out, changedIds(result.things[category]), [&](uint32_t id) { return target.getDatRecord(category, id); });
+    }
+
+    if (!out.commit()) {
+        error = "Failed to write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool AssetPatch::load(const std::string& path, std::string& error) {
+    if (!Tools::readFileBytes(path, data)) {
+        error = "Couldn't read " + path;
+        return false;
+    }
+
+    BinaryReader reader(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    uint32_t magic = reader.readU32();
+    uint16_t version = reader.readU16();
+    uint16_t flags = reader.readU16();
+    if (magic != MAGIC || version != VERSION) {
+        error = path + " isn't a patch this version can read.";
+        return false;
+    }
+    format = AssetFormat();
+    format.extended = flags & FLAG_EXTENDED;
+    format.transparency = flags & FLAG_TRANSPARENCY;
+    format.frameDurations = flags & FLAG_FRAME_DURATIONS;
+    format.frameGroups = flags & FLAG_FRAME_GROUPS;
+    format.dimension = reader.readU32();
+
+    baseSpr.size = reader.read<uint64_t>();
+    baseSpr.crc = reader.readU32();
+    baseDat.size = reader.read<uint64_t>();
+    baseDat.crc = reader.readU32();
+
+    sprSignature = reader.readU32();
+    spriteCount = reader.readU32();
+    datHeader = DatFormat::readHeader(reader);
+
+    // Ids have to be ascending and within the target, the appliers rely on it
+    auto readEntries = [&](std::vector<Entry>& entries, uint32_t firstId, uint32_t lastId) {
+        entries.clear();
+        uint32_t count = reader.readU32();
+        for (uint32_t i = 0; i < count && !reader.overflowed(); ++i) {
+            Entry entry;
+            entry.id = reader.readU32();
+            entry.size = reader.readU32();
+            entry.data = reader.current();
+            reader.skip(entry.size);
+            if (entry.id < firstId || entry.id > lastId || (!entries.empty() && entry.id <= entries.back().id)) {
+                return false;
+            }
+            entries.push_back(entry);
+        }
+        return !reader.overflowed();
+    };
+
+    bool valid = readEntries(sprites, 1, spriteCount);
+    for (ThingCategory_t category : {THING_ITEM, THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        valid = valid && readEntries(things[category], getFirstId(category), getLastId(datHeader, category));
+    }
+    // Sprite records have their 5 byte header at least, or nothing for blank sprites
+    valid = valid && std::all_of(sprites.begin(), sprites.end(), [](const Entry& entry) {
+        return entry.size == 0 || entry.size >= 5;
+    });
+    if (!valid) {
+        error = path + " is damaged.";
+        return false;
+    }
+    return true;
+}
+
+bool AssetPatch::apply(const AssetDiff::Paths& base, const AssetDiff::Paths& output, std::string& error, Job* job) const {
+    const bool sprInPlace = output.spr.empty() || samePath(output.spr, base.spr);
+    // An in-place apply that didn't get through puts the base pair back first, the stamps are of that one
+    if (sprInPlace && !rollBack(base.spr, base.dat, error)) {
+        return false;
+    }
+
+    FileStamp sprStamp;
+    FileStamp datStamp;
+    if (!stampFile(base.spr, sprStamp) || !stampFile(base.dat, datStamp)) {
+        error = "Couldn't read the files to patch.";
+        return false;
+    }
+    if (sprStamp.size != baseSpr.size || sprStamp.crc != baseSpr.crc) {
+        error = base.spr + " isn't the .spr this patch was made for.";
+        return false;
+    }
+    if (datStamp.size != baseDat.size || datStamp.crc != baseDat.crc) {
+        error = base.dat + " isn't the .dat this patch was made for.";
+        return false;
+    }
+
+    const std::string datPath = output.dat.empty() ? base.dat : output.dat;
+    AtomicFileWriter datOut(datPath, 1024 * 1024);
+    if (!writeDat(base.dat, datOut, error)) {
+        return false;
+    }
+
+    if (sprInPlace) {
+        return applyInPlace(base.spr, base.dat, datPath, datOut, error, job);
+    }
+    if (!applySprToFile(base.spr, output.spr, error, job)) {
+        return false;
+    }
+    if (!datOut.commit()) {
+        error = "Failed to write " + datPath;
+        std::error_code ec;
+        std::filesystem::remove(output.spr, ec); // no new .spr without its .dat
+        return false;
+    }
+    return true;
+}
+
+bool AssetPatch::rollBack(const std::string& sprPath, const std::string& datPath, std::string& error) {
+    const std::string journalPath = getJournalPath(sprPath);
+    std::error_code ec;
+    if (!std::filesystem::exists(journalPath, ec)) {
+        return true;
+    }
+
+    std::vector<char> journal;
+    if (!Tools::readFileBytes(journalPath, journal)) {
+        error = "Couldn't read " + journalPath + ", " + sprPath + " may be half patched.";
+        return false;
+    }
+    BinaryReader reader(reinterpret_cast<const uint8_t*>(journal.data()), journal.size());
+    const uint32_t magic = reader.read<uint32_t>();
+    const uint64_t oldSize = reader.read<uint64_t>();
+    const uint32_t headSize = reader.read<uint32_t>();
+    const uint8_t* head = reader.current();
+    reader.skip(headSize);
+    if (magic != JOURNAL_MAGIC || reader.overflowed() || headSize > oldSize) {
+        error = journalPath + " is damaged, " + sprPath + " may be half patched.";
+        return false;
+    }
+
+    std::fstream file(sprPath, std::ios::in | std::ios::out | std::ios::binary);
+    file.write(reinterpret_cast<const char*>(head), headSize);
+    file.flush();
+    const bool restored = file.good();
+    file.close();
+    std::filesystem::resize_file(sprPath, oldSize, ec);
+    if (!restored || ec || !AtomicFileWriter::syncFile(sprPath)) {
+        error = "Couldn't restore " + sprPath + " from " + journalPath;
+        return false;
+    }
+
+    const std::string backupPath = getDatBackupPath(datPath);
+    if (std::filesystem::exists(backupPath, ec)) {
+        std::filesystem::rename(backupPath, datPath, ec);
+        if (ec) {
+            error = "Couldn't restore " + datPath + " from " + backupPath;
+            return false;
+        }
+    }
+    // The journal goes last, it's what says the pair needs restoring
+    std::filesystem::remove(journalPath, ec);
+    return true;
+}
+
+bool AssetPatch::writeDat(const std::string& basePath, AtomicFileWriter& out, std::string& error) const {
+    AssetFiles baseFiles;
+    if (!baseFiles.readDat(basePath, format, error)) {
+        return false;
+    }
+
+    out.writeValue(datHeader.signature);
+    out.writeValue(datHeader.itemCount);
+    out.writeValue(datHeader.outfitCount);
+    out.writeValue(datHeader.effectCount);
+    out.writeValue(datHeader.missileCount);
+
+    for (ThingCategory_t category : {THING_ITEM, THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        const auto& entries = things[category];
+        size_t next = 0;
+        for (uint32_t id = getFirstId(category); id <= getLastId(datHeader, category); ++id) {
+            if (const Entry* entry = findEntry(entries, next, id)) {
+                out.write(entry->data, entry->size);
+                continue;
+            }
+
+            AssetFiles::Record record = baseFiles.getDatRecord(category, id);
+            if (record.size == 0) {
+                error = "Patch is missing " + std::to_string(id) + " of .dat category " + std::to_string(category);
+                return false;
+            }
+            out.write(record.data, record.size);
+        }
+    }
+    if (!out.good()) {
+        error = "Failed to write the .dat";
+        return false;
+    }
+    return true;
+}
+
+bool AssetPatch::applySprToFile(const std::string& basePath, const std::string& outputPath, std::string& error, Job* job) const {
+    AssetFiles baseFiles;
+    if (!baseFiles.openSpr(basePath, format, error)) {
+        return false;
+    }
+
+    // Where every record goes, records follow the offset table in id order like compile writes them
+    const size_t headerSize = 4 + (format.extended ? 4 : 2);
+    std::vector<uint32_t> offsets(spriteCount, 0);
+    uint64_t position = headerSize + 4ull * spriteCount;
+    size_t next = 0;
+    for (uint32_t id = 1; id <= spriteCount; ++id) {
+        const Entry* entry = findEntry(sprites, next, id);
+        size_t size = entry ? entry->size : baseFiles.getSpriteRecord(id).size;
+        if (size > 0) {
+            offsets[id - 1] = static_cast<uint32_t>(position);
+            position += size;
+        }
+    }
+    if (position > UINT32_MAX) {
+        error = "Patched .spr would be over 4 GB, offsets can't point that far.";
+        return false;
+    }
+
+    AtomicFileWriter out(outputPath);
+    out.writeValue(sprSignature);
+    if (format.extended) {
+        out.writeValue(spriteCount);
+    } else {
+        out.writeValue(static_cast<uint16_t>(spriteCount));
+    }
+    out.write(offsets.data(), offsets.size() * 4);
+
+    next = 0;
+    for (uint32_t id = 1; id <= spriteCount && out.good(); ++id) {
+        const Entry* entry = findEntry(sprites, next, id);
+        if (entry) {
+            out.write(entry->data, entry->size);
+        } else {
+            AssetFiles::Record record = baseFiles.getSpriteRecord(id);
+            out.write(record.data, record.size);
+        }
+        if (job && id % 4096 == 0) {
+            job->setProgress(id, spriteCount);
+        }
+    }
+    if (!out.commit()) {
+        error = "Failed to write " + outputPath;
+        return false;
+    }
+    return true;
+}
+
+bool AssetPatch::applyInPlace(const std::string& path, const std::string& baseDatPath, const std::string& datPath,
+                              AtomicFileWriter& datOut, std::string& error, Job* job) const {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        error = "Couldn't open " + path + " for writing.";
+        return false;
+    }
+
+    uint32_t oldCount = 0;
+    file.seekg(4);
+    file.read(reinterpret_cast<char*>(&oldCount), format.extended ? 4 : 2);
+    const uint64_t offsetsStart = 4 + (format.extended ? 4 : 2);
+    std::vector<uint32_t> offsets(std::max(oldCount, spriteCount), 0);
+    file.read(reinterpret_cast<char*>(offsets.data()), static_cast<std::streamsize>(4ull * oldCount));
+    if (!file) {
+        error = "Offset table of " + path + " is cut off.";
+        return false;
+    }
+    offsets.resize(spriteCount);
+
+    // A bigger table grows into the first records, those move to the end with the patched ones
+    const uint64_t tableEnd = offsetsStart + 4ull * spriteCount;
+    std::vector<uint8_t> relocated;
+    std::vector<std::pair<uint32_t, uint32_t>> relocatedRecords; // id, size
+    size_t next = 0;
+    for (uint32_t id = 1; id <= std::min(oldCount, spriteCount); ++id) {
+        if (offsets[id - 1] == 0 || offsets[id - 1] >= tableEnd || findEntry(sprites, next, id)) {
+            continue;
+        }
+        uint8_t recordHeader[5];
+        file.seekg(offsets[id - 1]);
+        file.read(reinterpret_cast<char*>(recordHeader), 5);
+        uint16_t dataSize = 0;
+        std::memcpy(&dataSize, recordHeader + 3, 2);
+        size_t start = relocated.size();
+        relocated.resize(start + 5 + dataSize);
+        std::memcpy(relocated.data() + start, recordHeader, 5);
+        file.read(reinterpret_cast<char*>(relocated.data() + start + 5), dataSize);
+        if (!file) {
+            error = "Record of sprite " + std::to_string(id) + " in " + path + " is cut off.";
+            return false;
+        }
+        relocatedRecords.emplace_back(id, static_cast<uint32_t>(5 + dataSize));
+    }
+
+    // Journal of what gets overwritten: the old size (appended records are cut off again)
+    // and the head the new table goes over. Nothing is touched until it's on the disk.
+    file.seekg(0, std::ios::end);
+    const uint64_t oldSize = static_cast<uint64_t>(file.tellg());
+    std::vector<char> head(std::min(oldSize, std::max<uint64_t>(offsetsStart + 4ull * oldCount, tableEnd)));
+    file.seekg(0);
+    file.read(head.data(), static_cast<std::streamsize>(head.size()));
+    if (!file) {
+        error = "Couldn't read " + path;
+        return false;
+    }
+    {
+        AtomicFileWriter journal(getJournalPath(path), 64 * 1024);
+        journal.writeValue(JOURNAL_MAGIC);
+        journal.writeValue(oldSize);
+        journal.writeValue(static_cast<uint32_t>(head.size()));
+        journal.write(head.data(), head.size());
+        if (!journal.commit()) {
+            error = "Couldn't write the journal of " + path + ", nothing was changed.";
+            return false;
+        }
+    }
+
+    // From here on every failure puts the base pair back
+    const bool datInPlace = samePath(datPath, baseDatPath);
+    bool datCommitted = false;
+    auto fail = [&](const std::string& message) {
+        error = message;
+        file.close();
+        if (datCommitted && !datInPlace) {
+            std::error_code ec;
+            std::filesystem::remove(datPath, ec);
+        }
+        std::string rollBackError;
+        if (!rollBack(path, baseDatPath, rollBackError)) {
+            error += " " + rollBackError;
+        }
+        return false;
+    };
+
+    if (datInPlace) {
+        std::error_code ec;
+        const std::string backupPath = getDatBackupPath(baseDatPath);
+        std::filesystem::copy_file(baseDatPath, backupPath, std::filesystem::copy_options::overwrite_existing, ec);
+        if (ec || !AtomicFileWriter::syncFile(backupPath)) {
+            return fail("Couldn't back up " + baseDatPath + ", nothing was changed.");
+        }
+    }
+
+    // Records first - until the table is written, the .spr is still the old one
+    file.seekp(0, std::ios::end);
+    uint64_t position = oldSize;
+    std::fill(offsets.begin() + std::min(oldCount, spriteCount), offsets.end(), 0);
+    size_t written = 0;
+    for (const Entry& entry : sprites) {
+        offsets[entry.id - 1] = entry.size > 0 ? static_cast<uint32_t>(position) : 0;
+        file.write(reinterpret_cast<const char*>(entry.data), entry.size);
+        position += entry.size;
+        if (job && ++written % 4096 == 0) {
+            job->setProgress(written, sprites.size() + relocatedRecords.size());
+        }
+    }
+    const uint8_t* record = relocated.data();
+    for (const auto& [id, size] : relocatedRecords) {
+        offsets[id - 1] = static_cast<uint32_t>(position);
+        file.write(reinterpret_cast<const char*>(record), size);
+        record += size;
+        position += size;
+    }
+    if (position > UINT32_MAX) {
+        return fail("Patched .spr would be over 4 GB, offsets can't point that far.");
+    }
+    file.flush();
+    if (!file || !AtomicFileWriter::syncFile(path)) {
+        return fail("Failed to append the records to " + path);
+    }
+
+    // The .dat switches before the table does, the records it points to are already there
+    if (!datOut.commit()) {
+        return fail("Failed to write " + datPath);
+    }
+    datCommitted = true;
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&sprSignature), 4);
+    file.write(reinterpret_cast<const char*>(&spriteCount), format.extended ? 4 : 2);
+    file.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(4ull * spriteCount));
+    file.flush();
+    if (!file || !AtomicFileWriter::syncFile(path)) {
+        return fail("Failed to write " + path);
+    }
+    file.close();
+
+    // Journal first - a backup left behind is harmless, a journal without its backup isn't
+    std::error_code ec;
+    std::filesystem::remove(getJournalPath(path), ec);
+    if (!ec && datInPlace) {
+        std::filesystem::remove(getDatBackupPath(baseDatPath), ec);
+    }
+    return true;
+}
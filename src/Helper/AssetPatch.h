@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AssetDiff.h"
+#include "AssetFiles.h"
+#include "AtomicFileWriter.h"
+
+/**
+ * @brief Delta between two compiled .spr/.dat pairs, applied without compiling anything
+ *
+ * Holds only what changed: sprite records of added/changed sprites (as they are in the target .spr,
+ * which becomes their new offset table entry) and .dat records of added/changed things.
+ * Both base files are stamped with their size and CRC32, a patch is never applied to anything else.
+ * Layout (little-endian):
+ *   header  - magic "OTPT", u16 version, u16 format flags (AssetFormat), u32 sprite dimension
+ *   base    - u64 .spr size, u32 .spr CRC32, u64 .dat size, u32 .dat CRC32
+ *   target  - u32 .spr signature, u32 sprite count, .dat header (u32 signature, u16 item/outfit/effect/missile counts)
+ *   sprites - u32 count, then u32 id, u32 size, record (size 0 = blank sprite)
+ *   things  - for items, outfits, effects and missiles: u32 count, then u32 id, u32 size, record
+ * Entries are by ascending id. Things past the target counts are dropped, the rest comes from the base.
+ */
+class AssetPatch {
+public:
+    static constexpr uint32_t MAGIC = 0x5450544F; // "OTPT"
+    static constexpr uint16_t VERSION = 1;
+    static constexpr const char* EXTENSION = ".otpatch";
+
+    struct Entry {
+        uint32_t id = 0;
+        const uint8_t* data = nullptr; // into the loaded patch
+        uint32_t size = 0;
+    };
+
+    // Writes the patch of a finished comparison (base -> target), false with 'error' set if it can't
+    static bool write(const AssetDiff::Comparison& comparison, const std::string& path, std::string& error);
+
+    // Reads a whole patch (they are small), false with 'error' set if it isn't a valid one
+    bool load(const std::string& path, std::string& error);
+
+    /**
+     * @brief Turns the base .spr/.dat into the target ones
+     *
+     * With empty output paths the base files get updated in place: changed records are appended to the .spr
+     * and only their offset table entries get rewritten, the records stay where they are otherwise.
+     * Before anything is touched a journal (old .spr size and the head the new table overwrites) and
+     * a copy of an in-place .dat go to the disk. Then the records are appended and synced, the .dat is committed
+     * and the table goes last. Any failure - or the next apply after a crash - puts the old pair back from those.
+     * With output paths the new files are streamed out of the base and the patch, the base stays untouched.
+     * The .dat is always written whole (atomically), it's small.
+     *
+     * @return False with 'error' set if the base files aren't the ones the patch was made for, or on I/O errors.
+     */
+    bool apply(const AssetDiff::Paths& base, const AssetDiff::Paths& output, std::string& error, Job* job = nullptr) const;
+
+    [[nodiscard]] const AssetFormat& getFormat() const { return format; }
+    [[nodiscard]] const std::vector<Entry>& getSprites() const { return sprites; }
+    [[nodiscard]] const std::vector<Entry>& getThings(ThingCategory_t category) const { return things[category]; }
+    [[nodiscard]] size_t getSize() const { return data.size(); }
+private:
+    struct FileStamp {
+        uint64_t size = 0;
+        uint32_t crc = 0;
+    };
+
+    // Size and CRC32 of a file, read in chunks
+    static bool stampFile(const std::string& path, FileStamp& stamp);
+    // Whole target .dat into 'out', committed by the caller once the .spr is done too
+    bool writeDat(const std::string& basePath, AtomicFileWriter& out, std::string& error) const;
+    // Patches the .spr in place and commits 'datOut' along with it, the base pair is restored if that fails
+    bool applyInPlace(const std::string& path, const std::string& baseDatPath, const std::string& datPath,
+                      AtomicFileWriter& datOut, std::string& error, Job* job) const;
+    // Restores the base pair from the journal of an in-place apply that didn't get through, true if there's none
+    static bool rollBack(const std::string& sprPath, const std::string& datPath, std::string& error);
+    bool applySprToFile(const std::string& basePath, const std::string& outputPath, std::string& error, Job* job) const;
+
+    std::vector<char> data; // whole patch file
+    AssetFormat format;
+    FileStamp baseSpr;
+    FileStamp baseDat;
+    uint32_t sprSignature = 0;
+    uint32_t spriteCount = 0;
+    DatFormat::Header datHeader;
+    std::vector<Entry> sprites;
+    std::array<std::vector<Entry>, THING_CATEGORY_COUNT> things;
+};
@@ -0,0 +1,180 @@
+#include "AtomicFileWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include "../Misc/Hash.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+AtomicFileWriter::AtomicFileWriter(const std::string& targetPath, size_t bufferSize)
+        : targetPath(targetPath), tempPath(targetPath + ".tmp") {
+    buffer.resize(std::max<size_t>(bufferSize, 64 * 1024));
+
+    file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Failed to open file for writing: " + tempPath);
+        return;
+    }
+    // We do our own buffering
+    std::setvbuf(file, nullptr, _IONBF, 0);
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+    abort();
+}
+
+bool AtomicFileWriter::write(const void* data, size_t size) {
+    if (!good()) {
+        return false;
+    }
+
+    crc = Hash::crc32(data, size, crc);
+    writtenSize += size;
+
+    // Big chunks go straight to the file, no point copying them into the buffer first
+    if (size >= buffer.size()) {
+        if (!flushBuffer() || std::fwrite(data, 1, size, file) != size) {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    if (bufferUsed + size > buffer.size() && !flushBuffer()) {
+        return false;
+    }
+    std::memcpy(buffer.data() + bufferUsed, data, size);
+    bufferUsed += size;
+    return true;
+}
+
+bool AtomicFileWriter::flushBuffer() {
+    if (bufferUsed == 0) {
+        return true;
+    }
+
+    if (std::fwrite(buffer.data(), 1, bufferUsed, file) != bufferUsed) {
+        failed = true;
+        return false;
+    }
+    bufferUsed = 0;
+    return true;
+}
+
+bool AtomicFileWriter::syncToDisk() {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool AtomicFileWriter::syncFile(const std::string& path) {
+    std::FILE* synced = std::fopen(path.c_str(), "r+b");
+    if (!synced) {
+        return false;
+    }
+#ifdef _WIN32
+    const bool ok = _commit(_fileno(synced)) == 0;
+#else
+    const bool ok = fsync(fileno(synced)) == 0;
+#endif
+    return std::fclose(synced) == 0 && ok;
+}
+
+void AtomicFileWriter::closeFile() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+bool AtomicFileWriter::verifyTempFile() {
+    std::FILE* check = std::fopen(tempPath.c_str(), "rb");
+    if (!check) {
+        return false;
+    }
+
+    uint32_t readCrc = 0;
+    uint64_t readSize = 0;
+    size_t count;
+    while ((count = std::fread(buffer.data(), 1, buffer.size(), check)) > 0) {
+        readCrc = Hash::crc32(buffer.data(), count, readCrc);
+        readSize += count;
+    }
+    bool readFailed = std::ferror(check) != 0;
+    std::fclose(check);
+
+    return !readFailed && readSize == writtenSize && readCrc == crc;
+}
+
+bool AtomicFileWriter::replaceTarget() {
+#ifdef _WIN32
+    return MoveFileExW(std::filesystem::path(tempPath).c_str(), std::filesystem::path(targetPath).c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (std::rename(tempPath.c_str(), targetPath.c_str()) != 0) {
+        return false;
+    }
+
+    // Make the rename itself durable
+    auto directory = std::filesystem::path(targetPath).parent_path();
+    int dirFd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+#endif
+}
+
+bool AtomicFileWriter::commit() {
+    if (!good()) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Writing " + tempPath + " failed, " + targetPath + " is left untouched.");
+        abort();
+        return false;
+    }
+
+    if (!flushBuffer() || !syncToDisk()) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Failed to flush " + tempPath + " (disk full?), " + targetPath + " is left untouched.");
+        abort();
+        return false;
+    }
+    closeFile();
+
+    if (!verifyTempFile()) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Checksum of " + tempPath + " doesn't match what was written, " + targetPath + " is left untouched.");
+        abort();
+        return false;
+    }
+
+    if (!replaceTarget()) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Failed to replace " + targetPath + " with " + tempPath);
+        abort();
+        return false;
+    }
+
+    tempPath.clear(); // nothing left to clean up
+    return true;
+}
+
+void AtomicFileWriter::abort() {
+    closeFile();
+    if (!tempPath.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(tempPath, ec);
+        tempPath.clear();
+    }
+    failed = true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writes a file so that the target is always either the old file or the complete new one
+ *
+ * Everything goes through one big buffer into a temporary file next to the target
+ * (same directory, so the rename stays on the same volume and is atomic).
+ * commit() flushes it to the disk, reads it back to verify the CRC32 of what was written
+ * and only then renames it over the target.
+ * Without a successful commit() the temporary file is removed and the target stays untouched.
+ */
+class AtomicFileWriter {
+public:
+    explicit AtomicFileWriter(const std::string& targetPath, size_t bufferSize = 8 * 1024 * 1024);
+    ~AtomicFileWriter();
+
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return file != nullptr; }
+    // False once any write failed, commit() will refuse to replace the target then
+    [[nodiscard]] bool good() const { return file != nullptr && !failed; }
+
+    bool write(const void* data, size_t size);
+    template<typename T>
+    bool writeValue(const T& value) {
+        return write(&value, sizeof(T));
+    }
+
+    [[nodiscard]] uint64_t getWrittenSize() const { return writtenSize; }
+    [[nodiscard]] uint32_t getChecksum() const { return crc; }
+
+    /**
+     * @brief Finishes the file and swaps it in place of the target
+     *
+     * Flush -> fsync -> read back and compare CRC32/size -> rename over the target.
+     *
+     * @return True if the target now contains exactly what was written.
+     */
+    bool commit();
+    // Drops the temporary file, target stays as it was
+    void abort();
+
+    // Flushes an existing file (written in place by someone else) to the disk
+    static bool syncFile(const std::string& path);
+private:
+    bool flushBuffer();
+    bool syncToDisk();
+    bool verifyTempFile();
+    bool replaceTarget();
+    void closeFile();
+
+    std::string targetPath;
+    std::string tempPath;
+    std::FILE* file = nullptr;
+
+    std::vector<char> buffer;
+    size_t bufferUsed = 0;
+
+    uint32_t crc = 0;
+    uint64_t writtenSize = 0;
+    bool failed = false;
+};
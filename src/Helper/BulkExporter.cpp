@@ -0,0 +1,392 @@
+#include "BulkExporter.h"
+#include <cstring>
+#include <filesystem>
+#include <imgui.h>
+#include "../Misc/SpriteCodec.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+#include "../Things/ItfArchive.h"
+#include "../Things/Items.h"
+
+namespace {
+    // More than this just floods the console, the count is reported at the end anyway
+    constexpr size_t MAX_LOGGED_FAILURES = 20;
+    // Sprites/items per job, the scheduling costs next to nothing then and a cancel still stops them quickly
+    constexpr size_t EXPORTS_PER_JOB = 256;
+}
+
+BulkExporter::~BulkExporter() {
+    cancel();
+}
+
+bool BulkExporter::start(AssetsManager& assetsManager, const Request& newRequest) {
+    if (active) {
+        Warninger::sendWarning(FUNC_NAME, "Another export is still running.");
+        return false;
+    }
+    if (!Tools::isValidFolderPath(newRequest.folder)) {
+        Warninger::sendWarning(FUNC_NAME, "Invalid output folder: " + newRequest.folder);
+        return false;
+    }
+
+    request = newRequest;
+    const bool perItemFiles = request.itemSheets || request.itemItf || request.itemToml;
+    const bool anyItems = perItemFiles || request.itemArchive;
+    const bool itemPixels = request.itemSheets || (request.itemArchive && request.archiveSprites);
+    const auto textureCount = static_cast<uint32_t>(assetsManager.getTextureCount());
+
+    auto next = std::make_shared<Export>();
+    next->request = request;
+    next->dimension = assetsManager.getSpriteSize();
+    next->items = anyItems ? Items::getItemTypes() : std::vector<std::shared_ptr<ItemType>>();
+
+    // Untouched sprites come from the .spr itself, that is a plain read instead of a GPU readback each
+    SprSource source = assetsManager.getSprSource();
+    if (!source.path.empty() && !Tools::readFileBytes(source.path, next->sprData)) {
+        Warninger::sendWarning(FUNC_NAME, "Couldn't read " + source.path + ", every sprite gets read back from its texture.");
+        source = SprSource();
+    }
+    next->transparency = source.transparency;
+
+    next->fromSpr.assign(textureCount, false);
+    for (uint32_t id = 1; id < textureCount; ++id) {
+        next->fromSpr[id] = source.canDecode(id);
+    }
+    next->records = std::move(source.records);
+
+    // Sprites that only exist as textures - the exported ones, and the ones item sheets are made of
+    std::vector<bool> needed(textureCount, false);
+    if (request.sprites) {
+        for (uint32_t id = 1; id < textureCount; ++id) {
+            needed[id] = assetsManager.isValidTextureIndex(static_cast<int>(id));
+        }
+    }
+    if (itemPixels) {
+        for (const auto& itemType : next->items) {
+            if (!itemType) {
+                continue;
+            }
+            for (uint32_t id : itemType->textureIdsVector) {
+                if (id > 0 && id < textureCount && assetsManager.isValidTextureIndex(static_cast<int>(id))) {
+                    needed[id] = true;
+                }
+            }
+        }
+    }
+
+    pendingReadbacks.clear();
+    readbackPos = 0;
+    next->readbacks.assign(itemPixels ? textureCount : 0, nullptr);
+
+    std::vector<uint32_t> decodable;
+    for (uint32_t id = 1; id < textureCount; ++id) {
+        if (!needed[id] || next->fromSpr[id]) {
+            if (request.sprites && needed[id]) {
+                decodable.push_back(id);
+            }
+            continue;
+        }
+
+        pendingReadbacks.push_back(id);
+    }
+
+    totalJobs = (perItemFiles ? next->items.size() : 0) + (request.itemArchive ? 1 : 0) + decodable.size() +
+                (request.sprites ? pendingReadbacks.size() : 0); // read back ones are submitted as they come
+    if (totalJobs == 0) {
+        pendingReadbacks.clear();
+        Warninger::sendWarning(FUNC_NAME, "Nothing to export.");
+        return false;
+    }
+
+    current = std::move(next);
+    jobs.clear();
+    doneJobs = 0;
+    failedJobs = 0;
+    cancelled = false;
+    itemsQueued = !anyItems;
+
+    for (size_t first = 0; first < decodable.size(); first += EXPORTS_PER_JOB) {
+        std::vector<uint32_t> ids(decodable.begin() + static_cast<std::ptrdiff_t>(first),
+                                  decodable.begin() + static_cast<std::ptrdiff_t>(std::min(first + EXPORTS_PER_JOB, decodable.size())));
+        size_t count = ids.size();
+        submit("Exporting sprites", count, [ids = std::move(ids)](Export& exporting, size_t i) {
+            exportSprite(exporting, ids[i], nullptr);
+        });
+    }
+
+    active = true;
+    return true;
+}
+
+void BulkExporter::update(AssetsManager& assetsManager, size_t readbackBudget) {
+    if (!active) {
+        return;
+    }
+
+    const uint32_t dimension = current->dimension;
+    const size_t spriteBytes = static_cast<size_t>(dimension) * dimension * 4;
+    std::vector<std::pair<uint32_t, Pixels>> readBack;
+    for (size_t n = 0; n < readbackBudget && readbackPos < pendingReadbacks.size() && !cancelled; ++n) {
+        uint32_t id = pendingReadbacks[readbackPos++];
+
+        std::shared_ptr<sf::Texture> texture;
+        if (assetsManager.isValidTextureIndex(static_cast<int>(id))) {
+            texture = assetsManager.getTexture(static_cast<int>(id));
+        }
+        if (!texture) {
+            // Removed meanwhile, item sheets draw it blank
+            if (request.sprites) {
+                fail(*current, "Sprite " + std::to_string(id) + " is gone, not exported");
+                ++current->doneJobs;
+            }
+            continue;
+        }
+        sf::Image image = texture->copyToImage();
+        auto pixels = std::make_shared<std::vector<uint8_t>>(spriteBytes, 0);
+        if (image.getSize().x == dimension && image.getSize().y == dimension) {
+            std::memcpy(pixels->data(), image.getPixelsPtr(), spriteBytes);
+        }
+
+        if (!current->readbacks.empty()) {
+            current->readbacks[id] = pixels;
+        }
+        if (request.sprites) {
+            readBack.emplace_back(id, std::move(pixels));
+        }
+    }
+    if (!readBack.empty()) {
+        size_t count = readBack.size();
+        submit("Exporting sprites", count, [readBack = std::move(readBack)](Export& exporting, size_t i) {
+            exportSprite(exporting, readBack[i].first, readBack[i].second);
+        });
+    }
+
+    // Item sheets may use any sprite, so they start once all the readbacks are there
+    if (!itemsQueued && readbackPos >= pendingReadbacks.size()) {
+        if (request.itemSheets || request.itemItf || request.itemToml) {
+            const size_t itemCount = current->items.size();
+            for (size_t first = 0; first < itemCount; first += EXPORTS_PER_JOB) {
+                submit("Exporting items", std::min(EXPORTS_PER_JOB, itemCount - first), [first](Export& exporting, size_t i) {
+                    exportItem(exporting, static_cast<uint32_t>(first + i));
+                });
+            }
+        }
+        if (request.itemArchive) {
+            submit("Writing item archive", 1, [](Export& exporting, size_t) {
+                exportArchive(exporting);
+            });
+        }
+        itemsQueued = true;
+    }
+
+    if (itemsQueued && readbackPos >= pendingReadbacks.size() && current->doneJobs >= totalJobs) {
+        finish();
+    }
+}
+
+void BulkExporter::cancel() {
+    cancelled = true;
+    for (const auto& job : jobs) {
+        job->cancel();
+    }
+    if (active) {
+        finish();
+    }
+}
+
+void BulkExporter::finish() {
+    // Jobs still running keep the export data alive, they see the cancel and stop after their current file
+    doneJobs = current->doneJobs;
+    failedJobs = current->failedJobs;
+    fmt::print("Export to {} {}: {} of {} done, {} failed\n", request.folder, cancelled ? "cancelled" : "finished",
+               doneJobs, totalJobs, failedJobs);
+
+    current.reset();
+    jobs.clear();
+    pendingReadbacks.clear();
+    active = false;
+}
+
+void BulkExporter::submit(const std::string& name, size_t count, ExportOne exportOne) {
+    jobs.push_back(JobSystem::getInstance()->schedule(name, [exporting = current, count, exportOne = std::move(exportOne)](Job& job) {
+        for (size_t i = 0; i < count && !job.isCancelled(); ++i) {
+            exportOne(*exporting, i);
+            ++exporting->doneJobs;
+            job.setProgress(i + 1, count);
+        }
+    }));
+}
+
+void BulkExporter::getSpritePixels(const Export& current, uint32_t id, uint8_t* out) {
+    const uint32_t dimension = current.dimension;
+    const size_t spriteBytes = static_cast<size_t>(dimension) * dimension * 4;
+    if (id < current.readbacks.size() && current.readbacks[id]) {
+        std::memcpy(out, current.readbacks[id]->data(), spriteBytes);
+        return;
+    }
+
+    if (id >= current.fromSpr.size() || !current.fromSpr[id] || current.records[id].offset == 0) {
+        std::memset(out, 0, spriteBytes);
+        return;
+    }
+
+    // Record: 3 bytes color key, u16 size, RLE data
+    const std::vector<char>& sprData = current.sprData;
+    const SprRecordRef& record = current.records[id];
+    size_t start = static_cast<size_t>(record.offset) + 5;
+    size_t size = start < sprData.size() ? std::min<size_t>(record.dataSize, sprData.size() - start) : 0;
+    const auto* data = reinterpret_cast<const uint8_t*>(sprData.data()) + std::min(start, sprData.size());
+
+    bool decoded = SpriteCodec::withCodec(current.transparency, dimension, [&](auto codec) {
+        using Codec = decltype(codec);
+        Codec::decode(data, size, out);
+    });
+    if (!decoded) {
+        std::memset(out, 0, spriteBytes);
+    }
+}
+
+void BulkExporter::exportSprite(Export& current, uint32_t id, const Pixels& pixels) {
+    const uint32_t dimension = current.dimension;
+    std::string path = (std::filesystem::path(current.request.folder) / ("sprite" + std::to_string(id))).string() +
+                       Tools::getFormatString(current.request.imageFormat);
+
+    if (pixels) {
+        if (!saveImage(path, dimension, dimension, pixels->data())) {
+            fail(current, "Failed to save image: " + path);
+        }
+        return;
+    }
+
+    std::vector<uint8_t> buffer(static_cast<size_t>(dimension) * dimension * 4);
+    getSpritePixels(current, id, buffer.data());
+    if (!saveImage(path, dimension, dimension, buffer.data())) {
+        fail(current, "Failed to save image: " + path);
+    }
+}
+
+void BulkExporter::exportItem(Export& current, uint32_t index) {
+    const std::shared_ptr<ItemType>& itemType = current.items[index];
+    if (!itemType) {
+        return; // removed item
+    }
+
+    // Same naming as exporting a single item
+    const Request& request = current.request;
+    const uint32_t dimension = current.dimension;
+    std::string basePath = (std::filesystem::path(request.folder) / ("item" + std::to_string(index))).string();
+
+    if (request.itemSheets) {
+        // Frames below each other, like AssetsManager::getItemSpriteSheet().
+        // Every layer/pattern gets its own column of frames, in .dat order (layers fastest, then patternX, Y, Z).
+        const uint32_t variants = static_cast<uint32_t>(itemType->layers) * itemType->patternX * itemType->patternY * itemType->patternZ;
+        const uint32_t variantWidth = itemType->width * dimension;
+        const uint32_t width = variantWidth * variants;
+        const uint32_t frameHeight = itemType->height * dimension;
+        const uint32_t height = frameHeight * itemType->animationsFrames;
+        const size_t rowBytes = static_cast<size_t>(dimension) * 4;
+
+        std::vector<uint8_t> sheet(static_cast<size_t>(width) * height * 4, 0);
+        std::vector<uint8_t> tile(rowBytes * dimension);
+        const auto& ids = itemType->textureIdsVector;
+        for (uint32_t a = 0; a < itemType->animationsFrames; ++a) {
+            for (uint32_t variant = 0; variant < variants; ++variant) {
+                const int layer = static_cast<int>(variant % itemType->layers);
+                const int patternX = static_cast<int>(variant / itemType->layers % itemType->patternX);
+                const int patternY = static_cast<int>(variant / itemType->layers / itemType->patternX % itemType->patternY);
+                const int patternZ = static_cast<int>(variant / itemType->layers / itemType->patternX / itemType->patternY);
+                for (uint32_t y = 0; y < itemType->height; ++y) {
+                    for (uint32_t x = 0; x < itemType->width; ++x) {
+                        size_t idIndex = itemType->getSpriteIndex(static_cast<int>(x), static_cast<int>(y), static_cast<int>(a),
+                                                                  layer, patternX, patternY, patternZ);
+                        if (idIndex >= ids.size() || ids[idIndex] == 0) {
+                            continue;
+                        }
+
+                        getSpritePixels(current, ids[idIndex], tile.data());
+                        const size_t dstX = static_cast<size_t>(variant) * variantWidth + x * dimension;
+                        for (uint32_t row = 0; row < dimension; ++row) {
+                            size_t dstY = static_cast<size_t>(a) * frameHeight + y * dimension + row;
+                            std::memcpy(sheet.data() + (dstY * width + dstX) * 4, tile.data() + row * rowBytes, rowBytes);
+                        }
+                    }
+                }
+            }
+        }
+
+        std::string path = basePath + Tools::getFormatString(request.imageFormat);
+        if (width == 0 || height == 0 || !saveImage(path, width, height, sheet.data())) {
+            fail(current, "Failed to save image: " + path);
+        }
+    }
+
+    if (request.itemItf) {
+        Items::exportItemItf(basePath + Tools::getFormatString(Tools::ITF), *itemType);
+    }
+    if (request.itemToml) {
+        Items::exportItemToml(basePath + Tools::getFormatString(Tools::TOML), static_cast<int>(index), *itemType);
+    }
+}
+
+void BulkExporter::exportArchive(Export& current) {
+    // Archive ids are the item indexes, like the item<id> names of the other exports
+    std::vector<std::pair<uint32_t, std::shared_ptr<ItemType>>> archiveItems;
+    archiveItems.reserve(current.items.size());
+    for (uint32_t index = 0; index < current.items.size(); ++index) {
+        archiveItems.emplace_back(index, current.items[index]);
+    }
+
+    const Request& request = current.request;
+    const size_t spriteBytes = static_cast<size_t>(current.dimension) * current.dimension * 4;
+    ItfArchive::SpritePixelsGetter getPixels;
+    if (request.archiveSprites) {
+        getPixels = [&current, spriteBytes](uint32_t id, std::vector<uint8_t>& rgba) {
+            if (id >= current.fromSpr.size()) {
+                return false;
+            }
+            rgba.resize(spriteBytes);
+            getSpritePixels(current, id, rgba.data());
+            return true;
+        };
+    }
+
+    std::string path = (std::filesystem::path(request.folder) / "items").string() + Tools::getFormatString(Tools::ITF);
+    if (!ItfArchive::write(path, archiveItems, request.archiveSprites ? current.dimension : 0, getPixels)) {
+        fail(current, "Failed to write archive: " + path);
+    }
+}
+
+bool BulkExporter::saveImage(const std::string& path, uint32_t width, uint32_t height, const uint8_t* pixels) {
+    sf::Image image(sf::Vector2u(width, height), pixels);
+    return image.saveToFile(path);
+}
+
+void BulkExporter::fail(Export& current, const std::string& message) {
+    size_t failed = ++current.failedJobs;
+    if (failed <= MAX_LOGGED_FAILURES) {
+        std::lock_guard<std::mutex> lock(current.logMutex);
+        Warninger::sendWarning(FUNC_NAME, message);
+    }
+}
+
+void BulkExporter::drawProgressPopup(const char* popupName) {
+    if (!ImGui::BeginPopupModal(popupName, nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+        return;
+    }
+
+    size_t done = getDoneJobs();
+    float progress = totalJobs > 0 ? static_cast<float>(done) / static_cast<float>(totalJobs) : 1.0f;
+    ImGui::Text("Exporting to %s", request.folder.c_str());
+    ImGui::Text("%zu / %zu done, %zu failed", done, totalJobs, getFailedJobs());
+    ImGui::ProgressBar(active ? progress : 1.0f, ImVec2(300, 0));
+
+    if (active) {
+        if (ImGui::Button("Cancel##BulkExportCancel")) {
+            cancel();
+            ImGui::CloseCurrentPopup();
+        }
+    } else if (ImGui::Button("OK##BulkExportOk")) {
+        ImGui::CloseCurrentPopup();
+    }
+    ImGui::EndPopup();
+}
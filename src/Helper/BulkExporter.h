@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "../Misc/tools.h"
+#include "../Things/ItemType.h"
+#include "../ResourceManagers/AssetsManager.h"
+
+/**
+ * @brief Exports all sprites and/or items into a folder, as JobSystem jobs
+ *
+ * Encoding and writing run on the workers from CPU pixels only, a few hundred sprites/items per job. Untouched sprites are decoded
+ * straight from the loaded .spr, the changed ones get read back from their textures first -
+ * a budget per frame on the UI thread, as that needs the GL context.
+ * Item sheets are put together from those pixels, they don't go through a RenderTexture.
+ */
+class BulkExporter {
+public:
+    struct Request {
+        std::string folder;
+        Tools::EXPORT_OPTIONS imageFormat = Tools::PNG; // sprites and item sheets
+        bool sprites = false;
+        bool itemSheets = false;
+        bool itemItf = false;
+        bool itemToml = false;
+        bool itemArchive = false;    // all items into one items.itf archive
+        bool archiveSprites = false; // with the pixels of their sprites
+    };
+
+    BulkExporter() = default;
+    ~BulkExporter();
+
+    BulkExporter(const BulkExporter&) = delete;
+    BulkExporter& operator=(const BulkExporter&) = delete;
+
+    // UI thread. False if an export is already running or there is nothing to export.
+    bool start(AssetsManager& assetsManager, const Request& request);
+    // UI thread, once per frame: reads back up to readbackBudget textures and queues the work that can start
+    void update(AssetsManager& assetsManager, size_t readbackBudget);
+    // Jobs that haven't started are cancelled, running ones stop after their current file. Files already written stay.
+    void cancel();
+
+    [[nodiscard]] bool isActive() const { return active; }
+    [[nodiscard]] size_t getTotalJobs() const { return totalJobs; }
+    [[nodiscard]] size_t getDoneJobs() const { return current ? current->doneJobs.load() : doneJobs; }
+    [[nodiscard]] size_t getFailedJobs() const { return current ? current->failedJobs.load() : failedJobs; }
+    [[nodiscard]] const std::string& getFolder() const { return request.folder; }
+
+    // Modal with progress and cancel, has to be opened with ImGui::OpenPopup(popupName) by the caller
+    void drawProgressPopup(const char* popupName);
+private:
+    using Pixels = std::shared_ptr<const std::vector<uint8_t>>;
+
+    // Shared with the jobs and read-only for them. A cancelled export lets go of it right away,
+    // the jobs still running keep it until they stop.
+    struct Export {
+        Request request;
+        uint32_t dimension = 32;
+        bool transparency = false;
+        std::vector<char> sprData; // whole loaded .spr
+        std::vector<SprRecordRef> records;
+        std::vector<bool> fromSpr;       // index = sprite id, true = decode from sprData
+        std::vector<Pixels> readbacks;   // index = sprite id, only kept when item sheets/archive need them
+        std::vector<std::shared_ptr<ItemType>> items;
+
+        std::atomic<size_t> doneJobs{0};
+        std::atomic<size_t> failedJobs{0};
+        std::mutex logMutex;
+    };
+    // Exports 'count' sprites/items, exportOne gets the index among them
+    using ExportOne = std::function<void(Export&, size_t)>;
+
+    // RGBA of the sprite into out (dimension^2 * 4 bytes), transparent if there is nothing
+    static void getSpritePixels(const Export& current, uint32_t id, uint8_t* out);
+    static void exportSprite(Export& current, uint32_t id, const Pixels& pixels);
+    static void exportItem(Export& current, uint32_t index);
+    static void exportArchive(Export& current);
+    static bool saveImage(const std::string& path, uint32_t width, uint32_t height, const uint8_t* pixels);
+    static void fail(Export& current, const std::string& message);
+    void submit(const std::string& name, size_t count, ExportOne exportOne);
+    void finish();
+
+    Request request;
+    std::shared_ptr<Export> current;
+    std::vector<JobHandle> jobs;
+
+    // UI thread only
+    std::vector<uint32_t> pendingReadbacks;
+    size_t readbackPos = 0;
+    bool itemsQueued = false;
+    bool active = false;
+    bool cancelled = false;
+
+    size_t totalJobs = 0;
+    // Counts of the last export, once it's finished
+    size_t doneJobs = 0;
+    size_t failedJobs = 0;
+};
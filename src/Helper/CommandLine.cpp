@@ -0,0 +1,156 @@
+#include "CommandLine.h"
+#include <cstdlib>
+#include "AssetDiff.h"
+#include "AssetMerge.h"
+#include "AssetPatch.h"
+#include "JobSystem.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+
+bool CommandLine::hasCommand(int argc, char** argv) {
+    return argc > 1 && std::string(argv[1]).rfind("--", 0) == 0;
+}
+
+int CommandLine::run(int argc, char** argv) {
+    const std::string command = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    Options options;
+    if (!parse(args, options)) {
+        printUsage();
+        return 2;
+    }
+
+    int exitCode = 2;
+    if (command == "--diff") {
+        exitCode = runDiff(options);
+    } else if (command == "--make-patch") {
+        exitCode = runMakePatch(options);
+    } else if (command == "--apply-patch") {
+        exitCode = runApplyPatch(options);
+    } else if (command == "--merge") {
+        exitCode = runMerge(options);
+    } else {
+        fmt::print("Unknown command {}\n", command);
+        printUsage();
+    }
+    JobSystem::getInstance()->shutdown();
+    return exitCode;
+}
+
+bool CommandLine::parse(const std::vector<std::string>& args, Options& options) {
+    AssetFormat& format = options.format;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg == "--extended") {
+            format.extended = true;
+        } else if (arg == "--transparency") {
+            format.transparency = true;
+        } else if (arg == "--frame-durations") {
+            format.frameDurations = true;
+        } else if (arg == "--frame-groups") {
+            format.frameGroups = true;
+        } else if (arg == "--size" && i + 1 < args.size()) {
+            format.dimension = static_cast<uint32_t>(std::strtoul(args[++i].c_str(), nullptr, 10));
+        } else if (arg == "--json" && i + 1 < args.size()) {
+            options.jsonPath = args[++i];
+        } else if (arg == "--out" && i + 1 < args.size()) {
+            options.outPath = args[++i];
+        } else if (arg == "--out-spr" && i + 1 < args.size()) {
+            options.outSpr = args[++i];
+        } else if (arg == "--out-dat" && i + 1 < args.size()) {
+            options.outDat = args[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            fmt::print("Unknown option {}\n", arg);
+            return false;
+        } else {
+            options.paths.push_back(arg);
+        }
+    }
+    return true;
+}
+
+int CommandLine::runDiff(const Options& options) {
+    const auto& paths = options.paths;
+    if (paths.size() != 4) {
+        printUsage();
+        return 2;
+    }
+
+    std::string error;
+    auto comparison = AssetDiff::run({paths[0], paths[1]}, {paths[2], paths[3]}, options.format, error);
+    if (!comparison) {
+        Warninger::sendErrorMsg(FUNC_NAME, error);
+        return 1;
+    }
+    return AssetDiff::writeJson(comparison->result, options.jsonPath) ? 0 : 1;
+}
+
+int CommandLine::runMakePatch(const Options& options) {
+    const auto& paths = options.paths;
+    if (paths.size() != 4 || options.outPath.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    std::string error;
+    auto comparison = AssetDiff::run({paths[0], paths[1]}, {paths[2], paths[3]}, options.format, error);
+    if (!comparison || !AssetPatch::write(*comparison, options.outPath, error)) {
+        Warninger::sendErrorMsg(FUNC_NAME, error);
+        return 1;
+    }
+
+    const auto& result = comparison->result;
+    fmt::print("Wrote {}: {} sprites, {} items, {} outfits, {} effects, {} missiles changed\n", options.outPath,
+               result.sprites.size(), result.itemsAdded.size() + result.itemsModified.size(),
+               result.things[THING_OUTFIT].size(), result.things[THING_EFFECT].size(),
+               result.things[THING_MISSILE].size());
+    return 0;
+}
+
+int CommandLine::runApplyPatch(const Options& options) {
+    const auto& paths = options.paths;
+    if (paths.size() != 3 || options.outSpr.empty() != options.outDat.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    std::string error;
+    AssetPatch patch;
+    if (!patch.load(paths[0], error) || !patch.apply({paths[1], paths[2]}, {options.outSpr, options.outDat}, error)) {
+        Warninger::sendErrorMsg(FUNC_NAME, error);
+        return 1;
+    }
+    fmt::print("Applied {} ({} sprites)\n", paths[0], patch.getSprites().size());
+    return 0;
+}
+
+int CommandLine::runMerge(const Options& options) {
+    const auto& paths = options.paths;
+    if (paths.size() != 6 || options.outSpr.empty() || options.outDat.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    std::string error;
+    auto merge = AssetMerge::run({paths[0], paths[1]}, {paths[2], paths[3]}, {paths[4], paths[5]},
+                                 {options.outSpr, options.outDat}, options.format, error);
+    if (!merge) {
+        Warninger::sendErrorMsg(FUNC_NAME, error);
+        return 1;
+    }
+    if (!AssetMerge::writeJson(merge->result, options.jsonPath)) {
+        return 1;
+    }
+    return merge->result.conflicts.empty() ? 0 : 3;
+}
+
+void CommandLine::printUsage() {
+    fmt::print("Usage:\n"
+               "  Sprforge --diff <base.spr> <base.dat> <target.spr> <target.dat> [--json <file>]\n"
+               "  Sprforge --make-patch <base.spr> <base.dat> <target.spr> <target.dat> --out <file>\n"
+               "  Sprforge --apply-patch <patch> <base.spr> <base.dat> [--out-spr <file> --out-dat <file>]\n"
+               "  Sprforge --merge <base.spr> <base.dat> <ours.spr> <ours.dat> <theirs.spr> <theirs.dat> "
+               "--out-spr <file> --out-dat <file> [--json <file>]\n"
+               "Format options: --extended --transparency --frame-durations --frame-groups --size <pixels>\n");
+}
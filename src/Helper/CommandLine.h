@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "AssetFiles.h"
+
+/**
+ * @brief Headless commands, run instead of the window when the app is started with one
+ *
+ *   --diff <base.spr> <base.dat> <target.spr> <target.dat> [--json <file>]
+ *   --make-patch <base.spr> <base.dat> <target.spr> <target.dat> --out <file>
+ *   --apply-patch <patch> <base.spr> <base.dat> [--out-spr <file> --out-dat <file>]
+ *   --merge <base.spr> <base.dat> <ours.spr> <ours.dat> <theirs.spr> <theirs.dat> --out-spr <file> --out-dat <file>
+ *           [--json <file>]
+ *
+ * Format of the assets: --extended, --transparency, --frame-durations, --frame-groups, --size <pixels>
+ * (protocol gets detected from the .dat, patches carry their own format). Results go to stdout unless a file is given.
+ * A patch is applied in place unless both outputs are given. A merge with conflicts still gets written
+ * (ours kept in them) but exits with 3.
+ */
+class CommandLine {
+public:
+    // True if the arguments name a command, the app shouldn't open its window then
+    static bool hasCommand(int argc, char** argv);
+    // Runs the command and waits for it, returns the process exit code
+    static int run(int argc, char** argv);
+private:
+    struct Options {
+        AssetFormat format;
+        std::vector<std::string> paths; // positional
+        std::string jsonPath = "-";
+        std::string outPath;
+        std::string outSpr;
+        std::string outDat;
+    };
+
+    // False with a message printed on anything unknown
+    static bool parse(const std::vector<std::string>& args, Options& options);
+    static int runDiff(const Options& options);
+    static int runMakePatch(const Options& options);
+    static int runApplyPatch(const Options& options);
+    static int runMerge(const Options& options);
+    static void printUsage();
+};
@@ -0,0 +1,339 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+    // Index of the worker running on this thread, -1 on any other thread
+    thread_local int currentWorker = -1;
+}
+
+float Job::getProgress() const {
+    if (isFinished()) {
+        return 1.0f;
+    }
+
+    uint64_t total = progressTotal;
+    if (total == 0) {
+        return 0.0f;
+    }
+    return std::min(1.0f, static_cast<float>(progressDone) / static_cast<float>(total));
+}
+
+void Job::fail(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error.empty()) {
+        error = message;
+    }
+    failed = true;
+}
+
+std::string Job::getError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+JobSystem::JobSystem() {
+    // UI thread is busy with its own frames, the rest of the cores get a worker each
+    size_t threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobHandle JobSystem::schedule(const std::string& name, Work work, const std::vector<JobHandle>& dependencies, Callback onFinished) {
+    auto job = makeJob(name);
+    job->work = std::move(work);
+    job->onFinished = std::move(onFinished);
+    addDependencies(job, dependencies);
+    return job;
+}
+
+JobHandle JobSystem::scheduleOnMainThread(const std::string& name, MainThreadWork work, const std::vector<JobHandle>& dependencies,
+                                          Callback onFinished) {
+    auto job = makeJob(name);
+    job->onMainThread = true;
+    job->mainThreadWork = std::move(work);
+    job->onFinished = std::move(onFinished);
+    addDependencies(job, dependencies);
+    return job;
+}
+
+JobHandle JobSystem::makeJob(const std::string& name) {
+    auto job = std::make_shared<Job>();
+    job->name = name;
+    return job;
+}
+
+void JobSystem::addDependencies(const JobHandle& job, const std::vector<JobHandle>& dependencies) {
+    for (const auto& dependency : dependencies) {
+        if (!dependency) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->isFinished()) {
+            if (dependency->status != Job::Status::DONE) {
+                job->dependencyFailed = true;
+            }
+            continue;
+        }
+        ++job->pendingDependencies;
+        dependency->dependents.push_back(job);
+    }
+
+    // Scheduling is over, dependencies that finished meanwhile could only get the count down to this 1
+    if (--job->pendingDependencies == 0) {
+        onDependenciesDone(job);
+    }
+}
+
+void JobSystem::onDependenciesDone(const JobHandle& job) {
+    if (job->dependencyFailed || job->cancelled) {
+        // Never runs, whatever the work captured is released right away
+        job->work = nullptr;
+        job->mainThreadWork = nullptr;
+        finish(job, Job::Status::CANCELLED);
+        return;
+    }
+
+    job->status = Job::Status::QUEUED;
+    if (job->onMainThread) {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        mainThreadJobs.push_back(job);
+        return;
+    }
+    enqueue(job);
+}
+
+void JobSystem::enqueue(const JobHandle& job) {
+    // Counted first, so a worker that takes the job early never sees the count below zero
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        ++queuedCount;
+    }
+
+    // Jobs spawned by a worker stay on it, it's likely to have their data in cache
+    size_t index = currentWorker >= 0 ? static_cast<size_t>(currentWorker) : nextWorker++ % workers.size();
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->queue.push_back(job);
+    }
+    jobAvailable.notify_one();
+}
+
+void JobSystem::finish(const JobHandle& job, Job::Status status) {
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->status = status;
+        dependents.swap(job->dependents);
+    }
+    if (waitingCount > 0) {
+        // Taken so a waiter can't miss it between checking the status and going to sleep
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        jobFinished.notify_all();
+    }
+
+    if (job->onFinished) {
+        postToMainThread([job]() {
+            job->onFinished(*job);
+            job->onFinished = nullptr;
+        });
+    }
+
+    for (const auto& dependent : dependents) {
+        if (status != Job::Status::DONE) {
+            dependent->dependencyFailed = true;
+        }
+        if (--dependent->pendingDependencies == 0) {
+            onDependenciesDone(dependent);
+        }
+    }
+}
+
+void JobSystem::runJob(const JobHandle& job) {
+    if (job->cancelled) {
+        job->work = nullptr;
+        finish(job, Job::Status::CANCELLED);
+        return;
+    }
+
+    job->status = Job::Status::RUNNING;
+    try {
+        job->work(*job);
+    } catch (const std::exception& e) {
+        job->fail(e.what());
+    }
+    // Whatever the work captured is released right away, not when the last handle goes
+    job->work = nullptr;
+
+    if (job->failed) {
+        finish(job, Job::Status::FAILED);
+    } else if (job->cancelled) {
+        finish(job, Job::Status::CANCELLED);
+    } else {
+        finish(job, Job::Status::DONE);
+    }
+}
+
+void JobSystem::postToMainThread(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mainThreadMutex);
+    mainThreadTasks.push_back(std::move(task));
+}
+
+void JobSystem::update() {
+    // Both taken at once - a callback posted before a main thread job got queued always runs before that job,
+    // so jobs depending on a worker job see whatever its callback applied
+    std::vector<std::function<void()>> tasks;
+    std::vector<JobHandle> jobs;
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        tasks.swap(mainThreadTasks);
+        jobs = mainThreadJobs;
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+
+    std::vector<std::pair<JobHandle, Job::Status>> finished;
+    for (const auto& job : jobs) {
+        bool done = job->cancelled;
+        if (!done) {
+            job->status = Job::Status::RUNNING;
+            try {
+                done = job->mainThreadWork(*job);
+            } catch (const std::exception& e) {
+                job->fail(e.what());
+            }
+            done = done || job->failed;
+        }
+        if (!done) {
+            continue;
+        }
+
+        job->mainThreadWork = nullptr;
+        finished.emplace_back(job, job->failed ? Job::Status::FAILED :
+                                   job->cancelled ? Job::Status::CANCELLED : Job::Status::DONE);
+    }
+    if (finished.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        for (const auto& [job, status] : finished) {
+            mainThreadJobs.erase(std::remove(mainThreadJobs.begin(), mainThreadJobs.end(), job), mainThreadJobs.end());
+        }
+    }
+    for (const auto& [job, status] : finished) {
+        finish(job, status);
+    }
+
+    // Callbacks of the main thread jobs that just finished don't wait for the next frame
+    tasks.clear();
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        tasks.swap(mainThreadTasks);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void JobSystem::waitIdle() {
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    idle.wait(lock, [this]() { return queuedCount == 0 && runningCount == 0; });
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    if (!job) {
+        return;
+    }
+
+    ++waitingCount;
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        jobFinished.wait(lock, [&job]() { return job->isFinished(); });
+    }
+    --waitingCount;
+}
+
+void JobSystem::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+size_t JobSystem::getQueueDepth() {
+    std::lock_guard<std::mutex> lock(mainThreadMutex);
+    return queuedCount + runningCount + mainThreadJobs.size();
+}
+
+JobHandle JobSystem::takeJob(size_t index) {
+    JobHandle job;
+    {
+        // Own queue from the back - newest job, its data is most likely still in cache
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        if (!workers[index]->queue.empty()) {
+            job = std::move(workers[index]->queue.back());
+            workers[index]->queue.pop_back();
+        }
+    }
+
+    // Steal the oldest job of another worker
+    for (size_t i = 1; !job && i < workers.size(); ++i) {
+        auto& victim = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.queue.empty()) {
+            job = std::move(victim.queue.front());
+            victim.queue.pop_front();
+        }
+    }
+
+    if (job) {
+        // Running goes up first, so waitIdle() never sees both at zero in between
+        ++runningCount;
+        --queuedCount;
+    }
+    return job;
+}
+
+void JobSystem::workerLoop(size_t index) {
+    currentWorker = static_cast<int>(index);
+
+    while (true) {
+        if (JobHandle job = takeJob(index)) {
+            runJob(job);
+
+            if (--runningCount == 0 && queuedCount == 0) {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping && queuedCount == 0) {
+            return;
+        }
+        // Counted but not pushed yet is only a moment, the worker just tries again then
+        if (queuedCount > 0) {
+            lock.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+        jobAvailable.wait(lock, [this]() { return stopping || queuedCount > 0; });
+    }
+}
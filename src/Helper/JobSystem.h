@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/**
+ * @brief Single unit of work scheduled on the JobSystem
+ *
+ * Jobs only start once all their dependencies are done. If a dependency gets cancelled or fails,
+ * the job never runs and ends up cancelled as well, so a whole chain can be stopped from any of its jobs.
+ * Cancellation is cooperative - running work checks isCancelled() and returns early.
+ */
+class Job {
+public:
+    enum class Status : uint8_t {
+        WAITING,  // for dependencies
+        QUEUED,
+        RUNNING,
+        DONE,
+        CANCELLED,
+        FAILED,
+    };
+
+    [[nodiscard]] const std::string& getName() const { return name; }
+    [[nodiscard]] Status getStatus() const { return status; }
+    [[nodiscard]] bool isFinished() const {
+        Status current = status;
+        return current == Status::DONE || current == Status::CANCELLED || current == Status::FAILED;
+    }
+
+    // From the work itself, any thread
+    void setProgress(uint64_t done, uint64_t total) {
+        progressTotal = total;
+        progressDone = done;
+    }
+    // 0..1, finished jobs are always at 1
+    [[nodiscard]] float getProgress() const;
+
+    void cancel() { cancelled = true; }
+    [[nodiscard]] bool isCancelled() const { return cancelled; }
+
+    // From the work itself - job (and everything depending on it) won't count as done
+    void fail(const std::string& message);
+    [[nodiscard]] std::string getError() const;
+private:
+    friend class JobSystem;
+
+    std::string name;
+    std::atomic<Status> status{Status::WAITING};
+    std::atomic<uint64_t> progressDone{0};
+    std::atomic<uint64_t> progressTotal{0};
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> failed{false};
+    std::atomic<bool> dependencyFailed{false};
+    // +1 while the job is still being scheduled, so it can't start halfway through
+    std::atomic<int> pendingDependencies{1};
+
+    bool onMainThread = false;
+    std::function<void(Job&)> work;
+    std::function<bool(Job&)> mainThreadWork;
+    std::function<void(Job&)> onFinished;
+
+    mutable std::mutex mutex; // error and dependents
+    std::string error;
+    std::vector<std::shared_ptr<Job>> dependents;
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+/**
+ * @brief Application wide job scheduler
+ *
+ * Every worker thread has its own queue, jobs scheduled from a worker land in its queue (newest run first)
+ * and idle workers steal the oldest jobs of the others. Jobs that need the GPU/ImGui run on the UI thread
+ * instead, a slice per frame from update(). Completion callbacks always run on the UI thread too,
+ * so they can touch textures and stores freely.
+ */
+class JobSystem {
+public:
+    using Work = std::function<void(Job&)>;
+    // Called once per frame until it returns true, keep each call short
+    using MainThreadWork = std::function<bool(Job&)>;
+    // Gets the finished job, check its status for DONE/CANCELLED/FAILED
+    using Callback = std::function<void(Job&)>;
+
+    static JobSystem* getInstance() {
+        if (instance_ == nullptr) {
+            instance_ = new JobSystem();
+        }
+
+        return instance_;
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Runs 'work' on a worker thread once all the dependencies are done
+    JobHandle schedule(const std::string& name, Work work, const std::vector<JobHandle>& dependencies = {},
+                       Callback onFinished = nullptr);
+    // Runs 'work' on the UI thread (from update()) once all the dependencies are done
+    JobHandle scheduleOnMainThread(const std::string& name, MainThreadWork work, const std::vector<JobHandle>& dependencies = {},
+                                   Callback onFinished = nullptr);
+    // Runs 'task' on the UI thread during the next update(), from any thread
+    void postToMainThread(std::function<void()> task);
+
+    // UI thread, once per frame - finished callbacks, then a slice of every main thread job
+    void update();
+
+    // Blocks until no worker job is queued or running. Jobs waiting for main thread ones aren't waited for.
+    void waitIdle();
+    // Blocks until the job is finished. Not from a worker, and not for a job that waits for main thread ones.
+    void wait(const JobHandle& job);
+    // Lets the queued jobs finish and stops the workers (app exit)
+    void shutdown();
+
+    [[nodiscard]] size_t getWorkerCount() const { return workers.size(); }
+    // Jobs queued or running right now, main thread ones included (not the ones still waiting for dependencies)
+    [[nodiscard]] size_t getQueueDepth();
+private:
+    JobSystem();
+    inline static JobSystem* instance_ = nullptr;
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<JobHandle> queue;
+    };
+
+    JobHandle makeJob(const std::string& name);
+    void addDependencies(const JobHandle& job, const std::vector<JobHandle>& dependencies);
+    // Last dependency got done (or failed)
+    void onDependenciesDone(const JobHandle& job);
+    void enqueue(const JobHandle& job);
+    void finish(const JobHandle& job, Job::Status status);
+    void runJob(const JobHandle& job);
+
+    void workerLoop(size_t index);
+    JobHandle takeJob(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> nextWorker{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable idle;
+    std::condition_variable jobFinished;
+    std::atomic<size_t> waitingCount{0}; // threads in wait(), finishing jobs only notify when there are any
+    std::atomic<size_t> queuedCount{0};
+    std::atomic<size_t> runningCount{0};
+    bool stopping = false;
+
+    std::mutex mainThreadMutex;
+    std::vector<JobHandle> mainThreadJobs;
+    std::vector<std::function<void()>> mainThreadTasks;
+};
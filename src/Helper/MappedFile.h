@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only memory map of a whole file. Pages are only read once touched,
+// so opening a big file and reading a few records out of it stays cheap.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file can't be opened/mapped (an empty file can't be mapped either)
+    bool open(const std::string& path);
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return ptr != nullptr; }
+    [[nodiscard]] const uint8_t* data() const { return ptr; }
+    [[nodiscard]] size_t size() const { return length; }
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    const uint8_t* ptr = nullptr;
+    size_t length = 0;
+};
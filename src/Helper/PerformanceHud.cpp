@@ -0,0 +1,175 @@
+#include "PerformanceHud.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <imgui.h>
+#include "JobSystem.h"
+#include "TextureUploader.h"
+#include "../ResourceManagers/ConfigManager.h"
+#include "../Misc/tools.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+
+namespace {
+    constexpr int HISTOGRAM_BUCKETS = 25;
+    constexpr float HISTOGRAM_BUCKET_MS = 2.0f; // last bucket takes everything slower
+
+    std::string formatBytes(uint64_t bytes) {
+        char text[32];
+        if (bytes >= 1024ull * 1024 * 1024) {
+            std::snprintf(text, sizeof(text), "%.2f GB", static_cast<double>(bytes) / (1024.0 * 1024.0 * 1024.0));
+        } else if (bytes >= 1024ull * 1024) {
+            std::snprintf(text, sizeof(text), "%.1f MB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+        } else {
+            std::snprintf(text, sizeof(text), "%.1f KB", static_cast<double>(bytes) / 1024.0);
+        }
+        return text;
+    }
+
+    // Red once it's over the budget (0 = none)
+    void drawMemoryLine(const char* label, uint64_t bytes, uint64_t budget) {
+        if (budget == 0) {
+            ImGui::Text("%s: %s", label, formatBytes(bytes).c_str());
+            return;
+        }
+
+        ImVec4 color = bytes > budget ? ImVec4(1.0f, 0.35f, 0.35f, 1.0f) : ImGui::GetStyle().Colors[ImGuiCol_Text];
+        ImGui::TextColored(color, "%s: %s / %s", label, formatBytes(bytes).c_str(), formatBytes(budget).c_str());
+    }
+}
+
+PerformanceHud::PerformanceHud(AssetsManager* assetsManager) : assetsManager(assetsManager) {
+}
+
+void PerformanceHud::sample(sf::Time frameTime) {
+    Sample& current = history[nextSample];
+    current = Sample();
+    current.frameMs = frameTime.asSeconds() * 1000.0f;
+
+    if (const ImDrawData* drawData = ImGui::GetDrawData()) {
+        for (int i = 0; i < drawData->CmdListsCount; ++i) {
+            current.drawCalls += static_cast<uint32_t>(drawData->CmdLists[i]->CmdBuffer.Size);
+        }
+        current.vertices = static_cast<uint32_t>(drawData->TotalVtxCount);
+    }
+
+    auto memory = assetsManager->getMemoryUsage();
+    current.textures = static_cast<uint32_t>(memory.spriteTextures + memory.previews);
+    current.textureBytes = memory.spriteTextureBytes + memory.previewBytes;
+    current.previewBytes = memory.previewBytes;
+    current.evictedSprites = static_cast<uint32_t>(memory.evictedSprites);
+    current.pixelStoreBytes = memory.pixelBytes;
+    current.itemTypeStoreBytes = memory.itemDataBytes;
+    current.jobQueueDepth = static_cast<uint32_t>(JobSystem::getInstance()->getQueueDepth());
+    current.uploads = static_cast<uint32_t>(TextureUploader::getInstance()->getLastFrameUploads());
+
+    nextSample = (nextSample + 1) % HISTORY_SIZE;
+    sampleCount = std::min(sampleCount + 1, HISTORY_SIZE);
+}
+
+const PerformanceHud::Sample& PerformanceHud::getSample(size_t age) const {
+    return history[(nextSample + HISTORY_SIZE - 1 - age) % HISTORY_SIZE];
+}
+
+void PerformanceHud::draw() {
+    if (!visible) {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(440, 0), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Performance (F3)", &visible)) {
+        ImGui::End();
+        return;
+    }
+
+    if (sampleCount == 0) {
+        ImGui::Text("No frames sampled yet.");
+        ImGui::End();
+        return;
+    }
+
+    // Oldest first, for the timeline
+    std::vector<float> frameTimes(sampleCount);
+    float histogram[HISTOGRAM_BUCKETS] = {};
+    float total = 0.0f;
+    float worst = 0.0f;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        float ms = getSample(sampleCount - 1 - i).frameMs;
+        frameTimes[i] = ms;
+        total += ms;
+        worst = std::max(worst, ms);
+        int bucket = std::min(HISTOGRAM_BUCKETS - 1, static_cast<int>(ms / HISTOGRAM_BUCKET_MS));
+        histogram[bucket] += 1.0f;
+    }
+    std::vector<float> sorted = frameTimes;
+    size_t p99Index = std::min(sorted.size() - 1, sorted.size() * 99 / 100);
+    std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(p99Index), sorted.end());
+    float average = total / static_cast<float>(sampleCount);
+
+    ImGui::Text("Frame: avg %.2f ms (%.0f FPS), p99 %.2f ms, max %.2f ms", average,
+                average > 0.0f ? 1000.0f / average : 0.0f, sorted[p99Index], worst);
+    ImGui::PlotLines("##FrameTimes", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, "Frame time (ms)",
+                     0.0f, std::max(33.3f, worst), ImVec2(-1, 60));
+    ImGui::PlotHistogram("##FrameHistogram", histogram, HISTOGRAM_BUCKETS, 0, "Frames per 2 ms bucket",
+                         0.0f, FLT_MAX, ImVec2(-1, 60));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("0 ms on the left, last bucket counts everything above %.0f ms",
+                          HISTOGRAM_BUCKET_MS * (HISTOGRAM_BUCKETS - 1));
+    }
+
+    ImGui::Separator();
+    const Sample& latest = getSample(0);
+    auto config = ConfigManager::getInstance();
+    ImGui::Text("Draw calls: %u, vertices: %u", latest.drawCalls, latest.vertices);
+    drawMemoryLine("Textures", latest.textureBytes, config->getTextureBudgetBytes());
+    ImGui::SameLine();
+    ImGui::Text("(%u live, %u sprites evicted)", latest.textures, latest.evictedSprites);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Estimated VRAM of sprites and item previews.\nTextures only held by undo history aren't included.");
+    }
+    drawMemoryLine("Previews", latest.previewBytes, config->getPreviewBudgetBytes());
+    drawMemoryLine("CPU pixel store", latest.pixelStoreBytes, config->getPixelBudgetBytes());
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Staging buffers (pooled and in use) and thumbnails waiting to be written");
+    }
+    drawMemoryLine("ItemType store", latest.itemTypeStoreBytes, config->getItemDataBudgetBytes());
+    ImGui::Text("Textures uploaded this frame: %u", latest.uploads);
+    ImGui::Text("Job queue depth: %u", latest.jobQueueDepth);
+
+    ImGui::Separator();
+    if (ImGui::Button("Export CSV", ImVec2(120, 0))) {
+        std::string folder = Tools::openFileDialogChooseFolder();
+        if (!folder.empty()) {
+            char name[64];
+            std::time_t now = std::time(nullptr);
+            std::strftime(name, sizeof(name), "performance_%Y%m%d_%H%M%S.csv", std::localtime(&now));
+            std::string path = folder + "/" + name;
+            exportStatus = exportCsv(path) ? "Exported to " + path : "Couldn't write " + path;
+        }
+    }
+    if (!exportStatus.empty()) {
+        ImGui::TextWrapped("%s", exportStatus.c_str());
+    }
+
+    ImGui::End();
+}
+
+bool PerformanceHud::exportCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        Warninger::sendWarning(FUNC_NAME, "Unable to open " + path);
+        return false;
+    }
+
+    file << "frame,frameMs,drawCalls,vertices,textures,textureBytes,previewBytes,evictedSprites,pixelStoreBytes,itemTypeStoreBytes,"
+            "jobQueueDepth,uploads\n";
+    for (size_t i = 0; i < sampleCount; ++i) {
+        const Sample& s = getSample(sampleCount - 1 - i);
+        file << i << ',' << s.frameMs << ',' << s.drawCalls << ',' << s.vertices << ',' << s.textures << ','
+             << s.textureBytes << ',' << s.previewBytes << ',' << s.evictedSprites << ',' << s.pixelStoreBytes << ',' << s.itemTypeStoreBytes << ','
+             << s.jobQueueDepth << ',' << s.uploads << '\n';
+    }
+    return file.good();
+}
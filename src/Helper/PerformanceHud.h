@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "../ResourceManagers/AssetsManager.h"
+
+/**
+ * @brief Window with per-frame performance counters (F3)
+ *
+ * Every frame a sample goes into a ring buffer, also while the window is hidden, so there's
+ * history to look at once it's opened. Everything in a sample is a counter read in O(1),
+ * memory comes from the assets' own accounting (AssetsManager::getMemoryUsage()).
+ * The whole history can be exported as CSV.
+ */
+class PerformanceHud {
+public:
+    static constexpr size_t HISTORY_SIZE = 600; // 10s at 60 FPS
+
+    struct Sample {
+        float frameMs = 0.0f;
+        uint32_t drawCalls = 0;
+        uint32_t vertices = 0;
+        uint32_t textures = 0;         // live sf::Textures of sprites and previews
+        uint64_t textureBytes = 0;     // estimated VRAM, RGBA8 without mipmaps
+        uint64_t previewBytes = 0;     // part of textureBytes
+        uint32_t evictedSprites = 0;
+        uint64_t pixelStoreBytes = 0;  // CPU side pixels - staging buffers and unwritten thumbnails
+        uint64_t itemTypeStoreBytes = 0;
+        uint32_t jobQueueDepth = 0;
+        uint32_t uploads = 0;          // textures uploaded in the frame
+    };
+
+    explicit PerformanceHud(AssetsManager* assetsManager);
+
+    void toggle() { visible = !visible; }
+    [[nodiscard]] bool isVisible() const { return visible; }
+
+    // Main loop, after ImGui got rendered - draw data of the frame is still there then
+    void sample(sf::Time frameTime);
+    void draw();
+
+    // Oldest sample first, returns false if the file couldn't be written
+    bool exportCsv(const std::string& path) const;
+private:
+    [[nodiscard]] const Sample& getSample(size_t age) const; // 0 = latest
+
+    AssetsManager* assetsManager;
+    bool visible = false;
+
+    std::vector<Sample> history = std::vector<Sample>(HISTORY_SIZE);
+    size_t nextSample = 0;
+    size_t sampleCount = 0;
+
+    std::string exportStatus;
+};
@@ -0,0 +1,553 @@
+#include "SessionSnapshot.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "AtomicFileWriter.h"
+#include "../Misc/BinaryWriter.h"
+#include "../Misc/Hash.h"
+#include "../Misc/Timer.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/SpriteCodec.h"
+#include "../Misc/definitions.h"
+#include "../Things/ItfArchive.h"
+
+namespace {
+    constexpr size_t HEADER_SIZE = 48;
+    constexpr size_t SECTION_ALIGNMENT = 16;
+    constexpr size_t COLUMN_ALIGNMENT = 8;
+    constexpr size_t STAMP_SAMPLE_SIZE = 64 * 1024;
+    constexpr uint8_t REMOVED_ITEM = 0xFF; // in the category column
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void pad(std::vector<uint8_t>& buffer, size_t alignment) {
+        buffer.resize(alignUp(buffer.size(), alignment), 0);
+    }
+
+    // Sections start aligned, so aligning the position within one aligns it in the file too
+    void skipPadding(BinaryReader& reader, size_t alignment) {
+        reader.skip(alignUp(reader.tell(), alignment) - reader.tell());
+    }
+
+    template<typename T>
+    void writeColumn(std::vector<uint8_t>& buffer, const std::vector<T>& column) {
+        BinaryWriter(buffer).writeBytes(reinterpret_cast<const uint8_t*>(column.data()), column.size() * sizeof(T));
+        pad(buffer, COLUMN_ALIGNMENT);
+    }
+
+    // Pointer to 'count' values of T, nullptr if the section is too short
+    template<typename T>
+    const uint8_t* readColumn(BinaryReader& reader, size_t count) {
+        if (count > reader.remaining() / sizeof(T)) {
+            reader.skip(reader.remaining() + 1);
+            return nullptr;
+        }
+        const uint8_t* column = reader.current();
+        reader.skip(count * sizeof(T));
+        skipPadding(reader, COLUMN_ALIGNMENT);
+        return column;
+    }
+
+    template<typename T>
+    T columnAt(const uint8_t* column, size_t index) {
+        T value;
+        std::memcpy(&value, column + index * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    void writeShortString(BinaryWriter& writer, const std::string& value) {
+        size_t length = std::min<size_t>(value.size(), 0xFFFF);
+        writer.writeU16(static_cast<uint16_t>(length));
+        writer.writeBytes(reinterpret_cast<const uint8_t*>(value.data()), length);
+    }
+
+    void writeStamp(BinaryWriter& writer, const SessionSnapshot::FileStamp& stamp) {
+        writer.write<uint64_t>(stamp.size);
+        writer.write<int64_t>(stamp.modified);
+        writer.writeU32(stamp.hash);
+    }
+
+    SessionSnapshot::FileStamp readStamp(BinaryReader& reader) {
+        SessionSnapshot::FileStamp stamp;
+        stamp.size = reader.read<uint64_t>();
+        stamp.modified = reader.read<int64_t>();
+        stamp.hash = reader.readU32();
+        return stamp;
+    }
+}
+
+SessionSnapshot::FileStamp SessionSnapshot::FileStamp::of(const std::string& path) {
+    FileStamp stamp;
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error) {
+        return stamp;
+    }
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return stamp;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return stamp;
+    }
+
+    stamp.size = size;
+    stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+
+    std::vector<char> sample(static_cast<size_t>(std::min<uint64_t>(size, STAMP_SAMPLE_SIZE)));
+    file.read(sample.data(), static_cast<std::streamsize>(sample.size()));
+    stamp.hash = Hash::crc32(sample.data(), static_cast<size_t>(file.gcount()));
+    if (size > STAMP_SAMPLE_SIZE) {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(size - sample.size()));
+        file.read(sample.data(), static_cast<std::streamsize>(sample.size()));
+        stamp.hash = Hash::crc32(sample.data(), static_cast<size_t>(file.gcount()), stamp.hash);
+    }
+    return stamp;
+}
+
+SessionSnapshot::~SessionSnapshot() {
+    waitForSave();
+}
+
+void SessionSnapshot::saveAsync(const std::string& path, const Metadata& newMetadata, const std::vector<SprRecordRef>& records) {
+    waitForSave();
+    if (file.isOpen()) {
+        close(); // mapped file can't be replaced on Windows
+    }
+
+    // ItemTypes may get edited (or unloaded) while the sprites are written, so they're serialized now
+    std::vector<uint8_t> items;
+    std::vector<uint8_t> things;
+    writeItems(items);
+    writeThings(things);
+
+    saveJob = JobSystem::getInstance()->schedule("Writing session snapshot",
+        [path, newMetadata, records, items = std::move(items), things = std::move(things)](Job& job) {
+            Timer timer("Writing session snapshot");
+            if (!writeFile(path, newMetadata, records, items, things)) {
+                job.fail("Failed to write session snapshot: " + path);
+            }
+        }, {}, [](Job& job) {
+            if (job.getStatus() == Job::Status::FAILED) {
+                Warninger::sendWarning(FUNC_NAME, job.getError());
+            }
+        });
+}
+
+void SessionSnapshot::waitForSave() {
+    JobSystem::getInstance()->wait(saveJob);
+    saveJob.reset();
+}
+
+void SessionSnapshot::writeMetadata(std::vector<uint8_t>& buffer, const Metadata& metadata) {
+    BinaryWriter writer(buffer);
+    writeShortString(writer, metadata.sprPath);
+    writeShortString(writer, metadata.datPath);
+    writeStamp(writer, metadata.sprStamp);
+    writeStamp(writer, metadata.datStamp);
+    writer.writeU32(metadata.sprSignature);
+    writer.writeU32(metadata.datSignature);
+    writer.writeU32(metadata.dimension);
+    writer.writeU8(metadata.versionIndex);
+    writer.writeU8(metadata.extended);
+    writer.writeU8(metadata.transparency);
+    writer.writeU8(metadata.frameDurations);
+    writer.writeU8(metadata.frameGroups);
+}
+
+void SessionSnapshot::writeItems(std::vector<uint8_t>& buffer) {
+    const auto& itemTypes = Items::getItemTypes();
+    const size_t count = itemTypes.size();
+
+    std::vector<uint8_t> categories(count, REMOVED_ITEM);
+    std::vector<uint64_t> flags(count, 0);
+    std::vector<uint16_t> speeds(count, 0);
+    std::vector<uint8_t> shapes(count * 8, 0);
+    std::vector<uint32_t> textureStarts(count + 1, 0);
+    std::vector<uint32_t> textureIds;
+    std::vector<uint32_t> nameStarts(count + 1, 0);
+    std::vector<uint8_t> names;
+    std::vector<uint32_t> attributeStarts(count + 1, 0);
+    std::vector<uint8_t> attributes;
+    BinaryWriter attributeWriter(attributes);
+
+    for (size_t i = 0; i < count; ++i) {
+        const auto& itemType = itemTypes[i];
+        if (itemType) {
+            categories[i] = static_cast<uint8_t>(itemType->category);
+            flags[i] = itemType->getAllFlags();
+            speeds[i] = itemType->speed;
+
+            const uint8_t shape[8] = {itemType->width, itemType->height, itemType->animationsFrames, itemType->patternX,
+                                      itemType->patternY, itemType->patternZ, itemType->layers, itemType->exactSize};
+            std::copy(std::begin(shape), std::end(shape), shapes.begin() + static_cast<std::ptrdiff_t>(i * 8));
+
+            textureIds.insert(textureIds.end(), itemType->textureIdsVector.begin(), itemType->textureIdsVector.end());
+            names.insert(names.end(), itemType->name.begin(), itemType->name.end());
+            if (const ItemTypeAttributes* itemAttributes = itemType->getAttributes()) {
+                ItfArchive::writeAttributes(attributeWriter, *itemAttributes);
+            }
+        }
+        textureStarts[i + 1] = static_cast<uint32_t>(textureIds.size());
+        nameStarts[i + 1] = static_cast<uint32_t>(names.size());
+        attributeStarts[i + 1] = static_cast<uint32_t>(attributes.size());
+    }
+
+    BinaryWriter writer(buffer);
+    writer.writeU32(static_cast<uint32_t>(count));
+    writer.writeU32(static_cast<uint32_t>(textureIds.size()));
+    writer.writeU32(static_cast<uint32_t>(names.size()));
+    writer.writeU32(static_cast<uint32_t>(attributes.size()));
+
+    writeColumn(buffer, categories);
+    writeColumn(buffer, flags);
+    writeColumn(buffer, speeds);
+    writeColumn(buffer, shapes);
+    writeColumn(buffer, textureStarts);
+    writeColumn(buffer, textureIds);
+    writeColumn(buffer, nameStarts);
+    writeColumn(buffer, names);
+    writeColumn(buffer, attributeStarts);
+    writeColumn(buffer, attributes);
+}
+
+void SessionSnapshot::writeThings(std::vector<uint8_t>& buffer) {
+    BinaryWriter writer(buffer);
+    for (uint8_t category = THING_OUTFIT; category < THING_CATEGORY_COUNT; ++category) {
+        const auto& thingTypes = ThingTypes::getThingTypes(static_cast<ThingCategory_t>(category));
+        writer.writeU32(static_cast<uint32_t>(thingTypes.size()));
+        for (const auto& thingType : thingTypes) {
+            static const ThingType empty(std::pmr::get_default_resource());
+            const ThingType& thing = thingType ? *thingType : empty;
+
+            writer.writeU16(thing.id);
+            writer.writeU32(static_cast<uint32_t>(thing.flagData.size()));
+            writer.writeBytes(thing.flagData.data(), thing.flagData.size());
+            writer.writeU32(static_cast<uint32_t>(thing.frameGroups.size()));
+            writer.writeBytes(reinterpret_cast<const uint8_t*>(thing.frameGroups.data()), thing.frameGroups.size() * sizeof(FrameGroup));
+            writer.writeU32(static_cast<uint32_t>(thing.textureIds.size()));
+            writer.writeBytes(reinterpret_cast<const uint8_t*>(thing.textureIds.data()), thing.textureIds.size() * sizeof(uint32_t));
+            writer.writeU32(static_cast<uint32_t>(thing.animationData.size()));
+            writer.writeBytes(thing.animationData.data(), thing.animationData.size());
+        }
+    }
+}
+
+bool SessionSnapshot::writeFile(const std::string& path, const Metadata& metadata, const std::vector<SprRecordRef>& records,
+                                const std::vector<uint8_t>& items, const std::vector<uint8_t>& things) {
+    std::vector<char> sprData;
+    if (!Tools::readFileBytes(metadata.sprPath, sprData)) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer;
+    writeMetadata(buffer, metadata);
+    const uint64_t metadataOffset = HEADER_SIZE;
+    const uint64_t itemsOffset = alignUp(metadataOffset + buffer.size(), SECTION_ALIGNMENT);
+    const uint64_t thingsOffset = alignUp(itemsOffset + items.size(), SECTION_ALIGNMENT);
+    const uint64_t spritesOffset = alignUp(thingsOffset + things.size(), SECTION_ALIGNMENT);
+
+    // Every offset is known up front, so the pixels can be streamed out as they get decoded
+    const auto spriteCount = static_cast<uint32_t>(records.size());
+    const size_t spriteBytes = static_cast<size_t>(metadata.dimension) * metadata.dimension * 4;
+    const uint64_t pixelOffsetsOffset = alignUp(spritesOffset + 16 + static_cast<uint64_t>(spriteCount) * 8, SECTION_ALIGNMENT);
+    const uint64_t pixelsOffset = alignUp(pixelOffsetsOffset + static_cast<uint64_t>(spriteCount) * 8, SECTION_ALIGNMENT);
+
+    std::vector<uint64_t> pixelOffsets(spriteCount, 0);
+    uint64_t nextPixels = pixelsOffset;
+    for (uint32_t id = 1; id < spriteCount; ++id) {
+        if (records[id].offset != 0) {
+            pixelOffsets[id] = nextPixels;
+            nextPixels += spriteBytes;
+        }
+    }
+
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(parent, error);
+    }
+
+    AtomicFileWriter out(path);
+    if (!out.isOpen()) {
+        return false;
+    }
+
+    std::vector<uint8_t> header;
+    BinaryWriter headerWriter(header);
+    headerWriter.writeU32(MAGIC);
+    headerWriter.writeU16(VERSION);
+    headerWriter.writeU16(0);
+    headerWriter.write<uint64_t>(metadataOffset);
+    headerWriter.write<uint64_t>(itemsOffset);
+    headerWriter.write<uint64_t>(thingsOffset);
+    headerWriter.write<uint64_t>(spritesOffset);
+    headerWriter.write<uint64_t>(nextPixels);
+    out.write(header.data(), header.size());
+    out.write(buffer.data(), buffer.size());
+
+    auto writeSection = [&out](uint64_t offset, const std::vector<uint8_t>& section) {
+        static const uint8_t zeroes[SECTION_ALIGNMENT] = {};
+        out.write(zeroes, static_cast<size_t>(offset - out.getWrittenSize()));
+        out.write(section.data(), section.size());
+    };
+    writeSection(itemsOffset, items);
+    writeSection(thingsOffset, things);
+
+    buffer.clear();
+    BinaryWriter writer(buffer);
+    writer.writeU32(metadata.dimension);
+    writer.writeU32(spriteCount);
+    writer.writeU32(0);
+    writer.writeU32(0);
+    for (const SprRecordRef& record : records) {
+        writer.writeU32(record.offset);
+        writer.writeU16(record.dataSize);
+        writer.writeU16(0);
+    }
+    writeSection(spritesOffset, buffer);
+
+    buffer.clear();
+    writeColumn(buffer, pixelOffsets);
+    writeSection(pixelOffsetsOffset, buffer);
+
+    std::vector<uint8_t> zeroes(pixelsOffset - out.getWrittenSize(), 0);
+    out.write(zeroes.data(), zeroes.size());
+
+    const auto* sprBytes = reinterpret_cast<const uint8_t*>(sprData.data());
+    bool knownDimension = SpriteCodec::withCodec(metadata.transparency, metadata.dimension, [&](auto codec) {
+        using Codec = decltype(codec);
+        std::vector<uint8_t> pixels(Codec::RGBA_SIZE);
+        for (uint32_t id = 1; id < spriteCount && out.good(); ++id) {
+            if (pixelOffsets[id] == 0) {
+                continue;
+            }
+
+            // Record: 3 bytes color key, u16 size, RLE data
+            size_t start = static_cast<size_t>(records[id].offset) + 5;
+            size_t size = start < sprData.size() ? std::min<size_t>(records[id].dataSize, sprData.size() - start) : 0;
+            Codec::decode(sprBytes + std::min(start, sprData.size()), size, pixels.data());
+            out.write(pixels.data(), pixels.size());
+        }
+    });
+    if (!knownDimension) {
+        out.abort();
+        return false;
+    }
+
+    return out.good() && out.commit();
+}
+
+bool SessionSnapshot::open(const std::string& path) {
+    waitForSave();
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    BinaryReader header(file.data(), std::min(file.size(), HEADER_SIZE));
+    uint32_t magic = header.readU32();
+    uint16_t version = header.readU16();
+    header.skip(2);
+    uint64_t metadataOffset = header.read<uint64_t>();
+    itemsOffset = header.read<uint64_t>();
+    thingsOffset = header.read<uint64_t>();
+    spritesOffset = header.read<uint64_t>();
+    uint64_t fileSize = header.read<uint64_t>();
+
+    // Sizes mismatch = file got cut off or this isn't ours
+    if (header.overflowed() || magic != MAGIC || version != VERSION || fileSize != file.size() ||
+        !(HEADER_SIZE <= metadataOffset && metadataOffset <= itemsOffset && itemsOffset <= thingsOffset &&
+          thingsOffset <= spritesOffset && spritesOffset <= fileSize)) {
+        close();
+        return false;
+    }
+
+    BinaryReader reader = getSection(metadataOffset, itemsOffset);
+    metadata = Metadata();
+    metadata.sprPath = reader.readString(reader.readU16());
+    metadata.datPath = reader.readString(reader.readU16());
+    metadata.sprStamp = readStamp(reader);
+    metadata.datStamp = readStamp(reader);
+    metadata.sprSignature = reader.readU32();
+    metadata.datSignature = reader.readU32();
+    metadata.dimension = reader.readU32();
+    metadata.versionIndex = reader.readU8();
+    metadata.extended = reader.readU8() != 0;
+    metadata.transparency = reader.readU8() != 0;
+    metadata.frameDurations = reader.readU8() != 0;
+    metadata.frameGroups = reader.readU8() != 0;
+
+    BinaryReader sprites = getSection(spritesOffset, fileSize);
+    uint32_t dimension = sprites.readU32();
+    spriteCount = sprites.readU32();
+    sprites.skip(8);
+    recordsData = readColumn<uint64_t>(sprites, spriteCount);
+    skipPadding(sprites, SECTION_ALIGNMENT);
+    pixelOffsets = readColumn<uint64_t>(sprites, spriteCount);
+
+    if (reader.overflowed() || sprites.overflowed() || dimension != metadata.dimension || !recordsData || !pixelOffsets) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SessionSnapshot::close() {
+    file.close();
+    metadata = Metadata();
+    itemsOffset = thingsOffset = spritesOffset = 0;
+    spriteCount = 0;
+    recordsData = nullptr;
+    pixelOffsets = nullptr;
+}
+
+BinaryReader SessionSnapshot::getSection(uint64_t offset, uint64_t end) const {
+    return {file.data() + offset, static_cast<size_t>(end - offset)};
+}
+
+bool SessionSnapshot::isUpToDate() const {
+    if (!isOpen()) {
+        return false;
+    }
+
+    FileStamp sprStamp = FileStamp::of(metadata.sprPath);
+    FileStamp datStamp = FileStamp::of(metadata.datPath);
+    return sprStamp.size != 0 && datStamp.size != 0 && sprStamp == metadata.sprStamp && datStamp == metadata.datStamp;
+}
+
+std::vector<SprRecordRef> SessionSnapshot::getSprRecords() const {
+    std::vector<SprRecordRef> records(spriteCount);
+    for (uint32_t id = 0; id < spriteCount; ++id) {
+        BinaryReader reader(recordsData + static_cast<size_t>(id) * 8, 8);
+        records[id].offset = reader.readU32();
+        records[id].dataSize = reader.readU16();
+    }
+    return records;
+}
+
+const uint8_t* SessionSnapshot::getSpritePixels(uint32_t id) const {
+    if (id >= spriteCount) {
+        return nullptr;
+    }
+
+    uint64_t offset = columnAt<uint64_t>(pixelOffsets, id);
+    uint64_t spriteBytes = static_cast<uint64_t>(metadata.dimension) * metadata.dimension * 4;
+    if (offset == 0 || offset < spritesOffset || offset + spriteBytes > file.size()) {
+        return nullptr;
+    }
+    return file.data() + offset;
+}
+
+bool SessionSnapshot::restoreItems() const {
+    BinaryReader reader = getSection(itemsOffset, thingsOffset);
+    uint32_t count = reader.readU32();
+    uint32_t textureIdCount = reader.readU32();
+    uint32_t namesSize = reader.readU32();
+    uint32_t attributesSize = reader.readU32();
+
+    const uint8_t* categories = readColumn<uint8_t>(reader, count);
+    const uint8_t* flags = readColumn<uint64_t>(reader, count);
+    const uint8_t* speeds = readColumn<uint16_t>(reader, count);
+    const uint8_t* shapes = readColumn<uint8_t>(reader, static_cast<size_t>(count) * 8);
+    const uint8_t* textureStarts = readColumn<uint32_t>(reader, static_cast<size_t>(count) + 1);
+    const uint8_t* textureIds = readColumn<uint32_t>(reader, textureIdCount);
+    const uint8_t* nameStarts = readColumn<uint32_t>(reader, static_cast<size_t>(count) + 1);
+    const uint8_t* names = readColumn<uint8_t>(reader, namesSize);
+    const uint8_t* attributeStarts = readColumn<uint32_t>(reader, static_cast<size_t>(count) + 1);
+    const uint8_t* attributes = readColumn<uint8_t>(reader, attributesSize);
+    if (reader.overflowed()) {
+        return false;
+    }
+
+    Items::beginBulkLoad(count, count * (sizeof(ItemType) + 64) + static_cast<size_t>(textureIdCount) * sizeof(uint32_t));
+    ItemTypeAttributes scratch;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t category = categories[i];
+        if (category == REMOVED_ITEM) {
+            Items::pushItemType(nullptr);
+            continue;
+        }
+
+        auto textureStart = columnAt<uint32_t>(textureStarts, i);
+        auto textureEnd = columnAt<uint32_t>(textureStarts, i + 1);
+        auto nameStart = columnAt<uint32_t>(nameStarts, i);
+        auto nameEnd = columnAt<uint32_t>(nameStarts, i + 1);
+        auto attributeStart = columnAt<uint32_t>(attributeStarts, i);
+        auto attributeEnd = columnAt<uint32_t>(attributeStarts, i + 1);
+        if (textureStart > textureEnd || textureEnd > textureIdCount || nameStart > nameEnd || nameEnd > namesSize ||
+            attributeStart > attributeEnd || attributeEnd > attributesSize) {
+            return false;
+        }
+
+        auto itemType = Items::makeArenaItemType();
+        itemType->category = category <= TOP ? static_cast<ItemCategory_t>(category) : COMMON;
+        itemType->setAllFlags(columnAt<uint64_t>(flags, i));
+        itemType->speed = columnAt<uint16_t>(speeds, i);
+
+        const uint8_t* shape = shapes + static_cast<size_t>(i) * 8;
+        itemType->width = shape[0];
+        itemType->height = shape[1];
+        itemType->animationsFrames = shape[2];
+        itemType->patternX = shape[3];
+        itemType->patternY = shape[4];
+        itemType->patternZ = shape[5];
+        itemType->layers = shape[6];
+        itemType->exactSize = shape[7];
+
+        itemType->textureIdsVector.resize(textureEnd - textureStart);
+        std::memcpy(itemType->textureIdsVector.data(), textureIds + static_cast<size_t>(textureStart) * sizeof(uint32_t),
+                    itemType->textureIdsVector.size() * sizeof(uint32_t));
+        itemType->name.assign(reinterpret_cast<const char*>(names) + nameStart, nameEnd - nameStart);
+
+        if (attributeEnd > attributeStart) {
+            BinaryReader attributeReader(attributes + attributeStart, attributeEnd - attributeStart);
+            scratch.reset();
+            if (!ItfArchive::readAttributes(attributeReader, scratch)) {
+                return false;
+            }
+            itemType->setAttributes(scratch);
+        }
+
+        Items::pushItemType(std::move(itemType));
+    }
+    return true;
+}
+
+bool SessionSnapshot::restoreThings() const {
+    BinaryReader reader = getSection(thingsOffset, spritesOffset);
+    ThingTypes::beginBulkLoad(static_cast<size_t>(spritesOffset - thingsOffset) * 2);
+
+    for (uint8_t category = THING_OUTFIT; category < THING_CATEGORY_COUNT; ++category) {
+        uint32_t count = reader.readU32();
+        for (uint32_t i = 0; i < count && !reader.overflowed(); ++i) {
+            auto thingType = ThingTypes::makeArenaThingType();
+            thingType->id = reader.readU16();
+
+            // Each vector is u32 count and the elements as they are in memory
+            auto readVector = [&reader](auto& vector) {
+                using T = typename std::decay_t<decltype(vector)>::value_type;
+                uint32_t elements = reader.readU32();
+                if (elements > reader.remaining() / sizeof(T)) {
+                    reader.skip(reader.remaining() + 1);
+                    return;
+                }
+                vector.resize(elements);
+                std::memcpy(vector.data(), reader.current(), elements * sizeof(T));
+                reader.skip(elements * sizeof(T));
+            };
+            readVector(thingType->flagData);
+            readVector(thingType->frameGroups);
+            readVector(thingType->textureIds);
+            readVector(thingType->animationData);
+
+            ThingTypes::pushThingType(static_cast<ThingCategory_t>(category), std::move(thingType));
+        }
+    }
+    return !reader.overflowed();
+}
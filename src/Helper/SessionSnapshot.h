@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "../Misc/BinaryReader.h"
+#include "../ResourceManagers/AssetsManager.h"
+
+/**
+ * @brief Binary snapshot of a loaded session, to skip .spr decoding and .dat parsing next time
+ *
+ * Layout (little-endian, every section starts 16-byte aligned):
+ *   header   - magic "OTSN", u16 version, u16 reserved, u64 offsets of metadata/items/things/sprites, u64 file size
+ *   metadata - source paths with their stamps, load options and signatures
+ *   items    - columnar: category, flags, speed, shape, then texture ids/names/attributes with start indexes
+ *   things   - outfits, effects and missiles, FrameGroups as they are in memory
+ *   sprites  - SprRecordRefs, u64 pixel offset per sprite (0 = blank), then raw RGBA of each non-blank sprite
+ *
+ * Restoring is a map of the file and a texture upload straight from the mapped pixels.
+ * It's only used while both sources still have the size, modification time and sampled hash it was made from.
+ */
+class SessionSnapshot {
+public:
+    static constexpr uint32_t MAGIC = 0x4E53544F; // "OTSN"
+    static constexpr uint16_t VERSION = 1;
+
+    // What a source file looked like when the snapshot was made
+    struct FileStamp {
+        uint64_t size = 0;
+        int64_t modified = 0;
+        uint32_t hash = 0; // CRC32 of the first and last 64 KB, a full hash would cost as much as the decode
+
+        // Zeroes if the file doesn't exist
+        static FileStamp of(const std::string& path);
+        bool operator==(const FileStamp& other) const {
+            return size == other.size && modified == other.modified && hash == other.hash;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    };
+
+    struct Metadata {
+        std::string sprPath;
+        std::string datPath;
+        FileStamp sprStamp;
+        FileStamp datStamp;
+
+        uint32_t sprSignature = 0;
+        uint32_t datSignature = 0;
+        uint32_t dimension = 32;
+        uint8_t versionIndex = 0; // DatFormat::ProfileId
+        bool extended = false;
+        bool transparency = false;
+        bool frameDurations = false;
+        bool frameGroups = false;
+    };
+
+    SessionSnapshot() = default;
+    ~SessionSnapshot();
+
+    SessionSnapshot(const SessionSnapshot&) = delete;
+    SessionSnapshot& operator=(const SessionSnapshot&) = delete;
+
+    /**
+     * @brief Starts writing a snapshot of what's loaded now
+     *
+     * UI thread. Items and things get serialized right away, so they can be edited afterwards.
+     * Sprites are decoded from metadata.sprPath by a background job, which also writes the file.
+     * A running save is waited for first.
+     *
+     * @param records where each sprite is in metadata.sprPath (index = sprite id), its size is the sprite count
+     */
+    void saveAsync(const std::string& path, const Metadata& metadata, const std::vector<SprRecordRef>& records);
+    void waitForSave();
+    [[nodiscard]] bool isSaving() const { return saveJob && !saveJob->isFinished(); }
+
+    // Maps the snapshot and reads its metadata, false if it's missing/broken/of another version
+    bool open(const std::string& path);
+    void close();
+    [[nodiscard]] bool isOpen() const { return file.isOpen(); }
+
+    [[nodiscard]] const Metadata& getMetadata() const { return metadata; }
+    // True if both source files are still exactly what the snapshot was made from
+    [[nodiscard]] bool isUpToDate() const;
+
+    // Including air (id 0)
+    [[nodiscard]] uint32_t getSpriteCount() const { return spriteCount; }
+    [[nodiscard]] std::vector<SprRecordRef> getSprRecords() const;
+    // Points into the mapped file (dimension^2 * 4 bytes), nullptr for a blank sprite
+    [[nodiscard]] const uint8_t* getSpritePixels(uint32_t id) const;
+
+    // Push the stored ItemTypes/ThingTypes into Items/ThingTypes (their arenas), false if a section is broken
+    bool restoreItems() const;
+    bool restoreThings() const;
+private:
+    static void writeMetadata(std::vector<uint8_t>& buffer, const Metadata& metadata);
+    static void writeItems(std::vector<uint8_t>& buffer);
+    static void writeThings(std::vector<uint8_t>& buffer);
+    static bool writeFile(const std::string& path, const Metadata& metadata, const std::vector<SprRecordRef>& records,
+                          const std::vector<uint8_t>& items, const std::vector<uint8_t>& things);
+
+    [[nodiscard]] BinaryReader getSection(uint64_t offset, uint64_t end) const;
+
+    JobHandle saveJob;
+
+    MappedFile file;
+    Metadata metadata;
+    uint64_t itemsOffset = 0;
+    uint64_t thingsOffset = 0;
+    uint64_t spritesOffset = 0;
+    uint32_t spriteCount = 0;
+    const uint8_t* recordsData = nullptr;
+    const uint8_t* pixelOffsets = nullptr;
+};
@@ -0,0 +1,190 @@
+#include "SpriteHashIndex.h"
+#include <algorithm>
+#include <filesystem>
+#include "AtomicFileWriter.h"
+#include "MappedFile.h"
+#include "../Misc/BinaryReader.h"
+#include "../Misc/BinaryWriter.h"
+#include "../Misc/Hash.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+
+namespace {
+    constexpr size_t HEADER_SIZE = 36;
+}
+
+std::string SpriteHashIndex::getPathFor(const std::string& sprPath) {
+    return std::filesystem::path(sprPath).replace_extension(".sprhash").string();
+}
+
+SpriteHashIndex::FileStamp SpriteHashIndex::getStampOf(const std::string& sprPath, uint32_t dimension, bool transparency) {
+    FileStamp stamp;
+    std::error_code error;
+    auto size = std::filesystem::file_size(sprPath, error);
+    if (error) {
+        return stamp;
+    }
+    auto writeTime = std::filesystem::last_write_time(sprPath, error);
+    if (error) {
+        return stamp;
+    }
+
+    stamp.dimension = dimension;
+    stamp.transparency = transparency ? 1 : 0;
+    stamp.sprSize = static_cast<uint64_t>(size);
+    stamp.sprWriteTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return stamp;
+}
+
+uint64_t SpriteHashIndex::hashPixels(const uint8_t* rgba, size_t size) {
+    static constexpr uint8_t TRANSPARENT_PIXEL[4] = {};
+    uint64_t hash = Hash::FNV64_OFFSET;
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        hash = Hash::fnv1a64(rgba[i + 3] == 0 ? TRANSPARENT_PIXEL : rgba + i, 4, hash);
+    }
+    return hash == 0 || hash == BLANK_HASH ? 2 : hash;
+}
+
+void SpriteHashIndex::reset(size_t count) {
+    hashes.assign(count, 0);
+    next.assign(count, NO_SPRITE);
+    prev.assign(count, NO_SPRITE);
+    heads.clear();
+    unknownCount = count;
+}
+
+void SpriteHashIndex::resize(size_t count) {
+    for (size_t id = count; id < hashes.size(); ++id) {
+        unlink(static_cast<uint32_t>(id));
+        if (hashes[id] == 0) {
+            --unknownCount;
+        }
+    }
+    if (count > hashes.size()) {
+        unknownCount += count - hashes.size();
+    }
+    hashes.resize(count, 0);
+    next.resize(count, NO_SPRITE);
+    prev.resize(count, NO_SPRITE);
+}
+
+void SpriteHashIndex::set(uint32_t id, uint64_t hash) {
+    if (id >= hashes.size()) {
+        resize(id + 1);
+    }
+    if (hashes[id] == hash) {
+        return;
+    }
+
+    if (hashes[id] == 0) {
+        --unknownCount;
+    } else {
+        unlink(id);
+    }
+    hashes[id] = hash;
+    if (hash == 0) {
+        ++unknownCount;
+    } else {
+        link(id);
+    }
+}
+
+void SpriteHashIndex::unlink(uint32_t id) {
+    if (hashes[id] == 0) {
+        return;
+    }
+
+    if (prev[id] != NO_SPRITE) {
+        next[prev[id]] = next[id];
+    } else if (next[id] != NO_SPRITE) {
+        heads[hashes[id]] = next[id];
+    } else {
+        heads.erase(hashes[id]);
+    }
+    if (next[id] != NO_SPRITE) {
+        prev[next[id]] = prev[id];
+    }
+    next[id] = NO_SPRITE;
+    prev[id] = NO_SPRITE;
+}
+
+void SpriteHashIndex::link(uint32_t id) {
+    auto [head, inserted] = heads.try_emplace(hashes[id], id);
+    if (!inserted) {
+        next[id] = head->second;
+        prev[head->second] = id;
+        head->second = id;
+    }
+}
+
+std::vector<uint32_t> SpriteHashIndex::find(uint64_t hash) const {
+    std::vector<uint32_t> ids;
+    auto head = heads.find(hash);
+    if (head == heads.end()) {
+        return ids;
+    }
+
+    for (uint32_t id = head->second; id != NO_SPRITE; id = next[id]) {
+        ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+bool SpriteHashIndex::load(const std::string& path, const FileStamp& stamp) {
+    MappedFile file;
+    if (stamp.sprSize == 0 || !std::filesystem::exists(path) || !file.open(path)) {
+        return false;
+    }
+
+    BinaryReader reader(file.data(), file.size());
+    uint32_t magic = reader.readU32();
+    uint16_t version = reader.readU16();
+    reader.skip(2);
+    FileStamp fileStamp;
+    fileStamp.dimension = reader.readU32();
+    fileStamp.transparency = reader.readU32();
+    fileStamp.sprSize = reader.read<uint64_t>();
+    fileStamp.sprWriteTime = reader.read<int64_t>();
+    uint32_t count = reader.readU32();
+
+    // The .spr changed since (or it's another one of the same name), the hashes are of no use then
+    if (reader.overflowed() || magic != MAGIC || version != VERSION || !(fileStamp == stamp) ||
+        count > reader.remaining() / sizeof(uint64_t)) {
+        return false;
+    }
+
+    reset(count);
+    for (uint32_t id = 0; id < count; ++id) {
+        set(id, reader.read<uint64_t>());
+    }
+    return true;
+}
+
+bool SpriteHashIndex::save(const std::string& path, const FileStamp& stamp, const std::function<bool(uint32_t)>& include) const {
+    if (stamp.sprSize == 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer;
+    buffer.reserve(HEADER_SIZE + hashes.size() * sizeof(uint64_t));
+    BinaryWriter writer(buffer);
+    writer.writeU32(MAGIC);
+    writer.writeU16(VERSION);
+    writer.writeU16(0);
+    writer.writeU32(stamp.dimension);
+    writer.writeU32(stamp.transparency);
+    writer.write<uint64_t>(stamp.sprSize);
+    writer.write<int64_t>(stamp.sprWriteTime);
+    writer.writeU32(static_cast<uint32_t>(hashes.size()));
+    for (uint32_t id = 0; id < hashes.size(); ++id) {
+        writer.write<uint64_t>(include(id) ? hashes[id] : 0);
+    }
+
+    AtomicFileWriter out(path);
+    if (!out.isOpen() || !out.write(buffer.data(), buffer.size()) || !out.commit()) {
+        Warninger::sendWarning(FUNC_NAME, "Failed to write sprite hashes: " + path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Content hash of every sprite, and the sprites of every content hash
+ *
+ * Lookups by hash are a single hash map access, sprites with the same pixels are chained
+ * through next/prev arrays (index = sprite id), so there's no allocation per sprite.
+ *
+ * Saved next to the .spr, stamped with that file's size and write time - loading the same .spr again
+ * takes the hashes from there instead of hashing every sprite. Layout (little-endian):
+ *   header - magic "OTSH", u16 version, u16 reserved, u32 dimension, u32 transparency,
+ *            u64 .spr size, i64 .spr write time, u32 count
+ *   hashes - u64 per sprite id, 0 = unknown
+ */
+class SpriteHashIndex {
+public:
+    static constexpr uint32_t MAGIC = 0x4853544F; // "OTSH"
+    static constexpr uint16_t VERSION = 1;
+    // Hash of the sprites without pixels, they all look the same
+    static constexpr uint64_t BLANK_HASH = 1;
+
+    struct FileStamp {
+        uint32_t dimension = 0;
+        uint32_t transparency = 0;
+        uint64_t sprSize = 0;
+        int64_t sprWriteTime = 0;
+
+        bool operator==(const FileStamp& other) const {
+            return dimension == other.dimension && transparency == other.transparency &&
+                   sprSize == other.sprSize && sprWriteTime == other.sprWriteTime;
+        }
+    };
+
+    // e.g. Tibia.spr -> Tibia.sprhash
+    static std::string getPathFor(const std::string& sprPath);
+    // Stamp of the .spr as it is on disk now, all zeroes if it doesn't exist
+    static FileStamp getStampOf(const std::string& sprPath, uint32_t dimension, bool transparency);
+
+    /**
+     * @brief Content hash of a sprite's RGBA pixels, never 0 or BLANK_HASH
+     *
+     * FNV-1a over the pixels, fully transparent ones count as (0, 0, 0, 0) whatever their color -
+     * that's what the .spr decoder gives, so an image with other colors under alpha 0 still matches.
+     */
+    static uint64_t hashPixels(const uint8_t* rgba, size_t size);
+
+    // 'count' sprites, all unknown
+    void reset(size_t count);
+    // Keeps the hashes of the sprites that are still there, new ones are unknown
+    void resize(size_t count);
+    void clear() { reset(0); }
+
+    [[nodiscard]] size_t size() const { return hashes.size(); }
+    // 0 = unknown
+    [[nodiscard]] uint64_t get(uint32_t id) const { return id < hashes.size() ? hashes[id] : 0; }
+    void set(uint32_t id, uint64_t hash);
+    void invalidate(uint32_t id) { set(id, 0); }
+    [[nodiscard]] size_t getUnknownCount() const { return unknownCount; }
+
+    // Sprite ids with exactly this content, ascending
+    [[nodiscard]] std::vector<uint32_t> find(uint64_t hash) const;
+
+    // False if the file is missing or doesn't belong to the stamped .spr, the index is untouched then
+    bool load(const std::string& path, const FileStamp& stamp);
+    // Sprites 'include' says no to are written as unknown (e.g. changed ones, that aren't in the .spr like that)
+    bool save(const std::string& path, const FileStamp& stamp, const std::function<bool(uint32_t)>& include) const;
+private:
+    static constexpr uint32_t NO_SPRITE = UINT32_MAX;
+
+    void unlink(uint32_t id);
+    void link(uint32_t id);
+
+    std::vector<uint64_t> hashes;  // index = sprite id
+    std::vector<uint32_t> next;    // following sprite with the same hash
+    std::vector<uint32_t> prev;
+    std::unordered_map<uint64_t, uint32_t> heads; // hash -> first sprite in its chain
+    size_t unknownCount = 0;
+};
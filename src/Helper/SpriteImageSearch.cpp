@@ -0,0 +1,133 @@
+#include "SpriteImageSearch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include "../Things/Items.h"
+
+bool SpriteImageSearch::start(const std::string& path, uint32_t newSpriteSize, std::string& error) {
+    clear();
+
+    sf::Image source;
+    if (!source.loadFromFile(path)) {
+        error = "Couldn't read " + path;
+        return false;
+    }
+    const auto size = source.getSize();
+    if (size.x == 0 || size.y == 0 || size.x % newSpriteSize != 0 || size.y % newSpriteSize != 0) {
+        error = "Image has to be " + std::to_string(newSpriteSize) + "x" + std::to_string(newSpriteSize) +
+                " or a sheet of such tiles, it is " + std::to_string(size.x) + "x" + std::to_string(size.y) + ".";
+        return false;
+    }
+
+    imagePath = path;
+    spriteSize = newSpriteSize;
+    image = std::make_shared<sf::Texture>();
+    if (!image->loadFromImage(source)) {
+        image.reset();
+        error = "Couldn't create a texture of " + path;
+        return false;
+    }
+
+    // Row by row, tiles with nothing visible aren't looked up - every blank sprite would match
+    const size_t rowBytes = static_cast<size_t>(spriteSize) * 4;
+    const size_t tileBytes = rowBytes * spriteSize;
+    const uint8_t* pixels = source.getPixelsPtr();
+    for (uint32_t tileY = 0; tileY < size.y / spriteSize; ++tileY) {
+        for (uint32_t tileX = 0; tileX < size.x / spriteSize; ++tileX) {
+            size_t offset = tilePixels.size();
+            tilePixels.resize(offset + tileBytes);
+            bool visible = false;
+            for (uint32_t row = 0; row < spriteSize; ++row) {
+                const uint8_t* src = pixels + ((static_cast<size_t>(tileY) * spriteSize + row) * size.x + tileX * spriteSize) * 4;
+                std::memcpy(tilePixels.data() + offset + row * rowBytes, src, rowBytes);
+                for (size_t alpha = 3; !visible && alpha < rowBytes; alpha += 4) {
+                    visible = src[alpha] != 0;
+                }
+            }
+
+            if (!visible) {
+                tilePixels.resize(offset);
+                ++emptyTiles;
+                continue;
+            }
+            TileResult result;
+            result.x = tileX;
+            result.y = tileY;
+            results.push_back(std::move(result));
+        }
+    }
+
+    pending = true;
+    return true;
+}
+
+void SpriteImageSearch::update(AssetsManager& assetsManager, size_t hashBudget) {
+    if (!pending) {
+        return;
+    }
+    if (assetsManager.getSpriteSize() != spriteSize) {
+        clear(); // other assets got loaded meanwhile
+        return;
+    }
+
+    missingHashes = assetsManager.hashMissingSprites(hashBudget);
+    if (missingHashes == 0) {
+        lookUp(assetsManager);
+    }
+}
+
+void SpriteImageSearch::lookUp(AssetsManager& assetsManager) {
+    auto start = std::chrono::steady_clock::now();
+
+    const size_t tileBytes = static_cast<size_t>(spriteSize) * spriteSize * 4;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> itemsOfSprite;
+    for (size_t i = 0; i < results.size(); ++i) {
+        results[i].spriteIds = assetsManager.findSpritesByPixels(tilePixels.data() + i * tileBytes);
+        for (uint32_t spriteId : results[i].spriteIds) {
+            itemsOfSprite.emplace(spriteId, std::vector<uint32_t>());
+        }
+        foundTiles += results[i].spriteIds.empty() ? 0 : 1;
+    }
+
+    // One pass over the items for all the tiles
+    if (!itemsOfSprite.empty()) {
+        const auto& itemTypes = Items::getItemTypes();
+        for (uint32_t itemId = 0; itemId < itemTypes.size(); ++itemId) {
+            if (!itemTypes[itemId]) {
+                continue;
+            }
+            for (uint32_t spriteId : itemTypes[itemId]->textureIdsVector) {
+                auto it = itemsOfSprite.find(spriteId);
+                if (it != itemsOfSprite.end() && (it->second.empty() || it->second.back() != itemId)) {
+                    it->second.push_back(itemId);
+                }
+            }
+        }
+    }
+    for (auto& result : results) {
+        for (uint32_t spriteId : result.spriteIds) {
+            const auto& items = itemsOfSprite[spriteId];
+            result.itemIds.insert(result.itemIds.end(), items.begin(), items.end());
+        }
+        std::sort(result.itemIds.begin(), result.itemIds.end());
+        result.itemIds.erase(std::unique(result.itemIds.begin(), result.itemIds.end()), result.itemIds.end());
+    }
+
+    tilePixels.clear();
+    tilePixels.shrink_to_fit();
+    pending = false;
+    lookupMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SpriteImageSearch::clear() {
+    imagePath.clear();
+    image.reset();
+    tilePixels.clear();
+    results.clear();
+    pending = false;
+    missingHashes = 0;
+    emptyTiles = 0;
+    foundTiles = 0;
+    lookupMs = 0.0f;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "../ResourceManagers/AssetsManager.h"
+
+/**
+ * @brief Finds where an image (or each sprite sized tile of it) already is among the loaded sprites
+ *
+ * Every tile's content hash is looked up in AssetsManager's sprite hash index, a single lookup per tile
+ * whatever the number of sprites. Only exact pixel matches are found, fully transparent tiles are skipped.
+ * Sprites the index doesn't know yet get hashed first, a budget per frame.
+ */
+class SpriteImageSearch {
+public:
+    struct TileResult {
+        uint32_t x = 0; // in tiles
+        uint32_t y = 0;
+        std::vector<uint32_t> spriteIds;
+        std::vector<uint32_t> itemIds; // ItemTypes that use any of the sprites
+    };
+
+    // UI thread. False with 'error' set if the image can't be read or isn't made of sprite sized tiles.
+    bool start(const std::string& path, uint32_t spriteSize, std::string& error);
+    // UI thread, once per frame - looks the tiles up once the index is complete
+    void update(AssetsManager& assetsManager, size_t hashBudget);
+    void clear();
+
+    [[nodiscard]] bool isPending() const { return pending; }
+    [[nodiscard]] bool hasResults() const { return !pending && image != nullptr; }
+    [[nodiscard]] const std::string& getImagePath() const { return imagePath; }
+    [[nodiscard]] uint32_t getSpriteSize() const { return spriteSize; }
+    // Whole image, the tiles are drawn out of it by their uv
+    [[nodiscard]] const std::shared_ptr<sf::Texture>& getImageTexture() const { return image; }
+    [[nodiscard]] size_t getMissingHashes() const { return missingHashes; }
+    [[nodiscard]] size_t getEmptyTiles() const { return emptyTiles; }
+    [[nodiscard]] size_t getFoundTiles() const { return foundTiles; }
+    [[nodiscard]] float getLookupMs() const { return lookupMs; }
+    // Every tile that isn't empty, found or not
+    [[nodiscard]] const std::vector<TileResult>& getResults() const { return results; }
+private:
+    void lookUp(AssetsManager& assetsManager);
+
+    std::string imagePath;
+    uint32_t spriteSize = 32;
+    std::shared_ptr<sf::Texture> image;
+    std::vector<uint8_t> tilePixels; // pending tiles, one after another
+    std::vector<TileResult> results;
+
+    bool pending = false;
+    size_t missingHashes = 0;
+    size_t emptyTiles = 0;
+    size_t foundTiles = 0;
+    float lookupMs = 0.0f;
+};
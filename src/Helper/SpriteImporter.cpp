@@ -0,0 +1,182 @@
+#include "SpriteImporter.h"
+#include "TextureUploader.h"
+#include <algorithm>
+#include <cstring>
+
+SpriteImporter::~SpriteImporter() {
+    cancel();
+}
+
+bool SpriteImporter::start(std::vector<std::string> filePaths, const Options& importOptions) {
+    if (active) {
+        return false;
+    }
+
+    session = std::make_shared<Session>();
+    session->options = importOptions;
+    session->paths = std::move(filePaths);
+    session->results.resize(session->paths.size());
+    cancelled = false;
+    takeFile = 0;
+    takeTile = 0;
+    uploadedTiles = 0;
+    active = !session->paths.empty();
+
+    // Each job keeps taking files, so they get decoded about in order and the uploads can follow right away
+    auto jobSystem = JobSystem::getInstance();
+    size_t jobCount = std::min(jobSystem->getWorkerCount(), session->paths.size());
+    jobs.clear();
+    for (size_t i = 0; i < jobCount; ++i) {
+        jobs.push_back(jobSystem->schedule("Decoding images", [session = session](Job& job) {
+            decodeFiles(*session, job);
+        }));
+    }
+    return true;
+}
+
+void SpriteImporter::cancel() {
+    cancelled = true;
+    for (const auto& job : jobs) {
+        job->cancel();
+    }
+    jobs.clear();
+
+    if (session) {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->results.clear();
+    }
+    active = false;
+}
+
+void SpriteImporter::decodeFiles(Session& session, Job& job) {
+    while (!job.isCancelled()) {
+        size_t index = session.nextFile.fetch_add(1);
+        if (index >= session.paths.size()) {
+            return;
+        }
+
+        // Decoded outside of the lock, only the hand over is guarded
+        FileResult result;
+        decodeFile(session, index, result);
+        result.ready = true;
+
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            if (index < session.results.size()) {
+                session.results[index] = std::move(result);
+            }
+        }
+        job.setProgress(++session.decodedFiles, session.paths.size());
+    }
+}
+
+void SpriteImporter::decodeFile(const Session& session, size_t index, FileResult& result) {
+    const Options& options = session.options;
+    sf::Image image;
+    if (!image.loadFromFile(session.paths[index])) {
+        result.error = "can't be decoded";
+        return;
+    }
+
+    const uint32_t size = options.spriteSize;
+    const sf::Vector2u imageSize = image.getSize();
+    const bool exactSprite = imageSize.x == size && imageSize.y == size;
+    const bool sheet = options.sliceSheets && imageSize.x > 0 && imageSize.y > 0 &&
+                       imageSize.x % size == 0 && imageSize.y % size == 0;
+    if (!exactSprite && !sheet) {
+        result.error = std::to_string(imageSize.x) + "x" + std::to_string(imageSize.y) + " isn't " +
+                       (options.sliceSheets ? "a multiple of " : "") + std::to_string(size) + "x" + std::to_string(size);
+        return;
+    }
+
+    const uint32_t columns = imageSize.x / size;
+    const uint32_t rows = imageSize.y / size;
+    const size_t rowBytes = static_cast<size_t>(size) * 4;
+    const size_t tileBytes = rowBytes * size;
+    const uint8_t* src = image.getPixelsPtr();
+
+    // Row by row, left to right - same order a sheet is read in
+    // Staging buffer of the uploader, so the pixels don't get copied again for the upload
+    result.pixels = TextureUploader::getInstance()->acquireStaging(static_cast<size_t>(columns) * rows * tileBytes);
+    uint32_t tiles = 0;
+    for (uint32_t row = 0; row < rows; ++row) {
+        for (uint32_t column = 0; column < columns; ++column) {
+            uint8_t* dst = result.pixels->data() + tiles * tileBytes;
+            bool empty = true;
+            for (uint32_t y = 0; y < size; ++y) {
+                const uint8_t* line = src + ((static_cast<size_t>(row) * size + y) * imageSize.x + column * size) * 4;
+                std::memcpy(dst + y * rowBytes, line, rowBytes);
+                for (size_t x = 3; x < rowBytes && empty; x += 4) {
+                    empty = line[x] == 0;
+                }
+            }
+
+            if (empty && options.skipEmptyTiles && !exactSprite) {
+                continue; // gets overwritten by the next tile
+            }
+            ++tiles;
+        }
+    }
+
+    result.tileCount = tiles;
+    if (tiles == 0) {
+        result.error = "has only empty tiles";
+    }
+}
+
+std::vector<std::shared_ptr<sf::Texture>> SpriteImporter::takeUploadBatch(size_t maxTiles) {
+    std::vector<std::shared_ptr<sf::Texture>> batch;
+    if (!active) {
+        return batch;
+    }
+
+    const uint32_t size = session->options.spriteSize;
+    const size_t tileBytes = static_cast<size_t>(size) * size * 4;
+
+    auto uploader = TextureUploader::getInstance();
+    std::lock_guard<std::mutex> lock(session->mutex);
+    auto& results = session->results;
+    while (batch.size() < maxTiles && uploader->hasBudget() && takeFile < results.size()) {
+        FileResult& result = results[takeFile];
+        if (!result.ready) {
+            break; // keep the file order
+        }
+
+        while (batch.size() < maxTiles && uploader->hasBudget() && takeTile < result.tileCount) {
+            auto texture = uploader->upload(size, size, result.pixels->data() + takeTile * tileBytes);
+            if (texture) {
+                batch.push_back(std::move(texture));
+            }
+            ++takeTile;
+        }
+
+        if (takeTile >= result.tileCount) {
+            // Pixels are on the GPU now, only the error (if any) is kept
+            result.pixels.reset();
+            ++takeFile;
+            takeTile = 0;
+        }
+    }
+
+    uploadedTiles += batch.size();
+    if (takeFile >= results.size()) {
+        active = false;
+    }
+    return batch;
+}
+
+std::vector<std::string> SpriteImporter::getErrors() {
+    std::vector<std::string> errors;
+    if (!session) {
+        return errors;
+    }
+
+    std::lock_guard<std::mutex> lock(session->mutex);
+    const auto& results = session->results;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].ready && !results[i].error.empty()) {
+            errors.push_back(session->paths[i] + ": " + results[i].error);
+        }
+    }
+    return errors;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "JobSystem.h"
+#include "TextureUploader.h"
+
+/**
+ * @brief Imports many image files at once, without blocking the UI
+ *
+ * Decoding and validation run as JobSystem jobs and only produce RGBA pixels.
+ * Sprite sheets (sizes that are a multiple of the sprite size) get sliced into tiles there too.
+ * The UI thread then takes the tiles in file order, as many per frame as the TextureUploader's budget allows,
+ * and turns them into textures - GPU uploads have to stay on the thread that owns the GL context.
+ */
+class SpriteImporter {
+public:
+    struct Options {
+        uint32_t spriteSize = 32;
+        bool sliceSheets = true;    // otherwise only images of exactly spriteSize are accepted
+        bool skipEmptyTiles = true; // fully transparent tiles of a sheet aren't imported
+    };
+
+    SpriteImporter() = default;
+    ~SpriteImporter();
+
+    SpriteImporter(const SpriteImporter&) = delete;
+    SpriteImporter& operator=(const SpriteImporter&) = delete;
+
+    // Starts importing the files (in the given order). False if an import is already running.
+    bool start(std::vector<std::string> paths, const Options& options);
+    // Jobs stop after the file they are on, tiles not taken yet are dropped
+    void cancel();
+
+    /**
+     * @brief Hands over decoded tiles as textures, in file order (UI thread only)
+     *
+     * Stops at the first file that isn't decoded yet, so ids always follow the file order.
+     *
+     * @param maxTiles Most tiles this call takes, it stops earlier once the frame's upload budget is used up.
+     */
+    std::vector<std::shared_ptr<sf::Texture>> takeUploadBatch(size_t maxTiles);
+
+    // True from start() until every tile got taken (or the import got cancelled)
+    [[nodiscard]] bool isActive() const { return active; }
+    [[nodiscard]] bool isCancelled() const { return cancelled; }
+
+    [[nodiscard]] size_t getTotalFiles() const { return session ? session->paths.size() : 0; }
+    [[nodiscard]] size_t getDecodedFiles() const { return session ? session->decodedFiles.load() : 0; }
+    [[nodiscard]] size_t getUploadedTiles() const { return uploadedTiles; }
+    // "path: reason" of every file that got rejected so far
+    [[nodiscard]] std::vector<std::string> getErrors();
+private:
+    struct FileResult {
+        bool ready = false;
+        uint32_t tileCount = 0;
+        TextureUploader::Staging pixels; // tileCount * spriteSize^2 RGBA, tile after tile
+        std::string error;
+    };
+
+    // Shared with the jobs, so a cancelled import can be replaced while some of them still run
+    struct Session {
+        Options options;
+        std::vector<std::string> paths;
+        std::vector<FileResult> results; // guarded by mutex until ready is set
+        std::mutex mutex;
+        std::atomic<size_t> nextFile{0};
+        std::atomic<size_t> decodedFiles{0};
+    };
+
+    // Job body, takes the next file until there are none left
+    static void decodeFiles(Session& session, Job& job);
+    static void decodeFile(const Session& session, size_t index, FileResult& result);
+
+    std::shared_ptr<Session> session;
+    std::vector<JobHandle> jobs;
+
+    // UI thread only
+    bool active = false;
+    bool cancelled = false;
+    size_t takeFile = 0; // next file to hand over
+    size_t takeTile = 0; // next tile of that file
+    size_t uploadedTiles = 0;
+};
@@ -0,0 +1,479 @@
+#include "SpriteSimilarity.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "../Misc/PerceptualHash.h"
+#include "../Misc/SpriteCodec.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/tools.h"
+#include "../Misc/definitions.h"
+
+namespace {
+    constexpr size_t HASH_JOB_SPRITES = 8192;
+    constexpr uint32_t CLUSTER_JOB_ENTRIES = 16384;
+
+    // All 16 bit masks by the number of bits set, masksUpToWeight[w] = how many have at most w bits
+    struct ChunkMasks {
+        std::vector<uint16_t> masks;
+        std::array<size_t, 17> masksUpToWeight{};
+
+        ChunkMasks() {
+            masks.reserve(1 << 16);
+            for (uint32_t weight = 0; weight <= 16; ++weight) {
+                for (uint32_t mask = 0; mask < (1u << 16); ++mask) {
+                    if (std::bitset<16>(mask).count() == weight) {
+                        masks.push_back(static_cast<uint16_t>(mask));
+                    }
+                }
+                masksUpToWeight[weight] = masks.size();
+            }
+        }
+    };
+
+    const ChunkMasks& getChunkMasks() {
+        static const ChunkMasks chunkMasks;
+        return chunkMasks;
+    }
+
+    // Chunk c is every 4th bit starting at c, so each chunk covers the whole sprite -
+    // contiguous bits would be the same 2 block rows, mostly empty for small sprites
+    uint32_t chunkOf(uint64_t hash, uint32_t chunk, uint32_t chunks, uint32_t chunkBits) {
+        uint32_t value = 0;
+        for (uint32_t bit = 0; bit < chunkBits; ++bit) {
+            value |= static_cast<uint32_t>((hash >> (bit * chunks + chunk)) & 1) << bit;
+        }
+        return value;
+    }
+
+    uint32_t findRoot(std::vector<std::atomic<uint32_t>>& parents, uint32_t x) {
+        while (true) {
+            uint32_t parent = parents[x].load();
+            if (parent == x) {
+                return x;
+            }
+            // Path halving, the grandparent is an ancestor whatever other threads do meanwhile
+            uint32_t grandparent = parents[parent].load();
+            if (grandparent != parent) {
+                parents[x].compare_exchange_weak(parent, grandparent);
+            }
+            x = grandparent;
+        }
+    }
+
+    void unite(std::vector<std::atomic<uint32_t>>& parents, uint32_t a, uint32_t b) {
+        while (true) {
+            a = findRoot(parents, a);
+            b = findRoot(parents, b);
+            if (a == b) {
+                return;
+            }
+            // Higher root goes under the lower one, fails if another thread linked it first
+            if (a < b) {
+                std::swap(a, b);
+            }
+            uint32_t expected = a;
+            if (parents[a].compare_exchange_strong(expected, b)) {
+                return;
+            }
+        }
+    }
+
+    // Record: 3 bytes color key, u16 size, RLE data
+    bool decodeRecord(const std::vector<char>& sprData, const SprRecordRef& record, bool transparency, uint32_t dimension, uint8_t* out) {
+        size_t start = static_cast<size_t>(record.offset) + 5;
+        if (record.offset == 0 || start > sprData.size()) {
+            return false;
+        }
+        size_t size = std::min<size_t>(record.dataSize, sprData.size() - start);
+        const auto* data = reinterpret_cast<const uint8_t*>(sprData.data()) + start;
+        return SpriteCodec::withCodec(transparency, dimension, [&](auto codec) {
+            using Codec = decltype(codec);
+            Codec::decode(data, size, out);
+        });
+    }
+}
+
+void SpriteSimilarity::Index::build() {
+    const auto count = static_cast<uint32_t>(hashes.size());
+    for (uint32_t chunk = 0; chunk < CHUNKS; ++chunk) {
+        // Counting sort of the entries by the chunk's value
+        auto& starts = bucketStarts[chunk];
+        auto& entries = bucketEntries[chunk];
+        starts.assign((1u << CHUNK_BITS) + 1, 0);
+        for (uint32_t entry = 0; entry < count; ++entry) {
+            ++starts[chunkOf(hashes[entry], chunk, CHUNKS, CHUNK_BITS) + 1];
+        }
+        for (size_t value = 1; value < starts.size(); ++value) {
+            starts[value] += starts[value - 1];
+        }
+
+        entries.resize(count);
+        std::vector<uint32_t> next(starts.begin(), starts.end() - 1);
+        for (uint32_t entry = 0; entry < count; ++entry) {
+            entries[next[chunkOf(hashes[entry], chunk, CHUNKS, CHUNK_BITS)]++] = entry;
+        }
+    }
+}
+
+template<typename Visit>
+void SpriteSimilarity::Index::query(uint64_t hash, uint32_t maxDistance, std::vector<uint32_t>& seen, uint32_t& queryId,
+                                    Visit&& visit) const {
+    maxDistance = std::min(maxDistance, MAX_DISTANCE);
+    if (seen.size() != hashes.size()) {
+        seen.assign(hashes.size(), 0);
+        queryId = 0;
+    }
+    if (++queryId == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        queryId = 1;
+    }
+
+    // Within maxDistance overall means at least one chunk is within maxDistance / CHUNKS
+    const auto& chunkMasks = getChunkMasks();
+    const size_t maskCount = chunkMasks.masksUpToWeight[maxDistance / CHUNKS];
+    for (uint32_t chunk = 0; chunk < CHUNKS; ++chunk) {
+        const uint32_t value = chunkOf(hash, chunk, CHUNKS, CHUNK_BITS);
+        const auto& starts = bucketStarts[chunk];
+        const auto& entries = bucketEntries[chunk];
+        for (size_t m = 0; m < maskCount; ++m) {
+            const uint32_t bucket = value ^ chunkMasks.masks[m];
+            for (uint32_t i = starts[bucket]; i < starts[bucket + 1]; ++i) {
+                const uint32_t entry = entries[i];
+                if (seen[entry] == queryId) {
+                    continue;
+                }
+                seen[entry] = queryId;
+
+                uint32_t distance = PerceptualHash::distance(hash, hashes[entry]);
+                if (distance <= maxDistance) {
+                    visit(entry, distance);
+                }
+            }
+        }
+    }
+}
+
+SpriteSimilarity::~SpriteSimilarity() {
+    cancel();
+}
+
+bool SpriteSimilarity::startIndexing(AssetsManager& assetsManager) {
+    if (build) {
+        Warninger::sendWarning(FUNC_NAME, "Sprites are already being indexed.");
+        return false;
+    }
+    const auto textureCount = static_cast<uint32_t>(assetsManager.getTextureCount());
+    if (textureCount < 2) {
+        Warninger::sendWarning(FUNC_NAME, "There are no sprites to index.");
+        return false;
+    }
+
+    auto newBuild = std::make_shared<Build>();
+    newBuild->dimension = assetsManager.getSpriteSize();
+    newBuild->index = std::make_shared<Index>();
+    newBuild->index->spritesRevision = assetsManager.getSpritesRevision();
+
+    // Untouched sprites come from the .spr itself, that is a plain read instead of a GPU readback each
+    SprSource source = assetsManager.getSprSource();
+    if (!source.path.empty() && !Tools::readFileBytes(source.path, newBuild->sprData)) {
+        Warninger::sendWarning(FUNC_NAME, "Couldn't read " + source.path + ", every sprite gets read back from its texture.");
+        source = SprSource();
+    }
+    newBuild->transparency = source.transparency;
+
+    pendingReadbacks.clear();
+    readbackPos = 0;
+    for (uint32_t id = 1; id < textureCount; ++id) {
+        if (!assetsManager.isValidTextureIndex(static_cast<int>(id))) {
+            continue;
+        }
+        if (source.canDecode(id)) {
+            newBuild->fromSpr.push_back(id);
+        } else {
+            pendingReadbacks.push_back(id);
+        }
+    }
+    newBuild->records = std::move(source.records);
+    newBuild->hashes.assign(textureCount, 0);
+    newBuild->hashed.assign(textureCount, 0);
+    newBuild->totalCount = newBuild->fromSpr.size() + pendingReadbacks.size();
+
+    auto jobSystem = JobSystem::getInstance();
+    buildJobs.clear();
+    for (size_t first = 0; first < newBuild->fromSpr.size(); first += HASH_JOB_SPRITES) {
+        size_t last = std::min(first + HASH_JOB_SPRITES, newBuild->fromSpr.size());
+        buildJobs.push_back(jobSystem->schedule("Hashing sprites", [newBuild, first, last](Job& job) {
+            hashFromSpr(*newBuild, first, last, job);
+        }));
+    }
+
+    build = std::move(newBuild);
+    indexJob.reset();
+    indexingStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+void SpriteSimilarity::hashFromSpr(Build& build, size_t first, size_t last, Job& job) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(build.dimension) * build.dimension * 4);
+    for (size_t i = first; i < last; ++i) {
+        if (job.isCancelled()) {
+            return;
+        }
+
+        uint32_t id = build.fromSpr[i];
+        if (id < build.records.size() && decodeRecord(build.sprData, build.records[id], build.transparency, build.dimension, pixels.data()) &&
+            PerceptualHash::compute(pixels.data(), build.dimension, build.hashes[id])) {
+            build.hashed[id] = 1;
+        }
+        ++build.doneCount;
+        job.setProgress(i + 1 - first, last - first);
+    }
+}
+
+void SpriteSimilarity::update(AssetsManager& assetsManager, size_t readbackBudget) {
+    if (build) {
+        const uint32_t dimension = build->dimension;
+        for (size_t n = 0; n < readbackBudget && readbackPos < pendingReadbacks.size(); ++n) {
+            uint32_t id = pendingReadbacks[readbackPos++];
+            ++build->doneCount;
+            if (!assetsManager.isValidTextureIndex(static_cast<int>(id))) {
+                continue; // removed meanwhile
+            }
+
+            sf::Image image = assetsManager.getTexture(static_cast<int>(id))->copyToImage();
+            if (image.getSize().x == dimension && image.getSize().y == dimension &&
+                PerceptualHash::compute(image.getPixelsPtr(), dimension, build->hashes[id])) {
+                build->hashed[id] = 1;
+            }
+        }
+
+        // Readbacks are done on this thread, so it's only now the index can wait for the rest
+        if (!indexJob && readbackPos >= pendingReadbacks.size()) {
+            auto finishedBuild = build;
+            indexJob = JobSystem::getInstance()->schedule("Indexing sprite hashes", [finishedBuild](Job& job) {
+                Index& newIndex = *finishedBuild->index;
+                const auto textureCount = static_cast<uint32_t>(finishedBuild->hashed.size());
+                newIndex.entryOfSprite.assign(textureCount, NO_ENTRY);
+                for (uint32_t id = 0; id < textureCount; ++id) {
+                    if (finishedBuild->hashed[id]) {
+                        newIndex.entryOfSprite[id] = static_cast<uint32_t>(newIndex.spriteIds.size());
+                        newIndex.spriteIds.push_back(id);
+                        newIndex.hashes.push_back(finishedBuild->hashes[id]);
+                    }
+                }
+                newIndex.blankCount = finishedBuild->totalCount - newIndex.spriteIds.size();
+                if (!job.isCancelled()) {
+                    newIndex.build();
+                }
+            }, buildJobs);
+        }
+
+        if (indexJob && indexJob->isFinished()) {
+            if (indexJob->getStatus() == Job::Status::DONE) {
+                index = build->index;
+                ++indexVersion;
+                seen.assign(index->hashes.size(), 0);
+                queryId = 0;
+                indexingMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - indexingStart).count();
+                fmt::print("Indexed {} sprites for similarity ({} blank) in {:.0f} ms\n", index->spriteIds.size(),
+                           index->blankCount, indexingMs);
+            } else if (indexJob->getStatus() == Job::Status::FAILED) {
+                Warninger::sendWarning(FUNC_NAME, "Indexing sprites failed: " + indexJob->getError());
+            }
+
+            build.reset();
+            buildJobs.clear();
+            indexJob.reset();
+            pendingReadbacks.clear();
+            readbackPos = 0;
+        }
+    }
+
+    if (clustering && clusteringJobs.back()->isFinished()) {
+        if (clusteringJobs.back()->getStatus() == Job::Status::DONE) {
+            clusters = std::move(clustering->clusters);
+            clustersIndex = clustering->index;
+            clustersDistance = clustering->maxDistance;
+            clusteringMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - clusteringStart).count();
+            fmt::print("Found {} clusters of similar sprites (distance {}) in {:.0f} ms\n", clusters.size(),
+                       clustersDistance, clusteringMs);
+        }
+        clustering.reset();
+        clusteringJobs.clear();
+    }
+}
+
+void SpriteSimilarity::cancel() {
+    for (const auto& job : buildJobs) {
+        job->cancel();
+    }
+    if (indexJob) {
+        indexJob->cancel();
+    }
+    for (const auto& job : clusteringJobs) {
+        job->cancel();
+    }
+
+    // Jobs still running keep their state alive themselves
+    build.reset();
+    buildJobs.clear();
+    indexJob.reset();
+    pendingReadbacks.clear();
+    readbackPos = 0;
+    clustering.reset();
+    clusteringJobs.clear();
+}
+
+float SpriteSimilarity::getIndexingProgress() const {
+    if (!build || build->totalCount == 0) {
+        return 1.0f;
+    }
+    return static_cast<float>(build->doneCount.load()) / static_cast<float>(build->totalCount);
+}
+
+bool SpriteSimilarity::isStale(const AssetsManager& assetsManager) const {
+    return index && index->spritesRevision != assetsManager.getSpritesRevision();
+}
+
+size_t SpriteSimilarity::getIndexedCount() const {
+    return index ? index->spriteIds.size() : 0;
+}
+
+size_t SpriteSimilarity::getBlankCount() const {
+    return index ? index->blankCount : 0;
+}
+
+std::vector<SpriteSimilarity::Match> SpriteSimilarity::findSimilar(uint32_t spriteId, uint32_t maxDistance) {
+    if (!index || spriteId >= index->entryOfSprite.size() || index->entryOfSprite[spriteId] == NO_ENTRY) {
+        return {};
+    }
+    return findSimilarToHash(index->hashes[index->entryOfSprite[spriteId]], maxDistance, spriteId);
+}
+
+std::vector<SpriteSimilarity::Match> SpriteSimilarity::findSimilarToHash(uint64_t hash, uint32_t maxDistance, uint32_t excludedSpriteId) {
+    std::vector<Match> matches;
+    if (!index) {
+        return matches;
+    }
+
+    index->query(hash, maxDistance, seen, queryId, [&](uint32_t entry, uint32_t distance) {
+        uint32_t spriteId = index->spriteIds[entry];
+        if (spriteId != excludedSpriteId) {
+            matches.push_back({spriteId, distance});
+        }
+    });
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.spriteId < b.spriteId;
+    });
+    return matches;
+}
+
+bool SpriteSimilarity::startClustering(uint32_t maxDistance) {
+    if (!index) {
+        Warninger::sendWarning(FUNC_NAME, "Sprites have to be indexed first.");
+        return false;
+    }
+    if (clustering) {
+        Warninger::sendWarning(FUNC_NAME, "Sprites are already being grouped.");
+        return false;
+    }
+
+    auto newClustering = std::make_shared<Clustering>();
+    newClustering->index = index;
+    newClustering->maxDistance = std::min(maxDistance, MAX_DISTANCE);
+    const auto count = static_cast<uint32_t>(index->hashes.size());
+    newClustering->parents = std::vector<std::atomic<uint32_t>>(count);
+    for (uint32_t entry = 0; entry < count; ++entry) {
+        newClustering->parents[entry].store(entry, std::memory_order_relaxed);
+    }
+
+    auto jobSystem = JobSystem::getInstance();
+    clusteringJobs.clear();
+    for (uint32_t first = 0; first < count; first += CLUSTER_JOB_ENTRIES) {
+        uint32_t last = std::min(first + CLUSTER_JOB_ENTRIES, count);
+        clusteringJobs.push_back(jobSystem->schedule("Finding similar sprites", [newClustering, first, last](Job& job) {
+            linkSimilar(*newClustering, first, last, job);
+        }));
+    }
+    clusteringJobs.push_back(jobSystem->schedule("Grouping similar sprites", [newClustering](Job&) {
+        groupClusters(*newClustering);
+    }, clusteringJobs));
+
+    clustering = std::move(newClustering);
+    clusteringStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+void SpriteSimilarity::linkSimilar(Clustering& clustering, uint32_t first, uint32_t last, Job& job) {
+    const Index& clusteringIndex = *clustering.index;
+    std::vector<uint32_t> jobSeen;
+    uint32_t jobQueryId = 0;
+    for (uint32_t entry = first; entry < last; ++entry) {
+        if (job.isCancelled()) {
+            return;
+        }
+
+        // Pairs are symmetric, each one is linked from its lower entry
+        clusteringIndex.query(clusteringIndex.hashes[entry], clustering.maxDistance, jobSeen, jobQueryId,
+                              [&](uint32_t other, uint32_t) {
+            if (other > entry) {
+                unite(clustering.parents, entry, other);
+            }
+        });
+        ++clustering.doneCount;
+        job.setProgress(entry + 1 - first, last - first);
+    }
+}
+
+void SpriteSimilarity::groupClusters(Clustering& clustering) {
+    const Index& clusteringIndex = *clustering.index;
+    const auto count = static_cast<uint32_t>(clusteringIndex.hashes.size());
+    std::vector<uint32_t> clusterOfRoot(count, NO_ENTRY);
+    std::vector<std::vector<uint32_t>> groups;
+    for (uint32_t entry = 0; entry < count; ++entry) {
+        uint32_t root = findRoot(clustering.parents, entry);
+        if (clusterOfRoot[root] == NO_ENTRY) {
+            clusterOfRoot[root] = static_cast<uint32_t>(groups.size());
+            groups.emplace_back();
+        }
+        // Entries follow the sprite ids, so every group is sorted already
+        groups[clusterOfRoot[root]].push_back(clusteringIndex.spriteIds[entry]);
+    }
+
+    clustering.clusters.clear();
+    for (auto& group : groups) {
+        if (group.size() > 1) {
+            clustering.clusters.push_back(std::move(group));
+        }
+    }
+    std::sort(clustering.clusters.begin(), clustering.clusters.end(), [](const auto& a, const auto& b) {
+        return a.size() != b.size() ? a.size() > b.size() : a.front() < b.front();
+    });
+}
+
+float SpriteSimilarity::getClusteringProgress() const {
+    if (!clustering || clustering->parents.empty()) {
+        return 1.0f;
+    }
+    return static_cast<float>(clustering->doneCount.load()) / static_cast<float>(clustering->parents.size());
+}
+
+bool SpriteSimilarity::exportClustersCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        Warninger::sendWarning(FUNC_NAME, "Unable to open " + path);
+        return false;
+    }
+
+    // Distance is to the first sprite of the cluster
+    file << "cluster,size,spriteId,distance\n";
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const auto& cluster = clusters[i];
+        uint64_t firstHash = clustersIndex->hashes[clustersIndex->entryOfSprite[cluster.front()]];
+        for (uint32_t spriteId : cluster) {
+            uint64_t hash = clustersIndex->hashes[clustersIndex->entryOfSprite[spriteId]];
+            file << i << ',' << cluster.size() << ',' << spriteId << ',' << PerceptualHash::distance(firstHash, hash) << '\n';
+        }
+    }
+    return file.good();
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "../ResourceManagers/AssetsManager.h"
+
+/**
+ * @brief Finds near-duplicate sprites by their perceptual hash (Misc/PerceptualHash.h)
+ *
+ * Hashes of all sprites get computed as jobs - untouched sprites decoded straight from the loaded .spr,
+ * changed ones read back from their textures on the UI thread, a budget per frame.
+ * They are then put into a multi-index hash: the 64 bits are split into 4 chunks of 16 bits with a table each.
+ * Two hashes within distance d have at least one chunk within d/4 of each other, so a query only
+ * looks at the few buckets around its chunks instead of every sprite.
+ *
+ * The index is a snapshot, once sprites change it's stale until rebuilt.
+ */
+class SpriteSimilarity {
+public:
+    static constexpr uint32_t MAX_DISTANCE = 16;
+
+    struct Match {
+        uint32_t spriteId = 0;
+        uint32_t distance = 0;
+    };
+
+    SpriteSimilarity() = default;
+    ~SpriteSimilarity();
+
+    SpriteSimilarity(const SpriteSimilarity&) = delete;
+    SpriteSimilarity& operator=(const SpriteSimilarity&) = delete;
+
+    // UI thread. False if it's already indexing or there are no sprites.
+    bool startIndexing(AssetsManager& assetsManager);
+    // UI thread, once per frame: reads back up to readbackBudget textures and picks up finished jobs
+    void update(AssetsManager& assetsManager, size_t readbackBudget);
+    // Stops indexing and clustering, the last finished index stays
+    void cancel();
+
+    [[nodiscard]] bool isIndexing() const { return build != nullptr; }
+    [[nodiscard]] float getIndexingProgress() const;
+    [[nodiscard]] bool hasIndex() const { return index != nullptr; }
+    // Sprites got changed/loaded since the index was built
+    [[nodiscard]] bool isStale(const AssetsManager& assetsManager) const;
+    [[nodiscard]] size_t getIndexedCount() const;
+    [[nodiscard]] size_t getBlankCount() const;
+    [[nodiscard]] float getIndexingMs() const { return indexingMs; }
+    // Goes up with every index that gets built, to tell when earlier query results are outdated
+    [[nodiscard]] uint32_t getIndexVersion() const { return indexVersion; }
+
+    // Sprites within maxDistance of the sprite (itself excluded), closest first. Empty for blank/unknown sprites.
+    [[nodiscard]] std::vector<Match> findSimilar(uint32_t spriteId, uint32_t maxDistance);
+    // Same for any hash, e.g. of an image that isn't a sprite
+    [[nodiscard]] std::vector<Match> findSimilarToHash(uint64_t hash, uint32_t maxDistance, uint32_t excludedSpriteId = 0);
+
+    // Groups all sprites within maxDistance of each other (transitively), as jobs. False if there is no index.
+    bool startClustering(uint32_t maxDistance);
+    [[nodiscard]] bool isClustering() const { return clustering != nullptr; }
+    [[nodiscard]] float getClusteringProgress() const;
+    // Biggest first, sprite ids ascending in each, single sprites aren't listed
+    [[nodiscard]] const std::vector<std::vector<uint32_t>>& getClusters() const { return clusters; }
+    [[nodiscard]] uint32_t getClustersDistance() const { return clustersDistance; }
+    [[nodiscard]] float getClusteringMs() const { return clusteringMs; }
+
+    // One row per sprite of every cluster, false if the file couldn't be written
+    bool exportClustersCsv(const std::string& path) const;
+private:
+    static constexpr uint32_t CHUNKS = 4;
+    static constexpr uint32_t CHUNK_BITS = 16;
+    static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+    struct Index {
+        uint64_t spritesRevision = 0;
+        size_t blankCount = 0;
+        std::vector<uint32_t> spriteIds;   // entry -> sprite id
+        std::vector<uint64_t> hashes;      // entry -> hash
+        std::vector<uint32_t> entryOfSprite; // sprite id -> entry, NO_ENTRY if blank
+        // Per chunk, entries sorted by the chunk's value - bucketStarts[value]..bucketStarts[value + 1]
+        std::array<std::vector<uint32_t>, CHUNKS> bucketStarts;
+        std::array<std::vector<uint32_t>, CHUNKS> bucketEntries;
+
+        void build();
+        // Calls visit(entry, distance) for the entries within maxDistance of hash.
+        // 'seen' has a slot per entry, so candidates in more than one bucket are checked only once.
+        template<typename Visit>
+        void query(uint64_t hash, uint32_t maxDistance, std::vector<uint32_t>& seen, uint32_t& queryId, Visit&& visit) const;
+    };
+
+    // Shared with the jobs
+    struct Build {
+        uint32_t dimension = 32;
+        bool transparency = false;
+        std::vector<char> sprData; // whole loaded .spr
+        std::vector<SprRecordRef> records;
+        std::vector<uint32_t> fromSpr; // sprite ids decoded from sprData
+        std::shared_ptr<Index> index;
+        std::vector<uint64_t> hashes;  // index = sprite id, valid if hashed[id]
+        std::vector<uint8_t> hashed;
+        std::atomic<size_t> doneCount{0};
+        size_t totalCount = 0;
+    };
+
+    struct Clustering {
+        std::shared_ptr<const Index> index;
+        uint32_t maxDistance = 0;
+        // Union-find over the entries, shared by all the jobs - roots only change through compare-exchange
+        std::vector<std::atomic<uint32_t>> parents;
+        std::vector<std::vector<uint32_t>> clusters;
+        std::atomic<size_t> doneCount{0};
+    };
+
+    static void hashFromSpr(Build& build, size_t first, size_t last, Job& job);
+    static void linkSimilar(Clustering& clustering, uint32_t first, uint32_t last, Job& job);
+    static void groupClusters(Clustering& clustering);
+
+    std::shared_ptr<Build> build;
+    std::vector<JobHandle> buildJobs;
+    JobHandle indexJob;
+    std::vector<uint32_t> pendingReadbacks; // UI thread only
+    size_t readbackPos = 0;
+    std::chrono::steady_clock::time_point indexingStart;
+    float indexingMs = 0.0f;
+
+    std::shared_ptr<const Index> index;
+    uint32_t indexVersion = 0;
+    std::vector<uint32_t> seen; // for the queries from the UI thread
+    uint32_t queryId = 0;
+
+    std::shared_ptr<Clustering> clustering;
+    std::vector<JobHandle> clusteringJobs; // last one groups, once the others are done
+    std::chrono::steady_clock::time_point clusteringStart;
+    std::shared_ptr<const Index> clustersIndex;
+    std::vector<std::vector<uint32_t>> clusters;
+    uint32_t clustersDistance = 0;
+    float clusteringMs = 0.0f;
+};
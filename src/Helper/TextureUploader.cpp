@@ -0,0 +1,146 @@
+#include "TextureUploader.h"
+#include <algorithm>
+#include "../ResourceManagers/ConfigManager.h"
+
+void TextureUploader::beginFrame() {
+    lastFrameUploads = frameUploads;
+    lastFrameBytes = frameBytes;
+    lastFrameMs = std::chrono::duration<float, std::milli>(frameTime).count();
+
+    frameUploads = 0;
+    frameBytes = 0;
+    frameTime = {};
+}
+
+bool TextureUploader::hasBudget() const {
+    if (frameUploads == 0) {
+        return true;
+    }
+
+    auto config = ConfigManager::getInstance();
+    return frameBytes < config->getUploadBudgetBytes() &&
+           std::chrono::duration<float, std::milli>(frameTime).count() < config->getUploadBudgetMs();
+}
+
+std::shared_ptr<sf::Texture> TextureUploader::upload(uint32_t width, uint32_t height, const uint8_t* pixels) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto texture = std::make_shared<sf::Texture>(sf::Vector2u(width, height));
+    if (texture->getSize().x == 0 || texture->getSize().y == 0) {
+        texture.reset();
+    } else {
+        texture->update(pixels);
+    }
+
+    ++frameUploads;
+    frameBytes += static_cast<size_t>(width) * height * 4;
+    frameTime += std::chrono::steady_clock::now() - start;
+    return texture;
+}
+
+TextureUploader::Staging TextureUploader::acquireStaging(size_t size) {
+    std::unique_ptr<std::vector<uint8_t>> buffer;
+    {
+        // Smallest pooled buffer that fits, so big ones stay for big requests
+        std::lock_guard<std::mutex> lock(poolMutex);
+        auto best = pool.end();
+        for (auto it = pool.begin(); it != pool.end(); ++it) {
+            if ((*it)->capacity() >= size && (best == pool.end() || (*it)->capacity() < (*best)->capacity())) {
+                best = it;
+            }
+        }
+        if (best != pool.end()) {
+            pooledBytes -= (*best)->capacity();
+            buffer = std::move(*best);
+            pool.erase(best);
+        }
+    }
+
+    if (!buffer) {
+        buffer = std::make_unique<std::vector<uint8_t>>();
+    }
+    buffer->resize(size);
+    handedOutBytes += buffer->capacity();
+    return Staging(buffer.release(), [this](std::vector<uint8_t>* released) { release(released); });
+}
+
+void TextureUploader::release(std::vector<uint8_t>* buffer) {
+    std::unique_ptr<std::vector<uint8_t>> owned(buffer);
+    handedOutBytes -= owned->capacity();
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (pooledBytes + owned->capacity() > ConfigManager::getInstance()->getStagingPoolBytes()) {
+        return; // pool is full, this one gets freed
+    }
+    pooledBytes += owned->capacity();
+    pool.push_back(std::move(owned));
+}
+
+void TextureUploader::enqueue(Staging staging, size_t offset, uint32_t width, uint32_t height, Callback onUploaded, const void* owner) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    queue.push_back({std::move(staging), offset, width, height, std::move(onUploaded), owner});
+}
+
+void TextureUploader::cancel(const void* owner) {
+    std::deque<Request> dropped; // staging buffers go back to the pool outside of the lock
+    std::lock_guard<std::mutex> lock(queueMutex);
+    for (auto it = queue.begin(); it != queue.end();) {
+        if (it->owner == owner) {
+            dropped.push_back(std::move(*it));
+            it = queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TextureUploader::drain() {
+    while (hasBudget() && uploadNext()) {
+    }
+}
+
+void TextureUploader::flush() {
+    while (uploadNext()) {
+    }
+}
+
+size_t TextureUploader::getPendingCount() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queue.size();
+}
+
+size_t TextureUploader::getStagingBytes() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return pooledBytes + handedOutBytes;
+}
+
+void TextureUploader::trimPool(size_t maxBytes) {
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> freed; // deallocated outside of the lock
+    std::lock_guard<std::mutex> lock(poolMutex);
+    std::sort(pool.begin(), pool.end(), [](const auto& a, const auto& b) { return a->capacity() < b->capacity(); });
+    while (pooledBytes > maxBytes && !pool.empty()) {
+        pooledBytes -= pool.back()->capacity();
+        freed.push_back(std::move(pool.back()));
+        pool.pop_back();
+    }
+}
+
+bool TextureUploader::uploadNext() {
+    Request request;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.empty()) {
+            return false;
+        }
+        request = std::move(queue.front());
+        queue.pop_front();
+    }
+
+    auto texture = upload(request.width, request.height, request.staging->data() + request.offset);
+    // Last upload of the buffer hands it back to the pool
+    request.staging.reset();
+    if (request.onUploaded) {
+        request.onUploaded(std::move(texture));
+    }
+    return true;
+}
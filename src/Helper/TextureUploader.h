@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+/**
+ * @brief Spreads texture uploads over frames
+ *
+ * Every frame gets a time and byte budget (config's [PERFORMANCE]) for creating textures out of pixels.
+ * Code on the UI thread that uploads a batch of its own asks hasBudget() before each one, anything else
+ * queues its pixels with enqueue() (from any thread) and the main loop drains the queue with what's left.
+ *
+ * Pixels wait in staging buffers from a pool - once all the uploads of a buffer are done it goes back
+ * to the pool, so streaming a whole .spr or import keeps reusing the same few allocations.
+ */
+class TextureUploader {
+public:
+    // Pixels waiting for upload, goes back to the pool once the last reference is gone
+    using Staging = std::shared_ptr<std::vector<uint8_t>>;
+    // UI thread. nullptr if the texture couldn't be created.
+    using Callback = std::function<void(std::shared_ptr<sf::Texture>)>;
+
+    static TextureUploader* getInstance() {
+        if (instance_ == nullptr) {
+            instance_ = new TextureUploader();
+        }
+
+        return instance_;
+    }
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    // Main loop, before anything uploads in the frame
+    void beginFrame();
+    // True while this frame's budget isn't used up, the first upload of a frame always fits
+    [[nodiscard]] bool hasBudget() const;
+
+    // UI thread. Creates the texture right away and counts it against the frame's budget, nullptr if it couldn't be created.
+    std::shared_ptr<sf::Texture> upload(uint32_t width, uint32_t height, const uint8_t* pixels);
+
+    // Any thread. Buffer of exactly 'size' bytes, contents are undefined.
+    Staging acquireStaging(size_t size);
+    /**
+     * @brief Queues an upload, any thread
+     *
+     * @param offset where the RGBA of the texture starts in 'staging'
+     * @param owner anything that identifies who queued it, to drop its uploads with cancel()
+     */
+    void enqueue(Staging staging, size_t offset, uint32_t width, uint32_t height, Callback onUploaded, const void* owner = nullptr);
+    // Drops the queued uploads of 'owner', their callbacks don't get called
+    void cancel(const void* owner);
+
+    // Main loop, once per frame - uploads from the queue while there's budget left
+    void drain();
+    // UI thread. Uploads the whole queue now, for code that has to have the textures before it goes on.
+    void flush();
+
+    [[nodiscard]] size_t getPendingCount();
+    // Pixels held in staging buffers, both handed out and pooled
+    [[nodiscard]] size_t getStagingBytes();
+    // Frees pooled buffers (biggest first) until at most 'maxBytes' stay in the pool
+    void trimPool(size_t maxBytes);
+    // Of the last finished frame
+    [[nodiscard]] size_t getLastFrameUploads() const { return lastFrameUploads; }
+    [[nodiscard]] size_t getLastFrameBytes() const { return lastFrameBytes; }
+    [[nodiscard]] float getLastFrameMs() const { return lastFrameMs; }
+private:
+    TextureUploader() = default;
+    inline static TextureUploader* instance_ = nullptr;
+
+    struct Request {
+        Staging staging;
+        size_t offset = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        Callback onUploaded;
+        const void* owner = nullptr;
+    };
+    // False if the queue is empty
+    bool uploadNext();
+    void release(std::vector<uint8_t>* buffer);
+
+    std::mutex queueMutex;
+    std::deque<Request> queue;
+
+    std::mutex poolMutex;
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> pool;
+    size_t pooledBytes = 0;
+    std::atomic<size_t> handedOutBytes{0};
+
+    // UI thread only
+    size_t frameUploads = 0;
+    size_t frameBytes = 0;
+    std::chrono::steady_clock::duration frameTime{};
+    size_t lastFrameUploads = 0;
+    size_t lastFrameBytes = 0;
+    float lastFrameMs = 0.0f;
+};
@@ -0,0 +1,162 @@
+#include "ThumbnailCache.h"
+#include <cstring>
+#include <filesystem>
+#include "AtomicFileWriter.h"
+#include "../Misc/BinaryReader.h"
+#include "../Misc/BinaryWriter.h"
+#include "../Misc/Warninger.h"
+#include "../Misc/definitions.h"
+
+namespace {
+    constexpr size_t HEADER_SIZE = 20;
+    constexpr size_t INDEX_ENTRY_SIZE = 16;
+}
+
+ThumbnailCache::~ThumbnailCache() {
+    close();
+}
+
+std::string ThumbnailCache::getPathFor(const std::string& sprPath) {
+    return std::filesystem::path(sprPath).replace_extension(".thumbs").string();
+}
+
+void ThumbnailCache::open(const std::string& newPath, uint32_t newWidth, uint32_t newHeight, size_t newMaxEntries) {
+    close();
+    path = newPath;
+    width = newWidth;
+    height = newHeight;
+    maxEntries = newMaxEntries;
+
+    if (!std::filesystem::exists(path) || !file.open(path)) {
+        return;
+    }
+
+    BinaryReader reader(file.data(), file.size());
+    uint32_t magic = reader.readU32();
+    uint16_t version = reader.readU16();
+    reader.skip(2);
+    uint32_t fileWidth = reader.readU32();
+    uint32_t fileHeight = reader.readU32();
+    uint32_t count = reader.readU32();
+
+    // Other thumbnail size (button size changed in config) - everything gets rebuilt
+    if (reader.overflowed() || magic != MAGIC || version != VERSION || fileWidth != width || fileHeight != height ||
+        count > (file.size() - HEADER_SIZE) / INDEX_ENTRY_SIZE) {
+        file.close();
+        return;
+    }
+
+    const size_t thumbnailBytes = getThumbnailBytes();
+    fileEntries.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t key = reader.read<uint64_t>();
+        uint64_t offset = reader.read<uint64_t>();
+        if (offset >= HEADER_SIZE && offset <= file.size() && thumbnailBytes <= file.size() - offset) {
+            fileEntries.emplace(key, offset);
+        }
+    }
+}
+
+bool ThumbnailCache::flush() {
+    if (!isOpen() || addedEntries.empty()) {
+        return true;
+    }
+
+    // New and used thumbnails first, the rest of the old ones while there's room
+    std::vector<std::pair<uint64_t, const uint8_t*>> entries;
+    entries.reserve(addedEntries.size() + fileEntries.size());
+    for (const auto& [key, pixels] : addedEntries) {
+        entries.emplace_back(key, pixels.data());
+    }
+    for (const auto& [key, offset] : fileEntries) {
+        if (addedEntries.count(key) == 0 && usedKeys.count(key) != 0) {
+            entries.emplace_back(key, file.data() + offset);
+        }
+    }
+    for (const auto& [key, offset] : fileEntries) {
+        if (entries.size() >= maxEntries) {
+            break;
+        }
+        if (addedEntries.count(key) == 0 && usedKeys.count(key) == 0) {
+            entries.emplace_back(key, file.data() + offset);
+        }
+    }
+
+    std::vector<uint8_t> buffer;
+    BinaryWriter writer(buffer);
+    writer.writeU32(MAGIC);
+    writer.writeU16(VERSION);
+    writer.writeU16(0);
+    writer.writeU32(width);
+    writer.writeU32(height);
+    writer.writeU32(static_cast<uint32_t>(entries.size()));
+
+    const size_t thumbnailBytes = getThumbnailBytes();
+    uint64_t offset = HEADER_SIZE + entries.size() * INDEX_ENTRY_SIZE;
+    for (const auto& entry : entries) {
+        writer.write<uint64_t>(entry.first);
+        writer.write<uint64_t>(offset);
+        offset += thumbnailBytes;
+    }
+
+    AtomicFileWriter out(path);
+    bool written = out.isOpen() && out.write(buffer.data(), buffer.size());
+    for (size_t i = 0; written && i < entries.size(); ++i) {
+        written = out.write(entries[i].second, thumbnailBytes);
+    }
+
+    // Old file has to be unmapped before it can be replaced (Windows)
+    file.close();
+    fileEntries.clear();
+    if (!written || !out.commit()) {
+        Warninger::sendWarning(FUNC_NAME, "Failed to write thumbnail cache: " + path);
+        addedEntries.clear();
+        return false;
+    }
+
+    // From now on everything comes from the new file
+    addedEntries.clear();
+    if (file.open(path)) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            fileEntries.emplace(entries[i].first, HEADER_SIZE + entries.size() * INDEX_ENTRY_SIZE + i * thumbnailBytes);
+        }
+    }
+    return true;
+}
+
+void ThumbnailCache::close() {
+    flush();
+    file.close();
+    fileEntries.clear();
+    addedEntries.clear();
+    usedKeys.clear();
+    path.clear();
+    width = 0;
+    height = 0;
+}
+
+const uint8_t* ThumbnailCache::find(uint64_t key) {
+    if (!isOpen()) {
+        return nullptr;
+    }
+
+    auto added = addedEntries.find(key);
+    if (added != addedEntries.end()) {
+        return added->second.data();
+    }
+
+    auto entry = fileEntries.find(key);
+    if (entry == fileEntries.end()) {
+        return nullptr;
+    }
+    usedKeys.insert(key);
+    return file.data() + entry->second;
+}
+
+void ThumbnailCache::store(uint64_t key, const uint8_t* rgba) {
+    if (!isOpen() || rgba == nullptr) {
+        return;
+    }
+
+    addedEntries[key].assign(rgba, rgba + getThumbnailBytes());
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "MappedFile.h"
+
+/**
+ * @brief Item preview thumbnails kept in one packed file next to the assets
+ *
+ * Layout (little-endian):
+ *   header - magic "OTTC", u16 version, u16 reserved, u32 width, u32 height, u32 entry count
+ *   index  - {u64 key, u64 offset} per entry
+ *   pixels - raw RGBA, width * height * 4 bytes per entry
+ *
+ * Keys are content hashes (AssetsManager::getPreviewKey()), so a changed item simply gets a new key
+ * and a stale thumbnail is never found. Lookups read straight from the mapped file,
+ * new thumbnails stay in memory until flush().
+ */
+class ThumbnailCache {
+public:
+    static constexpr uint32_t MAGIC = 0x4354544F; // "OTTC"
+    static constexpr uint16_t VERSION = 1;
+
+    ThumbnailCache() = default;
+    ~ThumbnailCache();
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    // e.g. Tibia.spr -> Tibia.thumbs
+    static std::string getPathFor(const std::string& sprPath);
+
+    /**
+     * @brief Starts using the cache file at path (the previous one gets flushed)
+     *
+     * A missing file, or one with thumbnails of another size, just starts out empty.
+     *
+     * @param maxEntries on flush, entries that weren't used since open() are dropped above this count
+     */
+    void open(const std::string& path, uint32_t width, uint32_t height, size_t maxEntries);
+    // Writes the file if anything got added, returns false if that failed
+    bool flush();
+    // Flushes and forgets everything
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return !path.empty(); }
+    [[nodiscard]] uint32_t getWidth() const { return width; }
+    [[nodiscard]] uint32_t getHeight() const { return height; }
+
+    // RGBA of width * height * 4 bytes, nullptr if it isn't cached
+    const uint8_t* find(uint64_t key);
+    void store(uint64_t key, const uint8_t* rgba);
+
+    // Pixels of the thumbnails that wait in memory for flush()
+    [[nodiscard]] size_t getPendingBytes() const { return addedEntries.size() * getThumbnailBytes(); }
+private:
+    [[nodiscard]] size_t getThumbnailBytes() const { return static_cast<size_t>(width) * height * 4; }
+
+    std::string path;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t maxEntries = 0;
+
+    MappedFile file;
+    std::unordered_map<uint64_t, uint64_t> fileEntries; // key -> offset of the pixels in the file
+    std::unordered_map<uint64_t, std::vector<uint8_t>> addedEntries;
+    std::unordered_set<uint64_t> usedKeys; // found since open(), always kept on flush
+};
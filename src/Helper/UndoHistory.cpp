@@ -0,0 +1,166 @@
+#include "UndoHistory.h"
+#include <algorithm>
+
+namespace {
+    ItemTypeChange::Values takeValues(const ItemType& it) {
+        ItemTypeChange::Values v;
+        v.name = it.name;
+        v.speed = it.speed;
+        v.category = it.category;
+        v.flags = it.getAllFlags();
+        v.width = it.width;
+        v.height = it.height;
+        v.animationsFrames = it.animationsFrames;
+        v.patternX = it.patternX;
+        v.patternY = it.patternY;
+        v.patternZ = it.patternZ;
+        v.layers = it.layers;
+        v.exactSize = it.exactSize;
+        return v;
+    }
+
+    bool sameDimensions(const ItemTypeChange::Values& a, const ItemTypeChange::Values& b) {
+        return a.width == b.width && a.height == b.height && a.animationsFrames == b.animationsFrames &&
+               a.patternX == b.patternX && a.patternY == b.patternY && a.patternZ == b.patternZ &&
+               a.layers == b.layers && a.exactSize == b.exactSize;
+    }
+}
+
+ItemTypeChange ItemTypeChange::diff(uint32_t id, const ItemType& before, const ItemType& after) {
+    ItemTypeChange change;
+    change.id = id;
+
+    auto b = takeValues(before);
+    auto a = takeValues(after);
+
+    if (b.name != a.name) change.fields |= FIELD_NAME;
+    if (b.speed != a.speed) change.fields |= FIELD_SPEED;
+    if (b.category != a.category) change.fields |= FIELD_CATEGORY;
+    if (b.flags != a.flags) change.fields |= FIELD_FLAGS;
+    if (!sameDimensions(b, a)) change.fields |= FIELD_DIMENSIONS;
+
+    if (!before.sameAttributes(after.getAttributes())) {
+        change.fields |= FIELD_ATTRIBUTES;
+        if (before.getAttributes()) {
+            change.attributesBefore = std::make_shared<const ItemTypeAttributes>(*before.getAttributes());
+        }
+        if (after.getAttributes()) {
+            change.attributesAfter = std::make_shared<const ItemTypeAttributes>(*after.getAttributes());
+        }
+    }
+
+    const auto& idsBefore = before.textureIdsVector;
+    const auto& idsAfter = after.textureIdsVector;
+    if (idsBefore.size() == idsAfter.size()) {
+        for (uint32_t i = 0; i < idsBefore.size(); ++i) {
+            if (idsBefore[i] != idsAfter[i]) {
+                change.textureIdChanges.push_back({i, idsBefore[i], idsAfter[i]});
+            }
+        }
+    } else {
+        change.textureIdsBefore.assign(idsBefore.begin(), idsBefore.end());
+        change.textureIdsAfter.assign(idsAfter.begin(), idsAfter.end());
+    }
+    if (!change.textureIdChanges.empty() || !change.textureIdsAfter.empty() || !change.textureIdsBefore.empty()) {
+        change.fields |= FIELD_TEXTURES;
+    }
+
+    // Name is the only field that can be big, don't keep it when it didn't change
+    if (!(change.fields & FIELD_NAME)) {
+        a.name.clear();
+        b.name.clear();
+    }
+    change.before = std::move(b);
+    change.after = std::move(a);
+    return change;
+}
+
+void ItemTypeChange::apply(ItemType& target, bool forward) const {
+    const Values& v = forward ? after : before;
+
+    if (fields & FIELD_NAME) target.name = v.name;
+    if (fields & FIELD_SPEED) target.speed = v.speed;
+    if (fields & FIELD_CATEGORY) target.category = v.category;
+    if (fields & FIELD_FLAGS) target.setAllFlags(v.flags);
+    if (fields & FIELD_ATTRIBUTES) {
+        const auto& attributes = forward ? attributesAfter : attributesBefore;
+        if (attributes) {
+            target.setAttributes(*attributes);
+        } else {
+            target.clearAttributes();
+        }
+    }
+    if (fields & FIELD_DIMENSIONS) {
+        target.width = v.width;
+        target.height = v.height;
+        target.animationsFrames = v.animationsFrames;
+        target.patternX = v.patternX;
+        target.patternY = v.patternY;
+        target.patternZ = v.patternZ;
+        target.layers = v.layers;
+        target.exactSize = v.exactSize;
+    }
+
+    if (fields & FIELD_TEXTURES) {
+        if (textureIdChanges.empty()) {
+            const auto& ids = forward ? textureIdsAfter : textureIdsBefore;
+            target.textureIdsVector.assign(ids.begin(), ids.end());
+        } else {
+            for (const auto& c : textureIdChanges) {
+                if (c.index < target.textureIdsVector.size()) {
+                    target.textureIdsVector[c.index] = forward ? c.after : c.before;
+                }
+            }
+        }
+    }
+}
+
+void UndoHistory::record(Entry entry) {
+    // New step invalidates whatever could be redone
+    entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(cursor), entries.end());
+
+    entries.push_back(std::move(entry));
+    while (entries.size() > maxSteps) {
+        entries.pop_front();
+    }
+    cursor = entries.size();
+}
+
+const UndoHistory::Entry* UndoHistory::stepBack() {
+    if (!canUndo()) {
+        return nullptr;
+    }
+
+    --cursor;
+    return &entries[cursor];
+}
+
+const UndoHistory::Entry* UndoHistory::stepForward() {
+    if (!canRedo()) {
+        return nullptr;
+    }
+
+    return &entries[cursor++];
+}
+
+UndoHistory::Entry* UndoHistory::getLastRecorded() {
+    if (entries.empty() || cursor != entries.size()) {
+        return nullptr;
+    }
+    return &entries.back();
+}
+
+void UndoHistory::clear() {
+    entries.clear();
+    cursor = 0;
+}
+
+void UndoHistory::setMaxSteps(size_t steps) {
+    maxSteps = std::max<size_t>(1, steps);
+    while (entries.size() > maxSteps) {
+        entries.pop_front();
+        if (cursor > 0) {
+            --cursor;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "../Things/ItemType.h"
+
+// Sprite slot change. Textures are never modified in place (replace just swaps the pointer),
+// so keeping the pointers is enough - the pixels are shared with the live textures, not copied.
+struct SpriteChange {
+    uint32_t id = 0;
+    std::shared_ptr<sf::Texture> before; // nullptr = sprite didn't exist yet (appended)
+    std::shared_ptr<sf::Texture> after;  // nullptr = sprite got removed
+};
+
+// Many sprite slot changes that are undone/redone as one step (e.g. batch import)
+struct SpriteBatchChange {
+    std::vector<SpriteChange> changes; // in the order they were applied
+};
+
+// Field-level delta of an ItemType, only what actually changed gets stored.
+struct ItemTypeChange {
+    enum Field : uint16_t {
+        FIELD_NAME       = 1 << 0,
+        FIELD_SPEED      = 1 << 1,
+        FIELD_CATEGORY   = 1 << 2,
+        FIELD_FLAGS      = 1 << 3,
+        FIELD_DIMENSIONS = 1 << 4, // width, height, animations, patterns, layers, exact size
+        FIELD_TEXTURES   = 1 << 5,
+        FIELD_ATTRIBUTES = 1 << 6,
+    };
+
+    struct Values {
+        std::string name;
+        uint16_t speed = 0;
+        ItemCategory_t category = COMMON;
+        uint64_t flags = 0;
+        uint8_t width = 1, height = 1, animationsFrames = 1;
+        uint8_t patternX = 1, patternY = 1, patternZ = 1, layers = 1;
+        uint8_t exactSize = 32;
+    };
+
+    struct TextureIdChange {
+        uint32_t index;
+        uint32_t before;
+        uint32_t after;
+    };
+
+    uint32_t id = 0;
+    uint16_t fields = 0;
+    Values before;
+    Values after;
+
+    // Same vector size -> only the changed cells. Resized -> whole vectors.
+    std::vector<TextureIdChange> textureIdChanges;
+    std::vector<uint32_t> textureIdsBefore;
+    std::vector<uint32_t> textureIdsAfter;
+
+    // Only with FIELD_ATTRIBUTES, nullptr = item had no attributes
+    std::shared_ptr<const ItemTypeAttributes> attributesBefore;
+    std::shared_ptr<const ItemTypeAttributes> attributesAfter;
+
+    [[nodiscard]] bool empty() const { return fields == 0; }
+
+    static ItemTypeChange diff(uint32_t id, const ItemType& before, const ItemType& after);
+    // forward = redo direction (before -> after), otherwise undo (after -> before)
+    void apply(ItemType& target, bool forward) const;
+};
+
+class UndoHistory {
+public:
+    using Entry = std::variant<SpriteChange, SpriteBatchChange, ItemTypeChange>;
+
+    explicit UndoHistory(size_t maxSteps = 500) : maxSteps(maxSteps) {}
+
+    // Adds new step, everything that could be redone is dropped.
+    void record(Entry entry);
+
+    [[nodiscard]] bool canUndo() const { return cursor > 0; }
+    [[nodiscard]] bool canRedo() const { return cursor < entries.size(); }
+
+    // Returns the step to be reverted/reapplied, or nullptr if there is none.
+    const Entry* stepBack();
+    const Entry* stepForward();
+
+    // Newest step, nullptr if there is none or it got undone. Lets a step grow while it's still the last one.
+    Entry* getLastRecorded();
+
+    void clear();
+    [[nodiscard]] size_t size() const { return entries.size(); }
+    void setMaxSteps(size_t steps);
+private:
+    std::deque<Entry> entries;
+    size_t cursor = 0; // entries[0, cursor) are undoable, the rest redoable
+    size_t maxSteps;
+};
@@ -1,8 +1,11 @@
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include "ItemsScrollableWindow.h"
 #include "Misc/tools.h"
 #include "Things/Item.h"
+#include "Things/ItfArchive.h"
+#include "Helper/TextureUploader.h"
 #include "Misc/definitions.h"
 
 ItemsScrollableWindow::ItemsScrollableWindow(sf::RenderWindow& window, AssetsManager* am)
@@ -260,7 +263,7 @@ void ItemsScrollableWindow::drawPaginationControls() {
 
 void ItemsScrollableWindow::drawGUIItemTypeExport() {
     if (ImGui::Button("Export###ExportItemTypeButton")) {
-        if(isAnyButtonSelected()) {
+        if(isAnyButtonSelected() || exportAllItems) {
             itemName = "item" + std::to_string(getSelectedButtonIndex());
             ImGui::OpenPopup("Export Item Popup");
         }
@@ -302,6 +305,21 @@ void ItemsScrollableWindow::drawGUIItemTypeExport() {
         ImGui::SameLine();
         ImGui::RadioButton("TOML", &exportFormatSelected, 4);
 
+        ImGui::Checkbox("All items", &exportAllItems);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Exports every item into the folder as item<id>, name is ignored");
+        }
+        if (exportAllItems && exportFormatSelected == Tools::ITF) {
+            ImGui::Checkbox("One archive", &exportAsArchive);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("All items into a single items.itf, any of them can be imported from it");
+            }
+            if (exportAsArchive) {
+                ImGui::SameLine();
+                ImGui::Checkbox("Embed sprites", &exportArchiveSprites);
+            }
+        }
+
         ImGui::Spacing();
         ImGui::Separator();
         ImGui::Spacing();
@@ -309,7 +327,11 @@ void ItemsScrollableWindow::drawGUIItemTypeExport() {
         auto colorsCount = Tools::pushImGuiGray(!Tools::isValidFolderPath(outputFolder));
         if (ImGui::Button("Confirm")) {
             if (Tools::isValidFolderPath(outputFolder)) {
-                exportItem(static_cast<Tools::EXPORT_OPTIONS>(exportFormatSelected));
+                if (exportAllItems) {
+                    startExportAllItems(static_cast<Tools::EXPORT_OPTIONS>(exportFormatSelected));
+                } else {
+                    exportItem(static_cast<Tools::EXPORT_OPTIONS>(exportFormatSelected));
+                }
                 ImGui::CloseCurrentPopup();
             }
         }
@@ -325,6 +347,34 @@ void ItemsScrollableWindow::drawGUIItemTypeExport() {
 
         ImGui::EndPopup();
     }
+
+    bulkExporter.update(*assetsManager, EXPORT_READBACKS_PER_FRAME);
+    if (openExportProgress) {
+        ImGui::OpenPopup("Exporting Items");
+        openExportProgress = false;
+    }
+    bulkExporter.drawProgressPopup("Exporting Items");
+}
+
+void ItemsScrollableWindow::startExportAllItems(Tools::EXPORT_OPTIONS option) {
+    BulkExporter::Request request;
+    request.folder = outputFolder;
+    switch (option) {
+        case Tools::ITF:
+            request.itemItf = !exportAsArchive;
+            request.itemArchive = exportAsArchive;
+            request.archiveSprites = exportAsArchive && exportArchiveSprites;
+            break;
+        case Tools::TOML:
+            request.itemToml = true;
+            break;
+        default:
+            request.imageFormat = option;
+            request.itemSheets = true;
+            break;
+    }
+
+    openExportProgress = bulkExporter.start(*assetsManager, request);
 }
 
 void ItemsScrollableWindow::handleItemTypeImport() {
@@ -339,7 +389,10 @@ void ItemsScrollableWindow::handleItemTypeImport() {
     std::string extension = filePath.extension().string(); // Includes the dot, e.g., ".itf"
 
     bool successImport = false;
-    if (extension == ".itf") {
+    if (extension == ".itf" && ItfArchive::isArchive(fileChosen)) {
+        successImport = importItemArchive(fileChosen);
+    }
+    else if (extension == ".itf") {
         successImport = Items::importItemItf(fileChosen);
     }
     else if (extension == ".toml") {
@@ -354,6 +407,64 @@ void ItemsScrollableWindow::handleItemTypeImport() {
     }
 }
 
+bool ItemsScrollableWindow::importItemArchive(const std::string& filePath) {
+    ItfArchive::Reader archive;
+    if (!archive.open(filePath)) {
+        Warninger::sendWarning(FUNC_NAME, archive.getError());
+        return false;
+    }
+
+    // Embedded sprites become new sprites, items get their ids remapped to them
+    std::unordered_map<uint32_t, uint32_t> spriteIdMap;
+    if (archive.hasSprites()) {
+        const uint32_t dimension = assetsManager->getSpriteSize();
+        if (archive.getSpriteDimension() != dimension) {
+            Warninger::sendWarning(FUNC_NAME, fmt::format("Archive sprites are {0}x{0}, loaded ones {1}x{1}, "
+                                                          "items keep their sprite ids.", archive.getSpriteDimension(), dimension));
+        } else {
+            std::vector<uint32_t> spriteIds = archive.getSpriteIds();
+            std::vector<std::shared_ptr<sf::Texture>> batch;
+            batch.reserve(spriteIds.size());
+            std::vector<uint8_t> rgba;
+            auto uploader = TextureUploader::getInstance();
+            for (uint32_t id : spriteIds) {
+                if (!archive.readSprite(id, rgba)) {
+                    rgba.assign(static_cast<size_t>(dimension) * dimension * 4, 0);
+                }
+                auto texture = uploader->upload(dimension, dimension, rgba.data());
+                batch.push_back(texture ? texture : assetsManager->BLANK_TEXTURE);
+            }
+
+            // All of them are valid textures, so they get consecutive ids from the current end
+            size_t firstId = assetsManager->getTextureCount();
+            size_t added = assetsManager->pushTextures(batch);
+            for (size_t i = 0; i < added; ++i) {
+                spriteIdMap[spriteIds[i]] = static_cast<uint32_t>(firstId + i);
+            }
+        }
+    }
+
+    size_t imported = 0;
+    for (uint32_t id : archive.getItemIds()) {
+        auto itemType = std::make_shared<ItemType>();
+        if (!archive.readItem(id, *itemType)) {
+            Warninger::sendWarning(FUNC_NAME, "Broken record of item " + std::to_string(id) + " in " + filePath);
+            continue;
+        }
+        for (uint32_t& spriteId : itemType->textureIdsVector) {
+            auto it = spriteIdMap.find(spriteId);
+            if (it != spriteIdMap.end()) {
+                spriteId = it->second;
+            }
+        }
+        Items::pushItemType(itemType);
+        ++imported;
+    }
+
+    fmt::print("Imported {} items and {} sprites from {}\n", imported, spriteIdMap.size(), filePath);
+    return imported > 0;
+}
+
 void ItemsScrollableWindow::drawItemTypePanel() {
     // --- Center Panel: Tabs for Texture and Item Info ---
     ImGui::BeginGroup();
@@ -381,7 +492,7 @@ void ItemsScrollableWindow::drawItemTypePanel() {
             }
         }
 
-        std::shared_ptr<ItemType> previewIt = assetsManager->getUnsavedItemType();
+        std::shared_ptr<const ItemType> previewIt = assetsManager->getUnsavedItemType();
         if (ImGui::BeginTabItem("Texture")) {
             if (getSelectedButtonIndex() >= 0 && getSelectedButtonIndex() < (int)Items::getItemTypesCount()) {
                 ImGui::BeginGroup();
@@ -389,7 +500,7 @@ void ItemsScrollableWindow::drawItemTypePanel() {
 
                 ImGui::Text("Texture Preview (Drop sprites here)");
                 auto oldPos = ImGui::GetCursorPos();
-                auto spriteMaxSize = ConfigManager::getInstance()->getSpriteMaxSize();
+                auto spriteMaxSize = assetsManager->getSpriteSize();
 
                 ImVec2 centeredPos(groupSize.x / 2.0f - ((spriteMaxSize * previewIt->width) / 2.0f), oldPos.y);
                 centeredPos.x += spriteMaxSize/4; // Small magic number correction because we couldn't center...
@@ -398,7 +509,7 @@ void ItemsScrollableWindow::drawItemTypePanel() {
 
                 for(int h = 0; h < previewIt->height; h++) {
                     for(int w = 0; w < previewIt->width; w++) {
-                        int spriteIndex = assetsManager->getTextureIdFromItemType(previewIt, h, w, assetsManager->getAnimationFrameSetting());
+                        int spriteIndex = assetsManager->getTextureIdFromItemType(*previewIt, h, w, assetsManager->getAnimationFrameSetting());
                         auto texture = assetsManager->getTexture(spriteIndex);
 
                         if (texture) {
@@ -419,7 +530,10 @@ void ItemsScrollableWindow::drawItemTypePanel() {
                             if (ImGui::BeginDragDropTarget()) {
                                 if (const ImGuiPayload *payload = ImGui::AcceptDragDropPayload("TEXTURE_ID")) {
                                     int newTextureId = *(int *) payload->Data;
-                                    assetsManager->setTextureIdFromItemType(previewIt, h, w, assetsManager->getAnimationFrameSetting(), newTextureId); // Update textureId
+                                    if (auto editIt = assetsManager->editUnsavedItemType()) {
+                                        assetsManager->setTextureIdFromItemType(editIt, h, w, assetsManager->getAnimationFrameSetting(), newTextureId); // Update textureId
+                                        previewIt = editIt;
+                                    }
                                 }
                                 ImGui::EndDragDropTarget();
                             }
@@ -475,7 +589,6 @@ void ItemsScrollableWindow::drawItemTypePanel() {
                 ImGui::SetCursorPosY(oldPos.y + groupSize.y/2 + 10);
                 //ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 20);
 
-                ItemType tempCopyIt = *previewIt;
                 if (ImGui::BeginTable("ItemTextureProperties", 3, ImGuiTableFlags_SizingFixedFit)) {
                     // Set up columns
                     ImGui::TableSetupColumn("Column 1", ImGuiTableColumnFlags_WidthFixed, (groupSize.x/2));
@@ -494,28 +607,34 @@ void ItemsScrollableWindow::drawItemTypePanel() {
                     ImGui::TableNextColumn();
                     ImGui::PushItemWidth(groupSize.x * 0.20);
 
-                    int width = tempCopyIt.width;
+                    int width = previewIt->width;
                     if (ImGui::InputInt("##Width", &width, 1, 1, ImGuiInputTextFlags_CharsDecimal)) {
                         width = std::clamp(width, 1, ConfigManager::getInstance()->getItemMaxWidth());
-                        tempCopyIt.width = static_cast<uint8_t>(width);
-                        previewIt->setItemTypeWidth(tempCopyIt.width);
+                        if (auto editIt = assetsManager->editUnsavedItemType()) {
+                            editIt->setItemTypeWidth(width);
+                            previewIt = editIt;
+                        }
                     }
 
-                    int height = tempCopyIt.height;
+                    int height = previewIt->height;
                     if (ImGui::InputInt("##Height", &height, 1, 1, ImGuiInputTextFlags_CharsDecimal)) {
                         height = std::clamp(height, 1, ConfigManager::getInstance()->getItemMaxHeight());
-                        tempCopyIt.height = static_cast<uint8_t>(height);
-                        previewIt->setItemTypeHeight(tempCopyIt.height);
+                        if (auto editIt = assetsManager->editUnsavedItemType()) {
+                            editIt->setItemTypeHeight(height);
+                            previewIt = editIt;
+                        }
                     }
 
-                    int animations = tempCopyIt.animationsFrames;
+                    int animations = previewIt->animationsFrames;
                     if (ImGui::InputInt("##Animations", &animations, 1, 1, ImGuiInputTextFlags_CharsDecimal)) {
                         animations = std::clamp(animations, 1, ConfigManager::getInstance()->getItemMaxAnimationCount());
-                        tempCopyIt.animationsFrames = static_cast<uint8_t>(animations);
-                        previewIt->setItemTypeAnimationCount(tempCopyIt.animationsFrames);
+                        if (auto editIt = assetsManager->editUnsavedItemType()) {
+                            editIt->setItemTypeAnimationCount(animations);
+                            previewIt = editIt;
 
-                        if(tempCopyIt.animationsFrames < assetsManager->getAnimationFrameSetting()) {
-                            assetsManager->setAnimationFrameSetting(tempCopyIt.animationsFrames);
+                            if(animations < assetsManager->getAnimationFrameSetting()) {
+                                assetsManager->setAnimationFrameSetting(animations);
+                            }
                         }
                     }
 
@@ -537,16 +656,24 @@ void ItemsScrollableWindow::drawItemTypePanel() {
                 // Radio button group for mutually exclusive options
                 ImGui::Text("Flag Type:");
                 if (ImGui::RadioButton("Common", previewIt->category == COMMON)) {
-                    previewIt->category = COMMON;
+                    if (auto editIt = assetsManager->editUnsavedItemType()) {
+                        editIt->category = COMMON;
+                    }
                 };
                 if (ImGui::RadioButton("Ground Border", previewIt->category == GROUND_BORDER)) {
-                    previewIt->category = GROUND_BORDER;
+                    if (auto editIt = assetsManager->editUnsavedItemType()) {
+                        editIt->category = GROUND_BORDER;
+                    }
                 };
                 if (ImGui::RadioButton("Bottom", previewIt->category == BOTTOM)) {
-                    previewIt->category = BOTTOM;
+                    if (auto editIt = assetsManager->editUnsavedItemType()) {
+                        editIt->category = BOTTOM;
+                    }
                 };
                 if (ImGui::RadioButton("Top", previewIt->category == TOP)) {
-                    previewIt->category = TOP;
+                    if (auto editIt = assetsManager->editUnsavedItemType()) {
+                        editIt->category = TOP;
+                    }
                 };
 
                 ImGui::Separator(); // A line to separate radio group from checkboxes
@@ -572,7 +699,9 @@ void ItemsScrollableWindow::drawItemTypePanel() {
 
                         bool checked = previewIt->hasFlag(flagNames[i].second);
                         if (ImGui::Checkbox(flagNames[i].first, &checked)) {
-                            previewIt->setFlag(flagNames[i].second, checked);
+                            if (auto editIt = assetsManager->editUnsavedItemType()) {
+                                editIt->setFlag(flagNames[i].second, checked);
+                            }
                         }
                     }
 
@@ -588,7 +717,9 @@ void ItemsScrollableWindow::drawItemTypePanel() {
         if (getSelectedButtonIndex() >= 0 && getSelectedButtonIndex() < (int)Items::getItemTypesCount()) {
             if (assetsManager->getUnsavedItemTypeId() != -1 &&
                 assetsManager->getUnsavedItemTypeId() == getSelectedButtonIndex()) {
-                if (*assetsManager->getUnsavedItemType() != *Items::getItemType(getSelectedButtonIndex())) {
+                // Still shared means nothing was touched, so no need to compare
+                if (!assetsManager->isUnsavedItemTypeShared() &&
+                    *assetsManager->getUnsavedItemType() != *Items::getItemType(getSelectedButtonIndex())) {
                     assetsManager->setUnsavedChanges(CATEGORY_ITEMS_ITEMTYPE, true);
                 } else {
                     assetsManager->setUnsavedChanges(CATEGORY_ITEMS_ITEMTYPE, false);
@@ -626,8 +757,7 @@ void ItemsScrollableWindow::drawItemTypePanel() {
             assetsManager->setUnsavedChanges(CATEGORY_ITEMS, true);
             assetsManager->setUnsavedChanges(CATEGORY_ITEMS_ITEMTYPE, false);
 
-            auto replacementItem = std::make_shared<ItemType>(*assetsManager->getUnsavedItemType());
-            bool replaceSuccess = Items::replaceItemType(assetsManager->getUnsavedItemTypeId(), replacementItem);
+            bool replaceSuccess = assetsManager->saveUnsavedItemType();
 
             assetsManager->createPreviewTexture(getSelectedButtonIndex());
             assetsManager->resetUnsavedItemType();
@@ -6,6 +6,7 @@
 #include "ResourceManagers/AssetsManager.h"
 #include "Things/Items.h"
 #include "Misc/tools.h"
+#include "Helper/BulkExporter.h"
 
 class ItemsScrollableWindow {
 public:
@@ -174,6 +175,13 @@ private:
     // Variables for export
     std::string outputFolder = Tools::getDesktopPath();
     int exportFormatSelected = 0; // 0 = PNG, 1 = BMP, 2 = JPG, 3 = ITF, 4 = TOML
+    bool exportAllItems = false;
+    bool exportAsArchive = false; // all items -> one items.itf
+    bool exportArchiveSprites = true;
+    BulkExporter bulkExporter;
+    bool openExportProgress = false;
+    static constexpr size_t EXPORT_READBACKS_PER_FRAME = 256;
+    void startExportAllItems(Tools::EXPORT_OPTIONS option);
     std::string itemName = "item" + std::to_string(getSelectedButtonIndex());
 
     uint32_t rightMenuClickedItem = 0;
@@ -181,4 +189,6 @@ private:
     void drawGUIItemTypeExport();
     void handleItemTypeImport();
     void onPostItemImport();
+    // Items (and sprites) of a multi-item .itf, appended at the end
+    bool importItemArchive(const std::string& filePath);
 };
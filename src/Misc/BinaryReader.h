@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Little-endian reader over a buffer in memory (whole file read at once).
+// Reading past the end gives zeroes and marks the reader as overflowed,
+// so it's enough to check overflowed() once after a whole record.
+class BinaryReader {
+public:
+    BinaryReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    template<typename T>
+    T read() {
+        T value{};
+        if (sizeof(T) > size - pos) {
+            overflow = true;
+            pos = size;
+            return value;
+        }
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    uint8_t readU8() { return read<uint8_t>(); }
+    uint16_t readU16() { return read<uint16_t>(); }
+    uint32_t readU32() { return read<uint32_t>(); }
+
+    std::string readString(size_t length) {
+        if (length > size - pos) {
+            overflow = true;
+            pos = size;
+            return {};
+        }
+        std::string value(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return value;
+    }
+
+    void skip(size_t count) {
+        if (count > size - pos) {
+            overflow = true;
+            pos = size;
+            return;
+        }
+        pos += count;
+    }
+
+    [[nodiscard]] size_t tell() const { return pos; }
+    void seek(size_t position) {
+        pos = position > size ? size : position;
+        overflow = position > size;
+    }
+    [[nodiscard]] size_t remaining() const { return size - pos; }
+    [[nodiscard]] bool overflowed() const { return overflow; }
+    [[nodiscard]] const uint8_t* current() const { return data + pos; }
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool overflow = false;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Little-endian counterpart of BinaryReader, appends to a buffer in memory
+// which then gets written to the file at once.
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::vector<uint8_t>& buffer) : buffer(buffer) {}
+
+    template<typename T>
+    void write(const T& value) {
+        size_t pos = buffer.size();
+        buffer.resize(pos + sizeof(T));
+        std::memcpy(buffer.data() + pos, &value, sizeof(T));
+    }
+
+    void writeU8(uint8_t value) { write(value); }
+    void writeU16(uint16_t value) { write(value); }
+    void writeU32(uint32_t value) { write(value); }
+
+    void writeBytes(const uint8_t* data, size_t count) {
+        buffer.insert(buffer.end(), data, data + count);
+    }
+    void writeString(const std::string& value) {
+        writeBytes(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+    }
+
+    [[nodiscard]] size_t tell() const { return buffer.size(); }
+private:
+    std::vector<uint8_t>& buffer;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// Passes allocations on to the default heap and keeps count of the bytes currently held,
+// meant as the upstream of an arena so its size can be read without walking it
+class CountingResource : public std::pmr::memory_resource {
+public:
+    [[nodiscard]] size_t getAllocatedBytes() const { return allocatedBytes.load(std::memory_order_relaxed); }
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        return memory;
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+        allocatedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::atomic<size_t> allocatedBytes{0};
+};
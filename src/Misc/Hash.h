@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Hash {
+    // CRC32 (IEEE, same as zip/png), slicing-by-8 tables
+    inline const std::array<std::array<uint32_t, 256>, 8>& crc32Tables() {
+        static const auto tables = [] {
+            std::array<std::array<uint32_t, 256>, 8> t{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (size_t s = 1; s < 8; ++s) {
+                    t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+                }
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    // Pass the previous result as 'crc' to continue over the next chunk, 0 to start
+    inline uint32_t crc32(const void* data, size_t size, uint32_t crc = 0) {
+        const auto& t = crc32Tables();
+        auto p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+
+        while (size >= 8) {
+            uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24));
+            uint32_t hi = p[4] | (p[5] << 8) | (p[6] << 16) | (static_cast<uint32_t>(p[7]) << 24);
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                  t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+            p += 8;
+            size -= 8;
+        }
+        while (size--) {
+            crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    // FNV-1a, 64 bit - for cache keys, where 32 bits would collide too soon.
+    // Pass the previous result as 'hash' to continue over the next chunk.
+    constexpr uint64_t FNV64_OFFSET = 0xCBF29CE484222325ull;
+    inline uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = FNV64_OFFSET) {
+        auto p = static_cast<const uint8_t*>(data);
+        while (size--) {
+            hash = (hash ^ *p++) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+}
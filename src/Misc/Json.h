@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+
+// Bits for writing JSON reports by hand, they are flat enough not to need a library
+namespace Json {
+    inline void appendString(std::string& out, const std::string& value) {
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        out += fmt::format("\\u{:04x}", static_cast<int>(c));
+                    } else {
+                        out += c;
+                    }
+                    break;
+            }
+        }
+        out += '"';
+    }
+
+    inline void appendIds(std::string& out, const std::vector<uint32_t>& ids) {
+        out += '[';
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            out += std::to_string(ids[i]);
+        }
+        out += ']';
+    }
+}
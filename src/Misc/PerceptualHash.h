@@ -0,0 +1,97 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PERCEPTUAL_HASH_SSE2 1
+#endif
+
+// 64 bit perceptual hash of sprites - similar looking sprites (recolors, small shifts) get hashes
+// that differ in a few bits only, so near-duplicates are found by Hamming distance
+namespace PerceptualHash {
+    constexpr uint32_t GRID = 8; // 8x8 blocks, one bit each
+
+    // Luminance (x256) of the alpha premultiplied pixel - transparent counts as black, so the outline matters too
+    inline uint32_t pixelLuma(const uint8_t* p) {
+        return ((p[0] * p[3]) >> 8) * 77 + ((p[1] * p[3]) >> 8) * 150 + ((p[2] * p[3]) >> 8) * 29;
+    }
+
+    // Sum of pixelLuma() over 'count' RGBA pixels, 4 at a time with SSE2
+    inline uint32_t sumLuma(const uint8_t* pixels, uint32_t count) {
+        uint32_t sum = 0;
+        uint32_t i = 0;
+#ifdef PERCEPTUAL_HASH_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+        __m128i acc = zero;
+        for (; i + 4 <= count; i += 4) {
+            __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + static_cast<size_t>(i) * 4));
+            // 2 pixels per register as u16, alpha of each broadcast over its 4 lanes
+            __m128i lo = _mm_unpacklo_epi8(rgba, zero);
+            __m128i hi = _mm_unpackhi_epi8(rgba, zero);
+            __m128i loAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m128i hiAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            lo = _mm_srli_epi16(_mm_mullo_epi16(lo, loAlpha), 8);
+            hi = _mm_srli_epi16(_mm_mullo_epi16(hi, hiAlpha), 8);
+            // r*77 + g*150 and b*29 + a*0, as 32 bit
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, weights));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, weights));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+#endif
+        for (; i < count; ++i) {
+            sum += pixelLuma(pixels + static_cast<size_t>(i) * 4);
+        }
+        return sum;
+    }
+
+    /**
+     * @brief Average hash of a sprite
+     *
+     * The sprite is split into 8x8 blocks, a bit is set if the block is brighter than the average block.
+     * Being relative to the average, it doesn't change with recolors by a few values.
+     *
+     * @param rgba dimension^2 RGBA pixels
+     * @return false if the sprite has nothing visible - blank sprites would all match each other
+     */
+    inline bool compute(const uint8_t* rgba, uint32_t dimension, uint64_t& hash) {
+        if (dimension < GRID) {
+            return false;
+        }
+
+        const uint32_t block = dimension / GRID;
+        uint32_t sums[GRID * GRID];
+        uint64_t total = 0;
+        for (uint32_t by = 0; by < GRID; ++by) {
+            for (uint32_t bx = 0; bx < GRID; ++bx) {
+                uint32_t sum = 0;
+                for (uint32_t y = 0; y < block; ++y) {
+                    sum += sumLuma(rgba + (static_cast<size_t>(by * block + y) * dimension + bx * block) * 4, block);
+                }
+                sums[by * GRID + bx] = sum;
+                total += sum;
+            }
+        }
+        if (total == 0) {
+            return false;
+        }
+
+        hash = 0;
+        for (uint32_t i = 0; i < GRID * GRID; ++i) {
+            if (static_cast<uint64_t>(sums[i]) * (GRID * GRID) > total) {
+                hash |= 1ull << i;
+            }
+        }
+        return true;
+    }
+
+    // Bits that differ, 0 = look the same
+    inline uint32_t distance(uint64_t a, uint64_t b) {
+        return static_cast<uint32_t>(std::bitset<64>(a ^ b).count());
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+// Allocator that shares ownership of its memory resource. Everything made with std::allocate_shared
+// through it keeps the resource alive, so an arena only goes once the last of its objects does.
+template<typename T>
+class SharedResourceAllocator {
+public:
+    using value_type = T;
+
+    explicit SharedResourceAllocator(std::shared_ptr<std::pmr::memory_resource> resource) noexcept
+        : resource(std::move(resource)) {}
+
+    template<typename U>
+    SharedResourceAllocator(const SharedResourceAllocator<U>& other) noexcept : resource(other.getResource()) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(resource->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* memory, size_t count) noexcept {
+        resource->deallocate(memory, count * sizeof(T), alignof(T));
+    }
+
+    [[nodiscard]] const std::shared_ptr<std::pmr::memory_resource>& getResource() const noexcept { return resource; }
+
+    template<typename U>
+    bool operator==(const SharedResourceAllocator<U>& other) const noexcept { return resource == other.getResource(); }
+    template<typename U>
+    bool operator!=(const SharedResourceAllocator<U>& other) const noexcept { return resource != other.getResource(); }
+private:
+    std::shared_ptr<std::pmr::memory_resource> resource;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// .spr sprite RLE codec, instantiated per {transparency, sprite dimension}.
+// Everything that used to be checked per pixel is a template parameter here,
+// so the inner loops have constant strides/sizes and no mode branches.
+// Pick the instantiation once per file with withCodec().
+namespace SpriteCodec {
+    inline uint16_t readLE16(const uint8_t* data) {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    inline void writeLE16(uint8_t* data, uint16_t value) {
+        data[0] = value & 0xFF;
+        data[1] = (value >> 8) & 0xFF;
+    }
+
+    template<bool Transparency, uint32_t Dimension>
+    struct Codec {
+        static constexpr bool TRANSPARENCY = Transparency;
+        static constexpr uint32_t DIMENSION = Dimension;
+        static constexpr size_t PIXELS = static_cast<size_t>(Dimension) * Dimension;
+        static constexpr size_t BYTES_PER_PIXEL = Transparency ? 4 : 3; // in .spr, RGBA in memory
+        static constexpr size_t RGBA_SIZE = PIXELS * 4;
+
+        // RLE data -> RGBA pixels (RGBA_SIZE bytes). Broken data just leaves the rest transparent.
+        static void decode(const uint8_t* data, size_t size, uint8_t* pixels) {
+            std::memset(pixels, 0, RGBA_SIZE);
+
+            size_t dataPtr = 0;
+            size_t pixelPtr = 0;
+            while (pixelPtr < PIXELS && dataPtr + 2 <= size) {
+                pixelPtr += readLE16(data + dataPtr); // transparent pixels, already zeroed
+                dataPtr += 2;
+                if (pixelPtr >= PIXELS || dataPtr + 2 > size) break;
+
+                size_t colored = readLE16(data + dataPtr);
+                dataPtr += 2;
+                // Clamp whole run once, instead of checking every pixel
+                colored = std::min({colored, PIXELS - pixelPtr, (size - dataPtr) / BYTES_PER_PIXEL});
+
+                uint8_t* dst = pixels + pixelPtr * 4;
+                const uint8_t* src = data + dataPtr;
+                if constexpr (Transparency) {
+                    std::memcpy(dst, src, colored * 4);
+                } else {
+                    for (size_t i = 0; i < colored; ++i) {
+                        dst[i * 4 + 0] = src[i * 3 + 0];
+                        dst[i * 4 + 1] = src[i * 3 + 1];
+                        dst[i * 4 + 2] = src[i * 3 + 2];
+                        dst[i * 4 + 3] = 255;
+                    }
+                }
+
+                dataPtr += colored * BYTES_PER_PIXEL;
+                pixelPtr += colored;
+            }
+        }
+
+        // RGBA pixels (RGBA_SIZE bytes) -> RLE data appended to 'out'.
+        // Transparent = alpha 0, or opaque magenta (255, 0, 255).
+        static void encode(const uint8_t* pixels, std::vector<uint8_t>& out) {
+            // Whole mask first - fixed count, no early exits, so it vectorizes
+            std::array<uint8_t, PIXELS> transparent;
+            for (size_t i = 0; i < PIXELS; ++i) {
+                const uint8_t* px = pixels + i * 4;
+                transparent[i] = static_cast<uint8_t>((px[3] == 0) |
+                        ((px[0] == 255) & (px[1] == 0) & (px[2] == 255) & (px[3] == 255)));
+            }
+
+            size_t i = 0;
+            while (i < PIXELS) {
+                size_t start = i;
+                while (i < PIXELS && transparent[i]) ++i;
+                size_t headerPos = out.size();
+                out.resize(headerPos + 2);
+                writeLE16(out.data() + headerPos, static_cast<uint16_t>(i - start));
+                if (i >= PIXELS) break;
+
+                start = i;
+                while (i < PIXELS && !transparent[i]) ++i;
+                size_t colored = i - start;
+
+                headerPos = out.size();
+                out.resize(headerPos + 2 + colored * BYTES_PER_PIXEL);
+                writeLE16(out.data() + headerPos, static_cast<uint16_t>(colored));
+
+                uint8_t* dst = out.data() + headerPos + 2;
+                const uint8_t* src = pixels + start * 4;
+                if constexpr (Transparency) {
+                    std::memcpy(dst, src, colored * 4);
+                } else {
+                    for (size_t j = 0; j < colored; ++j) {
+                        dst[j * 3 + 0] = src[j * 4 + 0];
+                        dst[j * 3 + 1] = src[j * 4 + 1];
+                        dst[j * 3 + 2] = src[j * 4 + 2];
+                    }
+                }
+            }
+        }
+    };
+
+    // Calls f with a default constructed Codec for the given mode, e.g. [](auto codec) { using C = decltype(codec); }
+    // Returns false (without calling f) for a dimension that has no codec.
+    template<typename F>
+    bool withCodec(bool transparency, uint32_t dimension, F&& f) {
+        auto pick = [&](auto transparent) {
+            constexpr bool T = decltype(transparent)::value;
+            switch (dimension) {
+                case 32: f(Codec<T, 32>{}); return true;
+                case 64: f(Codec<T, 64>{}); return true;
+                case 128: f(Codec<T, 128>{}); return true;
+                default: return false;
+            }
+        };
+
+        if (transparency) {
+            return pick(std::true_type{});
+        }
+        return pick(std::false_type{});
+    }
+
+    // Box filter, shrinks RGBA sprite of srcSize by an integer Factor (64 -> 32 is 2).
+    // Alpha is the weight of each pixel, so transparent (and magenta) pixels don't bleed into the colors.
+    template<uint32_t Factor>
+    void downscaleBox(const uint8_t* src, uint32_t srcSize, uint8_t* dst) {
+        constexpr uint32_t AREA = Factor * Factor;
+        const uint32_t dstSize = srcSize / Factor;
+
+        for (uint32_t y = 0; y < dstSize; ++y) {
+            for (uint32_t x = 0; x < dstSize; ++x) {
+                uint32_t r = 0, g = 0, b = 0, a = 0;
+                for (uint32_t dy = 0; dy < Factor; ++dy) {
+                    const uint8_t* row = src + (static_cast<size_t>(y * Factor + dy) * srcSize + x * Factor) * 4;
+                    for (uint32_t dx = 0; dx < Factor; ++dx) {
+                        const uint8_t* px = row + dx * 4;
+                        bool magenta = (px[0] == 255) & (px[1] == 0) & (px[2] == 255);
+                        uint32_t alpha = magenta ? 0 : px[3];
+                        r += px[0] * alpha;
+                        g += px[1] * alpha;
+                        b += px[2] * alpha;
+                        a += alpha;
+                    }
+                }
+
+                uint8_t* out = dst + (static_cast<size_t>(y) * dstSize + x) * 4;
+                if (a == 0) {
+                    out[0] = out[1] = out[2] = out[3] = 0;
+                    continue;
+                }
+                out[0] = static_cast<uint8_t>((r + a / 2) / a);
+                out[1] = static_cast<uint8_t>((g + a / 2) / a);
+                out[2] = static_cast<uint8_t>((b + a / 2) / a);
+                out[3] = static_cast<uint8_t>((a + AREA / 2) / AREA);
+            }
+        }
+    }
+
+    inline bool canDownscale(uint32_t srcSize, uint32_t dstSize) {
+        if (dstSize == 0 || srcSize % dstSize != 0) {
+            return false;
+        }
+        uint32_t factor = srcSize / dstSize;
+        return factor == 1 || factor == 2 || factor == 4;
+    }
+
+    // dst has to hold dstSize * dstSize * 4 bytes. Returns false if srcSize isn't 1x/2x/4x of dstSize.
+    inline bool downscale(const uint8_t* src, uint32_t srcSize, uint32_t dstSize, uint8_t* dst) {
+        if (!canDownscale(srcSize, dstSize)) {
+            return false;
+        }
+
+        switch (srcSize / dstSize) {
+            case 1:
+                std::memcpy(dst, src, static_cast<size_t>(srcSize) * srcSize * 4);
+                return true;
+            case 2:
+                downscaleBox<2>(src, srcSize, dst);
+                return true;
+            case 4:
+                downscaleBox<4>(src, srcSize, dst);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // .spr header: signature + sprite count (u16, or u32 when extended), then u32 offset per sprite
+    template<bool Extended>
+    struct SprLayout {
+        using CountType = std::conditional_t<Extended, uint32_t, uint16_t>;
+        static constexpr uint32_t MAX_SPRITES = Extended ? 0xFFFFFFFFu : 0xFFFFu;
+        static constexpr size_t HEADER_SIZE = 4 + sizeof(CountType);
+    };
+
+    template<typename F>
+    decltype(auto) withSprLayout(bool extended, F&& f) {
+        if (extended) {
+            return f(SprLayout<true>{});
+        }
+        return f(SprLayout<false>{});
+    }
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <fstream>
 #include "imgui.h"
 #include "nfd.h"
 #include <algorithm>
@@ -131,6 +133,22 @@ namespace Tools {
         return std::filesystem::exists(path) && std::filesystem::is_directory(path);
     }
 
+    // Reads whole file into 'out', returns false if it couldn't be read
+    inline bool readFileBytes(const std::string &path, std::vector<char> &out) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::streamsize size = file.tellg();
+        if (size < 0) {
+            return false;
+        }
+        out.resize(static_cast<size_t>(size));
+        file.seekg(0, std::ios::beg);
+        return static_cast<bool>(file.read(out.data(), size));
+    }
+
     inline bool isPresentFileExtensionInAPath(const std::string &path, std::string extension) {
         if (!std::filesystem::is_directory(path)) {
             return false;
@@ -472,6 +490,63 @@ namespace Tools {
         return ext;
     }
 
+// Natural order, so "2.png" comes before "10.png"
+    inline bool naturalLess(const std::string &a, const std::string &b) {
+        size_t i = 0, j = 0;
+        while (i < a.size() && j < b.size()) {
+            if (std::isdigit(static_cast<unsigned char>(a[i])) && std::isdigit(static_cast<unsigned char>(b[j]))) {
+                size_t endA = i, endB = j;
+                while (endA < a.size() && std::isdigit(static_cast<unsigned char>(a[endA]))) ++endA;
+                while (endB < b.size() && std::isdigit(static_cast<unsigned char>(b[endB]))) ++endB;
+                // Skip leading zeros, then the longer number is the bigger one
+                while (i + 1 < endA && a[i] == '0') ++i;
+                while (j + 1 < endB && b[j] == '0') ++j;
+                if (endA - i != endB - j) {
+                    return endA - i < endB - j;
+                }
+                int cmp = a.compare(i, endA - i, b, j, endB - j);
+                if (cmp != 0) {
+                    return cmp < 0;
+                }
+                i = endA;
+                j = endB;
+                continue;
+            }
+
+            char ca = static_cast<char>(std::tolower(static_cast<unsigned char>(a[i])));
+            char cb = static_cast<char>(std::tolower(static_cast<unsigned char>(b[j])));
+            if (ca != cb) {
+                return ca < cb;
+            }
+            ++i;
+            ++j;
+        }
+        return a.size() - i < b.size() - j;
+    }
+
+// Image files (by extension) directly in the folder, in natural order of their names
+    inline std::vector<std::string> getImageFilesInFolder(const std::string &folderPath) {
+        std::vector<std::string> files;
+        const auto allowedExtensions = getImageExtensions();
+
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(folderPath, ec)) {
+            if (!entry.is_regular_file(ec)) {
+                continue;
+            }
+            std::string path = entry.path().string();
+            std::string ext = getExtensionFromPath(path);
+            if (std::find(allowedExtensions.begin(), allowedExtensions.end(), ext) != allowedExtensions.end()) {
+                files.push_back(path);
+            }
+        }
+
+        std::sort(files.begin(), files.end(), [](const std::string &a, const std::string &b) {
+            return naturalLess(std::filesystem::path(a).filename().string(), std::filesystem::path(b).filename().string());
+        });
+        return files;
+    }
+
     inline std::string cleanPathIntoFolderPath(const std::string &path) {
         // Find last slash (both Windows '\' and Unix '/' supported)
         size_t lastSlash = path.find_last_of("\\/");
@@ -3,46 +3,240 @@
 #include <fstream>
 #include <vector>
 #include <filesystem>
+#include <cstring>
+#include <algorithm>
 
 #include "AssetsManager.h"
 #include "../Helper/SavedData.h"
 #include "misc/cpp/imgui_stdlib.h"
 #include "../Misc/definitions.h"
 #include "../Misc/Timer.h"
+#include "../Helper/AtomicFileWriter.h"
+#include "../Helper/SessionSnapshot.h"
+#include "../Misc/SpriteCodec.h"
+#include "../Misc/Hash.h"
+#include "../Helper/TextureUploader.h"
 
 AssetsManager::AssetsManager(GUIHelper* guiHelper) {
     this->guiHelper = guiHelper;
-
-    // Setup blank texture
-    auto spriteMaxSize = ConfigManager::getInstance()->getSpriteMaxSize();
-    sf::Image image({spriteMaxSize, spriteMaxSize}, sf::Color::Transparent);
-    BLANK_TEXTURE = std::make_shared<sf::Texture>();
-    if (!BLANK_TEXTURE->loadFromImage(image)) {
-        Warninger::sendWarning(FUNC_NAME, "Failed to create blank texture.");
+    sessionSnapshot = std::make_unique<SessionSnapshot>();
+
+    // Config's sprite size is the default dimension, until something gets loaded
+    auto configSpriteSize = ConfigManager::getInstance()->getSpriteMaxSize();
+    auto dimensionIt = std::find(m_spriteDimensions.begin(), m_spriteDimensions.end(), configSpriteSize);
+    if (dimensionIt != m_spriteDimensions.end()) {
+        m_assetsInfo.dimensionIndex = static_cast<uint8_t>(dimensionIt - m_spriteDimensions.begin());
+        m_tempCreation_AssetsInfo.dimensionIndex = m_assetsInfo.dimensionIndex;
+    } else {
+        Warninger::sendWarning(FUNC_NAME, "Sprite size " + std::to_string(configSpriteSize) + " from config is not supported, using 32.");
     }
+    setSpriteSize(getSpriteDimensionsVector().at(m_assetsInfo.dimensionIndex));
 
     // Setup Temp Info for "New Assets" creation
     m_tempCreation_AssetsInfo.extended = SavedData::getInstance()->getDataBool("sprExtended");
     m_tempCreation_AssetsInfo.transparency = SavedData::getInstance()->getDataBool("sprTransparency");
+
+    history.setMaxSteps(ConfigManager::getInstance()->getUndoSteps());
 }
 
 AssetsManager::~AssetsManager() {
+    // Jobs may still be using the stores/arenas
+    cancelOperation();
+    JobSystem::getInstance()->waitIdle();
+    endOperation();
     unload();
 }
 
+void AssetsManager::setSpriteSize(uint32_t size) {
+    if (BLANK_TEXTURE && size == spriteSize) {
+        return;
+    }
+    spriteSize = size;
+
+    // Setup blank texture
+    sf::Image image({size, size}, sf::Color::Transparent);
+    BLANK_TEXTURE = std::make_shared<sf::Texture>();
+    if (!BLANK_TEXTURE->loadFromImage(image)) {
+        Warninger::sendWarning(FUNC_NAME, "Failed to create blank texture.");
+    }
+}
+
 std::shared_ptr<sf::Texture> AssetsManager::getTexture(int id) {
     if(!isValidTextureIndex(id)) {
         return BLANK_TEXTURE;
     }
 
-    return textures.at(id);
+    touchSprite(static_cast<uint32_t>(id));
+    const auto& texture = textures.at(id);
+    return texture ? texture : BLANK_TEXTURE;
 }
 
-// Helper function to read a little-endian 16-bit integer from a byte array
-uint16_t readLE16(const uint8_t* data) {
-    return data[0] | (data[1] << 8);
+namespace {
+    // Sprites one decode job takes care of
+    constexpr uint32_t SPR_LOAD_CHUNK = 4096;
+    // Read backs per frame before compiling in the background
+    constexpr size_t COMPILE_READBACKS_PER_FRAME = 256;
+    // Textures used in this many last frames are never evicted, they are most likely on screen
+    constexpr uint32_t EVICTION_GRACE_FRAMES = 2;
+    // Eviction goes this far below the budget, so it doesn't run again right away
+    constexpr uint64_t EVICTION_HEADROOM_PERCENT = 10;
+    // Frames to wait after an eviction that couldn't get under the budget
+    constexpr uint32_t EVICTION_RETRY_FRAMES = 60;
+
+    uint64_t getTextureBytes(const std::shared_ptr<sf::Texture>& texture) {
+        if (!texture) {
+            return 0;
+        }
+        return static_cast<uint64_t>(texture->getSize().x) * texture->getSize().y * 4;
+    }
+
+    // Moves values to their new ids (index = old id), ids the vector didn't reach get 'missing'
+    template<typename T>
+    void moveToNewIds(std::vector<T>& values, const std::vector<uint32_t>& newIds, const T& missing) {
+        std::vector<T> moved(newIds.size(), missing);
+        for (size_t id = 0; id < newIds.size() && id < values.size(); ++id) {
+            moved[newIds[id]] = values[id];
+        }
+        values = std::move(moved);
+    }
+
+    bool writeDatFile(const std::string& path, const std::vector<uint8_t>& data) {
+        AtomicFileWriter file(path);
+        if (!file.isOpen() || !file.write(data.data(), data.size()) || !file.commit()) {
+            Warninger::sendErrorMsg(FUNC_NAME, "Failed to write dat to: " + path);
+            return false;
+        }
+        return true;
+    }
 }
 
+// .spr being loaded - decoded in chunks (any thread), uploaded through the TextureUploader (UI thread)
+struct AssetsManager::SprLoad {
+    std::string path;
+    MappedFile file;
+    bool transparency = false;
+    uint32_t dimension = 32;
+    uint32_t signature = 0;
+    uint32_t spriteCount = 0;
+    size_t offsetsStart = 0;
+
+    std::vector<SprRecordRef> records; // index = sprite id, written by the chunk that has the sprite
+    // Content hashes by sprite id, filled while decoding - empty if they were saved for this .spr already
+    std::vector<uint64_t> contentHashes;
+
+    // Puts the uploaded texture in place (UI thread), nullptr texture = couldn't be created
+    std::function<void(uint32_t, std::shared_ptr<sf::Texture>)> onUploaded;
+    std::atomic<uint32_t> queued{0};
+    uint32_t uploaded = 0; // UI thread only
+
+    [[nodiscard]] size_t getChunkCount() const { return (spriteCount + SPR_LOAD_CHUNK - 1) / SPR_LOAD_CHUNK; }
+    [[nodiscard]] size_t getRgbaSize() const { return static_cast<size_t>(dimension) * dimension * 4; }
+
+    // Maps the file and reads its header, false with 'error' set if it can't be decoded
+    bool open(const std::string& filePath, bool extended, bool withTransparency, uint32_t spriteDimension, std::string& error) {
+        if (!SpriteCodec::withCodec(withTransparency, spriteDimension, [](auto) {})) {
+            error = "Sprite dimension " + std::to_string(spriteDimension) + " is not supported.";
+            return false;
+        }
+        if (!file.open(filePath)) {
+            error = "File not found: " + filePath;
+            return false;
+        }
+
+        path = filePath;
+        transparency = withTransparency;
+        dimension = spriteDimension;
+
+        BinaryReader reader(file.data(), file.size());
+        signature = reader.readU32();
+        // Sprite count is 2 bytes for non-extended format
+        SpriteCodec::withSprLayout(extended, [&](auto layout) {
+            spriteCount = static_cast<uint32_t>(reader.read<typename decltype(layout)::CountType>());
+        });
+        offsetsStart = reader.tell();
+        if (reader.overflowed() || offsetsStart + 4ull * spriteCount > file.size()) {
+            error = "Offset table of " + filePath + " is cut off.";
+            return false;
+        }
+
+        records.assign(1 + spriteCount, SprRecordRef());
+        return true;
+    }
+
+    // Any thread, each chunk by one thread only. Decoded sprites get queued for upload, in one staging buffer per chunk.
+    // Stops early (nothing of the chunk queued) if the job gets cancelled.
+    void decodeChunk(size_t chunk, Job* job) {
+        const uint32_t first = static_cast<uint32_t>(chunk * SPR_LOAD_CHUNK) + 1;
+        const uint32_t last = std::min(spriteCount, first + SPR_LOAD_CHUNK - 1);
+
+        // Remember where every record is, so untouched sprites can be copied as they are on compile
+        size_t nonBlank = 0;
+        for (uint32_t spriteId = first; spriteId <= last; ++spriteId) {
+            uint32_t offset = 0;
+            std::memcpy(&offset, file.data() + offsetsStart + 4ull * (spriteId - 1), 4);
+            // Record: 3 unused bytes, u16 data size, RLE data
+            if (offset == 0 || static_cast<uint64_t>(offset) + 5 > file.size()) {
+                continue; // Empty sprite, still takes its id
+            }
+
+            uint16_t dataSize = 0;
+            std::memcpy(&dataSize, file.data() + offset + 3, 2);
+            records[spriteId] = {offset, dataSize};
+            ++nonBlank;
+        }
+
+        if (nonBlank == 0) {
+            return;
+        }
+        auto uploader = TextureUploader::getInstance();
+        auto staging = uploader->acquireStaging(nonBlank * getRgbaSize());
+
+        // Codec for this file's mode gets picked once, the loop below has no per-pixel mode checks
+        bool decoded = true;
+        SpriteCodec::withCodec(transparency, dimension, [&](auto codec) {
+            using Codec = decltype(codec);
+            uint8_t* out = staging->data();
+            for (uint32_t spriteId = first; spriteId <= last; ++spriteId) {
+                const SprRecordRef& record = records[spriteId];
+                if (record.offset == 0) {
+                    continue;
+                }
+
+                size_t start = static_cast<size_t>(record.offset) + 5;
+                size_t size = std::min<size_t>(record.dataSize, file.size() - start);
+                Codec::decode(file.data() + start, size, out);
+                if (!contentHashes.empty()) {
+                    contentHashes[spriteId] = SpriteHashIndex::hashPixels(out, Codec::RGBA_SIZE);
+                }
+                out += Codec::RGBA_SIZE;
+
+                if (job && (spriteId - first) % 256 == 255) {
+                    if (job->isCancelled()) {
+                        decoded = false;
+                        return;
+                    }
+                    job->setProgress(spriteId - first + 1, last - first + 1);
+                }
+            }
+        });
+        if (!decoded) {
+            return;
+        }
+
+        size_t position = 0;
+        for (uint32_t spriteId = first; spriteId <= last; ++spriteId) {
+            if (records[spriteId].offset == 0) {
+                continue;
+            }
+            uploader->enqueue(staging, position, dimension, dimension, [this, spriteId](std::shared_ptr<sf::Texture> texture) {
+                onUploaded(spriteId, std::move(texture));
+            }, this);
+            position += getRgbaSize();
+        }
+        queued += static_cast<uint32_t>(nonBlank);
+    }
+};
+
 bool AssetsManager::loadSpr(const std::string& sprFilePath) {
     Timer timer("Loading .spr");
 
@@ -51,238 +245,517 @@ bool AssetsManager::loadSpr(const std::string& sprFilePath) {
         decidedPath = ConfigManager::getInstance()->getPathAssets() + "Tibia.spr";
     }
 
-    std::ifstream file(decidedPath, std::ios::binary);
-    if (!file.is_open()) {
-        Warninger::sendErrorMsg(FUNC_NAME, "File not found: " + decidedPath);
+    SprLoad load;
+    std::string error;
+    if (!load.open(decidedPath, m_assetsInfo.extended, m_assetsInfo.transparency,
+                   getSpriteDimensionsVector().at(m_assetsInfo.dimensionIndex), error)) {
+        Warninger::sendErrorMsg(FUNC_NAME, error);
         return false;
     }
+    fmt::print("Signature of loaded spr: {}\n", load.signature);
+    setSpriteSize(load.dimension);
+
+    // Chunk by chunk, so only one chunk of pixels is in memory at a time
+    prepareSprUpload(load);
+    for (size_t chunk = 0; chunk < load.getChunkCount(); ++chunk) {
+        load.decodeChunk(chunk, nullptr);
+        TextureUploader::getInstance()->flush();
+    }
+    finishSprLoad(load);
+    return true;
+}
 
-    // Read and verify signature
-    uint32_t signature;
-    file.read(reinterpret_cast<char*>(&signature), 4);
-    fmt::print("Signature of loaded spr: {}\n", signature);
-    setLoadedSprSignature(signature);
-
-    // Read sprite count (2 bytes for non-extended format)
-    uint32_t spriteCount;
-    if(m_assetsInfo.extended) {
-        file.read(reinterpret_cast<char *>(&spriteCount), 4);
-    } else {
-        uint16_t tempSpriteCount;
-        file.read(reinterpret_cast<char*>(&tempSpriteCount), 2);
-        spriteCount = static_cast<uint32_t>(tempSpriteCount);
+void AssetsManager::prepareSprUpload(SprLoad& load) {
+    // Slots are there from the start (air, id 0, included), textures fill them as they get uploaded
+    textures.assign(1 + load.spriteCount, BLANK_TEXTURE);
+    spriteTextureCount = 0;
+    spriteTextureBytes = 0;
+    if (!loadSpriteHashes(load.path, load.dimension, load.transparency)) {
+        load.contentHashes.assign(1 + load.spriteCount, 0);
     }
 
-    // Add BLANK_TEXTURE, as air (id 0)
-    textures.reserve(1 + spriteCount);
-    textures.push_back(BLANK_TEXTURE);
+    load.onUploaded = [this, &load](uint32_t spriteId, std::shared_ptr<sf::Texture> texture) {
+        if (texture) {
+            accountSpriteTexture(textures[spriteId], texture);
+            textures[spriteId] = std::move(texture);
+        } else {
+            // Don't let compile reuse the record of a sprite we don't have
+            load.records[spriteId] = SprRecordRef();
+        }
+        ++load.uploaded;
+    };
+}
 
-    // Read sprite offsets (4 bytes per offset)
-    std::vector<uint32_t> offsets(spriteCount);
-    for (uint32_t i = 0; i < spriteCount; ++i) {
-        file.read(reinterpret_cast<char*>(&offsets[i]), 4);
+void AssetsManager::finishSprLoad(SprLoad& load) {
+    setLoadedSprSignature(load.signature);
+    // Sprites whose texture couldn't be created are blank now, whatever was saved for them
+    for (uint32_t id = 0; id < load.records.size(); ++id) {
+        if (load.records[id].offset == 0) {
+            spriteHashIndex.set(id, SpriteHashIndex::BLANK_HASH);
+        } else if (!load.contentHashes.empty()) {
+            spriteHashIndex.set(id, load.contentHashes[id]);
+        }
+    }
+    spriteHashesChanged = spriteHashesChanged || !load.contentHashes.empty();
+    sprRecords = std::move(load.records);
+    sprRecordsPath = load.path;
+    sprRecordsTransparency = load.transparency;
+    sprRecordsDimension = load.dimension;
+    dirtySprites.assign(textures.size(), false);
+    ++spritesRevision;
+    load.file.close();
+    if (spriteHashesChanged) {
+        saveSpriteHashes();
     }
 
-    // temp var to decide loaded sprite size
-    const auto& singleSpriteSize = getSpriteDimensionsVector().at(m_assetsInfo.dimensionIndex);
+    onGraphicsLoaded(load.path);
+}
 
-    // Process each sprite
-    for (uint32_t spriteId = 1; spriteId <= spriteCount; ++spriteId) {
-        uint32_t offset = offsets[spriteId - 1];
-        if (offset == 0) continue;
+bool AssetsManager::canCompileSprIncrementally() const {
+    // RLE payloads are only reusable if they were encoded the same way we would encode them now
+    return !sprRecordsPath.empty() &&
+           sprRecordsTransparency == m_assetsInfo.transparency &&
+           sprRecordsDimension == getCompileSpriteSize() &&
+           std::filesystem::exists(sprRecordsPath);
+}
 
-        file.seekg(offset, std::ios::beg);
-        file.ignore(3); // Skip unused bytes
+void AssetsManager::markSpriteDirty(uint32_t id) {
+    if (id >= dirtySprites.size()) {
+        dirtySprites.resize(id + 1, false);
+    }
+    dirtySprites[id] = true;
+    ++spritesRevision;
 
-        // Read sprite data size
-        uint16_t dataSize;
-        file.read(reinterpret_cast<char*>(&dataSize), 2);
+    spriteHashIndex.invalidate(id);
+}
 
-        // Read compressed sprite data
-        std::vector<uint8_t> spriteData(dataSize);
-        file.read(reinterpret_cast<char*>(spriteData.data()), dataSize);
+bool AssetsManager::isSpriteDirty(uint32_t id) const {
+    // Sprites we have no bit for were never loaded/compiled, so they are dirty too
+    return id >= dirtySprites.size() || dirtySprites[id];
+}
 
-        // Process RLE data into 32x32 RGBA pixels
-        std::vector<uint8_t> pixels(singleSpriteSize * singleSpriteSize * 4, 0); // RGBA buffer
-        size_t dataPtr = 0;
-        size_t pixelPtr = 0;
+SprSource AssetsManager::getSprSource() const {
+    SprSource source;
+    if (sprRecordsPath.empty() || sprRecordsDimension != getSpriteSize() || !std::filesystem::exists(sprRecordsPath)) {
+        return source;
+    }
 
-        while (pixelPtr < singleSpriteSize * singleSpriteSize && dataPtr < spriteData.size()) {
-            // Read transparent pixels count
-            if (dataPtr + 2 > spriteData.size()) break;
-            uint16_t transparent = readLE16(&spriteData[dataPtr]);
-            dataPtr += 2;
-            pixelPtr += transparent;
+    source.path = sprRecordsPath;
+    source.transparency = sprRecordsTransparency;
+    source.dimension = sprRecordsDimension;
+    source.records = sprRecords;
+    source.dirty = dirtySprites;
+    return source;
+}
 
-            if (pixelPtr >= singleSpriteSize * singleSpriteSize) break;
+// Everything the .spr writer needs, gathered on the UI thread so the writing can run anywhere
+struct AssetsManager::SprCompile {
+    std::string outputPath;
+    bool extended = false;
+    bool transparency = false;
+    uint32_t signature = 0;
+    uint32_t sourceSize = 32;
+    uint32_t outputSize = 32;
+    bool sideBuild = false;
+    uint32_t spriteCount = 0;
+
+    // Empty = not incremental
+    std::string previousPath;
+    uint64_t previousSize = 0;
+
+    enum RecordSource : uint8_t { RECORD_EMPTY, RECORD_REUSED, RECORD_ENCODED };
+    struct PendingRecord {
+        RecordSource source = RECORD_EMPTY;
+        uint32_t position = 0; // offset in previous .spr, index in 'pixels' until encoded, then offset in 'encoded'
+        uint16_t dataSize = 0;
+    };
+    std::vector<PendingRecord> records; // index = sprite id
+    uint32_t reusedCount = 0;
+    uint32_t encodedCount = 0;
+
+    // Textures to read back (UI thread), in id order
+    std::vector<std::pair<uint32_t, std::shared_ptr<sf::Texture>>> toRead;
+    size_t readCount = 0;
+    std::vector<uint8_t> pixels; // sourceSize^2 * 4 per read back sprite
+
+    // Offsets of the written .spr
+    std::vector<uint32_t> offsets;
+    bool written = false; // target got replaced
+
+    // Any thread. Encodes the read back sprites and writes the file, target is untouched if it returns false.
+    bool write(Job* job) {
+        const size_t sourceRgbaSize = static_cast<size_t>(sourceSize) * sourceSize * 4;
+        std::vector<uint8_t> encoded;
+        std::vector<uint8_t> scaled(static_cast<size_t>(outputSize) * outputSize * 4);
+
+        // Codec for the output mode gets picked once, not per pixel
+        bool knownDimension = SpriteCodec::withCodec(transparency, outputSize, [&](auto codec) {
+            using Codec = decltype(codec);
+
+            for (uint32_t id = 1; id <= spriteCount; ++id) {
+                auto& record = records[id];
+                if (record.source != RECORD_ENCODED) {
+                    continue;
+                }
+                if (job && id % 256 == 0) {
+                    if (job->isCancelled()) {
+                        return;
+                    }
+                    job->setProgress(id, 2ull * spriteCount);
+                }
+
+                const uint8_t* pixelsPtr = pixels.data() + static_cast<size_t>(record.position) * sourceRgbaSize;
+                if (sideBuild) {
+                    SpriteCodec::downscale(pixelsPtr, sourceSize, Codec::DIMENSION, scaled.data());
+                    if constexpr (!Codec::TRANSPARENCY) {
+                        // No alpha in output, so half covered edge pixels are either there or not
+                        for (size_t i = 0; i < Codec::PIXELS; ++i) {
+                            if (scaled[i * 4 + 3] < 128) {
+                                scaled[i * 4 + 3] = 0;
+                            }
+                        }
+                    }
+                    pixelsPtr = scaled.data();
+                }
+
+                size_t start = encoded.size();
+                Codec::encode(pixelsPtr, encoded);
+                size_t dataSize = encoded.size() - start;
+                if (dataSize > 0xFFFF) {
+                    Warninger::sendWarning(FUNC_NAME, "Sprite " + std::to_string(id) + " is too big after compression, written as empty.");
+                    encoded.resize(start);
+                    record = PendingRecord();
+                    continue;
+                }
+                record.position = static_cast<uint32_t>(start);
+                record.dataSize = static_cast<uint16_t>(dataSize);
+                ++encodedCount;
+            }
+        });
+        if (!knownDimension) {
+            Warninger::sendErrorMsg(FUNC_NAME, "Sprite dimension " + std::to_string(outputSize) + " is not supported.");
+            return false;
+        }
+        if (job && job->isCancelled()) {
+            return false;
+        }
+        // Read back pixels aren't needed anymore
+        std::vector<uint8_t>().swap(pixels);
+
+        // 2. Offset table - records go right after it, in id order
+        offsets.assign(spriteCount, 0);
+        uint64_t position = SpriteCodec::withSprLayout(extended, [](auto layout) {
+            return decltype(layout)::HEADER_SIZE;
+        }) + 4ull * spriteCount;
+        for (uint32_t id = 1; id <= spriteCount; ++id) {
+            if (records[id].source == RECORD_EMPTY) {
+                continue;
+            }
+            offsets[id - 1] = static_cast<uint32_t>(position);
+            position += 5 + records[id].dataSize; // 3 unused bytes + data size + data
+        }
+        if (position > 0xFFFFFFFFull) {
+            Warninger::sendErrorMsg(FUNC_NAME, "Sprites don't fit into .spr (over 4GB), nothing got compiled.");
+            return false;
+        }
 
-            // Read colored pixels count
-            if (dataPtr + 2 > spriteData.size()) break;
-            uint16_t colored = readLE16(&spriteData[dataPtr]);
-            dataPtr += 2;
+        // Output goes to a temporary file first, so the previous .spr can be read while writing, even if it is the target
+        std::ifstream previousSpr;
+        if (!previousPath.empty()) {
+            previousSpr.open(previousPath, std::ios::binary);
+        }
 
-            for (uint16_t i = 0; i < colored; ++i) {
-                if (pixelPtr >= singleSpriteSize * singleSpriteSize || dataPtr + 3 > spriteData.size()) break;
+        // 3. Write it all in one go, front to back
+        AtomicFileWriter out(outputPath);
+        if (!out.isOpen()) {
+            return false;
+        }
 
-                // Read RGB values
-                uint8_t r = spriteData[dataPtr++];
-                uint8_t g = spriteData[dataPtr++];
-                uint8_t b = spriteData[dataPtr++];
-                uint8_t a = m_assetsInfo.transparency ? spriteData[dataPtr++] : 255;
+        out.writeValue(signature);
+        SpriteCodec::withSprLayout(extended, [&](auto layout) {
+            out.writeValue(static_cast<typename decltype(layout)::CountType>(spriteCount));
+        });
+        out.write(offsets.data(), offsets.size() * 4);
+
+        // Reused records mostly sit next to each other in the previous .spr, so they get copied in runs
+        std::vector<char> copyBuffer;
+        uint64_t runStart = 0, runEnd = 0;
+        auto copyRun = [&]() {
+            while (runStart < runEnd) {
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(runEnd - runStart, 4 * 1024 * 1024));
+                copyBuffer.resize(chunk);
+                previousSpr.seekg(static_cast<std::streamoff>(runStart));
+                if (!previousSpr.read(copyBuffer.data(), static_cast<std::streamsize>(chunk))) {
+                    return false;
+                }
+                out.write(copyBuffer.data(), chunk);
+                runStart += chunk;
+            }
+            return true;
+        };
 
-                // Fill RGBA buffer
-                size_t idx = pixelPtr * 4;
-                pixels[idx] = r;
-                pixels[idx + 1] = g;
-                pixels[idx + 2] = b;
-                pixels[idx + 3] = a;
+        bool copyFailed = false;
+        for (uint32_t id = 1; id <= spriteCount && !copyFailed; ++id) {
+            if (job && id % 4096 == 0) {
+                if (job->isCancelled()) {
+                    return false; // Not committed, target stays as it was
+                }
+                job->setProgress(spriteCount + id, 2ull * spriteCount);
+            }
 
-                pixelPtr++;
+            const auto& record = records[id];
+            if (record.source == RECORD_REUSED) {
+                // Whole record, unused bytes and data size included
+                if (record.position != runEnd) {
+                    copyFailed = !copyRun();
+                    runStart = record.position;
+                }
+                runEnd = static_cast<uint64_t>(record.position) + 5 + record.dataSize;
+            } else if (record.source == RECORD_ENCODED) {
+                copyFailed = !copyRun();
+                const uint8_t unusedBytes[3] = {0, 0, 0};
+                out.write(unusedBytes, sizeof(unusedBytes));
+                out.writeValue(record.dataSize);
+                out.write(encoded.data() + record.position, record.dataSize);
             }
         }
+        copyFailed = copyFailed || !copyRun();
 
-        auto texture = std::make_shared<sf::Texture>(sf::Vector2u(singleSpriteSize, singleSpriteSize));
-        if (texture->getSize().x != 0 && texture->getSize().y != 0) {
-            texture->update(pixels.data());
-            textures.push_back(texture);
-        } else {
-            //Warninger::sendWarning(FUNC_NAME, "Failed to create texture, id: " + std::to_string(textureId));
+        // Windows won't replace a file that is still open
+        previousSpr.close();
+
+        if (copyFailed) {
+            Warninger::sendErrorMsg(FUNC_NAME, "Failed to read sprites from " + previousPath + ", " + outputPath + " is left untouched.");
+            return false;
         }
+        if (out.getWrittenSize() != position || !out.commit()) {
+            return false;
+        }
+        written = true;
+        fmt::print("Compiled {} sprites ({} reused, {} encoded)\n", spriteCount, reusedCount, encodedCount);
+        return true;
     }
+};
 
-    onGraphicsLoaded(decidedPath);
+bool AssetsManager::compileSprFromTextures(const std::string& fileName)
+{
+    SprCompile compile;
+    if (!prepareSprCompile(fileName, compile)) {
+        return false;
+    }
+    readBackSprites(compile, compile.toRead.size());
+    if (!compile.write(nullptr)) {
+        return false;
+    }
+    finishSprCompile(compile);
     return true;
 }
 
-void AssetsManager::compileSprFromTextures(const std::string& fileName)
-{
-    // temp var for an optional feature that I once used
-    bool downscale64To32 = false;
-
-    std::ofstream out(fileName, std::ios::binary);
-    if (!out.is_open()) {
-        std::cerr << "Failed to open file for writing: " << fileName << std::endl;
-        return;
+bool AssetsManager::prepareSprCompile(const std::string& fileName, SprCompile& compile) {
+    // Mapped .spr couldn't be replaced on Windows, it gets mapped again when needed
+    sprMapping.close();
+    sprMappingPath.clear();
+
+    // HD sprites can be compiled into a legacy 32x32 build, that's a side build though -
+    // it isn't what the next incremental compile should reuse records from
+    compile.outputPath = fileName;
+    compile.extended = m_assetsInfo.extended;
+    compile.transparency = m_assetsInfo.transparency;
+    compile.signature = getLoadedSprSignature();
+    compile.sourceSize = getSpriteSize();
+    compile.outputSize = getCompileSpriteSize();
+    compile.sideBuild = compile.outputSize != compile.sourceSize;
+
+    if (!SpriteCodec::canDownscale(compile.sourceSize, compile.outputSize)) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Can't downscale " + std::to_string(compile.sourceSize) + "x" + std::to_string(compile.sourceSize) +
+                                           " sprites to " + std::to_string(compile.outputSize) + "x" + std::to_string(compile.outputSize));
+        return false;
     }
 
-    // 1. Write signature
-    uint32_t signature = getLoadedSprSignature();
-    out.write(reinterpret_cast<const char*>(&signature), sizeof(signature));
-
-    // 2. Write sprite count
-    uint32_t spriteCount = static_cast<uint32_t>(textures.size());
-    if (m_assetsInfo.extended) {
-        out.write(reinterpret_cast<const char*>(&spriteCount), 4);
-    } else {
-        uint16_t count16 = static_cast<uint16_t>(spriteCount);
-        out.write(reinterpret_cast<const char*>(&count16), 2);
+    bool incremental = m_assetsInfo.incrementalCompile && canCompileSprIncrementally();
+    if (incremental) {
+        std::error_code ec;
+        compile.previousSize = std::filesystem::file_size(sprRecordsPath, ec);
+        if (ec) {
+            Warninger::sendWarning(FUNC_NAME, "Couldn't read " + sprRecordsPath + ", compiling all sprites.");
+            incremental = false;
+        } else {
+            compile.previousPath = sprRecordsPath;
+        }
     }
 
-    // 3. Reserve space for offset table
-    std::streampos offsetTableStart = out.tellp();
-    std::vector<std::streampos> offsetPositions(spriteCount);
-    for (uint32_t i = 0; i < spriteCount; ++i) {
-        offsetPositions[i] = out.tellp();
-        uint32_t placeholder = 0;
-        out.write(reinterpret_cast<const char*>(&placeholder), 4);
+    // Sprite ids in .spr start from 1, textures[0] is air and doesn't get written
+    compile.spriteCount = textures.empty() ? 0 : static_cast<uint32_t>(textures.size() - 1);
+    uint32_t maxSprites = SpriteCodec::withSprLayout(m_assetsInfo.extended, [](auto layout) {
+        return decltype(layout)::MAX_SPRITES;
+    });
+    if (compile.spriteCount > maxSprites) {
+        Warninger::sendWarning(FUNC_NAME, "Too many sprites for not extended .spr, only the first " + std::to_string(maxSprites) + " get compiled.");
+        compile.spriteCount = maxSprites;
     }
 
-    // 4. Write each sprite
-    std::vector<uint32_t> actualOffsets(spriteCount, 0);
+    // 1. Collect records - untouched ones are taken as they are from the previous .spr, the rest gets encoded
+    compile.records.assign(1 + compile.spriteCount, SprCompile::PendingRecord());
+    for (uint32_t id = 1; id <= compile.spriteCount; ++id) {
+        if (incremental && id < sprRecords.size() && !isSpriteDirty(id)) {
+            const auto& ref = sprRecords[id];
+            if (ref.offset == 0) {
+                continue; // was empty, still is
+            }
+            if (static_cast<uint64_t>(ref.offset) + 5 + ref.dataSize <= compile.previousSize) {
+                compile.records[id] = {SprCompile::RECORD_REUSED, ref.offset, ref.dataSize};
+                ++compile.reusedCount;
+                continue;
+            }
+        }
 
-    for (uint32_t i = 0; i < spriteCount; ++i) {
-        auto texture = textures[i];
-        if (!texture) continue;
+        if (isSpriteEvicted(id)) {
+            // Not worth uploading again just to read it back
+            const size_t rgbaSize = static_cast<size_t>(compile.sourceSize) * compile.sourceSize * 4;
+            size_t offset = compile.pixels.size();
+            compile.pixels.resize(offset + rgbaSize);
+            if (decodeSpriteFromSpr(id, compile.pixels.data() + offset)) {
+                compile.records[id] = {SprCompile::RECORD_ENCODED, static_cast<uint32_t>(offset / rgbaSize), 0};
+            } else {
+                compile.pixels.resize(offset);
+                Warninger::sendWarning(FUNC_NAME, "Sprite " + std::to_string(id) + " couldn't be decoded, written as empty.");
+            }
+            continue;
+        }
 
-        std::streampos spriteStart = out.tellp();
-        actualOffsets[i] = static_cast<uint32_t>(spriteStart);
+        const auto& texture = textures[id];
+        if (texture && texture != BLANK_TEXTURE) {
+            compile.toRead.emplace_back(id, texture);
+        }
+    }
+    compile.pixels.reserve(compile.pixels.size() + compile.toRead.size() * compile.sourceSize * compile.sourceSize * 4);
+    // Evicted sprites got decoded through the mapping, the target has to be free again
+    sprMapping.close();
+    sprMappingPath.clear();
+    return true;
+}
 
-        // Write 3 unused bytes
-        out.put(0).put(0).put(0);
+void AssetsManager::readBackSprites(SprCompile& compile, size_t budget) {
+    const size_t rgbaSize = static_cast<size_t>(compile.sourceSize) * compile.sourceSize * 4;
+    for (; budget > 0 && compile.readCount < compile.toRead.size(); --budget) {
+        auto& [id, texture] = compile.toRead[compile.readCount++];
 
         // Get pixel data
-        const uint8_t* pixels;
-        if(downscale64To32) {
-            sf::RenderTexture rt({32, 32});
-            sf::Sprite sprite(*texture);
-            sprite.setScale({0.5f, 0.5f}); // 64 → 32 scaling
-
-            rt.clear(sf::Color::Transparent);
-            rt.draw(sprite);
-            rt.display();
-
-            sf::Image scaledImage = rt.getTexture().copyToImage();
-            pixels = scaledImage.getPixelsPtr();
-        } else {
-            const auto& image = texture->copyToImage();
-            pixels = image.getPixelsPtr();
+        sf::Image image = texture->copyToImage();
+        texture.reset();
+        if (image.getSize().x != compile.sourceSize || image.getSize().y != compile.sourceSize) {
+            Warninger::sendWarning(FUNC_NAME, "Sprite " + std::to_string(id) + " has wrong size, written as empty.");
+            continue;
         }
 
-        // RLE compression
-        std::vector<uint8_t> rleData;
-        size_t pixelPtr = 0;
-        const size_t totalPixels = 32 * 32;
+        auto index = static_cast<uint32_t>(compile.pixels.size() / rgbaSize);
+        compile.pixels.insert(compile.pixels.end(), image.getPixelsPtr(), image.getPixelsPtr() + rgbaSize);
+        compile.records[id] = {SprCompile::RECORD_ENCODED, index, 0};
+    }
+}
 
-        auto writeLE16 = [](std::vector<uint8_t>& data, uint16_t val) {
-            data.push_back(val & 0xFF);
-            data.push_back((val >> 8) & 0xFF);
-        };
+void AssetsManager::finishSprCompile(const SprCompile& compile) {
+    if (compile.sideBuild) {
+        return;
+    }
 
-        auto isTransparent = [](const uint8_t* px, size_t i) {
-            return (px[i * 4 + 0] == 255 &&
-                    px[i * 4 + 1] == 0 &&
-                    px[i * 4 + 2] == 255 && px[i * 4 + 3] == 255) || px[i * 4 + 3] == 0;
-        };
+    // Compiled file is now the one to reuse records from
+    sprRecords.assign(1 + compile.spriteCount, SprRecordRef());
+    for (uint32_t id = 1; id <= compile.spriteCount; ++id) {
+        if (compile.records[id].source != SprCompile::RECORD_EMPTY) {
+            sprRecords[id] = {compile.offsets[id - 1], compile.records[id].dataSize};
+        }
+    }
+    sprRecordsPath = compile.outputPath;
+    sprRecordsTransparency = compile.transparency;
+    sprRecordsDimension = compile.outputSize;
+    dirtySprites.assign(textures.size(), false);
+
+    // Hashes of all the sprites are those of the new file now
+    spriteHashStamp = SpriteHashIndex::getStampOf(sprRecordsPath, sprRecordsDimension, sprRecordsTransparency);
+    saveSpriteHashes();
+}
 
-        while (pixelPtr < totalPixels) {
-            // Transparent pixels
-            uint16_t transparentCount = 0;
-            while (pixelPtr < totalPixels && isTransparent(pixels, pixelPtr)) {
-                ++transparentCount;
-                ++pixelPtr;
-            }
-            writeLE16(rleData, transparentCount);
-            if (pixelPtr >= totalPixels) break;
-
-            // Colored pixels
-            uint16_t coloredCount = 0;
-            size_t colorStart = pixelPtr;
-            while (pixelPtr < totalPixels && !isTransparent(pixels, pixelPtr)) {
-                ++coloredCount;
-                ++pixelPtr;
-            }
+bool AssetsManager::reorderSpritesByUse() {
+    const size_t count = textures.size();
+    std::vector<uint32_t> newIds(count, 0);
+    uint32_t nextId = 1;
+    auto place = [&](uint32_t id) {
+        if (id > 0 && id < count && newIds[id] == 0) {
+            newIds[id] = nextId++;
+        }
+    };
 
-            writeLE16(rleData, coloredCount);
-            for (size_t j = colorStart; j < colorStart + coloredCount; ++j) {
-                const size_t idx = j * 4;
-                rleData.push_back(pixels[idx]);     // R
-                rleData.push_back(pixels[idx + 1]); // G
-                rleData.push_back(pixels[idx + 2]); // B
-                if (m_assetsInfo.transparency) {
-                    rleData.push_back(pixels[idx + 3]); // A
-                }
-            }
+    // Sprite ids of a thing go frame after frame, so taking them in order keeps the animation together
+    for (const auto& itemType : Items::getItemTypes()) {
+        if (itemType) {
+            std::for_each(itemType->textureIdsVector.begin(), itemType->textureIdsVector.end(), place);
+        }
+    }
+    for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        for (const auto& thingType : ThingTypes::getThingTypes(category)) {
+            std::for_each(thingType->textureIds.begin(), thingType->textureIds.end(), place);
         }
+    }
+    for (uint32_t id = 1; id < count; ++id) {
+        place(id);
+    }
 
-        // Data size
-        uint16_t dataSize = static_cast<uint16_t>(rleData.size());
-        out.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
-        out.write(reinterpret_cast<const char*>(rleData.data()), rleData.size());
+    bool moved = false;
+    for (uint32_t id = 1; id < count && !moved; ++id) {
+        moved = newIds[id] != id;
+    }
+    if (!moved) {
+        return false;
     }
 
-    // 5. Write offset table
-    out.seekp(offsetTableStart);
-    for (uint32_t i = 0; i < spriteCount; ++i) {
-        uint32_t offset = actualOffsets[i];
-        out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    auto remap = [&](auto& ids) {
+        for (uint32_t& id : ids) {
+            id = id < count ? newIds[id] : id;
+        }
+    };
+    for (const auto& itemType : Items::getItemTypes()) {
+        if (itemType) {
+            remap(itemType->textureIdsVector);
+        }
+    }
+    if (unsavedItemTypeCopy && unsavedItemTypeOwned) {
+        remap(unsavedItemTypeCopy->textureIdsVector);
+    }
+    for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+        for (const auto& thingType : ThingTypes::getThingTypes(category)) {
+            remap(thingType->textureIds);
+        }
     }
 
-    out.close();
+    // Everything kept by sprite id, records included - untouched sprites still get reused by incremental compile
+    moveToNewIds(textures, newIds, std::shared_ptr<sf::Texture>());
+    moveToNewIds(dirtySprites, newIds, true);
+    moveToNewIds(evictedSprites, newIds, false);
+    moveToNewIds(spriteLastUse, newIds, 0u);
+    moveToNewIds(sprRecords, newIds, SprRecordRef());
+
+    SpriteHashIndex hashes;
+    hashes.reset(std::max(count, spriteHashIndex.size()));
+    for (uint32_t id = 1; id < count; ++id) {
+        if (uint64_t hash = spriteHashIndex.get(id)) {
+            hashes.set(newIds[id], hash);
+        }
+    }
+    spriteHashIndex = std::move(hashes);
+    spriteHashScanPos = 0;
+
+    // Steps of the history point at the old ids
+    history.clear();
+    ++spritesRevision;
+    setUnsavedChanges(CATEGORY_SPRITES, true);
+    setUnsavedChanges(CATEGORY_ITEMS, true);
+    fmt::print("Reordered {} sprites by the things using them\n", count > 0 ? count - 1 : 0);
+    return true;
 }
 
 bool AssetsManager::isValidTexture(std::shared_ptr<sf::Texture> texture) {
-    auto spriteMaxSize = ConfigManager::getInstance()->getSpriteMaxSize();
-    if(texture->getSize().x != spriteMaxSize || texture->getSize().y != spriteMaxSize) {
+    if(texture->getSize().x != getSpriteSize() || texture->getSize().y != getSpriteSize()) {
         return false;
     }
 
@@ -294,8 +767,8 @@ bool AssetsManager::isValidTextureIndex(int id) {
         return false;
     }
 
-    // Check if the pointer is not null
-    return textures.at(id) != nullptr;
+    // Evicted ones are still there, just not on the GPU right now
+    return textures.at(id) != nullptr || isSpriteEvicted(static_cast<uint32_t>(id));
 }
 
 bool AssetsManager::pushTexture(std::shared_ptr<sf::Texture> texture) {
@@ -303,17 +776,46 @@ bool AssetsManager::pushTexture(std::shared_ptr<sf::Texture> texture) {
         return false;
     }
 
-    textures.push_back(texture);
+    history.record(SpriteChange{static_cast<uint32_t>(textures.size()), nullptr, texture});
+    setTextureSlot(static_cast<uint32_t>(textures.size()), texture);
     return true;
 }
 
+size_t AssetsManager::pushTextures(const std::vector<std::shared_ptr<sf::Texture>>& batch, bool continueBatch) {
+    SpriteBatchChange change;
+    for (const auto& texture : batch) {
+        if (!texture || !isValidTexture(texture)) {
+            continue;
+        }
+
+        auto id = static_cast<uint32_t>(textures.size());
+        change.changes.push_back({id, nullptr, texture});
+        setTextureSlot(id, texture);
+    }
+
+    if (change.changes.empty()) {
+        return 0;
+    }
+
+    size_t added = change.changes.size();
+    auto last = continueBatch ? history.getLastRecorded() : nullptr;
+    auto lastBatch = last ? std::get_if<SpriteBatchChange>(last) : nullptr;
+    if (lastBatch) {
+        lastBatch->changes.insert(lastBatch->changes.end(), change.changes.begin(), change.changes.end());
+    } else {
+        history.record(std::move(change));
+    }
+    return added;
+}
+
 void AssetsManager::replaceTexture(int id, std::shared_ptr<sf::Texture> newTexture) {
     if(!isValidTextureIndex(id)) {
         Warninger::sendErrorMsg(FUNC_NAME, "Invalid texture id " + std::to_string(id));
         return;
     }
 
-    textures[id] = newTexture;
+    history.record(SpriteChange{static_cast<uint32_t>(id), getTexture(id), newTexture});
+    setTextureSlot(id, newTexture);
 }
 
 void AssetsManager::removeTexture(int id) {
@@ -322,16 +824,119 @@ void AssetsManager::removeTexture(int id) {
         return;
     }
 
-    textures[id] = nullptr; // Set to nullptr to avoid dangling pointer
+    history.record(SpriteChange{static_cast<uint32_t>(id), getTexture(id), nullptr});
+    setTextureSlot(id, nullptr);
+}
 
-    // If last element, then reduce vector size by popping from the back
-    if(id == (textures.size() - 1)) {
-        textures.pop_back();
+void AssetsManager::createNewTexture() {
+    history.record(SpriteChange{static_cast<uint32_t>(textures.size()), nullptr, BLANK_TEXTURE});
+    setTextureSlot(static_cast<uint32_t>(textures.size()), BLANK_TEXTURE);
+}
+
+void AssetsManager::setTextureSlot(uint32_t id, std::shared_ptr<sf::Texture> texture) {
+    markSpriteDirty(id);
+    if (isSpriteEvicted(id)) {
+        evictedSprites[id] = false;
+        --evictedSpriteCount;
+    }
+
+    if (!texture) {
+        if (id >= textures.size()) {
+            return;
+        }
+
+        accountSpriteTexture(textures[id], nullptr);
+        textures[id] = nullptr; // Set to nullptr to avoid dangling pointer
+
+        // If last element, then reduce vector size by popping from the back
+        if(id == (textures.size() - 1)) {
+            textures.pop_back();
+        }
+        return;
+    }
+
+    if (id >= textures.size()) {
+        textures.resize(id + 1);
     }
+    accountSpriteTexture(textures[id], texture);
+    textures[id] = std::move(texture);
 }
 
-void AssetsManager::createNewTexture() {
-    getTextures().push_back(BLANK_TEXTURE);
+bool AssetsManager::undo() {
+    if (isBusy()) {
+        return false;
+    }
+    if (hasUnsavedChanges(CATEGORY_ITEMS_ITEMTYPE)) {
+        Warninger::sendWarning(FUNC_NAME, "Save or discard the ItemType changes before using undo.");
+        return false;
+    }
+
+    auto entry = history.stepBack();
+    if (!entry) {
+        return false;
+    }
+
+    applyHistoryEntry(*entry, false);
+    return true;
+}
+
+bool AssetsManager::redo() {
+    if (isBusy()) {
+        return false;
+    }
+    if (hasUnsavedChanges(CATEGORY_ITEMS_ITEMTYPE)) {
+        Warninger::sendWarning(FUNC_NAME, "Save or discard the ItemType changes before using redo.");
+        return false;
+    }
+
+    auto entry = history.stepForward();
+    if (!entry) {
+        return false;
+    }
+
+    applyHistoryEntry(*entry, true);
+    return true;
+}
+
+void AssetsManager::applyHistoryEntry(const UndoHistory::Entry& entry, bool forward) {
+    if (auto sprite = std::get_if<SpriteChange>(&entry)) {
+        setTextureSlot(sprite->id, forward ? sprite->after : sprite->before);
+        setUnsavedChanges(CATEGORY_SPRITES, true);
+    } else if (auto batch = std::get_if<SpriteBatchChange>(&entry)) {
+        // Undo goes backwards, so appended sprites get popped from the end
+        if (forward) {
+            for (const auto& c : batch->changes) {
+                setTextureSlot(c.id, c.after);
+            }
+        } else {
+            for (auto it = batch->changes.rbegin(); it != batch->changes.rend(); ++it) {
+                setTextureSlot(it->id, it->before);
+            }
+        }
+        setUnsavedChanges(CATEGORY_SPRITES, true);
+    } else if (auto item = std::get_if<ItemTypeChange>(&entry)) {
+        if (!Items::isValidItemTypeIndex(item->id)) {
+            Warninger::sendWarning(FUNC_NAME, "ItemType from history doesn't exist anymore (" + std::to_string(item->id) + ")");
+            return;
+        }
+
+        auto stored = Items::getItemType(item->id);
+        if (stored->isArenaBacked()) {
+            // Steps go into a heap copy, reallocations in the arena would pile up with every undo/redo
+            auto heapCopy = std::make_shared<ItemType>(*stored);
+            Items::replaceItemType(item->id, heapCopy);
+            if (unsavedItemTypeCopy == stored) {
+                unsavedItemTypeCopy = heapCopy;
+            }
+            stored = std::move(heapCopy);
+        }
+        // Applied in place - edit session (if any) only shares this ItemType, since there are no unsaved changes
+        item->apply(*stored, forward);
+        if (item->id < previewTextures.size()) {
+            createPreviewTexture(static_cast<int>(item->id));
+        }
+        setUnsavedChanges(CATEGORY_ITEMS, true);
+    }
 }
 
 ImTextureID AssetsManager::getImGuiTexture(int id) {
@@ -339,7 +944,7 @@ ImTextureID AssetsManager::getImGuiTexture(int id) {
         return (ImTextureID)BLANK_TEXTURE->getNativeHandle();
     }
 
-    auto texture = textures.at(id);
+    auto texture = getTexture(id);
     return (ImTextureID)texture->getNativeHandle();
 }
 
@@ -360,344 +965,684 @@ void AssetsManager::exportTexture(const std::string& outputString, sf::Texture t
     }
 }
 
-void AssetsManager::compileOTDat(const std::string& outputFilePath) {
-    fmt::println("--- Compiling .dat needs to be implemented :) TO-DO");
+bool AssetsManager::compileOTDat(const std::string& outputFilePath) {
+    Timer timer("Compiling .dat (OTDat)");
+
+    std::vector<uint8_t> data;
+    return buildOTDat(outputFilePath, data) && writeDatFile(outputFilePath, data);
+}
+
+bool AssetsManager::buildOTDat(const std::string& outputFilePath, std::vector<uint8_t>& data) {
+    const auto& items = Items::getItemTypes();
+    if (items.size() + 99 > 0xFFFF) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Too many items for .dat: " + std::to_string(items.size()));
+        return false;
+    }
+
+    DatFormat::ParseOptions options;
+    options.extended = m_assetsInfo.extended;
+    options.frameDurations = m_assetsInfo.frameDurations;
+    options.frameGroups = m_assetsInfo.frameGroups;
+
+    DatFormat::Header header;
+    header.itemCount = static_cast<uint16_t>(items.size() + 99);
+    header.outfitCount = static_cast<uint16_t>(ThingTypes::getThingTypesCount(THING_OUTFIT));
+    header.effectCount = static_cast<uint16_t>(ThingTypes::getThingTypesCount(THING_EFFECT));
+    header.missileCount = static_cast<uint16_t>(ThingTypes::getThingTypesCount(THING_MISSILE));
+
+    // Whole .dat is built in memory, it's a few MB at most
+    data.clear();
+    data.reserve(1024 * 1024);
+    BinaryWriter writer(data);
+
+    std::string error;
+    bool written = DatFormat::withProfile(m_assetsInfo.versionIndex, [&](auto profile) {
+        using Profile = decltype(profile);
+        header.signature = datSignature != 0 ? datSignature : Profile::SIGNATURE;
+        DatFormat::writeHeader(writer, header);
+
+        bool ok = DatFormat::writeItems<Profile>(writer, items, options, error);
+        for (ThingCategory_t category : {THING_OUTFIT, THING_EFFECT, THING_MISSILE}) {
+            if (!ok) {
+                break;
+            }
+            ok = DatFormat::writeThings(writer, category, ThingTypes::getThingTypes(category), options, error);
+        }
+        return ok;
+    });
+
+    if (!written) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Failed to compile dat '" + outputFilePath + "': " + error);
+        return false;
+    }
+    return true;
+}
+
+// .dat being loaded - read on the UI thread, parsed anywhere, stored on the UI thread
+struct AssetsManager::DatLoad {
+    std::string path;
+    std::vector<char> fileData;
+    DatFormat::ParseOptions options;
+    int fallbackProfile = 0;
+
+    // Parsed, not in Items/ThingTypes yet. Made in their arenas, which only the parsing thread touches meanwhile.
+    int profileId = 0;
+    uint32_t signature = 0;
+    std::vector<std::shared_ptr<ItemType>> items;
+    std::vector<std::pair<ThingCategory_t, std::shared_ptr<ThingType>>> things;
+
+    // Any thread. Things read up to a broken one are kept, like the rest of the app does with broken files.
+    void parse(Job* job) {
+        auto data = reinterpret_cast<const uint8_t*>(fileData.data());
+
+        // Protocol version from signature, or whichever layout reads the items fine
+        profileId = DatFormat::findProfile(data, fileData.size(), options);
+        if (profileId < 0) {
+            Warninger::sendWarning(FUNC_NAME, "Couldn't detect protocol version of " + path + ", reading it as " +
+                                              DatFormat::PROFILE_NAMES[fallbackProfile]);
+            profileId = fallbackProfile;
+        }
+
+        BinaryReader reader(data, fileData.size());
+        DatFormat::Header header = DatFormat::readHeader(reader);
+        fmt::print("Signature of loaded dat: {} (protocol {})\n", header.signature, DatFormat::PROFILE_NAMES[profileId]);
+        signature = header.signature;
+
+        uint64_t total = (header.itemCount >= 100 ? header.itemCount - 99 : 0) +
+                         static_cast<uint64_t>(header.outfitCount) + header.effectCount + header.missileCount;
+        auto countParsed = [&]() {
+            if (job && (items.size() + things.size()) % 1024 == 0) {
+                job->setProgress(items.size() + things.size(), total);
+            }
+        };
+
+        // Read items starting from ID 100, then outfits, effects and missiles - all in one pass
+        std::string error;
+        bool parsed = DatFormat::withProfile(profileId, [&](auto profile) {
+            using Profile = decltype(profile);
+            bool ok = DatFormat::parseItems<Profile>(reader, header, options,
+                                                     []() { return Items::makeArenaItemType(); },
+                                                     [&](std::shared_ptr<ItemType> itemType) {
+                                                         items.push_back(std::move(itemType));
+                                                         countParsed();
+                                                     },
+                                                     error);
+
+            const std::pair<ThingCategory_t, uint16_t> thingCategories[] = {
+                    {THING_OUTFIT, header.outfitCount},
+                    {THING_EFFECT, header.effectCount},
+                    {THING_MISSILE, header.missileCount},
+            };
+            for (const auto& [category, count] : thingCategories) {
+                if (!ok || (job && job->isCancelled())) {
+                    break;
+                }
+                ok = DatFormat::parseThings<Profile>(reader, category, count, options,
+                                                     []() { return ThingTypes::makeArenaThingType(); },
+                                                     [&, category = category](std::shared_ptr<ThingType> thingType) {
+                                                         things.emplace_back(category, std::move(thingType));
+                                                         countParsed();
+                                                     },
+                                                     error);
+            }
+            return ok;
+        });
+
+        if (!parsed) {
+            // Things read so far are fine, everything after the broken one would be garbage
+            Warninger::sendErrorMsg(FUNC_NAME, "Failed to read dat '" + path + "': " + error);
+        } else if (reader.remaining() > 0) {
+            Warninger::sendWarning(FUNC_NAME, std::to_string(reader.remaining()) + " bytes left unread at the end of " + path);
+        }
+        // File isn't needed anymore, ItemTypes/ThingTypes don't point into it
+        std::vector<char>().swap(fileData);
+    }
+};
+
+void AssetsManager::loadOTDat(const std::string &datFilePath) {
+    Timer timer("Loading .dat (OTDat)");
+
+    std::string decidedPath = datFilePath;
+    if(decidedPath.empty()) {
+        decidedPath = ConfigManager::getInstance()->getPathAssets() +
+                      ConfigManager::getInstance()->getDatFileName();
+    };
+
+    DatLoad load;
+    if (!readDatForLoad(decidedPath, load)) {
+        return;
+    }
+    load.parse(nullptr);
+    applyDatLoad(load);
+}
+
+bool AssetsManager::readDatForLoad(const std::string& path, DatLoad& load) {
+    // Whole .dat is read at once, it's a few MB at most
+    if (!Tools::readFileBytes(path, load.fileData)) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Failed to open file for reading: " + path);
+        return false;
+    }
+
+    load.path = path;
+    load.options.extended = m_assetsInfo.extended;
+    load.options.frameDurations = m_assetsInfo.frameDurations;
+    load.options.frameGroups = m_assetsInfo.frameGroups;
+    load.fallbackProfile = m_assetsInfo.versionIndex;
+
+    // Header is the same in every protocol
+    BinaryReader reader(reinterpret_cast<const uint8_t*>(load.fileData.data()), load.fileData.size());
+    DatFormat::Header header = DatFormat::readHeader(reader);
+
+    // Sprite ids are what takes most of the .dat, and each one becomes uint32_t in memory
+    uint32_t itemsToRead = header.itemCount >= 100 ? header.itemCount - 99 : 0;
+    size_t expectedBytes = itemsToRead * (sizeof(ItemType) + 64) + load.fileData.size() * 2;
+    Items::beginBulkLoad(itemsToRead, expectedBytes);
+    load.items.reserve(itemsToRead);
+
+    // Outfits, effects and missiles take much less, their ThingTypes come from their own arena
+    ThingTypes::beginBulkLoad(load.fileData.size());
+    return true;
+}
+
+void AssetsManager::applyDatLoad(DatLoad& load) {
+    m_assetsInfo.versionIndex = static_cast<uint8_t>(load.profileId);
+    datSignature = load.signature;
+
+    for (auto& itemType : load.items) {
+        Items::pushItemType(std::move(itemType));
+    }
+    for (auto& [category, thingType] : load.things) {
+        ThingTypes::pushThingType(category, std::move(thingType));
+    }
+    load.items.clear();
+    load.things.clear();
+
+    onDatLoaded(load.path);
+}
+
+bool AssetsManager::hasUnsavedChanges(ASSET_CATEGORY fromCategory) const {
+    switch(fromCategory) {
+        case CATEGORY_ITEMS:
+            return unsavedItemChanges;
+        case CATEGORY_ITEMS_ITEMTYPE:
+            return unsavedItemTypeChange;
+        case CATEGORY_SPRITES:
+            return unsavedSpriteChanges;
+        case CATEGORY_MAIN_ONES:
+            return (unsavedSpriteChanges || unsavedItemChanges);
+        default:
+            return false;
+    }
+}
+
+void AssetsManager::setUnsavedChanges(ASSET_CATEGORY fromCategory, bool value) {
+    switch(fromCategory) {
+        case CATEGORY_ITEMS:
+            unsavedItemChanges = value;
+            break;
+        case CATEGORY_ITEMS_ITEMTYPE:
+            unsavedItemTypeChange = value;
+            break;
+        case CATEGORY_SPRITES:
+            unsavedSpriteChanges = value;
+            break;
+        case CATEGORY_MAIN_ONES:
+            unsavedSpriteChanges = value;
+            unsavedItemChanges = value;
+            break;
+        default:
+            return;
+    }
+}
+
+bool AssetsManager::saveUnsavedItemType() {
+    if (unsavedItemTypeId < 0 || !Items::isValidItemTypeIndex(unsavedItemTypeId)) {
+        return false;
+    }
+
+    auto stored = Items::getItemType(unsavedItemTypeId);
+    auto replacement = editUnsavedItemType();
+    if (!replacement) {
+        return false;
+    }
+    auto change = ItemTypeChange::diff(unsavedItemTypeId, *stored, *replacement);
+
+    if (!Items::replaceItemType(unsavedItemTypeId, replacement)) {
+        return false;
+    }
+    // From now on the session shares what is stored
+    unsavedItemTypeOwned = false;
+
+    if (!change.empty()) {
+        history.record(std::move(change));
+    }
+    return true;
+}
+
+std::shared_ptr<ItemType> AssetsManager::editUnsavedItemType() {
+    if (!unsavedItemTypeCopy) {
+        Warninger::sendWarning(FUNC_NAME, "No ItemType is being edited.");
+        return nullptr;
+    }
+
+    if (!unsavedItemTypeOwned) {
+        unsavedItemTypeCopy = std::make_shared<ItemType>(*unsavedItemTypeCopy);
+        unsavedItemTypeOwned = true;
+    }
+
+    return unsavedItemTypeCopy;
+}
+
+std::shared_ptr<sf::Texture> AssetsManager::getPreviewTexture(int itemTypeId) {
+    if (itemTypeId < 0) {
+        return BLANK_TEXTURE;
+    }
+
+    auto id = static_cast<size_t>(itemTypeId);
+    if (id < evictedPreviews.size() && evictedPreviews[id]) {
+        // Dropped to fit the budget, most likely comes straight from the thumbnail cache
+        createPreviewTexture(itemTypeId);
+    }
+    if (id < previewTextures.size() && previewTextures[id]) {
+        if (id >= previewLastUse.size()) {
+            previewLastUse.resize(previewTextures.size(), 0);
+        }
+        previewLastUse[id] = memoryFrame;
+        return previewTextures[id];
+    }
+
+    return BLANK_TEXTURE;
+}
+
+void AssetsManager::replacePreviewTexture(int itemTypeId, std::shared_ptr<sf::Texture> texture) {
+    if(itemTypeId < 0 || itemTypeId >= previewTextures.size()) {
+        return;
+    }
+
+    if (itemTypeId < evictedPreviews.size()) {
+        evictedPreviews[itemTypeId] = false;
+    }
+    accountPreviewTexture(previewTextures[itemTypeId], texture);
+    previewTextures[itemTypeId] = texture;
+}
+
+void AssetsManager::createPreviewTexture(int id) {
+    if (id < 0) {
+        return;
+    }
+
+    auto SizeOfButtonSprite = ConfigManager::getInstance()->getSpriteButtonSize();
+    std::shared_ptr<sf::Texture> texture;
+
+    // Known preview comes from the cache, without compositing anything
+    uint64_t key = thumbnailCache.isOpen() ? getPreviewKey(id) : 0;
+    if (key != 0) {
+        if (const uint8_t* pixels = thumbnailCache.find(key)) {
+            auto uploader = TextureUploader::getInstance();
+            const uint32_t width = thumbnailCache.getWidth();
+            const uint32_t height = thumbnailCache.getHeight();
+            if (uploader->hasBudget()) {
+                texture = uploader->upload(width, height, pixels);
+            } else {
+                // Frame's uploads are used up, it shows up blank for a frame or two
+                size_t size = static_cast<size_t>(width) * height * 4;
+                auto staging = uploader->acquireStaging(size);
+                std::memcpy(staging->data(), pixels, size);
+                uploader->enqueue(staging, 0, width, height, [this, id](std::shared_ptr<sf::Texture> uploaded) {
+                    if (uploaded) {
+                        replacePreviewTexture(id, uploaded);
+                    }
+                }, &previewTextures);
+                texture = BLANK_TEXTURE;
+            }
+        }
+    }
+
+    if (!texture) {
+        auto itemPreviewTexture = getItemSpriteSheet(id, 1);
+        auto finalSprite = sf::Sprite(itemPreviewTexture);
+
+        // Scale to the Config defined sprite's desired button size
+        finalSprite.setScale({
+             static_cast<float>(SizeOfButtonSprite.x) / itemPreviewTexture.getSize().x,
+             static_cast<float>(SizeOfButtonSprite.y) / itemPreviewTexture.getSize().y
+         });
+
+        // Create a new RenderTexture to hold the scaled image
+        sf::RenderTexture scaledRender (sf::Vector2u(SizeOfButtonSprite.x, SizeOfButtonSprite.y));
+        scaledRender.clear(sf::Color::Transparent);
+        scaledRender.draw(finalSprite);
+        scaledRender.display();
+
+        texture = std::make_shared<sf::Texture>(scaledRender.getTexture());
+
+        if (key != 0) {
+            sf::Image image = texture->copyToImage();
+            if (image.getSize().x == thumbnailCache.getWidth() && image.getSize().y == thumbnailCache.getHeight()) {
+                thumbnailCache.store(key, image.getPixelsPtr());
+            }
+        }
+    }
+
+    // Every item keeps its own slot, evicted previews leave holes that have to stay where they are
+    if (id >= previewTextures.size()) {
+        previewTextures.resize(id + 1);
+    }
+    replacePreviewTexture(id, texture);
+}
+
+uint64_t AssetsManager::getPreviewKey(int itemTypeId) {
+    if (!Items::isValidItemTypeIndex(itemTypeId)) {
+        return 0;
+    }
+
+    // Same tiles getItemSpriteSheet(id, 1) draws
+    auto it = Items::getItemType(itemTypeId);
+    const uint32_t keyHeader[] = {thumbnailCache.getWidth(), thumbnailCache.getHeight(), getSpriteSize(), it->width, it->height};
+    uint64_t key = Hash::fnv1a64(keyHeader, sizeof(keyHeader));
+    for (int y = 0; y < it->height; ++y) {
+        for (int x = 0; x < it->width; ++x) {
+            size_t index = static_cast<size_t>(y) * it->width + x;
+            uint32_t spriteId = index < it->textureIdsVector.size() ? it->textureIdsVector[index] : 0;
+            uint64_t contentHash = getSpriteContentHash(spriteId);
+            key = Hash::fnv1a64(&spriteId, sizeof(spriteId), key);
+            key = Hash::fnv1a64(&contentHash, sizeof(contentHash), key);
+        }
+    }
+    return key != 0 ? key : 1;
+}
+
+uint64_t AssetsManager::getSpriteContentHash(uint32_t id) {
+    if (!isValidTextureIndex(static_cast<int>(id))) {
+        return SpriteHashIndex::BLANK_HASH;
+    }
+    if (uint64_t known = spriteHashIndex.get(id)) {
+        return known;
+    }
+    // Blank ones all look the same
+    if (textures[id] == BLANK_TEXTURE) {
+        spriteHashIndex.set(id, SpriteHashIndex::BLANK_HASH);
+        return SpriteHashIndex::BLANK_HASH;
+    }
+
+    const uint32_t dimension = getSpriteSize();
+    std::vector<uint8_t> pixels(static_cast<size_t>(dimension) * dimension * 4, 0);
+    if (!decodeSpriteFromSpr(id, pixels.data())) {
+        sf::Image image = getTexture(static_cast<int>(id))->copyToImage();
+        if (image.getSize().x == dimension && image.getSize().y == dimension) {
+            std::memcpy(pixels.data(), image.getPixelsPtr(), pixels.size());
+        }
+    }
+
+    uint64_t hash = SpriteHashIndex::hashPixels(pixels.data(), pixels.size());
+    spriteHashIndex.set(id, hash);
+    spriteHashesChanged = spriteHashesChanged || !isSpriteDirty(id);
+    return hash;
+}
+
+std::vector<uint32_t> AssetsManager::findSpritesByPixels(const uint8_t* rgba) {
+    const size_t size = static_cast<size_t>(getSpriteSize()) * getSpriteSize() * 4;
+    std::vector<uint32_t> ids = spriteHashIndex.find(SpriteHashIndex::hashPixels(rgba, size));
+    // Hashes of removed sprites can still be around
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [this](uint32_t id) {
+        return !isValidTextureIndex(static_cast<int>(id));
+    }), ids.end());
+    return ids;
+}
+
+size_t AssetsManager::hashMissingSprites(size_t budget) {
+    spriteHashIndex.resize(textures.size());
+    const auto count = static_cast<uint32_t>(textures.size());
+    for (uint32_t scanned = 0; scanned < count && budget > 0 && spriteHashIndex.getUnknownCount() > 0; ++scanned) {
+        uint32_t id = spriteHashScanPos++ % count;
+        if (spriteHashIndex.get(id) != 0) {
+            continue;
+        }
+
+        if (isValidTextureIndex(static_cast<int>(id))) {
+            getSpriteContentHash(id);
+            --budget;
+        } else {
+            spriteHashIndex.set(id, SpriteHashIndex::BLANK_HASH);
+        }
+    }
+    return spriteHashIndex.getUnknownCount();
+}
+
+bool AssetsManager::loadSpriteHashes(const std::string& sprPath, uint32_t dimension, bool transparency) {
+    spriteHashStamp = SpriteHashIndex::getStampOf(sprPath, dimension, transparency);
+    spriteHashesChanged = false;
+    spriteHashScanPos = 0;
+    if (spriteHashIndex.load(SpriteHashIndex::getPathFor(sprPath), spriteHashStamp) && spriteHashIndex.size() == textures.size()) {
+        return true;
+    }
+    spriteHashIndex.reset(textures.size());
+    return false;
 }
 
-void AssetsManager::loadOTDat(const std::string &datFilePath) {
-    // TO-DO protocol version should be detected, as currently OTDat is done for 8.6.
-    // Higher protocol versions had offset of all flags +1 because there was a flag inserted in the middle xD
-
-    Timer timer("Loading .dat (OTDat)");
+void AssetsManager::saveSpriteHashes() {
+    // Only if the .spr on disk is still the one the hashes are of
+    if (sprRecordsPath.empty() || sprRecordsDimension != getSpriteSize() ||
+        !(SpriteHashIndex::getStampOf(sprRecordsPath, sprRecordsDimension, sprRecordsTransparency) == spriteHashStamp)) {
+        return;
+    }
 
-    std::string decidedPath = datFilePath;
-    if(decidedPath.empty()) {
-        decidedPath = ConfigManager::getInstance()->getPathAssets() +
-                      ConfigManager::getInstance()->getDatFileName();
-    };
+    spriteHashIndex.save(SpriteHashIndex::getPathFor(sprRecordsPath), spriteHashStamp,
+                         [this](uint32_t id) { return !isSpriteDirty(id); });
+    spriteHashesChanged = false;
+}
 
-    try {
-        // Open the file in binary mode for reading
-        std::ifstream inFile(decidedPath, std::ios::binary);
-        if (!inFile.is_open()) {
-            Warninger::sendErrorMsg(FUNC_NAME, "Failed to open file for reading: " + decidedPath);
-            return;
-        }
+bool AssetsManager::decodeSpriteFromSpr(uint32_t id, uint8_t* out) {
+    const uint32_t dimension = getSpriteSize();
+    if (isSpriteDirty(id) || id >= sprRecords.size() || sprRecordsDimension != dimension) {
+        return false;
+    }
 
-        // Read .dat signature (4 bytes)
-        uint32_t datSignature;
-        inFile.read(reinterpret_cast<char*>(&datSignature), sizeof(datSignature));
-
-        // Read item count (2 bytes)
-        uint16_t itemCount;
-        inFile.read(reinterpret_cast<char*>(&itemCount), sizeof(itemCount));
-
-        // Skip outfit count, effect count, and missile count (2 bytes each)
-        inFile.seekg(6, std::ios_base::cur);
-
-        // Read items starting from ID 100
-        for (uint16_t id = 0; id <= itemCount - 100; ++id) {
-            auto itemType = std::make_shared<ItemType>();
-
-            // Read flags until we encounter 0xFF (ItemFlag.LastFlag)
-            uint8_t flag;
-            while (true) {
-                inFile.read(reinterpret_cast<char*>(&flag), sizeof(flag));
-                //std::cout << "Read flag 0x" << std::hex << (int)flag << " at id " <<  std::dec << id << std::endl;
-                if (flag == 0xFF) break; // LastFlag
-
-                switch (flag) {
-                    case 0x00: // Ground
-                        //itemType->type = ITEM_TYPE_GROUND;
-                        inFile.read(reinterpret_cast<char*>(&itemType->speed), sizeof(itemType->speed));
-                        break;
-                    case 0x01: // GroundBorder
-                        //itemType->hasStackOrder = true;
-                        //itemType->stackOrder = STACK_ORDER_BORDER;
-                        break;
-                    case 0x02: // OnBottom
-                        //itemType->hasStackOrder = true;
-                        //itemType->stackOrder = STACK_ORDER_BOTTOM;
-                        break;
-                    case 0x03: // OnTop
-                        //itemType->hasStackOrder = true;
-                        //itemType->stackOrder = STACK_ORDER_TOP;
-                        break;
-                    case 0x04: // Container
-                        //itemType->type = ITEM_TYPE_CONTAINER;
-                        break;
-                    case 0x05: // Stackable
-                        //itemType->stackable = true;
-                        break;
-                    case 0x06: // ForceUse
-                        //itemType->forceUse = true;
-                        break;
-                    case 0x07: // MultiUse
-                        //itemType->multiUse = true;
-                        break;
-                    case 0x08: { // Writable
-                        //itemType->readable = true;
-                        uint16_t maxReadWriteChars = 0;
-                        inFile.read(reinterpret_cast<char *>(&maxReadWriteChars), sizeof(maxReadWriteChars));
-                        break;
-                    }
-                    case 0x09: { // WritableOnce
-                        //itemType->readable = true;
-                        uint16_t maxReadChars = 0;
-                        inFile.read(reinterpret_cast<char *>(&maxReadChars), sizeof(maxReadChars));
-                        break;
-                    }
-                    case 0x0A: // FluidContainer
-                        //itemType->type = ITEM_TYPE_FLUID;
-                        break;
-                    case 0x0B: // Fluid
-                        //itemType->type = ITEM_TYPE_SPLASH;
-                        break;
-                    case 0x0C: // Unpassable
-                        //itemType->unpassable = true;
-                        break;
-                    case 0x0D: // Unmoveable
-                        //itemType->unmoveable = true;
-                        break;
-                    case 0x0E: // BlockMissiles
-                        //itemType->blockMissiles = true;
-                        break;
-                    case 0x0F: // BlockPathfinder
-                        //itemType->blockPathfinder = true;
-                        break;
-//                    case 0x10: // NoMoveAnimation
-//                        // Not implemented
-//                        break;
-                    case 0x10: // Pickupable
-                        //itemType->pickupable = true;
-                        break;
-                    case 0x11: // Hangable
-                        //itemType->hangable = true;
-                        break;
-                    case 0x12: // Horizontal
-                        //itemType->hookEast = true;
-                        break;
-                    case 0x13: // Vertical
-                        //itemType->hookSouth = true;
-                        break;
-                    case 0x14: // Rotatable
-                        //itemType->rotatable = true;
-                        break;
-                    case 0x15: { // HasLight
-                        uint16_t lightLevel = 0;
-                        uint16_t lightColor = 0;
-                        inFile.read(reinterpret_cast<char *>(&lightLevel), sizeof(lightLevel));
-                        inFile.read(reinterpret_cast<char *>(&lightColor), sizeof(lightColor));
-                        break;
-                    }
-                    case 0x16: // DontHide
-                        break;
-                    case 0x17: // Translucent
-                        break;
-                    case 0x18: // HasOffset
-                        inFile.seekg(4, std::ios_base::cur); // Skip offsetX and offsetY
-                        break;
-                    case 0x19: // HasElevation
-                        //itemType->hasElevation = true;
-                        inFile.seekg(2, std::ios_base::cur); // Skip height
-                        break;
-                    case 0x1A: // Lying
-                        break;
-                    case 0x1B: // AnimateAlways
-                        break;
-                    case 0x1C: { // Minimap
-                        uint16_t minimapColor = 0;
-                        inFile.read(reinterpret_cast<char *>(&minimapColor), sizeof(minimapColor));
-                        break;
-                    }
-                    case 0x1D: // LensHelp
-                        uint16_t opt;
-                        inFile.read(reinterpret_cast<char*>(&opt), sizeof(opt));
-                        if (opt == 1112) {
-                            //itemType->readable = true;
-                        }
-                        break;
-                    case 0x1E: // FullGround
-                        //itemType->fullGround = true;
-                        break;
-                    case 0x1F: // IgnoreLook
-                        //itemType->ignoreLook = true;
-                        break;
-                    case 0x20: // Cloth
-                        inFile.seekg(2, std::ios_base::cur); // Skip cloth value
-                        break;
-                    case 0x21: { // Market
-                        inFile.seekg(2, std::ios_base::cur); // Skip category
-                        uint16_t tradeAs, showAs, nameLength;
-
-                        inFile.read(reinterpret_cast<char*>(&tradeAs), sizeof(tradeAs));
-                        inFile.read(reinterpret_cast<char*>(&showAs), sizeof(showAs));
-                        inFile.read(reinterpret_cast<char*>(&nameLength), sizeof(nameLength));
-
-                        // Validate nameLength before reading
-                        if (nameLength > 0 && nameLength < 256) { // Reasonable upper limit
-                            std::vector<char> buffer(nameLength);
-                            inFile.read(buffer.data(), nameLength);
-                            itemType->name.assign(buffer.data(), nameLength);
-                        } else {
-                            // Skip corrupted name
-                            inFile.seekg(nameLength, std::ios_base::cur);
-                            itemType->name.clear();
-                        }
+    if (sprMappingPath != sprRecordsPath) {
+        sprMapping.open(sprRecordsPath);
+        sprMappingPath = sprRecordsPath;
+    }
 
-                        // Read remaining fields
-                        uint16_t restrictVocation = 0;
-                        uint16_t requiredLevel = 0;
-                        inFile.read(reinterpret_cast<char*>(&restrictVocation), sizeof(restrictVocation));
-                        inFile.read(reinterpret_cast<char*>(&requiredLevel), sizeof(requiredLevel));
-                        break;
-                    }
-                    case 0x22: // DefaultAction
-                        inFile.seekg(2, std::ios_base::cur); // Skip action
-                        break;
-                    case 0x23: // Wrappable
-                    case 0x24: // Unwrappable
-                    case 0x25: // TopEffect
-                    case 0x26: // Usable
-                        break;
-                    case 0xFE: // 254
-                        break;
-                    default:
-                        Warninger::sendErrorMsg(FUNC_NAME, "Unknown flag 0x" + std::to_string(flag) + " at id " + std::to_string(id));
-                        //delete itemType;
-                        //inFile.close();
-                        //return;
-                        break;
-                }
-            }
+    // Record: 3 bytes color key, u16 size, RLE data
+    const SprRecordRef& record = sprRecords[id];
+    size_t start = static_cast<size_t>(record.offset) + 5;
+    if (!sprMapping.isOpen() || record.offset == 0 || start > sprMapping.size()) {
+        return false;
+    }
 
-            // Read data
-            inFile.read(reinterpret_cast<char*>(&itemType->width), sizeof(itemType->width));
-            inFile.read(reinterpret_cast<char*>(&itemType->height), sizeof(itemType->height));
+    size_t size = std::min<size_t>(record.dataSize, sprMapping.size() - start);
+    return SpriteCodec::withCodec(sprRecordsTransparency, dimension, [&](auto codec) {
+        using Codec = decltype(codec);
+        Codec::decode(sprMapping.data() + start, size, out);
+    });
+}
 
-            if (itemType->width > 1 || itemType->height > 1) {
-                inFile.seekg(1, std::ios_base::cur); // Skip exact size
-            }
+AssetsManager::MemoryUsage AssetsManager::getMemoryUsage() const {
+    MemoryUsage usage;
+    usage.spriteTextures = spriteTextureCount;
+    usage.spriteTextureBytes = spriteTextureBytes;
+    usage.evictedSprites = evictedSpriteCount;
+    usage.previews = previewCount;
+    usage.previewBytes = previewBytes;
+    usage.pixelBytes = TextureUploader::getInstance()->getStagingBytes() + thumbnailCache.getPendingBytes();
+    usage.itemDataBytes = Items::getStoreBytes();
+    return usage;
+}
 
-            inFile.read(reinterpret_cast<char*>(&itemType->layers), sizeof(itemType->layers));
-            inFile.read(reinterpret_cast<char*>(&itemType->patternX), sizeof(itemType->patternX));
-            inFile.read(reinterpret_cast<char*>(&itemType->patternY), sizeof(itemType->patternY));
-            inFile.read(reinterpret_cast<char*>(&itemType->patternZ), sizeof(itemType->patternZ));
-            inFile.read(reinterpret_cast<char*>(&itemType->animationsFrames), sizeof(itemType->animationsFrames));
-            bool isAnimation = itemType->animationsFrames > 1;
+void AssetsManager::accountSpriteTexture(const std::shared_ptr<sf::Texture>& removed, const std::shared_ptr<sf::Texture>& added) {
+    if (removed && removed != BLANK_TEXTURE) {
+        spriteTextureCount -= std::min<size_t>(spriteTextureCount, 1);
+        spriteTextureBytes -= std::min(spriteTextureBytes, getTextureBytes(removed));
+    }
+    if (added && added != BLANK_TEXTURE) {
+        ++spriteTextureCount;
+        spriteTextureBytes += getTextureBytes(added);
+    }
+}
 
-            // Skip frame durations if needed
-            if (isAnimation && m_assetsInfo.frameDurations) {
-                inFile.seekg(6 + 8 * itemType->animationsFrames, std::ios_base::cur);
-            }
+void AssetsManager::accountPreviewTexture(const std::shared_ptr<sf::Texture>& removed, const std::shared_ptr<sf::Texture>& added) {
+    if (removed && removed != BLANK_TEXTURE) {
+        previewCount -= std::min<size_t>(previewCount, 1);
+        previewBytes -= std::min(previewBytes, getTextureBytes(removed));
+    }
+    if (added && added != BLANK_TEXTURE) {
+        ++previewCount;
+        previewBytes += getTextureBytes(added);
+    }
+}
 
-            // Calculate number of sprites
-            uint32_t numSprites = itemType->width * itemType->height * itemType->layers *
-                    itemType->patternX * itemType->patternY * itemType->patternZ *
-                                  itemType->animationsFrames;
-
-            // Read sprite IDs
-            itemType->textureIdsVector.resize(numSprites);
-            for (uint32_t i = 0; i < numSprites; ++i) {
-                uint32_t spriteId = 0;
-                if (m_assetsInfo.extended) {
-                    uint32_t id32;
-                    inFile.read(reinterpret_cast<char*>(&id32), sizeof(id32));
-                    spriteId = id32;
-                } else {
-                    uint16_t id16;
-                    inFile.read(reinterpret_cast<char*>(&id16), sizeof(id16));
-                    spriteId = id16;
-                }
+void AssetsManager::touchSprite(uint32_t id) {
+    // A compile may be replacing the .spr meanwhile, evicted sprites stay blank until it's done
+    if (isSpriteEvicted(id) && !isBusy()) {
+        restoreEvictedSprite(id);
+    }
 
-                itemType->textureIdsVector[i] = spriteId;
-            }
+    if (id >= spriteLastUse.size()) {
+        spriteLastUse.resize(std::max<size_t>(id + 1, textures.size()), 0);
+    }
+    spriteLastUse[id] = memoryFrame;
+}
 
-            // Store the item
-            Items::pushItemType(itemType);
-        }
+void AssetsManager::restoreEvictedSprite(uint32_t id) {
+    evictedSprites[id] = false;
+    --evictedSpriteCount;
 
-        inFile.close();
-        onDatLoaded(decidedPath);
-    } catch (const std::exception& e) {
-        Warninger::sendErrorMsg(FUNC_NAME, "Failed to read dat '" + decidedPath + "': " + e.what());
+    const uint32_t dimension = getSpriteSize();
+    std::vector<uint8_t> pixels(static_cast<size_t>(dimension) * dimension * 4);
+    std::shared_ptr<sf::Texture> texture;
+    if (decodeSpriteFromSpr(id, pixels.data())) {
+        texture = TextureUploader::getInstance()->upload(dimension, dimension, pixels.data());
+    }
+    if (!texture) {
+        Warninger::sendWarning(FUNC_NAME, "Sprite " + std::to_string(id) + " couldn't be decoded from " + sprRecordsPath + " again.");
+        texture = BLANK_TEXTURE;
     }
+
+    accountSpriteTexture(nullptr, texture);
+    textures[id] = std::move(texture);
 }
 
-bool AssetsManager::hasUnsavedChanges(ASSET_CATEGORY fromCategory) const {
-    switch(fromCategory) {
-        case CATEGORY_ITEMS:
-            return unsavedItemChanges;
-        case CATEGORY_ITEMS_ITEMTYPE:
-            return unsavedItemTypeChange;
-        case CATEGORY_SPRITES:
-            return unsavedSpriteChanges;
-        case CATEGORY_MAIN_ONES:
-            return (unsavedSpriteChanges || unsavedItemChanges);
-        default:
-            return false;
+bool AssetsManager::canEvictSprite(uint32_t id) const {
+    const auto& texture = textures[id];
+    // Only the slot holds it - with undo history or a pending compile holding it too, nothing would be freed
+    if (!texture || texture == BLANK_TEXTURE || texture.use_count() != 1) {
+        return false;
     }
+    return !isSpriteDirty(id) && id < sprRecords.size() && sprRecords[id].offset != 0 &&
+           !sprRecordsPath.empty() && sprRecordsDimension == getSpriteSize();
 }
 
-void AssetsManager::setUnsavedChanges(ASSET_CATEGORY fromCategory, bool value) {
-    switch(fromCategory) {
-        case CATEGORY_ITEMS:
-            unsavedItemChanges = value;
-            break;
-        case CATEGORY_ITEMS_ITEMTYPE:
-            unsavedItemTypeChange = value;
-            break;
-        case CATEGORY_SPRITES:
-            unsavedSpriteChanges = value;
-            break;
-        case CATEGORY_MAIN_ONES:
-            unsavedSpriteChanges = value;
-            unsavedItemChanges = value;
+uint64_t AssetsManager::evictPreviews(uint64_t bytes) {
+    std::vector<std::pair<uint32_t, uint32_t>> candidates; // last use, item id
+    for (uint32_t id = 0; id < previewTextures.size(); ++id) {
+        const auto& texture = previewTextures[id];
+        // Decoys are blank on purpose, there'd be nothing to free anyway
+        if (!texture || texture == BLANK_TEXTURE || getTextureBytes(texture) == 0) {
+            continue;
+        }
+        uint32_t lastUse = id < previewLastUse.size() ? previewLastUse[id] : 0;
+        if (memoryFrame - lastUse < EVICTION_GRACE_FRAMES) {
+            continue;
+        }
+        candidates.emplace_back(lastUse, id);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    evictedPreviews.resize(previewTextures.size(), false);
+    uint64_t freed = 0;
+    for (const auto& [lastUse, id] : candidates) {
+        if (freed >= bytes) {
             break;
-        default:
-            return;
+        }
+        freed += getTextureBytes(previewTextures[id]);
+        accountPreviewTexture(previewTextures[id], nullptr);
+        previewTextures[id] = nullptr;
+        evictedPreviews[id] = true;
     }
+    return freed;
 }
 
-std::shared_ptr<sf::Texture> AssetsManager::getPreviewTexture(int itemTypeId) {
-    if(itemTypeId < previewTextures.size() && previewTextures.at(itemTypeId)) {
-        return previewTextures[itemTypeId];
+uint64_t AssetsManager::evictSprites(uint64_t bytes) {
+    const uint64_t spriteBytes = static_cast<uint64_t>(getSpriteSize()) * getSpriteSize() * 4;
+    std::vector<std::pair<uint32_t, uint32_t>> candidates; // last use, sprite id
+    for (uint32_t id = 1; id < textures.size(); ++id) {
+        uint32_t lastUse = id < spriteLastUse.size() ? spriteLastUse[id] : 0;
+        if (memoryFrame - lastUse < EVICTION_GRACE_FRAMES || !canEvictSprite(id)) {
+            continue;
+        }
+        candidates.emplace_back(lastUse, id);
     }
 
-    return BLANK_TEXTURE;
+    // All sprites are the same size, so only the oldest 'needed' have to be found, not sorted
+    size_t needed = static_cast<size_t>((bytes + spriteBytes - 1) / spriteBytes);
+    if (needed < candidates.size()) {
+        std::nth_element(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(needed), candidates.end());
+        candidates.resize(needed);
+    }
+
+    evictedSprites.resize(textures.size(), false);
+    uint64_t freed = 0;
+    for (const auto& [lastUse, id] : candidates) {
+        freed += getTextureBytes(textures[id]);
+        accountSpriteTexture(textures[id], nullptr);
+        textures[id] = nullptr;
+        evictedSprites[id] = true;
+        ++evictedSpriteCount;
+    }
+    return freed;
 }
 
-void AssetsManager::replacePreviewTexture(int itemTypeId, std::shared_ptr<sf::Texture> texture) {
-    if(itemTypeId < 0 || itemTypeId >= previewTextures.size()) {
+void AssetsManager::enforceMemoryBudgets() {
+    ++memoryFrame;
+    // Loading/compiling still works with the textures and the .spr
+    if (isBusy()) {
         return;
     }
 
-    previewTextures[itemTypeId] = texture;
-}
+    auto config = ConfigManager::getInstance();
+    auto target = [](uint64_t budget) {
+        return budget - budget * EVICTION_HEADROOM_PERCENT / 100;
+    };
 
-void AssetsManager::createPreviewTexture(int id) {
-    auto itemPreviewTexture = getItemSpriteSheet(id, 1);
-    auto finalSprite = sf::Sprite(itemPreviewTexture);
+    if (memoryFrame >= nextEvictionFrame) {
+        bool fits = true;
 
-    // Scale to the Config defined sprite's desired button size
-    auto SizeOfButtonSprite = ConfigManager::getInstance()->getSpriteButtonSize();
-    finalSprite.setScale({
-         static_cast<float>(SizeOfButtonSprite.x) / itemPreviewTexture.getSize().x,
-         static_cast<float>(SizeOfButtonSprite.y) / itemPreviewTexture.getSize().y
-     });
+        const uint64_t previewBudget = config->getPreviewBudgetBytes();
+        if (previewBudget != 0 && previewBytes > previewBudget) {
+            uint64_t toFree = previewBytes - target(previewBudget);
+            fits = evictPreviews(toFree) >= toFree;
+        }
+
+        // Whole GPU side - previews go first, they come back cheaply from the thumbnail cache
+        const uint64_t textureBudget = config->getTextureBudgetBytes();
+        if (textureBudget != 0 && spriteTextureBytes + previewBytes > textureBudget) {
+            uint64_t toFree = spriteTextureBytes + previewBytes - target(textureBudget);
+            uint64_t freed = evictPreviews(toFree);
+            if (freed < toFree) {
+                freed += evictSprites(toFree - freed);
+            }
+            fits = fits && freed >= toFree;
+        }
 
-    // Create a new RenderTexture to hold the scaled image
-    sf::RenderTexture scaledRender (sf::Vector2u(SizeOfButtonSprite.x, SizeOfButtonSprite.y));
-    scaledRender.clear(sf::Color::Transparent);
-    scaledRender.draw(finalSprite);
-    scaledRender.display();
+        // Whatever is left is in use (on screen, changed, or in undo history), no point in scanning again every frame
+        if (!fits) {
+            nextEvictionFrame = memoryFrame + EVICTION_RETRY_FRAMES;
+        }
+    }
 
-    auto texture = std::make_shared<sf::Texture>(scaledRender.getTexture());
+    const uint64_t pixelBudget = config->getPixelBudgetBytes();
+    if (pixelBudget != 0 && TextureUploader::getInstance()->getStagingBytes() + thumbnailCache.getPendingBytes() > pixelBudget) {
+        // Pooled buffers are only kept for reuse, new thumbnails can go to their file early
+        TextureUploader::getInstance()->trimPool(0);
+        thumbnailCache.flush();
+    }
 
-    if (id >= previewTextures.size()) {
-        previewTextures.push_back(texture);
-    } else {
-        replacePreviewTexture(id, texture);
+    // ItemTypes can't be dropped, it can only be reported
+    const uint64_t itemDataBudget = config->getItemDataBudgetBytes();
+    if (itemDataBudget != 0 && !itemDataBudgetWarned && Items::getStoreBytes() > itemDataBudget) {
+        itemDataBudgetWarned = true;
+        Warninger::sendWarning(FUNC_NAME, "ItemTypes take " + std::to_string(Items::getStoreBytes() / (1024 * 1024)) +
+                                          " MB, over the budget of " + std::to_string(itemDataBudget / (1024 * 1024)) + " MB.");
     }
 }
 
@@ -708,8 +1653,13 @@ void AssetsManager::createPreviewTexturesForPage(int pageFirstItemType, int page
 }
 
 void AssetsManager::clearPreviewTextures() {
+    TextureUploader::getInstance()->cancel(&previewTextures);
     previewTextures.clear();
     previewTextures.shrink_to_fit();
+    previewLastUse.clear();
+    evictedPreviews.clear();
+    previewCount = 0;
+    previewBytes = 0;
 }
 
 sf::Texture AssetsManager::getItemSpriteSheet(int itemTypeId, int animations) {
@@ -724,7 +1674,7 @@ sf::Texture AssetsManager::getItemSpriteSheet(int itemTypeId, int animations) {
         return sf::Texture(*BLANK_TEXTURE);
     }
 
-    auto spriteMaxSize = ConfigManager::getInstance()->getSpriteMaxSize();
+    auto spriteMaxSize = getSpriteSize();
     int singleAnimationFrameSize = it->height * spriteMaxSize;
 
     // Create a RenderTexture with the correct size
@@ -743,7 +1693,7 @@ sf::Texture AssetsManager::getItemSpriteSheet(int itemTypeId, int animations) {
     for (int a = 1; a <= animations; a++) {
         for (int y = 0; y < it->height; y++) {
             for (int x = 0; x < it->width; x++) {
-                auto texture = getTexture(getTextureIdFromItemType(it, y, x, a));
+                auto texture = getTexture(getTextureIdFromItemType(*it, y, x, a));
 
                 if (texture) {
                     sf::Sprite sprite(*texture);
@@ -795,7 +1745,7 @@ void AssetsManager::drawAssetsManagerControls() {
         ImGui::BeginDisabled();
     }
     if (ImGui::ImageButton("##ControlButton_CompileAssets", compileAssetsIcon, {16,16})) {
-        compile();
+        startCompile();
     }
     if(colorsCount > 0) {
         ImGui::EndDisabled();
@@ -822,6 +1772,8 @@ void AssetsManager::drawAssetsManagerControls() {
         doPopupAssetsCompileAs();
     }
 
+    drawOperationProgress();
+
     ImGui::Separator();
 }
 
@@ -831,38 +1783,306 @@ void AssetsManager::onGraphicsLoaded(const std::string& loadedPath) {
 }
 
 void AssetsManager::onDatLoaded(const std::string& loadedPath) {
-    fmt::print("Finished loading dat from {}\nTotal: {} itemTypes loaded.\n", loadedPath, Items::getItemTypesCount());
-
+    fmt::print("Finished loading dat from {}\nTotal: {} itemTypes, {} outfits, {} effects, {} missiles loaded.\n", loadedPath,
+               Items::getItemTypesCount(), ThingTypes::getThingTypesCount(THING_OUTFIT),
+               ThingTypes::getThingTypesCount(THING_EFFECT), ThingTypes::getThingTypesCount(THING_MISSILE));
+
+    // Previews of the items come from the cache next to the .spr, where they're still up to date
+    if (!sprRecordsPath.empty()) {
+        auto buttonSize = ConfigManager::getInstance()->getSpriteButtonSize();
+        thumbnailCache.open(ThumbnailCache::getPathFor(sprRecordsPath), static_cast<uint32_t>(buttonSize.x),
+                            static_cast<uint32_t>(buttonSize.y), Items::getItemTypesCount() + 1024);
+    }
     createPreviewTexturesForPage(0, ConfigManager::getInstance()->getButtonsCountItemPage());
 
     setDatFileLoaded(true);
 }
 
 void AssetsManager::buttonLoadGraphics(std::string& foundGraphicFilePath) {
+    if (isBusy()) {
+        Warninger::sendWarning(FUNC_NAME, operationTitle + " is still running.");
+        return;
+    }
     if(isGraphicFileLoaded()) {
         unload();
     }
 
     SavedData::getInstance()->setDataString("tempLoadedGraphicFilePath", foundGraphicFilePath);
 
-    loadSpr(foundGraphicFilePath);
+    std::string sprPath = foundGraphicFilePath;
     Tools::removeSuffix(foundGraphicFilePath, ".spr");
+    std::string datPath = foundGraphicFilePath + ".dat";
+    SavedData::getInstance()->setDataString("tempLoadedDatFilePath", datPath);
+
+    if (loadSessionSnapshot(sprPath, datPath, true)) {
+        return;
+    }
+
+    startLoad(sprPath, datPath);
+}
+
+void AssetsManager::startLoad(const std::string& sprFilePath, const std::string& datFilePath) {
+    if (isBusy()) {
+        return;
+    }
+
+    auto spr = std::make_shared<SprLoad>();
+    std::string error;
+    if (!spr->open(sprFilePath, m_assetsInfo.extended, m_assetsInfo.transparency,
+                   getSpriteDimensionsVector().at(m_assetsInfo.dimensionIndex), error)) {
+        Warninger::sendErrorMsg(FUNC_NAME, error);
+        return;
+    }
+    fmt::print("Signature of loaded spr: {}\n", spr->signature);
+    setSpriteSize(spr->dimension);
+    prepareSprUpload(*spr);
+
+    // Without the .dat, the sprites still get loaded
+    auto dat = std::make_shared<DatLoad>();
+    bool datRead = readDatForLoad(datFilePath, *dat);
+
+    auto jobSystem = JobSystem::getInstance();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<JobHandle> jobs;
+    for (size_t chunk = 0; chunk < spr->getChunkCount(); ++chunk) {
+        jobs.push_back(jobSystem->schedule("Decoding sprites", [spr, chunk](Job& job) {
+            spr->decodeChunk(chunk, &job);
+        }));
+    }
+    // Decoded chunks stream in through the uploader meanwhile, this only waits for the last of them
+    auto upload = jobSystem->scheduleOnMainThread("Uploading sprites", [spr](Job& job) {
+        job.setProgress(spr->uploaded, spr->queued);
+        return spr->uploaded >= spr->queued;
+    }, jobs);
+    jobs.push_back(upload);
+
+    JobHandle parse;
+    if (datRead) {
+        parse = jobSystem->schedule("Reading .dat", [dat](Job& job) {
+            dat->parse(&job);
+        });
+        jobs.push_back(parse);
+    }
+
+    // Runs only once everything above is done, so nothing touches the stores/arenas anymore
+    jobs.push_back(jobSystem->scheduleOnMainThread("Finishing", [this, spr, dat, datRead, start](Job&) {
+        finishSprLoad(*spr);
+        if (datRead) {
+            applyDatLoad(*dat);
+            saveSessionSnapshot(spr->path, dat->path);
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        fmt::print("Loading assets took: {}\n", Tools::formatDuration(duration));
+        return true;
+    }, {upload, parse}, [this, spr](Job& job) {
+        // Jobs (and what they captured of the stores) go first
+        endOperation();
+        if (job.getStatus() != Job::Status::DONE) {
+            // Half loaded assets are of no use
+            Warninger::sendWarning(FUNC_NAME, "Loading assets got cancelled.");
+            TextureUploader::getInstance()->cancel(spr.get());
+            unload();
+        }
+    }));
+
+    beginOperation("Loading assets", std::move(jobs));
+}
+
+bool AssetsManager::restoreLastSession() {
+    auto sprPath = SavedData::getInstance()->getDataString("tempLoadedGraphicFilePath");
+    auto datPath = SavedData::getInstance()->getDataString("tempLoadedDatFilePath");
+    if (sprPath.empty() || datPath.empty()) {
+        return false;
+    }
+
+    return loadSessionSnapshot(sprPath, datPath, false);
+}
+
+bool AssetsManager::loadSessionSnapshot(const std::string& sprPath, const std::string& datPath, bool matchLoadOptions) {
+    auto config = ConfigManager::getInstance();
+    if (!config->isSessionSnapshotEnabled() || !sessionSnapshot->open(config->getSessionSnapshotPath())) {
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto& metadata = sessionSnapshot->getMetadata();
+    auto samePath = [](const std::string& a, const std::string& b) {
+        return std::filesystem::path(a).lexically_normal() == std::filesystem::path(b).lexically_normal();
+    };
+    auto dimensionIt = std::find(m_spriteDimensions.begin(), m_spriteDimensions.end(), static_cast<int>(metadata.dimension));
+
+    bool usable = samePath(metadata.sprPath, sprPath) && samePath(metadata.datPath, datPath) &&
+                  dimensionIt != m_spriteDimensions.end();
+    if (usable && matchLoadOptions) {
+        usable = metadata.extended == m_assetsInfo.extended && metadata.transparency == m_assetsInfo.transparency &&
+                 metadata.frameDurations == m_assetsInfo.frameDurations && metadata.frameGroups == m_assetsInfo.frameGroups &&
+                 metadata.dimension == static_cast<uint32_t>(getSpriteDimensionsVector().at(m_assetsInfo.dimensionIndex));
+    }
+    // Changed source files make the whole snapshot stale, it gets rewritten after the normal load
+    if (!usable || !sessionSnapshot->isUpToDate()) {
+        sessionSnapshot->close();
+        return false;
+    }
+
+    if (isGraphicFileLoaded() || isDatFileLoaded()) {
+        unload();
+    }
+
+    m_assetsInfo.extended = metadata.extended;
+    m_assetsInfo.transparency = metadata.transparency;
+    m_assetsInfo.frameDurations = metadata.frameDurations;
+    m_assetsInfo.frameGroups = metadata.frameGroups;
+    m_assetsInfo.versionIndex = metadata.versionIndex;
+    m_assetsInfo.dimensionIndex = static_cast<uint8_t>(dimensionIt - m_spriteDimensions.begin());
+    setSpriteSize(metadata.dimension);
+    setLoadedSprSignature(metadata.sprSignature);
+
+    // Items and things are plain copies out of the mapped file, only the sprites are worth spreading over frames
+    bool restored = sessionSnapshot->restoreItems() && sessionSnapshot->restoreThings();
+    if (!restored) {
+        Warninger::sendWarning(FUNC_NAME, "Session snapshot is broken, it won't be used.");
+        sessionSnapshot->close();
+        unload();
+        return false;
+    }
+    datSignature = metadata.datSignature;
+
+    // Slots are there from the start, like a normal load. Pixels get uploaded straight from the mapped file
+    // under the frame's upload budget, nothing gets decoded.
+    struct Restore {
+        std::vector<SprRecordRef> records;
+        uint32_t nextId = 1;
+    };
+    auto restore = std::make_shared<Restore>();
+    restore->records = sessionSnapshot->getSprRecords();
+    textures.assign(sessionSnapshot->getSpriteCount(), BLANK_TEXTURE);
+    spriteTextureCount = 0;
+    spriteTextureBytes = 0;
+
+    const uint32_t dimension = metadata.dimension;
+    const bool transparency = metadata.transparency;
+    auto upload = JobSystem::getInstance()->scheduleOnMainThread("Uploading sprites", [this, restore, dimension](Job& job) {
+        auto uploader = TextureUploader::getInstance();
+        const uint32_t spriteCount = sessionSnapshot->getSpriteCount();
+        while (restore->nextId < spriteCount && uploader->hasBudget()) {
+            uint32_t spriteId = restore->nextId++;
+            const uint8_t* pixels = sessionSnapshot->getSpritePixels(spriteId);
+            if (!pixels) {
+                continue;
+            }
+
+            auto texture = uploader->upload(dimension, dimension, pixels);
+            if (texture) {
+                accountSpriteTexture(textures[spriteId], texture);
+                textures[spriteId] = std::move(texture);
+            } else {
+                // Don't let compile reuse the record of a sprite we don't have
+                restore->records[spriteId] = SprRecordRef();
+            }
+        }
+        job.setProgress(restore->nextId, spriteCount);
+        return restore->nextId >= spriteCount;
+    }, {}, [this, restore, sprPath, datPath, dimension, transparency, start](Job& job) {
+        endOperation();
+        sessionSnapshot->close();
+        if (job.getStatus() != Job::Status::DONE) {
+            Warninger::sendWarning(FUNC_NAME, "Restoring the session got cancelled.");
+            unload();
+            return;
+        }
+
+        sprRecords = std::move(restore->records);
+        sprRecordsPath = sprPath;
+        sprRecordsTransparency = transparency;
+        sprRecordsDimension = dimension;
+        dirtySprites.assign(textures.size(), false);
+        ++spritesRevision;
+        loadSpriteHashes(sprPath, dimension, transparency);
+        onGraphicsLoaded(sprPath);
+        onDatLoaded(datPath);
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        fmt::print("Restoring session snapshot took: {}\n", Tools::formatDuration(duration));
+    });
+
+    beginOperation("Restoring session", {upload});
+    return true;
+}
+
+void AssetsManager::saveSessionSnapshot(const std::string& sprPath, const std::string& datPath) {
+    auto config = ConfigManager::getInstance();
+    if (!config->isSessionSnapshotEnabled()) {
+        return;
+    }
 
-    loadOTDat(foundGraphicFilePath + ".dat");
-    SavedData::getInstance()->setDataString("tempLoadedDatFilePath", foundGraphicFilePath + ".dat");
+    // Pixels get decoded from the .spr by the snapshot writer, so it has to be exactly what's loaded
+    bool anyDirty = std::find(dirtySprites.begin(), dirtySprites.end(), true) != dirtySprites.end();
+    if (sprRecordsPath != sprPath || sprRecordsDimension != getSpriteSize() || anyDirty ||
+        dirtySprites.size() != textures.size() || sprRecords.size() != textures.size()) {
+        return;
+    }
+
+    SessionSnapshot::Metadata metadata;
+    metadata.sprPath = sprPath;
+    metadata.datPath = datPath;
+    metadata.sprStamp = SessionSnapshot::FileStamp::of(sprPath);
+    metadata.datStamp = SessionSnapshot::FileStamp::of(datPath);
+    metadata.sprSignature = getLoadedSprSignature();
+    metadata.datSignature = datSignature;
+    metadata.dimension = getSpriteSize();
+    metadata.versionIndex = m_assetsInfo.versionIndex;
+    metadata.extended = m_assetsInfo.extended;
+    metadata.transparency = sprRecordsTransparency;
+    metadata.frameDurations = m_assetsInfo.frameDurations;
+    metadata.frameGroups = m_assetsInfo.frameGroups;
+
+    sessionSnapshot->saveAsync(config->getSessionSnapshotPath(), metadata, sprRecords);
 }
 
 void AssetsManager::unloadDat() {
+    // Edit session may still share an ItemType from the arena
+    resetUnsavedItemType();
     Items::clearItemTypes();
+    Items::releaseArena();
+    ThingTypes::clear();
     clearPreviewTextures();
+    thumbnailCache.close();
+    datSignature = 0;
 }
 
 void AssetsManager::unloadTextures() {
     textures.clear();
     textures.shrink_to_fit();
+    spriteTextureCount = 0;
+    spriteTextureBytes = 0;
+    spriteLastUse.clear();
+    spriteLastUse.shrink_to_fit();
+    evictedSprites.clear();
+    evictedSpriteCount = 0;
+    itemDataBudgetWarned = false;
+    if (spriteHashesChanged) {
+        saveSpriteHashes();
+    }
+    spriteHashIndex.clear();
+    dirtySprites.clear();
+    ++spritesRevision;
+    sprRecords.clear();
+    sprRecordsPath.clear();
+    sprMapping.close();
+    sprMappingPath.clear();
 }
 
 void AssetsManager::compile(const std::string& outputFilesPath) {
+    if (isBusy()) {
+        return;
+    }
+
+    // Snapshot writer may still be reading the .spr that is about to be replaced
+    sessionSnapshot->waitForSave();
+    if (m_assetsInfo.reorderSprites) {
+        reorderSpritesByUse();
+    }
+
     std::string compileAssetsTo = outputFilesPath;
     std::string compileDatTo = outputFilesPath;
     if(compileAssetsTo.empty()) {
@@ -876,7 +2096,11 @@ void AssetsManager::compile(const std::string& outputFilesPath) {
 
     Tools::removeSuffix(compileAssetsTo, ".spr");
     pathWeCompiledGraphicsTo = compileAssetsTo + ".spr";
-    compileSprFromTextures(pathWeCompiledGraphicsTo);
+    if (!compileSprFromTextures(pathWeCompiledGraphicsTo)) {
+        // Target files are untouched, changes stay unsaved
+        Warninger::sendErrorMsg(FUNC_NAME, "Compiling graphics failed, nothing got compiled.");
+        return;
+    }
 
     auto end = std::chrono::high_resolution_clock::now(); // End time
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
@@ -884,13 +2108,165 @@ void AssetsManager::compile(const std::string& outputFilesPath) {
 
     // Compile Dat
     Tools::removeSuffix(compileDatTo, ".dat");
-    compileOTDat(compileDatTo + ".dat");
+    if (!compileOTDat(compileDatTo + ".dat")) {
+        // .spr is already replaced, but the item changes aren't saved anywhere yet
+        return;
+    }
     fmt::print("Compiled dat to: {}\n", compileDatTo + ".dat");
 
     setUnsavedChanges(CATEGORY_MAIN_ONES, false);
+
+    // Compiled files are what the next start should restore
+    if (outputFilesPath.empty()) {
+        saveSessionSnapshot(pathWeCompiledGraphicsTo, compileDatTo + ".dat");
+    }
+}
+
+void AssetsManager::startCompile(const std::string& outputFilesPath) {
+    if (isBusy()) {
+        return;
+    }
+
+    // Snapshot writer may still be reading the .spr that is about to be replaced
+    sessionSnapshot->waitForSave();
+    if (m_assetsInfo.reorderSprites) {
+        reorderSpritesByUse();
+    }
+
+    std::string compileAssetsTo = outputFilesPath;
+    std::string compileDatTo = outputFilesPath;
+    if(compileAssetsTo.empty()) {
+        compileAssetsTo = SavedData::getInstance()->getDataString("tempLoadedGraphicFilePath");
+        compileDatTo = SavedData::getInstance()->getDataString("tempLoadedDatFilePath");
+    }
+    Tools::removeSuffix(compileAssetsTo, ".spr");
+    Tools::removeSuffix(compileDatTo, ".dat");
+    std::string sprPath = compileAssetsTo + ".spr";
+    std::string datPath = compileDatTo + ".dat";
+
+    auto spr = std::make_shared<SprCompile>();
+    if (!prepareSprCompile(sprPath, *spr)) {
+        Warninger::sendErrorMsg(FUNC_NAME, "Compiling graphics failed, nothing got compiled.");
+        return;
+    }
+    // Items are written into memory right away, it's quick and they can't change under the writer then.
+    // Like compile(), the .spr still gets written if this fails.
+    auto datData = std::make_shared<std::vector<uint8_t>>();
+    bool datBuilt = buildOTDat(datPath, *datData);
+
+    auto jobSystem = JobSystem::getInstance();
+    auto start = std::chrono::steady_clock::now();
+    auto readBack = jobSystem->scheduleOnMainThread("Reading changed sprites", [this, spr](Job& job) {
+        readBackSprites(*spr, COMPILE_READBACKS_PER_FRAME);
+        job.setProgress(spr->readCount, spr->toRead.size());
+        return spr->readCount >= spr->toRead.size();
+    });
+    auto writeSpr = jobSystem->schedule("Writing .spr", [spr](Job& job) {
+        if (!spr->write(&job) && !job.isCancelled()) {
+            job.fail("Compiling graphics failed, nothing got compiled.");
+        }
+    }, {readBack}, [this, spr, start](Job& job) {
+        // Once the target got replaced its records are the ones to reuse, whatever happens to the rest
+        if (spr->written) {
+            finishSprCompile(*spr);
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            fmt::print("Compiled graphics to: {}\nIt took: {}\n", spr->outputPath, Tools::formatDuration(duration));
+        } else if (job.getStatus() == Job::Status::FAILED) {
+            Warninger::sendErrorMsg(FUNC_NAME, job.getError());
+        }
+    });
+
+    std::vector<JobHandle> jobs = {readBack, writeSpr};
+    JobHandle writeDat;
+    if (datBuilt) {
+        writeDat = jobSystem->schedule("Writing .dat", [datData, datPath](Job& job) {
+            if (!job.isCancelled() && !writeDatFile(datPath, *datData)) {
+                job.fail("Failed to write dat to: " + datPath);
+            }
+        }, {writeSpr});
+        jobs.push_back(writeDat);
+    }
+
+    // .spr records got updated by the callback of its job by now, callbacks run before main thread jobs queued after them
+    jobs.push_back(jobSystem->scheduleOnMainThread("Finishing", [this, datBuilt, sprPath, datPath, outputFilesPath](Job&) {
+        if (!datBuilt) {
+            // .spr is already replaced, but the item changes aren't saved anywhere yet
+            return true;
+        }
+        fmt::print("Compiled dat to: {}\n", datPath);
+        setUnsavedChanges(CATEGORY_MAIN_ONES, false);
+
+        // Compiled files are what the next start should restore
+        if (outputFilesPath.empty()) {
+            saveSessionSnapshot(sprPath, datPath);
+        }
+        return true;
+    }, {writeSpr, writeDat}, [this](Job& job) {
+        if (job.getStatus() != Job::Status::DONE) {
+            Warninger::sendWarning(FUNC_NAME, "Compiling didn't finish, changes stay unsaved.");
+        }
+        endOperation();
+    }));
+
+    beginOperation("Compiling assets", std::move(jobs));
+}
+
+void AssetsManager::beginOperation(const std::string& title, std::vector<JobHandle> jobs) {
+    operationTitle = title;
+    operationJobs = std::move(jobs);
+    openOperationProgress = true;
+}
+
+void AssetsManager::endOperation() {
+    operationJobs.clear();
+}
+
+void AssetsManager::cancelOperation() {
+    // Jobs that already started stop at their next check, the rest never starts
+    for (const auto& job : operationJobs) {
+        job->cancel();
+    }
+}
+
+void AssetsManager::drawOperationProgress() {
+    if (openOperationProgress) {
+        ImGui::OpenPopup("###OperationProgress");
+        openOperationProgress = false;
+    }
+
+    std::string popupName = operationTitle + "###OperationProgress";
+    if (!ImGui::BeginPopupModal(popupName.c_str(), nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+        return;
+    }
+
+    // Jobs of the same step (e.g. decoding of each chunk) share one bar
+    std::vector<std::pair<std::string, std::pair<float, int>>> steps;
+    for (const auto& job : operationJobs) {
+        auto step = std::find_if(steps.begin(), steps.end(), [&](const auto& s) { return s.first == job->getName(); });
+        if (step == steps.end()) {
+            steps.push_back({job->getName(), {job->getProgress(), 1}});
+        } else {
+            step->second.first += job->getProgress();
+            ++step->second.second;
+        }
+    }
+    for (const auto& [name, progress] : steps) {
+        ImGui::Text("%s", name.c_str());
+        ImGui::ProgressBar(progress.first / static_cast<float>(progress.second), ImVec2(300, 0));
+    }
+
+    ImGui::Separator();
+    if (!isBusy()) {
+        ImGui::CloseCurrentPopup();
+    } else if (ImGui::Button("Cancel", ImVec2(120, 0))) {
+        cancelOperation();
+    }
+
+    ImGui::EndPopup();
 }
 
 void AssetsManager::unload() {
+    history.clear();
     setGraphicFileLoaded(false);
     setDatFileLoaded(false);
     unloadDat();
@@ -936,6 +2312,24 @@ void AssetsManager::doPopupAssetFileOpen() {
     ImGui::Checkbox("Frame Durations##FrameDurationsSpr", &m_assetsInfo.frameDurations);
     ImGui::Checkbox("Frame Groups##FrameGroupsSpr", &m_assetsInfo.frameGroups);
 
+    auto& spriteDimensions = getSpriteDimensionsVector();
+    std::string currentDimLabel = std::to_string(spriteDimensions[m_assetsInfo.dimensionIndex]) + "x" + std::to_string(spriteDimensions[m_assetsInfo.dimensionIndex]);
+    ImGui::PushItemWidth(100);
+    if (ImGui::BeginCombo("Sprite Dimension##LoadSprDimension", currentDimLabel.c_str())) {
+        for (int i = 0; i < spriteDimensions.size(); ++i) {
+            std::string itemLabel = std::to_string(spriteDimensions[i]) + "x" + std::to_string(spriteDimensions[i]);
+            bool isSelected = (i == m_assetsInfo.dimensionIndex);
+            if (ImGui::Selectable(itemLabel.c_str(), isSelected)) {
+                m_assetsInfo.dimensionIndex = i;
+            }
+            if (isSelected) {
+                ImGui::SetItemDefaultFocus();
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::PopItemWidth();
+
     ImGui::Spacing();
     ImGui::Separator();
     ImGui::Spacing();
@@ -966,7 +2360,7 @@ void AssetsManager::doPopupAssetFileOpen() {
 
 void AssetsManager::doPopupNewAssetFiles() {
     auto versions = getVersionsArray();
-    std::string currentVLabel = "v" + std::string(versions[m_assetsInfo.versionIndex]);
+    std::string currentVLabel = "v" + std::string(versions[m_tempCreation_AssetsInfo.versionIndex]);
     // trim trailing zeroes from float formatting
     currentVLabel.erase(currentVLabel.find_last_not_of('0') + 1, std::string::npos);
     if (currentVLabel.back() == '.') currentVLabel.pop_back();
@@ -979,9 +2373,9 @@ void AssetsManager::doPopupNewAssetFiles() {
             itemLabel.erase(itemLabel.find_last_not_of('0') + 1, std::string::npos);
             if (itemLabel.back() == '.') itemLabel.pop_back();
 
-            bool isSelected = (i == m_assetsInfo.versionIndex);
+            bool isSelected = (i == m_tempCreation_AssetsInfo.versionIndex);
             if (ImGui::Selectable(itemLabel.c_str(), isSelected)) {
-                m_assetsInfo.versionIndex = i;
+                m_tempCreation_AssetsInfo.versionIndex = i;
             }
             if (isSelected) {
                 ImGui::SetItemDefaultFocus();
@@ -994,14 +2388,14 @@ void AssetsManager::doPopupNewAssetFiles() {
     ImGui::Text("Sprite Dimension");
 
     auto& spriteDimensions = getSpriteDimensionsVector();
-    std::string currentDimLabel = std::to_string(spriteDimensions[m_assetsInfo.dimensionIndex]) + "x" + std::to_string(spriteDimensions[m_assetsInfo.dimensionIndex]);
+    std::string currentDimLabel = std::to_string(spriteDimensions[m_tempCreation_AssetsInfo.dimensionIndex]) + "x" + std::to_string(spriteDimensions[m_tempCreation_AssetsInfo.dimensionIndex]);
 
     if (ImGui::BeginCombo("##SelectNewAssetsDimension", currentDimLabel.c_str())) {
         for (int i = 0; i < spriteDimensions.size(); ++i) {
             std::string itemLabel = std::to_string(spriteDimensions[i]) + "x" + std::to_string(spriteDimensions[i]);
-            bool isSelected = (i == m_assetsInfo.dimensionIndex);
+            bool isSelected = (i == m_tempCreation_AssetsInfo.dimensionIndex);
             if (ImGui::Selectable(itemLabel.c_str(), isSelected)) {
-                m_assetsInfo.dimensionIndex = i;
+                m_tempCreation_AssetsInfo.dimensionIndex = i;
             }
             if (isSelected) {
                 ImGui::SetItemDefaultFocus();
@@ -1030,10 +2424,11 @@ void AssetsManager::doPopupNewAssetFiles() {
         m_assetsInfo = m_tempCreation_AssetsInfo;
 
         unload();
+        setSpriteSize(getSpriteDimensionsVector().at(m_assetsInfo.dimensionIndex));
         setGraphicFileLoaded(true);
         setDatFileLoaded(true);
 
-        createNewTexture();
+        textures.push_back(BLANK_TEXTURE); // air, not something to undo
         // TO-DO use addItemType() from ItemsScrollableWindow instead
         auto newItemType = std::make_shared<ItemType>();
         Items::pushItemType(newItemType);
@@ -1050,6 +2445,9 @@ void AssetsManager::doPopupNewAssetFiles() {
 }
 
 bool AssetsManager::isCompilable(bool needPath) {
+    if (isBusy()) {
+        return false;
+    }
     if(needPath && SavedData::getInstance()->getDataString("tempLoadedGraphicFilePath").empty()) {
         return false;
     }
@@ -1095,12 +2493,28 @@ void AssetsManager::doPopupAssetsCompileAs() {
     ImGui::Checkbox("Transparency", &m_assetsInfo.transparency);
     ImGui::Checkbox("Frame Durations", &m_assetsInfo.frameDurations);
     ImGui::Checkbox("Frame Groups", &m_assetsInfo.frameGroups);
+    ImGui::Checkbox("Incremental", &m_assetsInfo.incrementalCompile);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Copies not changed sprites from the previous .spr instead of compressing them again");
+    }
+    if (getSpriteSize() > 32) {
+        ImGui::Checkbox("Downscale to 32x32", &m_assetsInfo.downscaleTo32);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Legacy build out of HD sprites, loaded sprites stay as they are");
+        }
+    } else {
+        m_assetsInfo.downscaleTo32 = false;
+    }
+    ImGui::Checkbox("Reorder Sprites", &m_assetsInfo.reorderSprites);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Sprites used by the same thing go next to each other, loaded sprites get new ids");
+    }
 
     ImGui::Spacing();
     ImGui::Separator();
 
     if (ImGui::Button("Confirm", ImVec2(120, 0))) {
-        compile(m_assetsInfo.outputPath + "\\" + m_assetsInfo.name);
+        startCompile(m_assetsInfo.outputPath + "\\" + m_assetsInfo.name);
         ImGui::CloseCurrentPopup();
     }
 
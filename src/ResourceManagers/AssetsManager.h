@@ -6,13 +6,21 @@
 #include <unordered_map>
 #include <SFML/Graphics.hpp>
 #include <cstdint>
+#include <memory>
 #include "../Things/ItemType.h"
 #include "../Things/Items.h"
+#include "../Things/DatFormat.h"
+#include "../Things/ThingTypes.h"
 #include "imgui.h"
 #include "ConfigManager.h"
 #include "../Misc/Warninger.h"
 #include "../Helper/GUIHelper.h"
 #include "../Helper/SavedData.h"
+#include "../Helper/UndoHistory.h"
+#include "../Helper/MappedFile.h"
+#include "../Helper/ThumbnailCache.h"
+#include "../Helper/SpriteHashIndex.h"
+#include "../Helper/JobSystem.h"
 
 enum ASSET_CATEGORY {
     CATEGORY_ITEMS = 0,
@@ -22,8 +30,10 @@ enum ASSET_CATEGORY {
     CATEGORY_MAIN_ONES // especially important on changing unsaved changes on - sprites, items, outfits
 };
 
+class SessionSnapshot;
+
 struct AssetsInfo {
-    uint8_t versionIndex = 0;
+    uint8_t versionIndex = 0; // DatFormat::ProfileId
     uint8_t dimensionIndex = 0;
 
     bool extended = false;
@@ -35,6 +45,30 @@ struct AssetsInfo {
     char name[128] = "Tibia"; // assets name without extension
     int compileTypeIndex = 1;
     std::string outputPath;
+    bool incrementalCompile = true; // reuse untouched sprites from the previous .spr
+    bool downscaleTo32 = false; // legacy 32x32 build out of HD sprites
+    bool reorderSprites = false; // sprites of the same thing next to each other in the .spr
+};
+
+// Where a sprite record is in a .spr
+struct SprRecordRef {
+    uint32_t offset = 0; // 0 = empty sprite
+    uint16_t dataSize = 0;
+};
+
+// Copy of what's needed to decode untouched sprites straight from the last loaded/compiled .spr,
+// so worker threads can get their pixels without touching the GPU textures
+struct SprSource {
+    std::string path; // empty = there is no such .spr
+    bool transparency = false;
+    uint32_t dimension = 0;
+    std::vector<SprRecordRef> records; // index = sprite id
+    std::vector<bool> dirty;           // index = sprite id, missing = dirty
+
+    // False -> pixels of the sprite have to come from its texture
+    [[nodiscard]] bool canDecode(uint32_t id) const {
+        return !path.empty() && id < dirty.size() && !dirty[id] && id < records.size();
+    }
 };
 
 class AssetsManager {
@@ -65,20 +99,70 @@ public:
      */
     bool isValidTextureIndex(int id);
     bool pushTexture(std::shared_ptr<sf::Texture> texture);
+    // Appends the textures as new sprites, all of them as one undo step. With continueBatch they extend
+    // the step of the previous call instead (import that is spread over frames).
+    // Returns how many got added, textures of a wrong size are skipped.
+    size_t pushTextures(const std::vector<std::shared_ptr<sf::Texture>>& batch, bool continueBatch = false);
     void replaceTexture(int id, std::shared_ptr<sf::Texture> newTexture);
     void removeTexture(int id);
     void createNewTexture();
 
-    // Compiles .spr file from loaded Textures into the app
-    void compileSprFromTextures(const std::string& outputFilePath = "");
-    // Main method for 'Compile' button, responsible for compiling .spr and .dat
+    // Undo/Redo (Ctrl+Z/Ctrl+Y) of sprite changes and ItemType saves.
+    // Returns false if there was nothing to undo/redo.
+    bool undo();
+    bool redo();
+
+    // Compiles .spr file from loaded Textures into the app.
+    // In incremental mode only changed (dirty) sprites get encoded, the rest is copied from the previous .spr.
+    // Output replaces the target only once it is fully written and verified, returns false if it wasn't.
+    bool compileSprFromTextures(const std::string& outputFilePath = "");
+    // True if the last loaded/compiled .spr can still be used as the source of untouched sprites
+    [[nodiscard]] bool canCompileSprIncrementally() const;
+    [[nodiscard]] bool isSpriteDirty(uint32_t id) const;
+    // Goes up whenever a sprite changes or the sprites get (un)loaded, to tell if something derived from them is stale
+    [[nodiscard]] uint64_t getSpritesRevision() const { return spritesRevision; }
+    // Records of the last loaded/compiled .spr, if it still matches the current sprite size
+    [[nodiscard]] SprSource getSprSource() const;
+    // Compiles .spr and .dat right away, the frame waits for it (e.g. on exit)
     void compile(const std::string& outputFilesPath = "");
-    void compileOTDat(const std::string& outputFilePath = "");
+    // Main method for 'Compile' button - same as compile(), but encoding and writing run as jobs
+    // while the progress modal is shown. Changed sprites are read back on the UI thread first.
+    void startCompile(const std::string& outputFilesPath = "");
+    // Writes items from their flags/attributes and the other things as they were loaded.
+    // Returns false (target untouched) if the .dat couldn't be written.
+    bool compileOTDat(const std::string& outputFilePath = "");
 
     // Loads textures from binary file containing graphics
     // Returns true if getTextureCount() is > 0.
     bool loadSpr(const std::string& sprFilePath = "");
     void loadOTDat(const std::string& datFilePath = "");
+    // Loads both as jobs - sprites get decoded in the background and streamed in by the TextureUploader,
+    // the .dat gets parsed meanwhile. Cancelling it from the progress modal unloads everything.
+    void startLoad(const std::string& sprFilePath, const std::string& datFilePath);
+
+    // True while a load/compile runs as jobs, nothing may change the assets until it's over
+    [[nodiscard]] bool isBusy() const { return !operationJobs.empty(); }
+    void cancelOperation();
+
+    // What the loaded assets take up, the counters follow every texture/preview that comes and goes
+    struct MemoryUsage {
+        size_t spriteTextures = 0;      // blank ones share a single texture, it isn't counted
+        uint64_t spriteTextureBytes = 0;
+        size_t evictedSprites = 0;      // dropped to fit the budget, decoded again once they're needed
+        size_t previews = 0;
+        uint64_t previewBytes = 0;
+        uint64_t pixelBytes = 0;        // CPU side - staging buffers and thumbnails not written yet
+        uint64_t itemDataBytes = 0;
+    };
+    [[nodiscard]] MemoryUsage getMemoryUsage() const;
+    /**
+     * @brief Keeps the loaded assets within the budgets of config's [MEMORY], main loop once per frame
+     *
+     * Over a budget, previews are dropped first and then sprite textures whose pixels can be decoded
+     * from the .spr again (untouched ones), least recently shown first. Whatever got used in the last
+     * couple of frames stays. Dropped ones come back on their own the next time they're asked for.
+     */
+    void enforceMemoryBudgets();
 
     // Unloads all - textures, dat etc.
     void unload();
@@ -88,6 +172,10 @@ public:
     void onGraphicsLoaded(const std::string& loadedPath);
     void onDatLoaded(const std::string& loadedPath);
 
+    // Restores the .spr/.dat of the last run from the session snapshot (if it's still up to date).
+    // Returns false if there was nothing to restore, the user loads the files as usual then.
+    bool restoreLastSession();
+
     /**
      * @brief Helper method for detecting changes to Items, Sprites etc.
      *
@@ -120,9 +208,13 @@ public:
     // Whenever prompted to save or not save changes, we will
     // either on 'Save', use this unsavedItemType to set it as an actual ItemType
     // or when canceling, we will just discard it.
-    void setUnsavedItemType(const std::shared_ptr<ItemType>& itemTypeToCopy, int id) {
-        if (itemTypeToCopy) {
-            unsavedItemTypeCopy = std::make_shared<ItemType>(*itemTypeToCopy); // deep copy
+    // It is copy-on-write - selecting an item only shares it, and the copy
+    // gets made by editUnsavedItemType() on the first actual change.
+    void setUnsavedItemType(const std::shared_ptr<ItemType>& itemType, int id) {
+        if (itemType) {
+            unsavedItemTypeCopy = itemType;
+            // Anything else than the stored ItemType (e.g. pasted one) is already ours to change
+            unsavedItemTypeOwned = itemType != Items::getItemType(id);
             unsavedItemTypeId = id;
         } else {
             resetUnsavedItemType();
@@ -130,17 +222,29 @@ public:
     }
     void resetUnsavedItemType() {
         unsavedItemTypeCopy.reset();
+        unsavedItemTypeOwned = false;
         unsavedItemTypeId = -1;
     }
-    std::shared_ptr<ItemType> getUnsavedItemType() {
+    // Read-only, use editUnsavedItemType() to change it
+    std::shared_ptr<const ItemType> getUnsavedItemType() const {
         if (unsavedItemTypeCopy) {
             return unsavedItemTypeCopy;
-        } else {
-            // Create a brand new copy of dollItemType
-            // This assumes ItemType has a copy constructor or a way to clone it.
-            // For shared_ptr, you'll need to create a new object and then a new shared_ptr to it.
-            return std::make_shared<ItemType>(*Items::dollItemType);
         }
+        return Items::dollItemType;
+    }
+    /**
+     * @brief Returns the UnsavedItemType that can be changed
+     *
+     * If the UnsavedItemType is still shared with the stored ItemType,
+     * this is where it gets copied (only once per edit session).
+     * Without any UnsavedItemType there is nothing to change, it warns and returns nullptr.
+     */
+    std::shared_ptr<ItemType> editUnsavedItemType();
+    // Stores UnsavedItemType as the actual ItemType, recording the change in undo history
+    bool saveUnsavedItemType();
+    // True as long as nothing got changed in the UnsavedItemType
+    [[nodiscard]] bool isUnsavedItemTypeShared() const {
+        return unsavedItemTypeCopy && !unsavedItemTypeOwned;
     }
     [[nodiscard]] int getUnsavedItemTypeId() const {
         return unsavedItemTypeId;
@@ -172,9 +276,10 @@ public:
      * @param w cell's 'width' from which we want texture
      * @param a cell's 'animation frame' that is set on the animation slider to know in which animation frame find the texture
      */
-    uint32_t getTextureIdFromItemType(const std::shared_ptr<ItemType>& it, int h, int w, int a) {
-        int index = h * it->width + w + ((a-1) * (it->width * it->height));
-        return it->textureIdsVector[index];
+    uint32_t getTextureIdFromItemType(const ItemType& it, int h, int w, int a) {
+        // First layer and pattern, that's what the editor shows
+        size_t index = it.getSpriteIndex(w, h, a - 1);
+        return index < it.textureIdsVector.size() ? it.textureIdsVector[index] : 0;
     }
     /**
      * @brief Main method to set texture in an ItemType
@@ -190,8 +295,10 @@ public:
      * it substitutes the previously texture id that was at that position (index).
      */
     void setTextureIdFromItemType(std::shared_ptr<ItemType> it, int h, int w, int a, int newId) {
-        int index = h * it->width + w + ((a-1) * (it->width * it->height));
-        it->textureIdsVector[index] = newId;
+        size_t index = it->getSpriteIndex(w, h, a - 1);
+        if (index < it->textureIdsVector.size()) {
+            it->textureIdsVector[index] = newId;
+        }
     }
 
     std::shared_ptr<sf::Texture> getPreviewTexture(int itemTypeId);
@@ -215,6 +322,28 @@ public:
      * @param pageLastItemType Id of last itemType on page
      */
     void createPreviewTexturesForPage(int pageFirstItemType, int pageLastItemType);
+    /**
+     * @brief Key of the item's preview in the thumbnail cache
+     *
+     * Hash of the sprite ids the preview is made of and of those sprites' pixels (and the thumbnail size),
+     * so it changes whenever the preview would look different.
+     *
+     * @return 0 for an invalid item
+     */
+    uint64_t getPreviewKey(int itemTypeId);
+    // Hash of the sprite's RGBA. Untouched sprites get decoded from the .spr for it, changed ones read back once.
+    uint64_t getSpriteContentHash(uint32_t id);
+    /**
+     * @brief Sprites with exactly these pixels, ascending
+     *
+     * A single lookup in the sprite hash index. Sprites that aren't hashed yet aren't found,
+     * hashMissingSprites() completes the index.
+     *
+     * @param rgba getSpriteSize()^2 RGBA pixels
+     */
+    std::vector<uint32_t> findSpritesByPixels(const uint8_t* rgba);
+    // UI thread: hashes up to 'budget' sprites the index doesn't know yet, returns how many are still missing
+    size_t hashMissingSprites(size_t budget);
     void setDecoyPreviewTexture(int id) {
         replacePreviewTexture(id, std::make_shared<sf::Texture>());
     }
@@ -288,14 +417,22 @@ public:
     std::shared_ptr<sf::Texture> BLANK_TEXTURE;
 
     const char* const* getVersionsArray() {
-        return m_versions;
+        return DatFormat::PROFILE_NAMES;
     }
     int getVersionsArraySize() {
-        return static_cast<int>(sizeof(m_versions) / sizeof(m_versions[0]));
+        return DatFormat::PROFILE_COUNT;
     }
     const std::vector<int>& getSpriteDimensionsVector() {
         return m_spriteDimensions;
     }
+    // Width (= height) of a single sprite in the loaded assets
+    [[nodiscard]] uint32_t getSpriteSize() const {
+        return spriteSize;
+    }
+    // Sprite size that compile writes, smaller than getSpriteSize() for downscaled builds
+    [[nodiscard]] uint32_t getCompileSpriteSize() const {
+        return m_assetsInfo.downscaleTo32 ? 32 : spriteSize;
+    }
 
     // Returns 'true' if 'Compile' button should be available.
     // The main thing is that unless there are changes we shouldn't compile.
@@ -319,6 +456,7 @@ private:
     bool unsavedItemTypeChange = false;
 
     std::shared_ptr<ItemType> unsavedItemTypeCopy;
+    bool unsavedItemTypeOwned = false; // false = still shares the stored ItemType
     int unsavedItemTypeId = -1;
 
     int lastSelectedItemId = -1; // Useful when we e.g. have unsaved changes and clicked select on some item.
@@ -328,13 +466,127 @@ private:
     bool datLoaded = false; // .dat loaded
 
     uint32_t loadedSprSignature = 0;
+    uint32_t spriteSize = 32;
+    // Also remakes BLANK_TEXTURE in that size
+    void setSpriteSize(uint32_t size);
+
+    // Per-sprite changes since the last load/compile (index = sprite id)
+    std::vector<bool> dirtySprites;
+    void markSpriteDirty(uint32_t id);
+    uint64_t spritesRevision = 0;
+
+    // Memory accounting, see getMemoryUsage()
+    size_t spriteTextureCount = 0;
+    uint64_t spriteTextureBytes = 0;
+    size_t previewCount = 0;
+    uint64_t previewBytes = 0;
+    // Moves the counters from what a slot held to what it holds now
+    void accountSpriteTexture(const std::shared_ptr<sf::Texture>& removed, const std::shared_ptr<sf::Texture>& added);
+    void accountPreviewTexture(const std::shared_ptr<sf::Texture>& removed, const std::shared_ptr<sf::Texture>& added);
+
+    // Eviction - last use is the frame (memoryFrame) a texture was last asked for
+    uint32_t memoryFrame = 1;
+    std::vector<uint32_t> spriteLastUse;  // index = sprite id
+    std::vector<uint32_t> previewLastUse; // index = item id
+    // Slot is nullptr while evicted, the texture comes back from the .spr on next use
+    std::vector<bool> evictedSprites;
+    size_t evictedSpriteCount = 0;
+    std::vector<bool> evictedPreviews;
+    bool itemDataBudgetWarned = false;
+    // After an eviction that couldn't get under the budget, the next try waits for this frame
+    uint32_t nextEvictionFrame = 0;
+    [[nodiscard]] bool isSpriteEvicted(uint32_t id) const { return id < evictedSprites.size() && evictedSprites[id]; }
+    void touchSprite(uint32_t id);
+    void restoreEvictedSprite(uint32_t id);
+    // Untouched, with its record still in the .spr and nothing else (e.g. undo) holding the texture
+    [[nodiscard]] bool canEvictSprite(uint32_t id) const;
+    // Least recently used first, until at least 'bytes' are freed. Returns how much was freed.
+    uint64_t evictPreviews(uint64_t bytes);
+    uint64_t evictSprites(uint64_t bytes);
+
+    // Where each sprite record is in the last loaded/compiled .spr (index = sprite id)
+    std::vector<SprRecordRef> sprRecords;
+    std::string sprRecordsPath;
+    // RLE payloads depend on these, so they must match to reuse records
+    bool sprRecordsTransparency = false;
+    uint32_t sprRecordsDimension = 0;
+
+    // Content hashes by sprite id and the other way round, 0 = not computed yet. Reset whenever the sprite changes.
+    // Saved next to the .spr for the next time the same file gets loaded.
+    SpriteHashIndex spriteHashIndex;
+    SpriteHashIndex::FileStamp spriteHashStamp; // of the .spr the hashes were loaded/saved with
+    bool spriteHashesChanged = false;           // hashes of untouched sprites got added since
+    uint32_t spriteHashScanPos = 0;
+    // Hashes saved for the .spr, false (all unknown then) if there are none that match it
+    bool loadSpriteHashes(const std::string& sprPath, uint32_t dimension, bool transparency);
+    // Untouched sprites only, the others don't look like that in the .spr
+    void saveSpriteHashes();
+    // .spr records get decoded from, for hashing untouched sprites without a GPU readback
+    MappedFile sprMapping;
+    std::string sprMappingPath;
+    // RGBA of an untouched sprite (getSpriteSize()^2 * 4 bytes) from its record, false if it can't be decoded
+    bool decodeSpriteFromSpr(uint32_t id, uint8_t* out);
+
+    // Item previews of the loaded assets, saved next to the .spr
+    ThumbnailCache thumbnailCache;
+
+    // Signature of the loaded .dat, 0 = new assets (profile's signature is used then)
+    uint32_t datSignature = 0;
+
+    UndoHistory history;
+    // Puts texture into the slot, appending/popping if needed, and marks it dirty. Doesn't record history.
+    void setTextureSlot(uint32_t id, std::shared_ptr<sf::Texture> texture);
+    void applyHistoryEntry(const UndoHistory::Entry& entry, bool forward);
 
     void buttonLoadGraphics(std::string& foundGraphicFilePath);
 
+    // Steps of loading/compiling, shared by the blocking methods and the jobs (defined in the .cpp)
+    struct SprLoad;
+    struct DatLoad;
+    struct SprCompile;
+    // UI thread: empty slots for every sprite, decoded ones get uploaded into them
+    void prepareSprUpload(SprLoad& load);
+    void finishSprLoad(SprLoad& load);
+    // UI thread: reads the whole file and sets up the arenas, parsing itself can run anywhere
+    bool readDatForLoad(const std::string& path, DatLoad& load);
+    void applyDatLoad(DatLoad& load);
+    // UI thread: decides which sprites get reused/encoded, false if nothing can be compiled
+    bool prepareSprCompile(const std::string& fileName, SprCompile& compile);
+    // UI thread: reads back pixels of the next 'budget' sprites to encode
+    void readBackSprites(SprCompile& compile, size_t budget);
+    void finishSprCompile(const SprCompile& compile);
+    /**
+     * @brief Gives sprites new ids in the order things use them, before compiling
+     *
+     * Sprites of an item (its animation frames one after another) end up next to each other in the .spr,
+     * then those of outfits, effects and missiles, then the ones nothing uses in their old order.
+     * Sprite ids of all the things and everything kept by sprite id get moved along, undo history gets cleared.
+     *
+     * @return False if the sprites already are in that order
+     */
+    bool reorderSpritesByUse();
+    // Whole .dat in memory, false if the things don't fit it
+    bool buildOTDat(const std::string& outputFilePath, std::vector<uint8_t>& data);
+
+    // Load/compile running as jobs, shown in the progress modal until the last one finishes
+    std::string operationTitle;
+    std::vector<JobHandle> operationJobs;
+    bool openOperationProgress = false;
+    void beginOperation(const std::string& title, std::vector<JobHandle> jobs);
+    void endOperation();
+    void drawOperationProgress();
+
+    // Snapshot of the loaded session, restored instead of decoding/parsing the same files again
+    std::unique_ptr<SessionSnapshot> sessionSnapshot;
+    // matchLoadOptions - the snapshot has to be made with the options from the load popup.
+    // True once the restore got started, its sprites are uploaded over the next frames as an operation.
+    bool loadSessionSnapshot(const std::string& sprPath, const std::string& datPath, bool matchLoadOptions);
+    // Only while everything loaded is still exactly what's in those files
+    void saveSessionSnapshot(const std::string& sprPath, const std::string& datPath);
+
     void doPopupAssetFileOpen();
     void doPopupNewAssetFiles();
     void doPopupAssetsCompileAs();
 
-    inline static const char* m_versions[] = {"0.01"};
-    inline static std::vector<int> m_spriteDimensions = {32};
+    inline static std::vector<int> m_spriteDimensions = {32, 64, 128};
 };
\ No newline at end of file
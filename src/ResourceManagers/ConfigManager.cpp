@@ -25,12 +25,33 @@ void ConfigManager::loadConfig(const std::string &filename) {
         ITEM_MAXHEIGHT = std::max(1, itemPropertiesConfig["maxHeight"].value_or(1));
         ITEM_MAXANIMATIONS = std::max(1, itemPropertiesConfig["maxAnimationCount"].value_or(1));
 
+        auto editorConfig = config["EDITOR"];
+        UNDO_STEPS = std::max(1, editorConfig["undoSteps"].value_or(500));
+
         auto compileConfig = config["COMPILE"];
         FILE_ASSETS_NAME = compileConfig["assetsFileName"].value_or("default.spr");
         FILE_ITEMS_NAME = compileConfig["itemsFileName"].value_or("default.dat");
 
         auto pathConfig = config["PATHS"];
         PATH_ASSETS = pathConfig["assetsPath"].value_or("data/things/");
+
+        auto cacheConfig = config["CACHE"];
+        SESSION_SNAPSHOT = cacheConfig["sessionSnapshot"].value_or(true);
+        PATH_SESSION_SNAPSHOT = cacheConfig["sessionSnapshotPath"].value_or("cache/session.snapshot");
+
+        auto performanceConfig = config["PERFORMANCE"];
+        UPLOAD_BUDGET_MS = std::max(0.5f, performanceConfig["uploadBudgetMs"].value_or(4.0f));
+        UPLOAD_BUDGET_BYTES = static_cast<size_t>(std::max(64, performanceConfig["uploadBudgetKB"].value_or(8192))) * 1024;
+        STAGING_POOL_BYTES = static_cast<size_t>(std::max(0, performanceConfig["stagingPoolMB"].value_or(64))) * 1024 * 1024;
+
+        auto memoryConfig = config["MEMORY"];
+        auto budgetMB = [&memoryConfig](const char* key, int64_t fallback) {
+            return static_cast<uint64_t>(std::max<int64_t>(0, memoryConfig[key].value_or(fallback))) * 1024 * 1024;
+        };
+        TEXTURE_BUDGET_BYTES = budgetMB("textureBudgetMB", 3072);
+        PREVIEW_BUDGET_BYTES = budgetMB("previewBudgetMB", 256);
+        PIXEL_BUDGET_BYTES = budgetMB("pixelBudgetMB", 256);
+        ITEM_DATA_BUDGET_BYTES = budgetMB("itemDataBudgetMB", 512);
     } catch (const toml::parse_error& err) {
         std::cerr << "TOML Parse Error: " << err << std::endl;
     }
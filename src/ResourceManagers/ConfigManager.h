@@ -31,10 +31,25 @@ public:
     [[nodiscard]] int getItemMaxHeight() const { return ITEM_MAXHEIGHT; };
     [[nodiscard]] int getItemMaxAnimationCount() const { return ITEM_MAXANIMATIONS; };
 
+    [[nodiscard]] int getUndoSteps() const { return UNDO_STEPS; };
+
     [[nodiscard]] const std::string& getAssetsFileName() const { return FILE_ASSETS_NAME; }
     [[nodiscard]] const std::string& getDatFileName() const { return FILE_ITEMS_NAME; }
 
     [[nodiscard]] const std::string& getPathAssets() const { return PATH_ASSETS; }
+
+    [[nodiscard]] bool isSessionSnapshotEnabled() const { return SESSION_SNAPSHOT; }
+    [[nodiscard]] const std::string& getSessionSnapshotPath() const { return PATH_SESSION_SNAPSHOT; }
+
+    [[nodiscard]] float getUploadBudgetMs() const { return UPLOAD_BUDGET_MS; }
+    [[nodiscard]] size_t getUploadBudgetBytes() const { return UPLOAD_BUDGET_BYTES; }
+    [[nodiscard]] size_t getStagingPoolBytes() const { return STAGING_POOL_BYTES; }
+
+    // 0 = no budget
+    [[nodiscard]] uint64_t getTextureBudgetBytes() const { return TEXTURE_BUDGET_BYTES; }
+    [[nodiscard]] uint64_t getPreviewBudgetBytes() const { return PREVIEW_BUDGET_BYTES; }
+    [[nodiscard]] uint64_t getPixelBudgetBytes() const { return PIXEL_BUDGET_BYTES; }
+    [[nodiscard]] uint64_t getItemDataBudgetBytes() const { return ITEM_DATA_BUDGET_BYTES; }
 private:
     static ConfigManager* instance_;
 
@@ -57,8 +72,22 @@ private:
     int ITEM_MAXHEIGHT;
     int ITEM_MAXANIMATIONS;
 
+    int UNDO_STEPS;
+
     std::string FILE_ASSETS_NAME;
     std::string FILE_ITEMS_NAME;
 
     std::string PATH_ASSETS;
+
+    bool SESSION_SNAPSHOT;
+    std::string PATH_SESSION_SNAPSHOT;
+
+    float UPLOAD_BUDGET_MS;
+    size_t UPLOAD_BUDGET_BYTES;
+    size_t STAGING_POOL_BYTES;
+
+    uint64_t TEXTURE_BUDGET_BYTES;
+    uint64_t PREVIEW_BUDGET_BYTES;
+    uint64_t PIXEL_BUDGET_BYTES;
+    uint64_t ITEM_DATA_BUDGET_BYTES;
 };
\ No newline at end of file
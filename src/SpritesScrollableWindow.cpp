@@ -1,8 +1,11 @@
 #include <iostream>
+#include <chrono>
+#include <ctime>
 #include "SpritesScrollableWindow.h"
 #include "Misc/tools.h"
 #include "Helper/SavedData.h"
 #include "Misc/definitions.h"
+#include "misc/cpp/imgui_stdlib.h"
 
 SpritesScrollableWindow::SpritesScrollableWindow(sf::RenderWindow& window, AssetsManager* am)
 : window(window)
@@ -148,7 +151,7 @@ void SpritesScrollableWindow::drawTextureList(sf::Clock& deltaClock) {
 
     // Popup code for invalid tile size on new texture
     if (ImGui::BeginPopupModal("Wrong Texture Size", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
-        auto spriteMaxSize = ConfigManager::getInstance()->getSpriteMaxSize();
+        auto spriteMaxSize = assetsManager->getSpriteSize();
         ImGui::Text(("Invalid image! You tried to import a sprite that is not size: "
                      + std::to_string(spriteMaxSize) + "x"
                      + std::to_string(spriteMaxSize)).c_str());
@@ -181,14 +184,22 @@ void SpritesScrollableWindow::drawTextureList(sf::Clock& deltaClock) {
             const auto& files = dropManager->GetDraggedFiles();
             const auto& allowedExtensions = Tools::getImageExtensions();
 
+            std::vector<std::string> imageFiles;
             for (const auto& filePath : files)
             {
                 std::string ext = Tools::getExtensionFromPath(filePath);
                 if (std::find(allowedExtensions.begin(), allowedExtensions.end(), ext) != allowedExtensions.end()) {
-                    importTexture(filePath);
+                    imageFiles.push_back(filePath);
                 }
             }
 
+            // Single file keeps the old behaviour (wrong size popup etc.)
+            if (imageFiles.size() == 1) {
+                importTexture(imageFiles.front());
+            } else if (imageFiles.size() > 1) {
+                startBatchImport(std::move(imageFiles));
+            }
+
             // TO-DO in the future when you also do the dragging for other things, you will probably need to clear it elsewhere
             dropManager->ClearDraggedFiles();
         }
@@ -262,6 +273,14 @@ void SpritesScrollableWindow::drawListControlButtons() {
         }
     }
 
+    ImGui::SameLine();
+    if (ImGui::Button("Import Folder##BatchImportIntoTextureList")) {
+        ImGui::OpenPopup("Batch Import Popup");
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Imports every image of a folder, sprite sheets get sliced into sprites");
+    }
+
     ImGui::SameLine();
     if (ImGui::Button("Export###ExportSpriteButton")) {
         if(isAnySpriteSelected()) {
@@ -295,6 +314,22 @@ void SpritesScrollableWindow::drawListControlButtons() {
         }
     }
 
+    ImGui::SameLine();
+    if (ImGui::Button("Similar##SimilarSpritesButton")) {
+        showSimilarSprites = !showSimilarSprites;
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Finds sprites that look like the selected one, and groups of near-duplicates");
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("Find by Image##FindSpritesByImage")) {
+        startImageSearch();
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Finds the sprites (and items using them) that are exactly an image, or the tiles of a sprite sheet");
+    }
+
     if (ImGui::BeginPopupModal("Export Sprite Popup", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
         ImGui::Text("Name:");
         ImGui::InputText("##name", &spriteName[0], spriteName.size() + 1);
@@ -320,6 +355,11 @@ void SpritesScrollableWindow::drawListControlButtons() {
         ImGui::RadioButton("BMP", &formatSelected, 1); ImGui::SameLine();
         ImGui::RadioButton("JPG", &formatSelected, 2);
 
+        ImGui::Checkbox("All sprites", &exportAllSprites);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Exports every sprite into the folder as sprite<id>, name is ignored");
+        }
+
         ImGui::Spacing();
         ImGui::Separator();
         ImGui::Spacing();
@@ -329,7 +369,15 @@ void SpritesScrollableWindow::drawListControlButtons() {
         auto colorsCount = Tools::pushImGuiGray(!Tools::isValidFolderPath(outputFolder));
         if (ImGui::Button("Confirm")) {
             if (Tools::isValidFolderPath(outputFolder)) {
-                exportTexture(static_cast<Tools::EXPORT_OPTIONS>(formatSelected));
+                if (exportAllSprites) {
+                    BulkExporter::Request request;
+                    request.folder = outputFolder;
+                    request.imageFormat = static_cast<Tools::EXPORT_OPTIONS>(formatSelected);
+                    request.sprites = true;
+                    openExportProgress = bulkExporter.start(*assetsManager, request);
+                } else {
+                    exportTexture(static_cast<Tools::EXPORT_OPTIONS>(formatSelected));
+                }
                 ImGui::CloseCurrentPopup();
             }
         }
@@ -353,6 +401,22 @@ void SpritesScrollableWindow::drawListControlButtons() {
         ImGui::EndPopup();
     }
 
+    updateBatchImport();
+    drawBatchImportPopups();
+
+    bulkExporter.update(*assetsManager, EXPORT_READBACKS_PER_FRAME);
+    if (openExportProgress) {
+        ImGui::OpenPopup("Exporting Sprites");
+        openExportProgress = false;
+    }
+    bulkExporter.drawProgressPopup("Exporting Sprites");
+
+    spriteSimilarity.update(*assetsManager, SIMILARITY_READBACKS_PER_FRAME);
+    drawSimilarSpritesWindow();
+
+    imageSearch.update(*assetsManager, IMAGE_SEARCH_HASHES_PER_FRAME);
+    drawImageSearchWindow();
+
     ImGui::EndGroup();
 
     if(!assetsManager->isGraphicFileLoaded()) {
@@ -360,6 +424,413 @@ void SpritesScrollableWindow::drawListControlButtons() {
     }
 }
 
+void SpritesScrollableWindow::drawSimilarSpritesWindow() {
+    if (!showSimilarSprites) {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(440, 560), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Similar Sprites", &showSimilarSprites)) {
+        ImGui::End();
+        return;
+    }
+
+    if (spriteSimilarity.isIndexing()) {
+        ImGui::Text("Hashing sprites...");
+        ImGui::ProgressBar(spriteSimilarity.getIndexingProgress(), ImVec2(300, 0));
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel##SimilarIndexCancel")) {
+            spriteSimilarity.cancel();
+        }
+    } else if (ImGui::Button(spriteSimilarity.hasIndex() ? "Rebuild Index##SimilarIndexBuild" : "Build Index##SimilarIndexBuild")) {
+        spriteSimilarity.startIndexing(*assetsManager);
+    }
+
+    if (spriteSimilarity.hasIndex()) {
+        ImGui::Text("%zu sprites indexed, %zu blank skipped (%.0f ms)", spriteSimilarity.getIndexedCount(),
+                    spriteSimilarity.getBlankCount(), spriteSimilarity.getIndexingMs());
+        if (spriteSimilarity.isStale(*assetsManager)) {
+            ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "Sprites changed since, rebuild to include the changes.");
+        }
+    }
+
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderInt("Max distance##SimilarMaxDistance", &similarMaxDistance, 0, static_cast<int>(SpriteSimilarity::MAX_DISTANCE));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("How many of the 64 hash bits may differ, 0 = look the same.\nRecolors are usually within 4, 1px shifts within 10.");
+    }
+    ImGui::Separator();
+
+    if (!spriteSimilarity.hasIndex()) {
+        ImGui::TextWrapped("Build the index first, it hashes every sprite in the background.");
+        ImGui::End();
+        return;
+    }
+
+    // Only searched again once something changed
+    int selected = getSelectedSpriteIndex();
+    if (selected != similarQuerySprite || similarMaxDistance != similarQueryDistance ||
+        spriteSimilarity.getIndexVersion() != similarQueryVersion) {
+        auto start = std::chrono::steady_clock::now();
+        auto matches = selected > 0 ? spriteSimilarity.findSimilar(static_cast<uint32_t>(selected), static_cast<uint32_t>(similarMaxDistance))
+                                    : std::vector<SpriteSimilarity::Match>();
+        similarQueryMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        similarIds.clear();
+        similarDistances.clear();
+        for (const auto& match : matches) {
+            similarIds.push_back(match.spriteId);
+            similarDistances.push_back(match.distance);
+        }
+        similarQuerySprite = selected;
+        similarQueryDistance = similarMaxDistance;
+        similarQueryVersion = spriteSimilarity.getIndexVersion();
+    }
+
+    if (selected <= 0) {
+        ImGui::Text("Select a sprite to see the ones like it.");
+    } else {
+        ImGui::Text("Like sprite %d: %zu found (%.2f ms)", selected, similarIds.size(), similarQueryMs);
+    }
+    ImGui::BeginChild("SimilarSpritesResults", ImVec2(0, 180), true);
+    drawSpriteButtons("Similar", similarIds, similarDistances);
+    ImGui::EndChild();
+
+    ImGui::Separator();
+    if (spriteSimilarity.isClustering()) {
+        ImGui::Text("Grouping sprites...");
+        ImGui::ProgressBar(spriteSimilarity.getClusteringProgress(), ImVec2(300, 0));
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel##SimilarClustersCancel")) {
+            spriteSimilarity.cancel();
+        }
+    } else {
+        if (ImGui::Button("Find Groups##SimilarClustersStart")) {
+            clustersExportStatus.clear();
+            spriteSimilarity.startClustering(static_cast<uint32_t>(similarMaxDistance));
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Groups all sprites within 'Max distance' of each other");
+        }
+    }
+
+    const auto& clusters = spriteSimilarity.getClusters();
+    if (!clusters.empty()) {
+        ImGui::SameLine();
+        if (ImGui::Button("Export CSV##SimilarClustersExport")) {
+            std::string folder = Tools::openFileDialogChooseFolder();
+            if (!folder.empty()) {
+                char name[64];
+                std::time_t now = std::time(nullptr);
+                std::strftime(name, sizeof(name), "similar_sprites_%Y%m%d_%H%M%S.csv", std::localtime(&now));
+                std::string path = folder + "/" + name;
+                clustersExportStatus = spriteSimilarity.exportClustersCsv(path) ? "Exported to " + path : "Couldn't write " + path;
+            }
+        }
+
+        size_t groupedSprites = 0;
+        for (const auto& cluster : clusters) {
+            groupedSprites += cluster.size();
+        }
+        ImGui::Text("%zu groups, %zu sprites (distance %u, %.0f ms)", clusters.size(), groupedSprites,
+                    spriteSimilarity.getClustersDistance(), spriteSimilarity.getClusteringMs());
+        if (!clustersExportStatus.empty()) {
+            ImGui::TextWrapped("%s", clustersExportStatus.c_str());
+        }
+
+        ImGui::BeginChild("SimilarSpritesClusters", ImVec2(0, 0), true);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(clusters.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                ImGui::PushID(i);
+                ImGui::Text("%zu sprites:", clusters[i].size());
+                ImGui::SameLine();
+                drawSpriteButtons("Cluster", clusters[i], {});
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndChild();
+    }
+
+    ImGui::End();
+}
+
+void SpritesScrollableWindow::drawSpriteButtons(const char* idPrefix, const std::vector<uint32_t>& ids,
+                                                const std::vector<uint32_t>& distances) {
+    // Groups stay one row each (clipper), the rest is cut off
+    constexpr size_t MAX_CLUSTER_BUTTONS = 8;
+    const bool singleRow = distances.empty();
+    const ImVec2 buttonSize(32, 32);
+    const float rowWidth = ImGui::GetContentRegionAvail().x;
+    const float stride = buttonSize.x + ImGui::GetStyle().FramePadding.x * 2 + ImGui::GetStyle().ItemSpacing.x;
+    const size_t perRow = std::max<size_t>(1, static_cast<size_t>(rowWidth / stride));
+
+    size_t shown = singleRow ? std::min(ids.size(), MAX_CLUSTER_BUTTONS) : ids.size();
+    for (size_t i = 0; i < shown; ++i) {
+        const uint32_t id = ids[i];
+        if (!assetsManager->isValidTextureIndex(static_cast<int>(id))) {
+            continue; // removed since indexing
+        }
+
+        if (i > 0 && (singleRow || i % perRow != 0)) {
+            ImGui::SameLine();
+        }
+        ImGui::PushID(idPrefix);
+        ImGui::PushID(static_cast<int>(id));
+        if (ImGui::ImageButton("##SimilarSprite", assetsManager->getImGuiTexture(static_cast<int>(id)), buttonSize)) {
+            selectSprite(static_cast<int>(id));
+        }
+        ImGui::PopID();
+        ImGui::PopID();
+        if (ImGui::IsItemHovered()) {
+            if (singleRow) {
+                ImGui::SetTooltip("Sprite %u", id);
+            } else {
+                ImGui::SetTooltip("Sprite %u, distance %u", id, distances[i]);
+            }
+        }
+    }
+    if (shown < ids.size()) {
+        ImGui::SameLine();
+        ImGui::Text("+%zu", ids.size() - shown);
+    }
+}
+
+void SpritesScrollableWindow::startImageSearch() {
+    auto filePath = Tools::openFileDialog(Tools::getImageExtensions());
+    if (filePath.empty()) {
+        return;
+    }
+
+    imageSearchError.clear();
+    if (!imageSearch.start(filePath, assetsManager->getSpriteSize(), imageSearchError)) {
+        Warninger::sendWarning(FUNC_NAME, imageSearchError);
+    }
+    showImageSearch = true;
+}
+
+void SpritesScrollableWindow::drawImageSearchWindow() {
+    if (!showImageSearch) {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(520, 480), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Find by Image", &showImageSearch)) {
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Button("Open Image##ImageSearchOpen")) {
+        startImageSearch();
+    }
+    if (!imageSearchError.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "%s", imageSearchError.c_str());
+    }
+
+    if (imageSearch.isPending()) {
+        ImGui::TextWrapped("%s", imageSearch.getImagePath().c_str());
+        ImGui::Text("Hashing sprites first, %zu left...", imageSearch.getMissingHashes());
+    } else if (imageSearch.hasResults()) {
+        const auto& results = imageSearch.getResults();
+        ImGui::TextWrapped("%s", imageSearch.getImagePath().c_str());
+        ImGui::Text("%zu of %zu tiles found, %zu empty skipped (%.2f ms)", imageSearch.getFoundTiles(), results.size(),
+                    imageSearch.getEmptyTiles(), imageSearch.getLookupMs());
+
+        const auto& texture = imageSearch.getImageTexture();
+        const float tileU = static_cast<float>(imageSearch.getSpriteSize()) / static_cast<float>(texture->getSize().x);
+        const float tileV = static_cast<float>(imageSearch.getSpriteSize()) / static_cast<float>(texture->getSize().y);
+        if (ImGui::BeginTable("ImageSearchResults", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+            ImGui::TableSetupColumn("Tile", ImGuiTableColumnFlags_WidthFixed, 48.0f);
+            ImGui::TableSetupColumn("Sprites");
+            ImGui::TableSetupColumn("Items");
+            ImGui::TableHeadersRow();
+
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(results.size()));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                    const auto& result = results[i];
+                    ImGui::PushID(i);
+                    ImGui::TableNextRow();
+
+                    ImGui::TableNextColumn();
+                    ImVec2 uv0(static_cast<float>(result.x) * tileU, static_cast<float>(result.y) * tileV);
+                    ImGui::Image((ImTextureID)texture->getNativeHandle(), ImVec2(32, 32), uv0, ImVec2(uv0.x + tileU, uv0.y + tileV));
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Tile %u, %u", result.x, result.y);
+                    }
+
+                    ImGui::TableNextColumn();
+                    if (result.spriteIds.empty()) {
+                        ImGui::TextDisabled("Not found");
+                    }
+                    for (size_t n = 0; n < result.spriteIds.size(); ++n) {
+                        if (n > 0) {
+                            ImGui::SameLine();
+                        }
+                        const uint32_t spriteId = result.spriteIds[n];
+                        if (ImGui::SmallButton((std::to_string(spriteId) + "##ImageSearchSprite").c_str())) {
+                            selectSprite(static_cast<int>(spriteId));
+                        }
+                    }
+
+                    ImGui::TableNextColumn();
+                    std::string items;
+                    for (uint32_t itemId : result.itemIds) {
+                        items += (items.empty() ? "" : ", ") + std::to_string(itemId);
+                    }
+                    ImGui::TextWrapped("%s", items.empty() ? "-" : items.c_str());
+                    ImGui::PopID();
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    ImGui::End();
+}
+
+void SpritesScrollableWindow::startBatchImport(std::vector<std::string> filePaths) {
+    if (importer.isActive()) {
+        Warninger::sendWarning(FUNC_NAME, "Another import is still running.");
+        return;
+    }
+    if (filePaths.empty()) {
+        Warninger::sendWarning(FUNC_NAME, "No images to import.");
+        return;
+    }
+
+    SpriteImporter::Options options;
+    options.spriteSize = assetsManager->getSpriteSize();
+    options.sliceSheets = importSliceSheets;
+    options.skipEmptyTiles = importSkipEmptyTiles;
+
+    importedSprites = 0;
+    importErrors.clear();
+    importContinuesBatch = false;
+    importer.start(std::move(filePaths), options);
+    openImportProgress = true;
+}
+
+void SpritesScrollableWindow::updateBatchImport() {
+    if (!importer.isActive()) {
+        return;
+    }
+
+    // GPU uploads are spread over frames, so the UI keeps responding
+    auto batch = importer.takeUploadBatch(IMPORT_UPLOADS_PER_FRAME);
+    if (!batch.empty()) {
+        importedSprites += assetsManager->pushTextures(batch, importContinuesBatch);
+        importContinuesBatch = true;
+        setUnsavedChanges(true);
+    }
+
+    if (!importer.isActive()) {
+        importErrors = importer.getErrors();
+        fmt::print("Batch import done: {} sprites from {} files, {} files rejected\n",
+                   importedSprites, importer.getTotalFiles(), importErrors.size());
+        for (const auto& error : importErrors) {
+            Warninger::sendWarning(FUNC_NAME, error);
+        }
+        if (importedSprites > 0) {
+            selectSprite(static_cast<int>(assetsManager->getTextureCount()) - 1, true);
+        }
+    }
+}
+
+void SpritesScrollableWindow::drawBatchImportPopups() {
+    if (ImGui::BeginPopupModal("Batch Import Popup", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+        ImGui::Text("Folder:");
+        if (!Tools::isValidFolderPath(importFolder)) {
+            ImGui::SameLine();
+            ImGui::Text("Invalid path!");
+        }
+        ImGui::PushItemWidth(200);
+        ImGui::InputText("##importFolder", &importFolder);
+        ImGui::SameLine();
+        if (ImGui::Button("Browse##BatchImportBrowse")) {
+            std::string selectedFolder = Tools::openFileDialogChooseFolder();
+            if (!selectedFolder.empty()) {
+                importFolder = selectedFolder;
+            }
+        }
+        ImGui::PopItemWidth();
+
+        ImGui::Checkbox("Slice sprite sheets", &importSliceSheets);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Images that are a multiple of the sprite size are cut into sprites, row by row");
+        }
+        if (!importSliceSheets) {
+            ImGui::BeginDisabled();
+        }
+        ImGui::Checkbox("Skip empty tiles", &importSkipEmptyTiles);
+        if (!importSliceSheets) {
+            ImGui::EndDisabled();
+        }
+
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+
+        auto colorsCount = Tools::pushImGuiGray(!Tools::isValidFolderPath(importFolder));
+        if (ImGui::Button("Confirm##BatchImportConfirm")) {
+            if (Tools::isValidFolderPath(importFolder)) {
+                ImGui::CloseCurrentPopup();
+                startBatchImport(Tools::getImageFilesInFolder(importFolder));
+            }
+        }
+        ImGui::PopStyleColor(colorsCount);
+
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel##BatchImportCancel")) {
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndPopup();
+    }
+
+    if (openImportProgress) {
+        ImGui::OpenPopup("Importing Sprites");
+        openImportProgress = false;
+    }
+
+    if (ImGui::BeginPopupModal("Importing Sprites", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+        size_t total = importer.getTotalFiles();
+        size_t decoded = importer.getDecodedFiles();
+
+        if (importer.isActive()) {
+            float progress = total > 0 ? static_cast<float>(decoded) / static_cast<float>(total) : 1.0f;
+            ImGui::Text("Decoded %zu / %zu files, %zu sprites added", decoded, total, importedSprites);
+            ImGui::ProgressBar(progress, ImVec2(300, 0));
+
+            if (ImGui::Button("Cancel##ImportProgressCancel")) {
+                // Sprites added so far stay (one undo step), the rest is dropped
+                importer.cancel();
+                fmt::print("Batch import cancelled, {} sprites were added\n", importedSprites);
+                if (importedSprites > 0) {
+                    selectSprite(static_cast<int>(assetsManager->getTextureCount()) - 1, true);
+                }
+                ImGui::CloseCurrentPopup();
+            }
+        } else {
+            ImGui::Text("Added %zu sprites from %zu files.", importedSprites, total);
+            if (!importErrors.empty()) {
+                ImGui::Text("%zu files were rejected:", importErrors.size());
+                ImGui::BeginChild("##ImportErrors", ImVec2(400, 120), true);
+                for (const auto& error : importErrors) {
+                    ImGui::TextUnformatted(error.c_str());
+                }
+                ImGui::EndChild();
+            }
+
+            if (ImGui::Button("OK##ImportProgressOk")) {
+                ImGui::CloseCurrentPopup();
+            }
+        }
+        ImGui::EndPopup();
+    }
+}
+
 void SpritesScrollableWindow::exportTexture(Tools::EXPORT_OPTIONS option) {
     std::string filePath = (std::filesystem::path(outputFolder) / (Tools::trim(spriteName))).string() + getFormatString(option);
     assetsManager->exportTexture(filePath, getSelectedSpriteIndex());
@@ -6,6 +6,10 @@
 #include "ResourceManagers/AssetsManager.h"
 #include "Misc/tools.h"
 #include "Helper/DropManager.h"
+#include "Helper/SpriteImporter.h"
+#include "Helper/BulkExporter.h"
+#include "Helper/SpriteSimilarity.h"
+#include "Helper/SpriteImageSearch.h"
 
 
 class SpritesScrollableWindow {
@@ -26,6 +30,15 @@ public:
      * If filePath is empty, then it just adds new, blank texture.
      */
     void importTexture(const std::string& filePath);
+    /**
+     * @brief Imports many images at once, as new sprites at the end
+     *
+     * Decoding runs in the background, the textures get added over the next frames
+     * (as one undo step) while a progress popup is shown.
+     *
+     * @param filePaths images to import, sprite ids follow this order
+     */
+    void startBatchImport(std::vector<std::string> filePaths);
 
     /**
      * @brief Select a texture
@@ -126,7 +139,51 @@ private:
 
     std::string outputFolder = Tools::getDesktopPath();
     int formatSelected = 0; // 0 = PNG, 1 = BMP, 2 = JPG
+    bool exportAllSprites = false;
+    BulkExporter bulkExporter;
+    bool openExportProgress = false;
     std::string spriteName = "sprite" + std::to_string(getSelectedSpriteIndex());
 
     uint32_t rightMenuClickedSprite = 0;
+
+    // Batch import
+    static constexpr size_t IMPORT_UPLOADS_PER_FRAME = 256;
+    static constexpr size_t EXPORT_READBACKS_PER_FRAME = 256;
+    void updateBatchImport();
+    void drawBatchImportPopups();
+
+    SpriteImporter importer;
+    std::string importFolder = Tools::getDesktopPath();
+    bool importSliceSheets = true;
+    bool importSkipEmptyTiles = true;
+    bool openImportProgress = false;
+    bool importContinuesBatch = false; // following uploads extend the same undo step
+    size_t importedSprites = 0;
+    std::vector<std::string> importErrors;
+
+    // Near-duplicate sprites
+    static constexpr size_t SIMILARITY_READBACKS_PER_FRAME = 256;
+    void drawSimilarSpritesWindow();
+    // Sprite buttons in rows, clicking one selects it
+    void drawSpriteButtons(const char* idPrefix, const std::vector<uint32_t>& ids, const std::vector<uint32_t>& distances);
+
+    SpriteSimilarity spriteSimilarity;
+    bool showSimilarSprites = false;
+    int similarMaxDistance = 6;
+    int similarQuerySprite = -1;
+    int similarQueryDistance = -1;
+    uint32_t similarQueryVersion = 0;
+    float similarQueryMs = 0.0f;
+    std::vector<uint32_t> similarIds;
+    std::vector<uint32_t> similarDistances;
+    std::string clustersExportStatus;
+
+    // Find by image
+    static constexpr size_t IMAGE_SEARCH_HASHES_PER_FRAME = 512;
+    void startImageSearch();
+    void drawImageSearchWindow();
+
+    SpriteImageSearch imageSearch;
+    bool showImageSearch = false;
+    std::string imageSearchError;
 };
\ No newline at end of file
@@ -0,0 +1,729 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+#include "ItemType.h"
+#include "ThingType.h"
+#include "../Misc/BinaryReader.h"
+#include "../Misc/BinaryWriter.h"
+
+// Layout of OT .dat per protocol version.
+// Each protocol is a profile type with its flag table built at compile time,
+// and the parser gets instantiated per profile - so reading flags is a table lookup,
+// not a pile of 'if (version >= ...)' checks for every flag.
+namespace DatFormat {
+    // Flags in the order they are in 8.60. Newer protocols insert/append, never reorder.
+    enum class Flag : uint8_t {
+        Ground, GroundBorder, OnBottom, OnTop, Container, Stackable, ForceUse, MultiUse,
+        Writable, WritableOnce, FluidContainer, Fluid, Unpassable, Unmoveable, BlockMissiles, BlockPathfinder,
+        NoMoveAnimation, // 10.x+, got inserted at 0x10 moving every flag after it by one
+        Pickupable, Hangable, Horizontal, Vertical, Rotatable, HasLight, DontHide,
+        Translucent, HasOffset, HasElevation, Lying, AnimateAlways, Minimap, LensHelp, FullGround,
+        IgnoreLook, Cloth, Market, DefaultAction, Wrappable, Unwrappable, TopEffect, Usable,
+        Unknown
+    };
+
+    constexpr uint8_t LAST_FLAG = 0xFF;
+    constexpr uint8_t USABLE_FLAG = 0xFE;
+    constexpr size_t FLAG_COUNT = static_cast<size_t>(Flag::Unknown);
+
+    // Flag -> ItemTypeFlags bit. 0 for the ones that are ItemType::category instead.
+    constexpr uint64_t ITEM_FLAG_BITS[] = {
+        IS_GROUND, 0, 0, 0, IS_CONTAINER, STACKABLE, FORCE_USE, MULTI_USE,
+        WRITABLE, WRITABLE_ONCE, FLUID_CONTAINER, FLUID, UNPASSABLE, UNMOVABLE, BLOCK_MISSILE, BLOCK_PATHFINDER,
+        NO_MOVE_ANIMATION,
+        PICKUPABLE, HANGABLE, HORIZONTAL, VERTICAL, ROTATABLE, HAS_LIGHT, DONT_HIDE,
+        TRANSLUCENT, HAS_OFFSET, HAS_ELEVATION, LYING, ANIMATE_ALWAYS, MINIMAP, LENS_HELP, FULL_GROUND,
+        IGNORE_LOOK, CLOTH, MARKET, DEFAULT_ACTION, WRAPPABLE, UNWRAPPABLE, TOP_EFFECT, USABLE,
+    };
+    static_assert(sizeof(ITEM_FLAG_BITS) / sizeof(ITEM_FLAG_BITS[0]) == FLAG_COUNT, "Every flag needs its bit");
+
+    // Flags that come with data, an item having any of them gets ItemTypeAttributes
+    constexpr uint64_t ATTRIBUTE_FLAGS = WRITABLE | WRITABLE_ONCE | HAS_LIGHT | HAS_OFFSET | HAS_ELEVATION |
+                                         MINIMAP | LENS_HELP | CLOTH | MARKET | DEFAULT_ACTION;
+
+    // async + loop count + start phase, then min/max duration for each frame
+    constexpr size_t frameDurationsSize(uint8_t frames) {
+        return 6 + 8 * static_cast<size_t>(frames);
+    }
+
+    // .dat byte -> Flag
+    constexpr std::array<Flag, 256> makeFlagTable(bool hasNoMoveAnimation) {
+        std::array<Flag, 256> table{};
+        for (size_t i = 0; i < table.size(); ++i) {
+            table[i] = Flag::Unknown;
+        }
+
+        // Sequential up to TopEffect, Usable only ever comes as USABLE_FLAG
+        size_t byte = 0;
+        for (uint8_t f = 0; f <= static_cast<uint8_t>(Flag::TopEffect); ++f) {
+            auto flag = static_cast<Flag>(f);
+            if (flag == Flag::NoMoveAnimation && !hasNoMoveAnimation) {
+                continue;
+            }
+            table[byte++] = flag;
+        }
+        table[USABLE_FLAG] = Flag::Usable;
+        return table;
+    }
+
+    // Flag -> .dat byte (reverse of the flag table), LAST_FLAG when the profile doesn't have the flag.
+    // Usable is always written as USABLE_FLAG.
+    constexpr std::array<uint8_t, FLAG_COUNT> makeByteTable(const std::array<Flag, 256>& flags) {
+        std::array<uint8_t, FLAG_COUNT> bytes{};
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            bytes[i] = LAST_FLAG;
+        }
+
+        for (size_t byte = 0; byte < USABLE_FLAG; ++byte) {
+            auto f = static_cast<size_t>(flags[byte]);
+            if (f < FLAG_COUNT && bytes[f] == LAST_FLAG) {
+                bytes[f] = static_cast<uint8_t>(byte);
+            }
+        }
+        bytes[static_cast<size_t>(Flag::Usable)] = USABLE_FLAG;
+        return bytes;
+    }
+
+    struct Profile860 {
+        static constexpr const char* NAME = "8.60";
+        static constexpr uint32_t SIGNATURE = 0x4C2C7993;
+        static constexpr auto FLAGS = makeFlagTable(false);
+        static constexpr auto FLAG_BYTES = makeByteTable(FLAGS);
+        static_assert(FLAGS[0x26] == Flag::Unknown, "Usable only maps at USABLE_FLAG");
+    };
+
+    struct Profile1098 {
+        static constexpr const char* NAME = "10.98";
+        static constexpr uint32_t SIGNATURE = 0x42A3;
+        static constexpr auto FLAGS = makeFlagTable(true);
+        static constexpr auto FLAG_BYTES = makeByteTable(FLAGS);
+        static_assert(FLAGS[0x27] == Flag::Unknown, "Usable only maps at USABLE_FLAG");
+    };
+
+    // Index of the profile, it is what AssetsInfo::versionIndex stores
+    enum ProfileId : uint8_t {
+        PROFILE_860 = 0,
+        PROFILE_1098,
+        PROFILE_COUNT
+    };
+
+    inline constexpr const char* PROFILE_NAMES[PROFILE_COUNT] = {Profile860::NAME, Profile1098::NAME};
+
+    // Returns profile with the given signature, or -1 if none has it
+    constexpr int detectProfile(uint32_t signature) {
+        if (signature == Profile860::SIGNATURE) return PROFILE_860;
+        if (signature == Profile1098::SIGNATURE) return PROFILE_1098;
+        return -1;
+    }
+
+    // The one place where the profile picked at runtime turns into a type.
+    // f gets called with a default constructed profile, e.g. [](auto profile) { using P = decltype(profile); }
+    template<typename F>
+    decltype(auto) withProfile(int profileId, F&& f) {
+        switch (profileId) {
+            case PROFILE_1098:
+                return f(Profile1098{});
+            case PROFILE_860:
+            default:
+                return f(Profile860{});
+        }
+    }
+
+    struct Header {
+        uint32_t signature = 0;
+        uint16_t itemCount = 0; // last item id, items start from 100
+        uint16_t outfitCount = 0;
+        uint16_t effectCount = 0;
+        uint16_t missileCount = 0;
+    };
+
+    inline Header readHeader(BinaryReader& reader) {
+        Header header;
+        header.signature = reader.readU32();
+        header.itemCount = reader.readU16();
+        header.outfitCount = reader.readU16();
+        header.effectCount = reader.readU16();
+        header.missileCount = reader.readU16();
+        return header;
+    }
+
+    struct ParseOptions {
+        bool extended = false;       // u32 sprite ids instead of u16
+        bool frameDurations = false; // animated things have per-frame durations
+        bool frameGroups = false;    // outfits have idle/moving groups
+    };
+
+    /**
+     * @brief Reads flags of a single thing, up to and including LAST_FLAG
+     *
+     * With itemType every flag ends up in its flags (or category), and their data in 'attributes'.
+     * Without it (outfits etc.) it only walks over them.
+     */
+    template<typename Profile>
+    bool parseFlags(BinaryReader& reader, ItemType* itemType, ItemTypeAttributes* attributes, std::string& error) {
+        ItemTypeAttributes unused;
+        ItemTypeAttributes& out = attributes ? *attributes : unused;
+
+        while (true) {
+            uint8_t byte = reader.readU8();
+            if (byte == LAST_FLAG || reader.overflowed()) {
+                return !reader.overflowed();
+            }
+
+            const Flag flag = Profile::FLAGS[byte];
+            if (flag == Flag::Unknown) {
+                char hex[8];
+                std::snprintf(hex, sizeof(hex), "0x%02X", byte);
+                error = std::string("Unknown flag ") + hex + " for " + Profile::NAME;
+                return false;
+            }
+
+            if (itemType) {
+                switch (flag) {
+                    case Flag::GroundBorder: itemType->category = GROUND_BORDER; break;
+                    case Flag::OnBottom: itemType->category = BOTTOM; break;
+                    case Flag::OnTop: itemType->category = TOP; break;
+                    default:
+                        itemType->setFlag(static_cast<ItemTypeFlags>(ITEM_FLAG_BITS[static_cast<size_t>(flag)]), true);
+                        break;
+                }
+            }
+
+            switch (flag) {
+                case Flag::Ground: {
+                    uint16_t speed = reader.readU16();
+                    if (itemType) itemType->speed = speed;
+                    break;
+                }
+                case Flag::Writable:
+                    out.writableLength = reader.readU16();
+                    break;
+                case Flag::WritableOnce:
+                    out.writableOnceLength = reader.readU16();
+                    break;
+                case Flag::HasLight:
+                    out.lightLevel = reader.readU16();
+                    out.lightColor = reader.readU16();
+                    break;
+                case Flag::HasOffset:
+                    out.offsetX = reader.readU16();
+                    out.offsetY = reader.readU16();
+                    break;
+                case Flag::HasElevation:
+                    out.elevation = reader.readU16();
+                    break;
+                case Flag::Minimap:
+                    out.minimapColor = reader.readU16();
+                    break;
+                case Flag::LensHelp:
+                    out.lensHelp = reader.readU16();
+                    break;
+                case Flag::Cloth:
+                    out.clothSlot = reader.readU16();
+                    break;
+                case Flag::Market: {
+                    out.marketCategory = reader.readU16();
+                    out.marketTradeAs = reader.readU16();
+                    out.marketShowAs = reader.readU16();
+                    uint16_t nameLength = reader.readU16();
+                    if (itemType) {
+                        itemType->name = reader.readString(nameLength);
+                    } else {
+                        reader.skip(nameLength);
+                    }
+                    out.marketRestrictVocation = reader.readU16();
+                    out.marketRequiredLevel = reader.readU16();
+                    break;
+                }
+                case Flag::DefaultAction:
+                    out.defaultAction = reader.readU16();
+                    break;
+                default:
+                    // Flags without any data
+                    break;
+            }
+        }
+    }
+
+    // False (and the reader marked as overflowed) if that many sprite ids can't be in what's left of the data.
+    // Checked before anything gets allocated - the count of a record read with the wrong profile can be in the billions.
+    inline bool fitsSpriteIds(BinaryReader& reader, uint64_t count, size_t idSize) {
+        if (count * idSize > reader.remaining()) {
+            reader.skip(reader.remaining() + 1);
+            return false;
+        }
+        return true;
+    }
+
+    template<typename SpriteId>
+    void readSpriteIds(BinaryReader& reader, ItemType& itemType, uint64_t count) {
+        if (!fitsSpriteIds(reader, count, sizeof(SpriteId))) {
+            return;
+        }
+        itemType.textureIdsVector.resize(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            itemType.textureIdsVector[i] = reader.read<SpriteId>();
+        }
+    }
+
+    // Dimensions, patterns, animation and sprite ids that follow the flags
+    inline void parseTexturesInfo(BinaryReader& reader, ItemType& itemType, ItemTypeAttributes& attributes,
+                                  const ParseOptions& options) {
+        itemType.width = reader.readU8();
+        itemType.height = reader.readU8();
+        if (itemType.width > 1 || itemType.height > 1) {
+            itemType.exactSize = reader.readU8();
+        }
+
+        itemType.layers = reader.readU8();
+        itemType.patternX = reader.readU8();
+        itemType.patternY = reader.readU8();
+        itemType.patternZ = reader.readU8();
+        itemType.animationsFrames = reader.readU8();
+
+        if (itemType.animationsFrames > 1 && options.frameDurations) {
+            size_t animationSize = frameDurationsSize(itemType.animationsFrames);
+            const uint8_t* animation = reader.current();
+            reader.skip(animationSize);
+            if (!reader.overflowed()) {
+                attributes.frameDurations.assign(animation, animation + animationSize);
+            }
+        }
+
+        // 64 bit, seven u8 factors don't always fit in 32
+        uint64_t numSprites = static_cast<uint64_t>(itemType.width) * itemType.height * itemType.layers *
+                              itemType.patternX * itemType.patternY * itemType.patternZ *
+                              itemType.animationsFrames;
+
+        if (options.extended) {
+            readSpriteIds<uint32_t>(reader, itemType, numSprites);
+        } else {
+            readSpriteIds<uint16_t>(reader, itemType, numSprites);
+        }
+    }
+
+    /**
+     * @brief Reads all items of the .dat (reader has to be right after the header)
+     *
+     * makeItem() -> std::shared_ptr<ItemType> gives the ItemType to fill,
+     * storeItem(std::shared_ptr<ItemType>) gets it once it's read. Trial parses
+     * (profile detection) just hand out the same scratch ItemType and store nothing.
+     * Only items that have any flag data or frame durations get ItemTypeAttributes.
+     *
+     * @return False with 'error' set, if there's a flag the profile doesn't know or the data ends early.
+     */
+    template<typename Profile, typename MakeItem, typename StoreItem>
+    bool parseItems(BinaryReader& reader, const Header& header, const ParseOptions& options,
+                    MakeItem&& makeItem, StoreItem&& storeItem, std::string& error) {
+        ItemTypeAttributes attributes; // scratch, copied over to the items that need it
+        for (uint32_t id = 100; id <= header.itemCount; ++id) {
+            std::shared_ptr<ItemType> itemType = makeItem();
+            attributes.reset();
+
+            if (!parseFlags<Profile>(reader, itemType.get(), &attributes, error)) {
+                if (error.empty()) {
+                    error = "Data ends in flags of item " + std::to_string(id);
+                } else {
+                    error += " at item " + std::to_string(id);
+                }
+                return false;
+            }
+
+            parseTexturesInfo(reader, *itemType, attributes, options);
+            if (reader.overflowed()) {
+                error = "Data ends in sprites of item " + std::to_string(id);
+                return false;
+            }
+
+            if ((itemType->getAllFlags() & ATTRIBUTE_FLAGS) || !attributes.frameDurations.empty()) {
+                itemType->setAttributes(attributes);
+            }
+
+            storeItem(std::move(itemType));
+        }
+        return true;
+    }
+
+    // One frame group (or the only sprites layout of effects/missiles) into thingType
+    inline void parseFrameGroup(BinaryReader& reader, ThingType& thingType, const ParseOptions& options, uint8_t groupType) {
+        FrameGroup group;
+        group.type = groupType;
+        group.width = reader.readU8();
+        group.height = reader.readU8();
+        if (group.width > 1 || group.height > 1) {
+            group.exactSize = reader.readU8();
+        }
+
+        group.layers = reader.readU8();
+        group.patternX = reader.readU8();
+        group.patternY = reader.readU8();
+        group.patternZ = reader.readU8();
+        group.animationsFrames = reader.readU8();
+
+        if (group.animationsFrames > 1 && options.frameDurations) {
+            size_t animationSize = frameDurationsSize(group.animationsFrames);
+            const uint8_t* animation = reader.current();
+            reader.skip(animationSize);
+            if (!reader.overflowed()) {
+                group.animationOffset = static_cast<uint32_t>(thingType.animationData.size());
+                group.animationSize = static_cast<uint16_t>(animationSize);
+                thingType.animationData.insert(thingType.animationData.end(), animation, animation + animationSize);
+            }
+        }
+
+        uint64_t count = static_cast<uint64_t>(group.width) * group.height * group.layers *
+                         group.patternX * group.patternY * group.patternZ * group.animationsFrames;
+        if (!fitsSpriteIds(reader, count, options.extended ? sizeof(uint32_t) : sizeof(uint16_t))) {
+            return;
+        }
+        group.firstTextureId = static_cast<uint32_t>(thingType.textureIds.size());
+        thingType.textureIds.resize(thingType.textureIds.size() + count);
+        uint32_t* ids = thingType.textureIds.data() + group.firstTextureId;
+        if (options.extended) {
+            for (uint64_t i = 0; i < count; ++i) ids[i] = reader.read<uint32_t>();
+        } else {
+            for (uint64_t i = 0; i < count; ++i) ids[i] = reader.read<uint16_t>();
+        }
+
+        thingType.frameGroups.push_back(group);
+    }
+
+    /**
+     * @brief Reads outfits, effects or missiles (whichever comes next in the reader)
+     *
+     * Flags are kept as raw bytes, sprites layout gets parsed into frame groups.
+     * Only outfits have frame groups in .dat, the rest always has a single one.
+     *
+     * @return False with 'error' set, same as parseItems().
+     */
+    template<typename Profile, typename MakeThing, typename StoreThing>
+    bool parseThings(BinaryReader& reader, ThingCategory_t category, uint16_t count, const ParseOptions& options,
+                     MakeThing&& makeThing, StoreThing&& storeThing, std::string& error) {
+        static const char* const CATEGORY_NAMES[] = {"item", "outfit", "effect", "missile"};
+
+        for (uint32_t id = 1; id <= count; ++id) {
+            std::shared_ptr<ThingType> thingType = makeThing();
+            thingType->id = static_cast<uint16_t>(id);
+
+            const uint8_t* flagsStart = reader.current();
+            size_t flagsStartPos = reader.tell();
+            if (!parseFlags<Profile>(reader, nullptr, nullptr, error)) {
+                if (error.empty()) {
+                    error = "Data ends in flags of ";
+                } else {
+                    error += " at ";
+                }
+                error += std::string(CATEGORY_NAMES[category]) + " " + std::to_string(id);
+                return false;
+            }
+            // Everything but the closing LAST_FLAG
+            thingType->flagData.assign(flagsStart, flagsStart + (reader.tell() - flagsStartPos - 1));
+
+            uint8_t groupCount = 1;
+            if (category == THING_OUTFIT && options.frameGroups) {
+                groupCount = reader.readU8();
+            }
+            for (uint8_t g = 0; g < groupCount; ++g) {
+                uint8_t groupType = FRAME_GROUP_IDLE;
+                if (category == THING_OUTFIT && options.frameGroups) {
+                    groupType = reader.readU8();
+                }
+                parseFrameGroup(reader, *thingType, options, groupType);
+            }
+
+            if (reader.overflowed()) {
+                error = "Data ends in sprites of " + std::string(CATEGORY_NAMES[category]) + " " + std::to_string(id);
+                return false;
+            }
+            storeThing(std::move(thingType));
+        }
+        return true;
+    }
+
+    inline void writeHeader(BinaryWriter& writer, const Header& header) {
+        writer.writeU32(header.signature);
+        writer.writeU16(header.itemCount);
+        writer.writeU16(header.outfitCount);
+        writer.writeU16(header.effectCount);
+        writer.writeU16(header.missileCount);
+    }
+
+    inline bool hasItemFlag(const ItemType& itemType, Flag flag) {
+        switch (flag) {
+            case Flag::GroundBorder: return itemType.category == GROUND_BORDER;
+            case Flag::OnBottom: return itemType.category == BOTTOM;
+            case Flag::OnTop: return itemType.category == TOP;
+            default: return (itemType.getAllFlags() & ITEM_FLAG_BITS[static_cast<size_t>(flag)]) != 0;
+        }
+    }
+
+    /**
+     * @brief Writes flags of an item in the order of the profile, LAST_FLAG included
+     *
+     * Flags the profile doesn't have are left out, missing attributes are written as zeroes.
+     */
+    template<typename Profile>
+    void writeFlags(BinaryWriter& writer, const ItemType& itemType) {
+        static const ItemTypeAttributes none;
+        const ItemTypeAttributes& in = itemType.getAttributes() ? *itemType.getAttributes() : none;
+
+        for (size_t f = 0; f < FLAG_COUNT; ++f) {
+            const auto flag = static_cast<Flag>(f);
+            const uint8_t byte = Profile::FLAG_BYTES[f];
+            if (byte == LAST_FLAG || !hasItemFlag(itemType, flag)) {
+                continue;
+            }
+
+            writer.writeU8(byte);
+            switch (flag) {
+                case Flag::Ground:
+                    writer.writeU16(itemType.speed);
+                    break;
+                case Flag::Writable:
+                    writer.writeU16(in.writableLength);
+                    break;
+                case Flag::WritableOnce:
+                    writer.writeU16(in.writableOnceLength);
+                    break;
+                case Flag::HasLight:
+                    writer.writeU16(in.lightLevel);
+                    writer.writeU16(in.lightColor);
+                    break;
+                case Flag::HasOffset:
+                    writer.writeU16(in.offsetX);
+                    writer.writeU16(in.offsetY);
+                    break;
+                case Flag::HasElevation:
+                    writer.writeU16(in.elevation);
+                    break;
+                case Flag::Minimap:
+                    writer.writeU16(in.minimapColor);
+                    break;
+                case Flag::LensHelp:
+                    writer.writeU16(in.lensHelp);
+                    break;
+                case Flag::Cloth:
+                    writer.writeU16(in.clothSlot);
+                    break;
+                case Flag::Market: {
+                    writer.writeU16(in.marketCategory);
+                    writer.writeU16(in.marketTradeAs);
+                    writer.writeU16(in.marketShowAs);
+                    size_t nameLength = std::min<size_t>(itemType.name.size(), 0xFFFF);
+                    writer.writeU16(static_cast<uint16_t>(nameLength));
+                    writer.writeBytes(reinterpret_cast<const uint8_t*>(itemType.name.data()), nameLength);
+                    writer.writeU16(in.marketRestrictVocation);
+                    writer.writeU16(in.marketRequiredLevel);
+                    break;
+                }
+                case Flag::DefaultAction:
+                    writer.writeU16(in.defaultAction);
+                    break;
+                default:
+                    break;
+            }
+        }
+        writer.writeU8(LAST_FLAG);
+    }
+
+    // Stored durations if they still match the frame count, otherwise default ones
+    // (thing got more frames since loading, or the source .dat didn't have durations)
+    inline void writeFrameDurations(BinaryWriter& writer, const uint8_t* data, size_t size, uint8_t frames) {
+        constexpr uint32_t DEFAULT_FRAME_DURATION = 500; // ms
+
+        if (data && size == frameDurationsSize(frames)) {
+            writer.writeBytes(data, size);
+            return;
+        }
+
+        writer.writeU8(1);          // async
+        writer.write<int32_t>(0);   // loop count, 0 = forever
+        writer.write<int8_t>(0);    // start phase
+        for (uint8_t i = 0; i < frames; ++i) {
+            writer.writeU32(DEFAULT_FRAME_DURATION); // min
+            writer.writeU32(DEFAULT_FRAME_DURATION); // max
+        }
+    }
+
+    // Missing ids (vector shorter than the layout) are written as 0.
+    // False if an id doesn't fit SpriteId.
+    template<typename SpriteId>
+    bool writeSpriteIds(BinaryWriter& writer, const uint32_t* ids, size_t available, uint32_t count) {
+        bool fits = true;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t id = i < available ? ids[i] : 0;
+            fits &= id <= std::numeric_limits<SpriteId>::max();
+            writer.write(static_cast<SpriteId>(id));
+        }
+        return fits;
+    }
+
+    inline bool writeSpriteIds(BinaryWriter& writer, const uint32_t* ids, size_t available, uint32_t count,
+                               const ParseOptions& options) {
+        if (options.extended) {
+            return writeSpriteIds<uint32_t>(writer, ids, available, count);
+        }
+        return writeSpriteIds<uint16_t>(writer, ids, available, count);
+    }
+
+    // Counterpart of parseTexturesInfo()
+    inline bool writeTexturesInfo(BinaryWriter& writer, const ItemType& itemType, const ParseOptions& options) {
+        writer.writeU8(itemType.width);
+        writer.writeU8(itemType.height);
+        if (itemType.width > 1 || itemType.height > 1) {
+            writer.writeU8(itemType.exactSize);
+        }
+
+        writer.writeU8(itemType.layers);
+        writer.writeU8(itemType.patternX);
+        writer.writeU8(itemType.patternY);
+        writer.writeU8(itemType.patternZ);
+        writer.writeU8(itemType.animationsFrames);
+
+        if (itemType.animationsFrames > 1 && options.frameDurations) {
+            const ItemTypeAttributes* attributes = itemType.getAttributes();
+            writeFrameDurations(writer, attributes ? attributes->frameDurations.data() : nullptr,
+                                attributes ? attributes->frameDurations.size() : 0, itemType.animationsFrames);
+        }
+
+        // 64 bit, seven u8 factors don't always fit in 32
+        uint64_t numSprites = static_cast<uint64_t>(itemType.width) * itemType.height * itemType.layers *
+                              itemType.patternX * itemType.patternY * itemType.patternZ *
+                              itemType.animationsFrames;
+        return writeSpriteIds(writer, itemType.textureIdsVector.data(), itemType.textureIdsVector.size(),
+                              numSprites, options);
+    }
+
+    /**
+     * @brief Writes items from id 100 on, counterpart of parseItems()
+     *
+     * Removed items (nullptr) are written as empty ones, so the ids after them stay the same.
+     *
+     * @return False with 'error' set, if a sprite id doesn't fit the .dat (u16 without extended).
+     */
+    template<typename Profile>
+    bool writeItems(BinaryWriter& writer, const std::vector<std::shared_ptr<ItemType>>& items,
+                    const ParseOptions& options, std::string& error) {
+        const ItemType empty;
+        for (size_t i = 0; i < items.size(); ++i) {
+            const ItemType& itemType = items[i] ? *items[i] : empty;
+            writeFlags<Profile>(writer, itemType);
+            if (!writeTexturesInfo(writer, itemType, options)) {
+                error = "Sprite id too big for non-extended .dat in item " + std::to_string(i + 100);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Counterpart of parseFrameGroup()
+    inline bool writeFrameGroup(BinaryWriter& writer, const ThingType& thingType, const FrameGroup& group,
+                                const ParseOptions& options) {
+        writer.writeU8(group.width);
+        writer.writeU8(group.height);
+        if (group.width > 1 || group.height > 1) {
+            writer.writeU8(group.exactSize);
+        }
+
+        writer.writeU8(group.layers);
+        writer.writeU8(group.patternX);
+        writer.writeU8(group.patternY);
+        writer.writeU8(group.patternZ);
+        writer.writeU8(group.animationsFrames);
+
+        if (group.animationsFrames > 1 && options.frameDurations) {
+            bool stored = group.animationSize > 0 &&
+                          group.animationOffset + group.animationSize <= thingType.animationData.size();
+            writeFrameDurations(writer, stored ? thingType.animationData.data() + group.animationOffset : nullptr,
+                                stored ? group.animationSize : 0, group.animationsFrames);
+        }
+
+        uint32_t count = group.getTextureCount();
+        size_t available = thingType.textureIds.size() > group.firstTextureId ?
+                           thingType.textureIds.size() - group.firstTextureId : 0;
+        const uint32_t* ids = available > 0 ? thingType.textureIds.data() + group.firstTextureId : nullptr;
+        return writeSpriteIds(writer, ids, available, count, options);
+    }
+
+    /**
+     * @brief Writes outfits, effects or missiles, counterpart of parseThings()
+     *
+     * Flags go back as the raw bytes they were read from.
+     * Without frameGroups only the first frame group of an outfit is written.
+     */
+    inline bool writeThings(BinaryWriter& writer, ThingCategory_t category,
+                            const std::vector<std::shared_ptr<ThingType>>& things,
+                            const ParseOptions& options, std::string& error) {
+        static const char* const CATEGORY_NAMES[] = {"item", "outfit", "effect", "missile"};
+        const bool withGroups = category == THING_OUTFIT && options.frameGroups;
+
+        for (const auto& thingType : things) {
+            writer.writeBytes(thingType->flagData.data(), thingType->flagData.size());
+            writer.writeU8(LAST_FLAG);
+
+            // A thing without any group still gets an empty one, so the file stays readable
+            const FrameGroup emptyGroup;
+            const bool hasGroups = !thingType->frameGroups.empty();
+            size_t groupCount = hasGroups ? std::min<size_t>(thingType->frameGroups.size(), withGroups ? 0xFF : 1) : 1;
+            if (withGroups) {
+                writer.writeU8(static_cast<uint8_t>(groupCount));
+            }
+
+            bool fits = true;
+            for (size_t g = 0; g < groupCount; ++g) {
+                const FrameGroup& group = hasGroups ? thingType->frameGroups[g] : emptyGroup;
+                if (withGroups) {
+                    writer.writeU8(group.type);
+                }
+                fits &= writeFrameGroup(writer, *thingType, group, options);
+            }
+
+            if (!fits) {
+                error = "Sprite id too big for non-extended .dat in " + std::string(CATEGORY_NAMES[category]) +
+                        " " + std::to_string(thingType->id);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Finds the profile for the .dat
+     *
+     * Known signature decides right away. Otherwise every profile gets a dry run
+     * through all the items, and the first one that reads them without problems wins.
+     *
+     * @return Profile id, or -1 if none fits.
+     */
+    inline int findProfile(const uint8_t* data, size_t size, const ParseOptions& options) {
+        BinaryReader reader(data, size);
+        Header header = readHeader(reader);
+        int profileId = detectProfile(header.signature);
+        if (profileId >= 0) {
+            return profileId;
+        }
+
+        auto scratch = std::make_shared<ItemType>();
+        for (int id = 0; id < PROFILE_COUNT; ++id) {
+            BinaryReader trialReader = reader;
+            std::string error;
+            bool parsed = withProfile(id, [&](auto profile) {
+                using P = decltype(profile);
+                return parseItems<P>(trialReader, header, options,
+                                     [&]() { return scratch; },
+                                     [](std::shared_ptr<ItemType>) {},
+                                     error);
+            });
+            if (parsed) {
+                return id;
+            }
+        }
+        return -1;
+    }
+}
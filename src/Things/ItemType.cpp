@@ -1,10 +1,49 @@
 #include "ItemType.h"
+#include <algorithm>
 
 ItemType::ItemType() {
     textureIdsVector.reserve(6);
     textureIdsVector.push_back(0);
 }
 
+ItemType::ItemType(std::pmr::memory_resource* resource)
+: textureIdsVector(resource) {
+}
+
+ItemType::ItemType(const ItemType& other)
+: name(other.name), speed(other.speed), category(other.category), textureIdsVector(other.textureIdsVector),
+  width(other.width), height(other.height), animationsFrames(other.animationsFrames),
+  patternX(other.patternX), patternY(other.patternY), patternZ(other.patternZ), layers(other.layers),
+  exactSize(other.exactSize), itemTypeFlags(other.itemTypeFlags) {
+    if (other.attributes) {
+        attributes = std::make_shared<ItemTypeAttributes>(*other.attributes);
+    }
+}
+
+ItemTypeAttributes& ItemType::editAttributes() {
+    if (!attributes) {
+        setAttributes(ItemTypeAttributes());
+    }
+    return *attributes;
+}
+
+void ItemType::setAttributes(const ItemTypeAttributes& values) {
+    std::pmr::memory_resource* resource = textureIdsVector.get_allocator().resource();
+    if (!attributes || attributes->frameDurations.get_allocator().resource() != resource) {
+        // Same as ItemType itself, arena ItemTypes get their attributes from the arena
+        attributes = std::allocate_shared<ItemTypeAttributes>(
+                std::pmr::polymorphic_allocator<ItemTypeAttributes>(resource), resource);
+    }
+    *attributes = values;
+}
+
+bool ItemType::sameAttributes(const ItemTypeAttributes* other) const {
+    if (!attributes || !other) {
+        return attributes.get() == other;
+    }
+    return *attributes == *other;
+}
+
 void ItemType::setItemTypeWidth(int _width) {
     int oldWidth = this->width;
     this->width = _width;
@@ -17,12 +56,38 @@ void ItemType::onItemTypeWidthChanged(int oldWith, int newWidth) {
         return;
     }
 
-    int total = getCalcIndexesCount();
-    this->textureIdsVector.resize(total, 0);
+    relayoutSprites(oldWith, height, animationsFrames);
 }
 
 int ItemType::getCalcIndexesCount() const {
-    return width * height * animationsFrames;
+    return width * height * layers * patternX * patternY * patternZ * animationsFrames;
+}
+
+void ItemType::relayoutSprites(int oldWidth, int oldHeight, int oldFrames) {
+    std::pmr::vector<uint32_t> ids(static_cast<size_t>(getCalcIndexesCount()), 0, textureIdsVector.get_allocator());
+    const int keptWidth = std::min<int>(oldWidth, width);
+    const int keptHeight = std::min<int>(oldHeight, height);
+    const int keptFrames = std::min<int>(oldFrames, animationsFrames);
+    for (int frame = 0; frame < keptFrames; ++frame) {
+        for (int z = 0; z < patternZ; ++z) {
+            for (int y = 0; y < patternY; ++y) {
+                for (int x = 0; x < patternX; ++x) {
+                    for (int layer = 0; layer < layers; ++layer) {
+                        for (int h = 0; h < keptHeight; ++h) {
+                            for (int w = 0; w < keptWidth; ++w) {
+                                size_t from = getSpriteIndex(oldWidth, oldHeight, layers, patternX, patternY, patternZ,
+                                                             w, h, frame, layer, x, y, z);
+                                if (from < textureIdsVector.size()) {
+                                    ids[getSpriteIndex(w, h, frame, layer, x, y, z)] = textureIdsVector[from];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    textureIdsVector = std::move(ids);
 }
 
 void ItemType::setItemTypeHeight(int _height) {
@@ -37,8 +102,7 @@ void ItemType::onItemTypeHeightChanged(int oldHeight, int height) {
         return;
     }
 
-    int total = getCalcIndexesCount();
-    this->textureIdsVector.resize(total, 0);
+    relayoutSprites(width, oldHeight, animationsFrames);
 }
 
 void ItemType::setItemTypeAnimationCount(int count) {
@@ -53,6 +117,5 @@ void ItemType::onItemTypeAnimationFramesChanged(int oldAnimationCount, int anima
         return;
     }
 
-    int total = getCalcIndexesCount();
-    this->textureIdsVector.resize(total, 0);
+    relayoutSprites(width, height, oldAnimationCount);
 }
\ No newline at end of file
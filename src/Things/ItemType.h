@@ -1,8 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
+#include <memory_resource>
 
 enum ItemCategory_t {
 	COMMON = 0,
@@ -35,30 +37,120 @@ enum SlotType_t
 	SLOT_LAST = SLOT_AMMO
 };
 
-enum ItemTypeFlags : uint32_t {
-    IS_GROUND      = 1 << 0,
-    IS_CONTAINER   = 1 << 1,
-    STACKABLE      = 1 << 2,
-    FORCE_USE      = 1 << 3,
-    MULTI_USE      = 1 << 4,
-    UNPASSABLE     = 1 << 5,
-    UNMOVABLE      = 1 << 6,
-    PICKUPABLE     = 1 << 7,
-    BLOCK_MISSILE  = 1 << 8,
+enum ItemTypeFlags : uint64_t {
+    IS_GROUND         = 1ull << 0,
+    IS_CONTAINER      = 1ull << 1,
+    STACKABLE         = 1ull << 2,
+    FORCE_USE         = 1ull << 3,
+    MULTI_USE         = 1ull << 4,
+    UNPASSABLE        = 1ull << 5,
+    UNMOVABLE         = 1ull << 6,
+    PICKUPABLE        = 1ull << 7,
+    BLOCK_MISSILE     = 1ull << 8,
+    // Rest of the .dat flags. The ones with data keep it in ItemTypeAttributes.
+    WRITABLE          = 1ull << 9,
+    WRITABLE_ONCE     = 1ull << 10,
+    FLUID_CONTAINER   = 1ull << 11,
+    FLUID             = 1ull << 12,
+    BLOCK_PATHFINDER  = 1ull << 13,
+    NO_MOVE_ANIMATION = 1ull << 14,
+    HANGABLE          = 1ull << 15,
+    HORIZONTAL        = 1ull << 16,
+    VERTICAL          = 1ull << 17,
+    ROTATABLE         = 1ull << 18,
+    HAS_LIGHT         = 1ull << 19,
+    DONT_HIDE         = 1ull << 20,
+    TRANSLUCENT       = 1ull << 21,
+    HAS_OFFSET        = 1ull << 22,
+    HAS_ELEVATION     = 1ull << 23,
+    LYING             = 1ull << 24,
+    ANIMATE_ALWAYS    = 1ull << 25,
+    MINIMAP           = 1ull << 26,
+    LENS_HELP         = 1ull << 27,
+    FULL_GROUND       = 1ull << 28,
+    IGNORE_LOOK       = 1ull << 29,
+    CLOTH             = 1ull << 30,
+    MARKET            = 1ull << 31,
+    DEFAULT_ACTION    = 1ull << 32,
+    WRAPPABLE         = 1ull << 33,
+    UNWRAPPABLE       = 1ull << 34,
+    TOP_EFFECT        = 1ull << 35,
+    USABLE            = 1ull << 36,
+};
+
+// Optional data of .dat flags. Most items have none of it, so it's a separate block
+// that ItemType only points to when there's something to keep.
+// Market name is ItemType::name, ground speed is ItemType::speed.
+struct ItemTypeAttributes {
+    explicit ItemTypeAttributes(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : frameDurations(resource) {}
+    ItemTypeAttributes(const ItemTypeAttributes&) = default;
+    ItemTypeAttributes& operator=(const ItemTypeAttributes&) = default;
+
+    uint16_t writableLength = 0;     // WRITABLE, max text length
+    uint16_t writableOnceLength = 0; // WRITABLE_ONCE
+    uint16_t lightLevel = 0;
+    uint16_t lightColor = 0;
+    uint16_t offsetX = 0;
+    uint16_t offsetY = 0;
+    uint16_t elevation = 0;
+    uint16_t minimapColor = 0;
+    uint16_t lensHelp = 0;
+    uint16_t clothSlot = 0;
+    uint16_t defaultAction = 0;
+
+    uint16_t marketCategory = 0;
+    uint16_t marketTradeAs = 0;
+    uint16_t marketShowAs = 0;
+    uint16_t marketRestrictVocation = 0;
+    uint16_t marketRequiredLevel = 0;
+
+    // As it is in .dat: async, loop count, start phase, then min/max duration of every frame
+    std::pmr::vector<uint8_t> frameDurations;
+
+    // Back to nothing, but keeps the capacity (used as scratch by the loader)
+    void reset() {
+        auto durations = std::move(frameDurations);
+        durations.clear();
+        *this = ItemTypeAttributes(durations.get_allocator().resource());
+        frameDurations = std::move(durations);
+    }
+
+    bool operator==(const ItemTypeAttributes& other) const {
+        return writableLength == other.writableLength && writableOnceLength == other.writableOnceLength &&
+               lightLevel == other.lightLevel && lightColor == other.lightColor &&
+               offsetX == other.offsetX && offsetY == other.offsetY &&
+               elevation == other.elevation && minimapColor == other.minimapColor &&
+               lensHelp == other.lensHelp && clothSlot == other.clothSlot &&
+               defaultAction == other.defaultAction &&
+               marketCategory == other.marketCategory && marketTradeAs == other.marketTradeAs &&
+               marketShowAs == other.marketShowAs && marketRestrictVocation == other.marketRestrictVocation &&
+               marketRequiredLevel == other.marketRequiredLevel &&
+               frameDurations == other.frameDurations;
+    }
+
+    bool operator!=(const ItemTypeAttributes& other) const {
+        return !(*this == other);
+    }
 };
 
 class ItemType
 {
 public:
     ItemType();
+    // Used by bulk loading (.dat). Sprite ids are carved out of the given resource
+    // and the vector starts empty, since the loader resizes it to the real count anyway.
+    explicit ItemType(std::pmr::memory_resource* resource);
     virtual ~ItemType() = default;
-    ItemType(const ItemType&) = default;
+    // Attributes get copied too, so a copy never points into the bulk loading arena
+    ItemType(const ItemType& other);
     std::string name;
 
     uint16_t speed = 0;
     ItemCategory_t category = COMMON;
 
-    std::vector<uint32_t> textureIdsVector;
+    // Copies of an ItemType (e.g. unsaved edits) always go back to the default heap resource
+    std::pmr::vector<uint32_t> textureIdsVector;
     uint8_t width = 1;
     uint8_t height = 1;
     uint8_t animationsFrames = 1;
@@ -67,20 +159,38 @@ public:
     uint8_t patternY = 1;
     uint8_t patternZ = 1;
     uint8_t layers = 1;
+    uint8_t exactSize = 32; // only stored in .dat when width or height > 1
+
+    // Made by bulk loading - whatever gets reallocated here stays taken in the arena until it's released
+    [[nodiscard]] bool isArenaBacked() const {
+        return textureIdsVector.get_allocator().resource() != std::pmr::get_default_resource();
+    }
 
     void setItemTypeWidth(int width);
     void setItemTypeHeight(int height);
     void setItemTypeAnimationCount(int count);
 
+    // Sprite ids the layout takes - width * height * layers * patterns * animation frames
     [[nodiscard]] int getCalcIndexesCount() const;
+    // Index into textureIdsVector, in .dat order (frame, patternZ, patternY, patternX, layer, height, width - slowest first)
+    [[nodiscard]] size_t getSpriteIndex(int w, int h, int frame, int layer = 0, int x = 0, int y = 0, int z = 0) const {
+        return getSpriteIndex(width, height, layers, patternX, patternY, patternZ, w, h, frame, layer, x, y, z);
+    }
 
     bool operator==(const ItemType& other) const {
         return itemTypeFlags == other.itemTypeFlags &&
+               name == other.name &&
                speed == other.speed &&
                category == other.category &&
                width == other.width &&
                height == other.height &&
                animationsFrames == other.animationsFrames &&
+               patternX == other.patternX &&
+               patternY == other.patternY &&
+               patternZ == other.patternZ &&
+               layers == other.layers &&
+               exactSize == other.exactSize &&
+               sameAttributes(other) &&
                textureIdsVector == other.textureIdsVector;
     }
 
@@ -92,12 +202,23 @@ public:
     ItemType& operator=(const ItemType& other) {
         if (this != &other) { // Prevent self-assignment
             itemTypeFlags = other.itemTypeFlags;
+            name = other.name;
             speed = other.speed;
             category = other.category;
             width = other.width;
             height = other.height;
             animationsFrames = other.animationsFrames;
+            patternX = other.patternX;
+            patternY = other.patternY;
+            patternZ = other.patternZ;
+            layers = other.layers;
+            exactSize = other.exactSize;
             textureIdsVector = other.textureIdsVector;
+            if (other.attributes) {
+                setAttributes(*other.attributes);
+            } else {
+                attributes.reset();
+            }
         }
         return *this;
     }
@@ -114,16 +235,45 @@ public:
         return itemTypeFlags & flag;
     }
 
-    [[nodiscard]] const uint32_t& getAllFlags() const {
+    [[nodiscard]] const uint64_t& getAllFlags() const {
         return itemTypeFlags;
     }
-    void setAllFlags(uint32_t flags) {
+    void setAllFlags(uint64_t flags) {
         itemTypeFlags = flags;
     }
+
+    // nullptr = the item has none of the optional data
+    [[nodiscard]] const ItemTypeAttributes* getAttributes() const {
+        return attributes.get();
+    }
+    // Creates the attributes if there aren't any yet
+    ItemTypeAttributes& editAttributes();
+    // Copies values into attributes living in the same memory resource as the sprite ids
+    void setAttributes(const ItemTypeAttributes& values);
+    void clearAttributes() {
+        attributes.reset();
+    }
+    [[nodiscard]] bool sameAttributes(const ItemTypeAttributes* other) const;
+    [[nodiscard]] bool sameAttributes(const ItemType& other) const {
+        return sameAttributes(other.attributes.get());
+    }
 private:
+    static size_t getSpriteIndex(int width, int height, int layers, int patternX, int patternY, int patternZ,
+                                 int w, int h, int frame, int layer, int x, int y, int z) {
+        size_t index = static_cast<size_t>(frame);
+        index = index * patternZ + z;
+        index = index * patternY + y;
+        index = index * patternX + x;
+        index = index * layers + layer;
+        index = index * height + h;
+        return index * width + w;
+    }
+    // Lays the sprite ids out for the new size, every id stays at its cell/layer/pattern/frame if that is still there
+    void relayoutSprites(int oldWidth, int oldHeight, int oldFrames);
     void onItemTypeWidthChanged(int oldWith, int width);
     void onItemTypeHeightChanged(int oldHeight, int height);
     void onItemTypeAnimationFramesChanged(int oldAnimationCount, int animationCount);
 
-    uint32_t itemTypeFlags = 0;
+    uint64_t itemTypeFlags = 0;
+    std::shared_ptr<ItemTypeAttributes> attributes;
 };
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include "ItemType.h"
+
+// ItemType split into the fields a diff/merge looks at, as bits of a mask.
+// Everything the .dat stores of an item is in exactly one of them.
+namespace ItemTypeFields {
+    enum Field : uint32_t {
+        FLAGS      = 1u << 0,  // flags without data
+        CATEGORY   = 1u << 1,  // ground border / on bottom / on top
+        SPEED      = 1u << 2,  // ground speed
+        NAME       = 1u << 3,  // market name
+        SIZE       = 1u << 4,  // width, height, exact size
+        PATTERNS   = 1u << 5,  // layers and patterns
+        ANIMATION  = 1u << 6,  // frame count and durations
+        SPRITES    = 1u << 7,  // sprite ids
+        LIGHT      = 1u << 8,
+        OFFSET     = 1u << 9,
+        ELEVATION  = 1u << 10,
+        MINIMAP    = 1u << 11,
+        LENS_HELP  = 1u << 12,
+        CLOTH      = 1u << 13,
+        MARKET     = 1u << 14, // market data but the name
+        WRITABLE   = 1u << 15, // text lengths of writable and writable once
+        ACTION     = 1u << 16, // default action
+    };
+
+    constexpr uint32_t FIELD_COUNT = 17;
+    constexpr uint32_t ALL_FIELDS = (1u << FIELD_COUNT) - 1;
+    // Only make sense together, the sprite count follows from the rest
+    constexpr uint32_t LAYOUT = SIZE | PATTERNS | ANIMATION | SPRITES;
+    constexpr uint32_t ATTRIBUTE_FIELDS = ANIMATION | LIGHT | OFFSET | ELEVATION | MINIMAP | LENS_HELP | CLOTH |
+                                          MARKET | WRITABLE | ACTION;
+
+    // Index = bit of the field
+    inline constexpr const char* NAMES[FIELD_COUNT] = {
+        "flags", "category", "speed", "name", "size", "patterns", "animation", "sprites",
+        "light", "offset", "elevation", "minimap", "lensHelp", "cloth", "market", "writable", "defaultAction",
+    };
+
+    // Fields in which the two differ, 0 = same item
+    inline uint32_t diff(const ItemType& a, const ItemType& b) {
+        static const ItemTypeAttributes NO_ATTRIBUTES;
+        const ItemTypeAttributes& attrA = a.getAttributes() ? *a.getAttributes() : NO_ATTRIBUTES;
+        const ItemTypeAttributes& attrB = b.getAttributes() ? *b.getAttributes() : NO_ATTRIBUTES;
+
+        uint32_t fields = 0;
+        if (a.getAllFlags() != b.getAllFlags()) fields |= FLAGS;
+        if (a.category != b.category) fields |= CATEGORY;
+        if (a.speed != b.speed) fields |= SPEED;
+        if (a.name != b.name) fields |= NAME;
+        if (a.width != b.width || a.height != b.height || a.exactSize != b.exactSize) fields |= SIZE;
+        if (a.layers != b.layers || a.patternX != b.patternX || a.patternY != b.patternY || a.patternZ != b.patternZ) {
+            fields |= PATTERNS;
+        }
+        if (a.animationsFrames != b.animationsFrames || attrA.frameDurations != attrB.frameDurations) fields |= ANIMATION;
+        if (a.textureIdsVector != b.textureIdsVector) fields |= SPRITES;
+        if (attrA.lightLevel != attrB.lightLevel || attrA.lightColor != attrB.lightColor) fields |= LIGHT;
+        if (attrA.offsetX != attrB.offsetX || attrA.offsetY != attrB.offsetY) fields |= OFFSET;
+        if (attrA.elevation != attrB.elevation) fields |= ELEVATION;
+        if (attrA.minimapColor != attrB.minimapColor) fields |= MINIMAP;
+        if (attrA.lensHelp != attrB.lensHelp) fields |= LENS_HELP;
+        if (attrA.clothSlot != attrB.clothSlot) fields |= CLOTH;
+        if (attrA.marketCategory != attrB.marketCategory || attrA.marketTradeAs != attrB.marketTradeAs ||
+            attrA.marketShowAs != attrB.marketShowAs || attrA.marketRestrictVocation != attrB.marketRestrictVocation ||
+            attrA.marketRequiredLevel != attrB.marketRequiredLevel) {
+            fields |= MARKET;
+        }
+        if (attrA.writableLength != attrB.writableLength || attrA.writableOnceLength != attrB.writableOnceLength) {
+            fields |= WRITABLE;
+        }
+        if (attrA.defaultAction != attrB.defaultAction) fields |= ACTION;
+        return fields;
+    }
+
+    // Copies the given fields of 'from' into 'to', the rest of 'to' stays as it is
+    inline void copy(uint32_t fields, const ItemType& from, ItemType& to) {
+        static const ItemTypeAttributes NO_ATTRIBUTES;
+        if (fields & FLAGS) to.setAllFlags(from.getAllFlags());
+        if (fields & CATEGORY) to.category = from.category;
+        if (fields & SPEED) to.speed = from.speed;
+        if (fields & NAME) to.name = from.name;
+        if (fields & SIZE) {
+            to.width = from.width;
+            to.height = from.height;
+            to.exactSize = from.exactSize;
+        }
+        if (fields & PATTERNS) {
+            to.layers = from.layers;
+            to.patternX = from.patternX;
+            to.patternY = from.patternY;
+            to.patternZ = from.patternZ;
+        }
+        if (fields & ANIMATION) to.animationsFrames = from.animationsFrames;
+        if (fields & SPRITES) to.textureIdsVector = from.textureIdsVector;
+        if (!(fields & ATTRIBUTE_FIELDS)) {
+            return;
+        }
+
+        const ItemTypeAttributes& in = from.getAttributes() ? *from.getAttributes() : NO_ATTRIBUTES;
+        ItemTypeAttributes& out = to.editAttributes();
+        if (fields & ANIMATION) out.frameDurations = in.frameDurations;
+        if (fields & LIGHT) {
+            out.lightLevel = in.lightLevel;
+            out.lightColor = in.lightColor;
+        }
+        if (fields & OFFSET) {
+            out.offsetX = in.offsetX;
+            out.offsetY = in.offsetY;
+        }
+        if (fields & ELEVATION) out.elevation = in.elevation;
+        if (fields & MINIMAP) out.minimapColor = in.minimapColor;
+        if (fields & LENS_HELP) out.lensHelp = in.lensHelp;
+        if (fields & CLOTH) out.clothSlot = in.clothSlot;
+        if (fields & MARKET) {
+            out.marketCategory = in.marketCategory;
+            out.marketTradeAs = in.marketTradeAs;
+            out.marketShowAs = in.marketShowAs;
+            out.marketRestrictVocation = in.marketRestrictVocation;
+            out.marketRequiredLevel = in.marketRequiredLevel;
+        }
+        if (fields & WRITABLE) {
+            out.writableLength = in.writableLength;
+            out.writableOnceLength = in.writableOnceLength;
+        }
+        if (fields & ACTION) out.defaultAction = in.defaultAction;
+    }
+}
@@ -5,6 +5,7 @@
 #include <toml++/toml.h>
 #include <iostream>
 #include <cstdint>
+#include <algorithm>
 
 std::vector<std::shared_ptr<ItemType>> Items::itemTypes = std::vector<std::shared_ptr<ItemType>>();
 
@@ -46,6 +47,32 @@ bool Items::replaceItemType(uint32_t itemTypeId, std::shared_ptr<ItemType> newIt
     return false;
 }
 
+void Items::beginBulkLoad(uint32_t expectedCount, size_t expectedBytes) {
+    if (!arena) {
+        arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(expectedBytes, 4096), &arenaUpstream);
+    }
+    itemTypes.reserve(itemTypes.size() + expectedCount);
+}
+
+std::shared_ptr<ItemType> Items::makeArenaItemType() {
+    if (!arena) {
+        beginBulkLoad(0, 0);
+    }
+
+    // Both the control block and the ItemType itself land in the arena, and the control block's allocator keeps it alive
+    return std::allocate_shared<ItemType>(SharedResourceAllocator<ItemType>(arena), arena.get());
+}
+
+void Items::releaseArena() {
+    if (!itemTypes.empty()) {
+        Warninger::sendWarning(FUNC_NAME, "ItemTypes still loaded, arena won't be released.");
+        return;
+    }
+
+    // ItemTypes still held outside the store keep it alive, it goes with the last of them
+    arena.reset();
+}
+
 uint32_t Items::getItemIdByName(const std::string& name) {
     if (!name.empty()) {
         uint32_t i = 2; // skip 0 (undefined) and 1 (air/empty)
@@ -60,15 +87,17 @@ uint32_t Items::getItemIdByName(const std::string& name) {
     return 0;
 }
 
-void Items::exportItemToml(const std::string& filePath, int itemId) {    // Serialize and write to file
+void Items::exportItemToml(const std::string& filePath, int itemId) {
+    exportItemToml(filePath, itemId, *getItemType(itemId));
+}
+
+void Items::exportItemToml(const std::string& filePath, int itemId, const ItemType& itemType) {    // Serialize and write to file
     std::ofstream file(filePath);
     if (!file.is_open()) {
         Warninger::sendWarning(FUNC_NAME, "Failed to open file: " + filePath);
         return;
     }
 
-    auto itemType = *getItemType(itemId);
-
     // Create a TOML table
     toml::table itemData;
     itemData.insert("id", itemId);
@@ -101,13 +130,16 @@ void Items::exportItemToml(const std::string& filePath, int itemId) {    // Seri
 }
 
 void Items::exportItemItf(const std::string &filePath, int itemId) {
+    exportItemItf(filePath, *getItemType(itemId));
+}
+
+void Items::exportItemItf(const std::string &filePath, const ItemType& itemType) {
     std::ofstream file(filePath, std::ios::binary);
     if (!file.is_open()) {
         Warninger::sendWarning(FUNC_NAME, "Failed to open file: " + filePath);
         return;
     }
 
-    auto itemType = *getItemType(itemId);
     serializeItemType(file, itemType);
     file.close();
 }
@@ -178,7 +210,8 @@ void Items::serializeItemType(std::ostream &stream, const ItemType &itemType) {
     // Write primitive members
     stream.write(reinterpret_cast<const char*>(&itemType.category), sizeof(itemType.category));
 
-    auto flags = itemType.getAllFlags();
+    // .itf keeps 32 bit flags, attributes and flags above that are .dat only
+    auto flags = static_cast<uint32_t>(itemType.getAllFlags());
     stream.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
 
     if(itemType.hasFlag(IS_GROUND)) {
@@ -202,7 +235,7 @@ void Items::deserializeItemType(std::istream& stream, ItemType& itemType) {
     // Read primitive data members
     stream.read(reinterpret_cast<char*>(&itemType.category), sizeof(itemType.category));
 
-    auto flags = itemType.getAllFlags();
+    uint32_t flags = 0;
     stream.read(reinterpret_cast<char*>(&flags), sizeof(flags));
     itemType.setAllFlags(flags);
 
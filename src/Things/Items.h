@@ -3,9 +3,12 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <memory_resource>
 
 #include <toml++/toml.h>
 #include "ItemType.h"
+#include "../Misc/CountingResource.h"
+#include "../Misc/SharedResourceAllocator.h"
 
 class Items
 {
@@ -30,7 +33,9 @@ public:
 
     // Export Methods
     static void exportItemToml(const std::string& filePath, int itemId);
+    static void exportItemToml(const std::string& filePath, int itemId, const ItemType& itemType);
     static void exportItemItf(const std::string& filePath, int itemId);
+    static void exportItemItf(const std::string& filePath, const ItemType& itemType);
 
     static bool importItemToml(const std::string& filePath);
     static bool importItemItf(const std::string& filePath);
@@ -42,7 +47,21 @@ public:
         itemTypes.clear();
     }
 
+    // Bulk loading (.dat) - ItemTypes and their sprite ids are carved out of a few big blocks,
+    // instead of 3+ heap allocations per item. The whole arena is released in one step, once the store
+    // has let go of it (releaseArena) and the last arena ItemType held elsewhere (exports, edit copies) is gone.
+    static void beginBulkLoad(uint32_t expectedCount, size_t expectedBytes);
+    static std::shared_ptr<ItemType> makeArenaItemType();
+    static void releaseArena();
+    // What the store takes up - the arena's blocks plus the store's slots (ItemTypes made outside the arena aren't counted)
+    static size_t getStoreBytes() {
+        return arenaUpstream.getAllocatedBytes() + itemTypes.capacity() * sizeof(std::shared_ptr<ItemType>);
+    }
+
     static inline std::shared_ptr<ItemType> dollItemType = std::make_shared<ItemType>();
 private:
     static std::vector<std::shared_ptr<ItemType>> itemTypes;
+    // Declared before the arena, so it outlives it
+    static inline CountingResource arenaUpstream;
+    static inline std::shared_ptr<std::pmr::monotonic_buffer_resource> arena;
 };
\ No newline at end of file
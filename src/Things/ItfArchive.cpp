@@ -0,0 +1,363 @@
+#include "ItfArchive.h"
+#include <algorithm>
+#include <fstream>
+#include "../Helper/AtomicFileWriter.h"
+#include "../Misc/Hash.h"
+#include "../Misc/SpriteCodec.h"
+
+namespace ItfArchive {
+    void writeAttributes(BinaryWriter& writer, const ItemTypeAttributes& attributes) {
+        const uint16_t values[] = {
+                attributes.writableLength, attributes.writableOnceLength, attributes.lightLevel, attributes.lightColor,
+                attributes.offsetX, attributes.offsetY, attributes.elevation, attributes.minimapColor,
+                attributes.lensHelp, attributes.clothSlot, attributes.defaultAction,
+                attributes.marketCategory, attributes.marketTradeAs, attributes.marketShowAs,
+                attributes.marketRestrictVocation, attributes.marketRequiredLevel,
+        };
+        for (uint16_t value : values) {
+            writer.writeU16(value);
+        }
+        writer.writeU16(static_cast<uint16_t>(attributes.frameDurations.size()));
+        writer.writeBytes(attributes.frameDurations.data(), attributes.frameDurations.size());
+    }
+
+    bool readAttributes(BinaryReader& reader, ItemTypeAttributes& attributes) {
+        uint16_t* values[] = {
+                &attributes.writableLength, &attributes.writableOnceLength, &attributes.lightLevel, &attributes.lightColor,
+                &attributes.offsetX, &attributes.offsetY, &attributes.elevation, &attributes.minimapColor,
+                &attributes.lensHelp, &attributes.clothSlot, &attributes.defaultAction,
+                &attributes.marketCategory, &attributes.marketTradeAs, &attributes.marketShowAs,
+                &attributes.marketRestrictVocation, &attributes.marketRequiredLevel,
+        };
+        for (uint16_t* value : values) {
+            *value = reader.readU16();
+        }
+        uint16_t durationsSize = reader.readU16();
+        if (durationsSize > reader.remaining()) {
+            return false;
+        }
+        attributes.frameDurations.assign(reader.current(), reader.current() + durationsSize);
+        reader.skip(durationsSize);
+        return !reader.overflowed();
+    }
+
+    void writeItemRecord(BinaryWriter& writer, const ItemType& itemType) {
+        writer.writeU8(static_cast<uint8_t>(itemType.category));
+        writer.write<uint64_t>(itemType.getAllFlags());
+        writer.writeU16(itemType.speed);
+
+        size_t nameLength = std::min<size_t>(itemType.name.size(), 0xFFFF);
+        writer.writeU16(static_cast<uint16_t>(nameLength));
+        writer.writeBytes(reinterpret_cast<const uint8_t*>(itemType.name.data()), nameLength);
+
+        writer.writeU8(itemType.width);
+        writer.writeU8(itemType.height);
+        writer.writeU8(itemType.animationsFrames);
+        writer.writeU8(itemType.patternX);
+        writer.writeU8(itemType.patternY);
+        writer.writeU8(itemType.patternZ);
+        writer.writeU8(itemType.layers);
+        writer.writeU8(itemType.exactSize);
+
+        writer.writeU32(static_cast<uint32_t>(itemType.textureIdsVector.size()));
+        for (uint32_t id : itemType.textureIdsVector) {
+            writer.writeU32(id);
+        }
+
+        const ItemTypeAttributes* attributes = itemType.getAttributes();
+        writer.writeU8(attributes ? 1 : 0);
+        if (!attributes) {
+            return;
+        }
+        writeAttributes(writer, *attributes);
+    }
+
+    bool readItemRecord(BinaryReader& reader, ItemType& itemType) {
+        uint8_t category = reader.readU8();
+        itemType.category = category <= TOP ? static_cast<ItemCategory_t>(category) : COMMON;
+        itemType.setAllFlags(reader.read<uint64_t>());
+        itemType.speed = reader.readU16();
+        itemType.name = reader.readString(reader.readU16());
+
+        itemType.width = reader.readU8();
+        itemType.height = reader.readU8();
+        itemType.animationsFrames = reader.readU8();
+        itemType.patternX = reader.readU8();
+        itemType.patternY = reader.readU8();
+        itemType.patternZ = reader.readU8();
+        itemType.layers = reader.readU8();
+        itemType.exactSize = reader.readU8();
+
+        uint32_t textureCount = reader.readU32();
+        if (static_cast<size_t>(textureCount) * 4 > reader.remaining()) {
+            return false;
+        }
+        itemType.textureIdsVector.resize(textureCount);
+        for (uint32_t i = 0; i < textureCount; ++i) {
+            itemType.textureIdsVector[i] = reader.readU32();
+        }
+
+        if (reader.readU8() == 0) {
+            itemType.clearAttributes();
+            return !reader.overflowed();
+        }
+
+        ItemTypeAttributes attributes;
+        if (!readAttributes(reader, attributes)) {
+            return false;
+        }
+        itemType.setAttributes(attributes);
+        return !reader.overflowed();
+    }
+
+    namespace {
+        struct IndexEntry {
+            uint32_t id;
+            uint64_t offset;
+            uint32_t size;
+        };
+
+        void writeIndexEntry(BinaryWriter& writer, const IndexEntry& entry) {
+            writer.writeU32(entry.id);
+            writer.write<uint64_t>(entry.offset);
+            writer.writeU32(entry.size);
+        }
+    }
+
+    bool write(const std::string& path, const std::vector<std::pair<uint32_t, std::shared_ptr<ItemType>>>& items,
+               uint32_t spriteDimension, const SpritePixelsGetter& getPixels) {
+        const bool withSprites = spriteDimension != 0 && getPixels;
+        AtomicFileWriter file(path);
+        if (!file.isOpen()) {
+            return false;
+        }
+
+        std::vector<uint8_t> buffer;
+        BinaryWriter writer(buffer);
+        writer.writeU32(MAGIC);
+        writer.writeU16(VERSION);
+        writer.writeU16(withSprites ? FLAG_SPRITES : 0);
+        writer.writeU32(withSprites ? spriteDimension : 0);
+        file.write(buffer.data(), buffer.size());
+
+        // Items sorted by id, so the index can be binary searched
+        std::vector<std::pair<uint32_t, const ItemType*>> sorted;
+        for (const auto& [id, itemType] : items) {
+            if (itemType) {
+                sorted.emplace_back(id, itemType.get());
+            }
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first == b.first; }),
+                     sorted.end());
+
+        std::vector<IndexEntry> itemEntries;
+        std::vector<uint32_t> spriteIds;
+        for (const auto& [id, itemType] : sorted) {
+            buffer.clear();
+            writeItemRecord(writer, *itemType);
+            itemEntries.push_back({id, file.getWrittenSize(), static_cast<uint32_t>(buffer.size())});
+            file.write(buffer.data(), buffer.size());
+
+            if (withSprites) {
+                for (uint32_t spriteId : itemType->textureIdsVector) {
+                    if (spriteId != 0) {
+                        spriteIds.push_back(spriteId);
+                    }
+                }
+            }
+        }
+
+        // Each sprite once, no matter how many items use it
+        std::sort(spriteIds.begin(), spriteIds.end());
+        spriteIds.erase(std::unique(spriteIds.begin(), spriteIds.end()), spriteIds.end());
+
+        std::vector<IndexEntry> spriteEntries;
+        if (withSprites) {
+            bool knownDimension = SpriteCodec::withCodec(true, spriteDimension, [&](auto codec) {
+                using Codec = decltype(codec);
+                std::vector<uint8_t> rgba;
+                for (uint32_t spriteId : spriteIds) {
+                    rgba.clear();
+                    if (!getPixels(spriteId, rgba) || rgba.size() != Codec::RGBA_SIZE) {
+                        continue; // items keep the id, there just won't be pixels for it
+                    }
+                    buffer.clear();
+                    Codec::encode(rgba.data(), buffer);
+                    spriteEntries.push_back({spriteId, file.getWrittenSize(), static_cast<uint32_t>(buffer.size())});
+                    file.write(buffer.data(), buffer.size());
+                }
+            });
+            if (!knownDimension) {
+                file.abort();
+                return false;
+            }
+        }
+
+        buffer.clear();
+        for (const auto& entry : itemEntries) {
+            writeIndexEntry(writer, entry);
+        }
+        for (const auto& entry : spriteEntries) {
+            writeIndexEntry(writer, entry);
+        }
+        uint64_t indexOffset = file.getWrittenSize();
+        uint32_t indexCrc = Hash::crc32(buffer.data(), buffer.size());
+
+        writer.write<uint64_t>(indexOffset);
+        writer.writeU32(static_cast<uint32_t>(itemEntries.size()));
+        writer.writeU32(static_cast<uint32_t>(spriteEntries.size()));
+        writer.writeU32(indexCrc);
+        writer.writeU32(FOOTER_MAGIC);
+        file.write(buffer.data(), buffer.size());
+
+        return file.good() && file.commit();
+    }
+
+    bool isArchive(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        uint32_t magic = 0;
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        return file && magic == MAGIC;
+    }
+
+    bool Reader::open(const std::string& path) {
+        close();
+        if (!file.open(path)) {
+            error = "Can't open " + path;
+            return false;
+        }
+
+        if (file.size() < HEADER_SIZE + FOOTER_SIZE) {
+            error = "File is too small to be an archive";
+            close();
+            return false;
+        }
+
+        BinaryReader header(file.data(), HEADER_SIZE);
+        uint32_t magic = header.readU32();
+        version = header.readU16();
+        uint16_t flags = header.readU16();
+        spriteDimension = header.readU32();
+        if (magic != MAGIC) {
+            error = "Not an .itf archive";
+            close();
+            return false;
+        }
+        if (version > VERSION) {
+            error = "Archive version " + std::to_string(version) + " is newer than supported " + std::to_string(VERSION);
+            close();
+            return false;
+        }
+        if (!(flags & FLAG_SPRITES)) {
+            spriteDimension = 0;
+        }
+
+        BinaryReader footer(file.data() + file.size() - FOOTER_SIZE, FOOTER_SIZE);
+        uint64_t indexOffset = footer.read<uint64_t>();
+        itemCount = footer.readU32();
+        spriteCount = footer.readU32();
+        uint32_t indexCrc = footer.readU32();
+        uint32_t footerMagic = footer.readU32();
+
+        // Index sits right before the footer, checked without adding anything the footer says (could wrap)
+        const uint64_t indexEnd = file.size() - FOOTER_SIZE;
+        uint64_t indexSize = (static_cast<uint64_t>(itemCount) + spriteCount) * INDEX_ENTRY_SIZE;
+        if (footerMagic != FOOTER_MAGIC || indexOffset < HEADER_SIZE || indexOffset > indexEnd ||
+            indexSize != indexEnd - indexOffset) {
+            error = "Archive index is broken (file incomplete?)";
+            close();
+            return false;
+        }
+
+        index = file.data() + indexOffset;
+        if (Hash::crc32(index, static_cast<size_t>(indexSize)) != indexCrc) {
+            error = "Archive index checksum mismatch";
+            close();
+            return false;
+        }
+        error.clear();
+        return true;
+    }
+
+    void Reader::close() {
+        file.close();
+        index = nullptr;
+        version = 0;
+        spriteDimension = 0;
+        itemCount = 0;
+        spriteCount = 0;
+    }
+
+    Reader::Entry Reader::getEntry(size_t position) const {
+        BinaryReader reader(index + position * INDEX_ENTRY_SIZE, INDEX_ENTRY_SIZE);
+        Entry entry{};
+        entry.id = reader.readU32();
+        entry.offset = reader.read<uint64_t>();
+        entry.size = reader.readU32();
+        return entry;
+    }
+
+    bool Reader::findEntry(size_t first, size_t count, uint32_t id, Entry& entry) const {
+        size_t low = first;
+        size_t high = first + count;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            Entry candidate = getEntry(middle);
+            if (candidate.id < id) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low >= first + count) {
+            return false;
+        }
+
+        entry = getEntry(low);
+        // Record has to be somewhere between the header and the index
+        return entry.id == id && entry.offset >= HEADER_SIZE &&
+               entry.offset + entry.size <= static_cast<uint64_t>(index - file.data());
+    }
+
+    std::vector<uint32_t> Reader::getItemIds() const {
+        std::vector<uint32_t> ids;
+        ids.reserve(itemCount);
+        for (size_t i = 0; i < itemCount; ++i) {
+            ids.push_back(getEntry(i).id);
+        }
+        return ids;
+    }
+
+    std::vector<uint32_t> Reader::getSpriteIds() const {
+        std::vector<uint32_t> ids;
+        ids.reserve(spriteCount);
+        for (size_t i = 0; i < spriteCount; ++i) {
+            ids.push_back(getEntry(itemCount + i).id);
+        }
+        return ids;
+    }
+
+    bool Reader::readItem(uint32_t id, ItemType& itemType) const {
+        Entry entry{};
+        if (!isOpen() || !findEntry(0, itemCount, id, entry)) {
+            return false;
+        }
+
+        BinaryReader reader(file.data() + entry.offset, entry.size);
+        return readItemRecord(reader, itemType);
+    }
+
+    bool Reader::readSprite(uint32_t id, std::vector<uint8_t>& rgba) const {
+        Entry entry{};
+        if (!isOpen() || !hasSprites() || !findEntry(itemCount, spriteCount, id, entry)) {
+            return false;
+        }
+
+        return SpriteCodec::withCodec(true, spriteDimension, [&](auto codec) {
+            using Codec = decltype(codec);
+            rgba.resize(Codec::RGBA_SIZE);
+            Codec::decode(file.data() + entry.offset, entry.size, rgba.data());
+        });
+    }
+}
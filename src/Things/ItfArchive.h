@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ItemType.h"
+#include "../Helper/MappedFile.h"
+#include "../Misc/BinaryReader.h"
+#include "../Misc/BinaryWriter.h"
+
+/**
+ * Many ItemTypes in one .itf, optionally with the pixels of their sprites.
+ *
+ * Layout (little-endian):
+ *   header   - magic "ITFA", u16 version, u16 flags, u32 sprite dimension (0 = no sprites)
+ *   records  - items, then sprites (RLE with alpha, same codec as .spr), back to back
+ *   index    - {u32 id, u64 offset, u32 size} per item, then per sprite, both sorted by id
+ *   footer   - u64 index offset, u32 item count, u32 sprite count, u32 CRC32 of the index, magic "ITFI"
+ *
+ * The footer sits at a fixed distance from the end, so a reader maps the file, reads the index
+ * and can then get any single item without touching the others.
+ * Old single item .itf files start with the category (a small number), never with the magic.
+ */
+namespace ItfArchive {
+    constexpr uint32_t MAGIC = 0x41465449;        // "ITFA"
+    constexpr uint32_t FOOTER_MAGIC = 0x49465449; // "ITFI"
+    constexpr uint16_t VERSION = 1;
+    constexpr uint16_t FLAG_SPRITES = 1 << 0;
+
+    constexpr size_t HEADER_SIZE = 12;
+    constexpr size_t INDEX_ENTRY_SIZE = 16;
+    constexpr size_t FOOTER_SIZE = 24;
+
+    // Gives RGBA (dimension^2 * 4) of a sprite, false if there's no such sprite
+    using SpritePixelsGetter = std::function<bool(uint32_t spriteId, std::vector<uint8_t>& rgba)>;
+
+    // Payloads of the attribute flags, also used by SessionSnapshot
+    void writeAttributes(BinaryWriter& writer, const ItemTypeAttributes& attributes);
+    bool readAttributes(BinaryReader& reader, ItemTypeAttributes& attributes);
+
+    // Full ItemType, attributes included (unlike the old single item .itf)
+    void writeItemRecord(BinaryWriter& writer, const ItemType& itemType);
+    bool readItemRecord(BinaryReader& reader, ItemType& itemType);
+
+    /**
+     * @brief Writes the archive (through AtomicFileWriter, target is either old or complete)
+     *
+     * @param items id -> ItemType, nullptr entries are skipped
+     * @param getPixels Without it (or spriteDimension 0) no sprites are embedded.
+     * @return False if it couldn't be written, target stays untouched then.
+     */
+    bool write(const std::string& path, const std::vector<std::pair<uint32_t, std::shared_ptr<ItemType>>>& items,
+               uint32_t spriteDimension, const SpritePixelsGetter& getPixels);
+
+    // True if the file starts with the archive magic
+    bool isArchive(const std::string& path);
+
+    // Random access to an archive through a memory map
+    class Reader {
+    public:
+        // False (with a message in getError()) if it isn't a valid archive
+        bool open(const std::string& path);
+        void close();
+
+        [[nodiscard]] bool isOpen() const { return file.isOpen(); }
+        [[nodiscard]] const std::string& getError() const { return error; }
+        [[nodiscard]] uint16_t getVersion() const { return version; }
+        [[nodiscard]] bool hasSprites() const { return spriteDimension != 0; }
+        [[nodiscard]] uint32_t getSpriteDimension() const { return spriteDimension; }
+
+        [[nodiscard]] uint32_t getItemCount() const { return itemCount; }
+        [[nodiscard]] uint32_t getSpriteCount() const { return spriteCount; }
+        // Ids in ascending order
+        [[nodiscard]] std::vector<uint32_t> getItemIds() const;
+        [[nodiscard]] std::vector<uint32_t> getSpriteIds() const;
+
+        // Parses only the record of that item
+        bool readItem(uint32_t id, ItemType& itemType) const;
+        // RGBA of getSpriteDimension()^2 * 4 bytes
+        bool readSprite(uint32_t id, std::vector<uint8_t>& rgba) const;
+    private:
+        struct Entry {
+            uint32_t id;
+            uint64_t offset;
+            uint32_t size;
+        };
+        [[nodiscard]] Entry getEntry(size_t index) const;
+        // Binary search in [first, first + count) of the index
+        bool findEntry(size_t first, size_t count, uint32_t id, Entry& entry) const;
+
+        MappedFile file;
+        std::string error;
+        uint16_t version = 0;
+        uint32_t spriteDimension = 0;
+        uint32_t itemCount = 0;
+        uint32_t spriteCount = 0;
+        const uint8_t* index = nullptr;
+    };
+}
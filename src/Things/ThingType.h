@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+enum ThingCategory_t : uint8_t {
+    THING_ITEM = 0,
+    THING_OUTFIT = 1,
+    THING_EFFECT = 2,
+    THING_MISSILE = 3,
+    THING_CATEGORY_COUNT
+};
+
+enum FrameGroupType_t : uint8_t {
+    FRAME_GROUP_IDLE = 0,
+    FRAME_GROUP_MOVING = 1,
+};
+
+// Sprites layout of one frame group. Only outfits can have more than one (idle + moving).
+// Plain data, the variable-length parts live in ThingType's vectors.
+struct FrameGroup {
+    uint8_t type = FRAME_GROUP_IDLE;
+    uint8_t width = 1;
+    uint8_t height = 1;
+    uint8_t exactSize = 32; // only stored in .dat when width or height > 1
+    uint8_t layers = 1;
+    uint8_t patternX = 1;
+    uint8_t patternY = 1;
+    uint8_t patternZ = 1;
+    uint8_t animationsFrames = 1;
+
+    uint32_t firstTextureId = 0;  // index into ThingType::textureIds
+    uint32_t animationOffset = 0; // index into ThingType::animationData
+    uint16_t animationSize = 0;   // 0 = no frame durations
+
+    [[nodiscard]] uint32_t getTextureCount() const {
+        return static_cast<uint32_t>(width) * height * layers * patternX * patternY * patternZ * animationsFrames;
+    }
+};
+
+// Outfit, effect or missile from .dat.
+// These aren't edited (yet), so flags are kept as the raw bytes they were read from,
+// which lets compile write them back exactly as they were.
+class ThingType {
+public:
+    explicit ThingType(std::pmr::memory_resource* resource)
+            : flagData(resource), frameGroups(resource), textureIds(resource), animationData(resource) {}
+
+    uint16_t id = 0;
+
+    std::pmr::vector<uint8_t> flagData; // flags with their payloads, without the closing LAST_FLAG
+    std::pmr::vector<FrameGroup> frameGroups;
+    std::pmr::vector<uint32_t> textureIds;
+    std::pmr::vector<uint8_t> animationData; // frame durations as they are in .dat, per group
+};
@@ -0,0 +1,38 @@
+#include "ThingTypes.h"
+#include <algorithm>
+
+void ThingTypes::beginBulkLoad(size_t expectedBytes) {
+    if (!arena) {
+        arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(expectedBytes, 4096));
+    }
+}
+
+std::shared_ptr<ThingType> ThingTypes::makeArenaThingType() {
+    if (!arena) {
+        beginBulkLoad(0);
+    }
+
+    // Like ItemTypes, the control block's allocator keeps the arena alive
+    return std::allocate_shared<ThingType>(SharedResourceAllocator<ThingType>(arena), arena.get());
+}
+
+void ThingTypes::pushThingType(ThingCategory_t category, std::shared_ptr<ThingType> thingType) {
+    stores.at(category).push_back(std::move(thingType));
+}
+
+std::shared_ptr<ThingType> ThingTypes::getThingType(ThingCategory_t category, uint32_t index) {
+    const auto& store = stores.at(category);
+    if (index >= store.size()) {
+        return nullptr;
+    }
+    return store[index];
+}
+
+void ThingTypes::clear() {
+    // Goes with the last ThingType, a cancelled load may still hold some
+    for (auto& store : stores) {
+        store.clear();
+        store.shrink_to_fit();
+    }
+    arena.reset();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include "ThingType.h"
+#include "../Misc/SharedResourceAllocator.h"
+
+// Stores of outfits, effects and missiles, one per category (items have their own, in Items).
+// Filled in bulk by the .dat loader, everything is carved out of one arena like ItemTypes are.
+class ThingTypes {
+public:
+    static void beginBulkLoad(size_t expectedBytes);
+    static std::shared_ptr<ThingType> makeArenaThingType();
+    static void pushThingType(ThingCategory_t category, std::shared_ptr<ThingType> thingType);
+
+    static const std::vector<std::shared_ptr<ThingType>>& getThingTypes(ThingCategory_t category) {
+        return stores.at(category);
+    }
+    static uint32_t getThingTypesCount(ThingCategory_t category) {
+        return static_cast<uint32_t>(stores.at(category).size());
+    }
+    static std::shared_ptr<ThingType> getThingType(ThingCategory_t category, uint32_t index);
+
+    // Clears every store and lets go of the arena, ThingTypes still held elsewhere (jobs) keep it until they're gone
+    static void clear();
+private:
+    static inline std::array<std::vector<std::shared_ptr<ThingType>>, THING_CATEGORY_COUNT> stores;
+    static inline std::shared_ptr<std::pmr::monotonic_buffer_resource> arena;
+};
@@ -9,12 +9,22 @@
 #include "Helper/SavedData.h"
 #include "Misc/definitions.h"
 #include "Helper/DropManager.h"
+#include "Helper/JobSystem.h"
+#include "Helper/TextureUploader.h"
+#include "Helper/PerformanceHud.h"
+#include "Helper/AssetDiffWindow.h"
+#include "Helper/CommandLine.h"
 
 void displayExitConfirmation(sf::RenderWindow& window, bool& showExitConfirmation, bool unsavedChanges, AssetsManager* am);
 void pasteFromClipboard(AssetsManager* am, SpritesScrollableWindow* spritesWindow, ItemsScrollableWindow* itemsWindow);
 void copyToClipboard(AssetsManager* am, SpritesScrollableWindow* spritesWindow, ItemsScrollableWindow* itemsWindow);
 
-int main() {
+int main(int argc, char** argv) {
+    // Headless commands (e.g. --diff) don't open any window
+    if (CommandLine::hasCommand(argc, argv)) {
+        return CommandLine::run(argc, argv);
+    }
+
     HRESULT hr = OleInitialize(NULL);
 
     // Create a single application window
@@ -35,9 +45,13 @@ int main() {
 
     // initialize assets manager
     auto assetsManager = new AssetsManager(guiHelper);
+    // Last session comes back from its snapshot, if the .spr/.dat didn't change since
+    assetsManager->restoreLastSession();
     // Create an instance of the SpritesScrollableWindow
     SpritesScrollableWindow spritesScrollableWindow(window, assetsManager);
     ItemsScrollableWindow itemsScrollableWindow(window, assetsManager);
+    PerformanceHud performanceHud(assetsManager);
+    AssetDiffWindow assetDiffWindow(assetsManager);
 
     // Add drop manager to panels
     spritesScrollableWindow.setDropManager(&dropManager);
@@ -65,6 +79,22 @@ int main() {
                     continue;
                 }
 
+                // F3 (Performance window), doesn't touch the assets so it works during loading/compiling too
+                if (keyEvent->code == sf::Keyboard::Key::F3) {
+                    performanceHud.toggle();
+                    continue;
+                }
+                // F4 (Compare Assets), only reads files
+                if (keyEvent->code == sf::Keyboard::Key::F4) {
+                    assetDiffWindow.toggle();
+                    continue;
+                }
+
+                // Nothing may change the assets while they are being loaded/compiled
+                if (assetsManager->isBusy()) {
+                    continue;
+                }
+
                 // Hotkey logic: Ctrl+C (Copy); Ctrl+V (Paste)
                 if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LControl) && keyEvent->scancode == sf::Keyboard::Scan::V) {
                     pasteFromClipboard(assetsManager, &spritesScrollableWindow, &itemsScrollableWindow);
@@ -72,11 +102,27 @@ int main() {
                 else if(sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LControl) && keyEvent->scancode == sf::Keyboard::Scan::C) {
                     copyToClipboard(assetsManager, &spritesScrollableWindow, &itemsScrollableWindow);
                 }
+                // Ctrl+Z (Undo); Ctrl+Y (Redo)
+                else if(sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LControl) && keyEvent->scancode == sf::Keyboard::Scan::Z) {
+                    assetsManager->undo();
+                }
+                else if(sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LControl) && keyEvent->scancode == sf::Keyboard::Scan::Y) {
+                    assetsManager->redo();
+                }
             }
         }
 
         // Update ImGui-SFML
-        ImGui::SFML::Update(window, deltaClock.restart());
+        sf::Time frameTime = deltaClock.restart();
+        ImGui::SFML::Update(window, frameTime);
+
+        // Finished jobs report back and UI thread jobs get their slice of the frame,
+        // then queued textures get uploaded with whatever is left of the frame's upload budget
+        TextureUploader::getInstance()->beginFrame();
+        JobSystem::getInstance()->update();
+        TextureUploader::getInstance()->drain();
+        // Before anything gets drawn, so nothing that's in this frame's draw lists gets dropped
+        assetsManager->enforceMemoryBudgets();
 
         // For showing demo window
         //ImGui::ShowDemoWindow();
@@ -121,12 +167,17 @@ int main() {
 
         ImGui::End();
 
+        performanceHud.draw();
+        assetDiffWindow.draw();
+
         // Clear the SFML window
         window.clear();
 
         displayExitConfirmation(window, showExitConfirmation, assetsManager->isCompilable(), assetsManager);
         // Render ImGui on top of the existing SFML content
         ImGui::SFML::Render(window);
+        // Draw data of the frame is only there until the next Update
+        performanceHud.sample(frameTime);
         window.display(); // Display everything in the SFML window
     }
 
@@ -135,6 +186,7 @@ int main() {
 
     delete assetsManager;
     delete guiHelper;
+    JobSystem::getInstance()->shutdown();
 
     ImGui::SFML::Shutdown();
 
@@ -185,7 +237,7 @@ void pasteFromClipboard(AssetsManager* am, SpritesScrollableWindow* spritesWindo
     if(selectedCategory == CATEGORY_SPRITES && IsClipboardFormatAvailable(CF_BITMAP)) {
         auto pastedTexture = std::make_shared<sf::Texture>();
         if (Tools::pasteTextureFromClipboard(pastedTexture)) {
-            auto spriteMaxSize = ConfigManager::getInstance()->getSpriteMaxSize();
+            auto spriteMaxSize = am->getSpriteSize();
             if (pastedTexture->getSize().x != spriteMaxSize ||
                 pastedTexture->getSize().y != spriteMaxSize)
             {